@@ -37,6 +37,10 @@ inline void AtomicAnd(volatile u32& target, u32 value) {
     __sync_and_and_fetch(&target, value);
 }
 
+inline void AtomicFence() {
+    __sync_synchronize();
+}
+
 inline void AtomicDecrement(volatile u32& target) {
     __sync_add_and_fetch(&target, -1);
 }
@@ -59,6 +63,14 @@ inline void AtomicOr(volatile u32& target, u32 value) {
     __sync_or_and_fetch(&target, value);
 }
 
+inline void AtomicOr(volatile u8& target, u8 value) {
+    __sync_or_and_fetch(&target, value);
+}
+
+inline u8 AtomicExchange(volatile u8& target, u8 value) {
+    return __sync_lock_test_and_set(&target, value);
+}
+
 inline void AtomicStore(volatile u32& dest, u32 value) {
     dest = value;
 }
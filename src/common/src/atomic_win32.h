@@ -41,6 +41,10 @@ inline void AtomicAnd(volatile u32& target, u32 value) {
     _InterlockedAnd((volatile LONG*)&target, (LONG)value);
 }
 
+inline void AtomicFence() {
+    MemoryBarrier();
+}
+
 inline void AtomicIncrement(volatile u32& target) {
     InterlockedIncrement((volatile LONG*)&target);
 }
@@ -63,6 +67,14 @@ inline void AtomicOr(volatile u32& target, u32 value) {
     _InterlockedOr((volatile LONG*)&target, (LONG)value);
 }
 
+inline void AtomicOr(volatile u8& target, u8 value) {
+    _InterlockedOr8((volatile char*)&target, (char)value);
+}
+
+inline u8 AtomicExchange(volatile u8& target, u8 value) {
+    return (u8)_InterlockedExchange8((volatile char*)&target, (char)value);
+}
+
 inline void AtomicStore(volatile u32& dest, u32 value) {
     dest = value;
 }
@@ -40,6 +40,8 @@ Config::Config() {
     default_renderer_config.enable_textures = true;
     default_renderer_config.anti_aliasing_mode = 0;
     default_renderer_config.anistropic_filtering_mode = 0;
+    default_renderer_config.texture_cache_size = 0;
+    default_renderer_config.enable_texture_full_hash = false;
 
     default_res.width = 640;
     default_res.height = 480;
@@ -47,6 +49,7 @@ Config::Config() {
     set_program_dir("", MAX_PATH);
     set_enable_multicore(true);
     set_enable_idle_skipping(false);
+    set_enable_fastmem(true);
     set_enable_hle(true);
     set_enable_auto_boot(true);
     set_enable_cheats(false);
@@ -103,6 +103,7 @@ public:
         CPU_NULL = 0,       ///< No CPU core
         CPU_INTERPRETER,    ///< Interpreter CPU core
         CPU_DYNAREC,        ///< Dynamic recompiler CPU core
+        CPU_INTERPRETER_THREADED,   ///< Threaded-code (computed goto) interpreter CPU core
         NUMBER_OF_CPU_CONFIGS
     };
 
@@ -114,6 +115,8 @@ public:
         bool enable_textures;
         int anti_aliasing_mode;
         int anistropic_filtering_mode;
+        int texture_cache_size;     ///< Texture memory budget in MB, 0 for the default
+        bool enable_texture_full_hash;  ///< Hash all of a written texture, not just samples
     } ;
 
     /// Struct used for configuring a screen resolution
@@ -130,7 +133,7 @@ public:
         RENDERER_DIRECTX9,      ///< DirectX9 core (not implemented)
         RENDERER_DIRECTX10,     ///< DirectX10 core (not implemented)
         RENDERER_DIRECTX11,     ///< DirectX11 core (not implemented)
-        RENDERER_SOFTWARE,      ///< Software  core (not implemented)
+        RENDERER_SOFTWARE,      ///< Software core
         RENDERER_HARDWARE,      ///< Hardware core (not implemented- this would be a driver)
         NUMBER_OF_VIDEO_CONFIGS
     };
@@ -140,11 +143,13 @@ public:
 
     bool enable_multicore() { return enable_multicore_; }
     bool enable_idle_skipping() {return enable_idle_skipping_; }
+    bool enable_fastmem() { return enable_fastmem_; }
     bool enable_hle() { return enable_hle_; }
     bool enable_auto_boot() { return enable_auto_boot_; }
     bool enable_cheats() { return enable_cheats_; }
     void set_enable_multicore(bool val) { enable_multicore_ = val; }
     void set_enable_idle_skipping(bool val) {enable_idle_skipping_ = val; }
+    void set_enable_fastmem(bool val) { enable_fastmem_ = val; }
     void set_enable_hle(bool val) { enable_hle_ = val; }
     void set_enable_auto_boot(bool val) { enable_auto_boot_ = val; }
     void set_enable_cheats(bool val) { enable_cheats_ = val; }
@@ -207,7 +212,9 @@ public:
      * @return Corresponding RenderType
      */
     static inline RendererType StringToRenderType(const char* renderer_str) {
-        if (E_OK == _stricmp(renderer_str, "opengl2")) {
+        if (E_OK == _stricmp(renderer_str, "null")) {
+            return RENDERER_NULL;
+        } else if (E_OK == _stricmp(renderer_str, "opengl2")) {
             return RENDERER_OPENGL_2;
         } else if (E_OK == _stricmp(renderer_str, "opengl3")) {
             return RENDERER_OPENGL_3;
@@ -263,6 +270,8 @@ public:
             return "interpreter";
         case CPU_DYNAREC:
             return "dynarec";
+        case CPU_INTERPRETER_THREADED:
+            return "threaded";
         }
         return "null";
     }
@@ -272,6 +281,7 @@ private:
 
     bool enable_multicore_;
     bool enable_idle_skipping_;
+    bool enable_fastmem_;
     bool enable_hle_;
     bool enable_auto_boot_;
     bool enable_cheats_;
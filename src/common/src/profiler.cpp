@@ -0,0 +1,75 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    profiler.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Lightweight per-subsystem timing, used by the benchmark mode
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include "SDL.h"
+
+#include "common.h"
+#include "profiler.h"
+
+namespace common {
+
+namespace profiler {
+
+bool g_enabled = false;
+u64  g_section_ticks[kSection_NumberOf];
+u64  g_section_calls[kSection_NumberOf];
+
+/// Enable or disable the timers
+void SetEnabled(bool enabled) {
+    if (enabled && !g_enabled) {
+        Reset();
+    }
+    g_enabled = enabled;
+}
+
+/// Reset all section counts
+void Reset() {
+    memset(g_section_ticks, 0, sizeof(g_section_ticks));
+    memset(g_section_calls, 0, sizeof(g_section_calls));
+}
+
+/// Returns the host high resolution counter
+u64 GetTicks() {
+    return SDL_GetPerformanceCounter();
+}
+
+/// Converts host ticks to seconds
+f64 TicksToSeconds(u64 ticks) {
+    return (f64)ticks / (f64)SDL_GetPerformanceFrequency();
+}
+
+/// Returns a printable name of a section
+const char* SectionName(Section section) {
+    static const char* names[kSection_NumberOf] = {
+        "CPU",
+        "GP decode",
+        "texture decode",
+        "HLE"
+    };
+    return names[section];
+}
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,88 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    profiler.h
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Lightweight per-subsystem timing, used by the benchmark mode
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef COMMON_PROFILER_H_
+#define COMMON_PROFILER_H_
+
+#include "common.h"
+
+namespace common {
+
+namespace profiler {
+
+/**
+ * Timed subsystems. Times are inclusive: HLE runs inside the CPU section, texture decode inside
+ * GP decode, and GP decode inside the CPU section too when the GP isn't on its own thread.
+ */
+enum Section {
+    kSection_CPU = 0,           ///< Guest code execution
+    kSection_GPDecode,          ///< GP FIFO command decode
+    kSection_TextureDecode,     ///< Texture decode to RGBA8
+    kSection_HLE,               ///< HLE'd guest functions
+    kSection_NumberOf
+};
+
+extern bool g_enabled;                          ///< Timers only run while this is set
+extern u64  g_section_ticks[kSection_NumberOf]; ///< Host ticks spent in each section
+extern u64  g_section_calls[kSection_NumberOf]; ///< Number of times each section was entered
+
+/// Enable or disable the timers, counts are reset when enabling
+void SetEnabled(bool enabled);
+
+/// Reset all section counts
+void Reset();
+
+/// Returns the host high resolution counter
+u64 GetTicks();
+
+/// Converts host ticks to seconds
+f64 TicksToSeconds(u64 ticks);
+
+/// Returns a printable name of a section
+const char* SectionName(Section section);
+
+/// Adds the time until it goes out of scope to a section, does nothing while disabled
+class ScopedTimer {
+public:
+    ScopedTimer(Section section) : section_(section), start_(g_enabled ? GetTicks() : 0) {
+    }
+    ~ScopedTimer() {
+        if (start_) {
+            g_section_ticks[section_] += GetTicks() - start_;
+            g_section_calls[section_]++;
+        }
+    }
+
+private:
+    Section section_;
+    u64     start_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedTimer);
+};
+
+} // namespace
+
+} // namespace
+
+#endif // COMMON_PROFILER_H_
@@ -76,6 +76,7 @@ void ParseGeneralNode(rapidxml::xml_node<> *node, Config& config) {
     char temp_str[MAX_PATH];
     config.set_enable_multicore(GetXMLElementAsBool(node, "EnableMultiCore"));
     config.set_enable_idle_skipping(GetXMLElementAsBool(node, "EnableIdleSkipping"));
+    config.set_enable_fastmem(GetXMLElementAsBool(node, "EnableFastmem"));
     config.set_enable_hle(GetXMLElementAsBool(node, "EnableHLE"));
     config.set_enable_auto_boot(GetXMLElementAsBool(node, "EnableAutoBoot"));
     config.set_enable_cheats(GetXMLElementAsBool(node, "EnableCheats"));
@@ -267,6 +268,9 @@ void ParsePowerPCNode(rapidxml::xml_node<> *node, Config& config) {
         // Use dynarec core
         } else if (E_OK == _stricmp(core_str, "dynarec")) {
             config.set_powerpc_core(Config::CPU_DYNAREC);       // Dynarec selected
+        // Use threaded interpreter core
+        } else if (E_OK == _stricmp(core_str, "threaded")) {
+            config.set_powerpc_core(Config::CPU_INTERPRETER_THREADED); // Threaded selected
         // Unsupported type
         } else {
             LOG_ERROR(TCONFIG, "Invalid PowerPC type %s for attribute 'core' selected!", 
@@ -294,6 +298,10 @@ void ParseVideoNode(rapidxml::xml_node<> *node, Config& config) {
     if (!node) {
         return;
     }
+    rapidxml::xml_attribute<> *renderer_attr = node->first_attribute("renderer");
+    if (renderer_attr) {
+        config.set_current_renderer(Config::StringToRenderType(renderer_attr->value()));
+    }
     config.set_enable_fullscreen(GetXMLElementAsBool(node, "EnableFullscreen"));
     
     // Set resolutions
@@ -318,6 +326,8 @@ void ParseVideoNode(rapidxml::xml_node<> *node, Config& config) {
         renderer_config.enable_texture_dumping = GetXMLElementAsBool(elem, "EnableTextureDumping");
         renderer_config.anti_aliasing_mode = GetXMLElementAsInt(elem, "AntiAliasingMode");
         renderer_config.anistropic_filtering_mode = GetXMLElementAsInt(elem, "AnistropicFilteringMode");
+        renderer_config.texture_cache_size = GetXMLElementAsInt(elem, "TextureCacheSize");
+        renderer_config.enable_texture_full_hash = GetXMLElementAsBool(elem, "EnableTextureFullHash");
 
         config.set_renderer_config(type, renderer_config);
 
@@ -30,11 +30,16 @@
 
 #include "core.h"
 #include "memory.h"
+#include "state.h"
 #include "hw/hw.h"
 #include "dvd/realdvd.h"
 #include "powerpc/cpu_core.h"
 #include "powerpc/interpreter/cpu_int.h"
+#include "powerpc/interpreter/cpu_int_threaded.h"
 #include "powerpc/recompiler/cpu_rec.h"
+#if defined(EMU_ARCHITECTURE_X64) && EMU_PLATFORM == PLATFORM_LINUX
+#include "powerpc/recompiler_x64/cpu_rec_x64.h"
+#endif
 
 // TODO: Include logic is stupid... video_core shouldn't be included if USE_NEW_VIDEO_CORE is false, but that variable is defined in that header..
 #include "video_core.h"
@@ -103,15 +108,21 @@ int Init(EmuWindow* emu_window) {
     if (common::g_config->powerpc_core() == common::Config::CPU_INTERPRETER) {
         delete cpu; // TODO: STUPID!
         cpu = new GekkoCPUInterpreter();
+    } else if (common::g_config->powerpc_core() == common::Config::CPU_INTERPRETER_THREADED) {
+        delete cpu;
+        cpu = new GekkoCPUInterpreterThreaded();
     } else {
 
 #ifndef EMU_IGNORE_RECOMPILER
 
-#ifdef EMU_ARCHITECTURE_X86
+#if defined(EMU_ARCHITECTURE_X64) && EMU_PLATFORM == PLATFORM_LINUX
+        delete cpu;
+        cpu = new GekkoCPURecompilerX64();
+#elif defined(EMU_ARCHITECTURE_X86)
         delete cpu;
        cpu = new GekkoCPURecompiler();
 #else
-        LOG_ERROR(TCORE, "Recompiler only x86 - Please switch your configuration to the interpreter!\n");
+        LOG_ERROR(TCORE, "Recompiler only x86 or x86-64 Linux - Please switch your configuration to the interpreter!\n");
         return E_ERR;
 #endif // EMU_ARCHITECTURE_X86
 
@@ -127,5 +138,20 @@ int Init(EmuWindow* emu_window) {
     return E_OK;
 }
 
+/// Save the emulated system to a state file
+bool SaveState(const char* filename) {
+    return state::SaveToFile(filename);
+}
+
+/// Load a state file
+bool LoadState(const char* filename) {
+    return state::LoadFromFile(filename);
+}
+
+/// Check the state survives a save/load round trip
+bool CheckState() {
+    return state::CheckRoundTrip();
+}
+
 } // namespace
 
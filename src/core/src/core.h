@@ -73,6 +73,27 @@ void Stop();
 /// Initialize the core
 int Init(EmuWindow* emu_window);
 
+/*!
+ * \brief Save the emulated system to a state file, the core must be paused
+ * \param filename Path of the state file
+ * \return True on success
+ */
+bool SaveState(const char* filename);
+
+/*!
+ * \brief Load a state file saved by SaveState, the core must be paused
+ * \param filename Path of the state file
+ * \return True on success
+ */
+bool LoadState(const char* filename);
+
+/*!
+ * \brief Save the state in memory, load it back and check a second save matches, the core must be
+ *      paused
+ * \return True if the state survived the round trip
+ */
+bool CheckState();
+
 extern common::ConfigManager*   g_config_manager;           ///< Global system configuration manager
 extern SystemState              g_state;                    ///< State of the emulator
 extern bool                     g_started;      ///< Whether or not the emulator has been started
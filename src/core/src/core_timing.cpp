@@ -0,0 +1,236 @@
+/*!
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * \file    core_timing.cpp
+ * \author  ShizZy <shizzy247@gmail.com>
+ * \date    2013-02-05
+ * \brief   Guest cycle timestamped event queue used to drive the Flipper hardware
+ *
+ * \section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "log.h"
+
+#include "powerpc/cpu_core_regs.h"
+#include "core_timing.h"
+
+namespace core_timing {
+
+/// Registered type of event
+struct EventType {
+    EventCallback   callback;
+    const char*     name;
+};
+
+/// Pending event
+struct Event {
+    u64 time;       ///< Guest cycle the event is due at
+    u64 order;      ///< Insertion order, keeps events due on the same cycle FIFO
+    int type;       ///< Index into g_event_types
+    u64 userdata;   ///< Passed to the callback
+};
+
+/// Heap ordering, the earliest event ends up at the front
+struct EventLater {
+    bool operator()(const Event& a, const Event& b) const {
+        return (a.time > b.time) || (a.time == b.time && a.order > b.order);
+    }
+};
+
+static std::vector<EventType>   g_event_types;
+static std::vector<Event>       g_event_queue;      ///< Min-heap on Event::time
+static u64                      g_event_order;
+
+// The guest is free to rewrite the time base, so the queue keeps its own monotonic clock. g_ticks
+// is the clock value at the moment the time base read g_time_base_sync.
+static u64                      g_ticks;
+static u64                      g_time_base_sync;
+
+u64 g_next_event_time_base = ~0ULL;
+
+/// Fold the cycles executed since the last sync into the monotonic clock
+static void Sync() {
+    // Time base went backwards without TimeBaseWritten (CPU core reset), count it as no time
+    if (ireg.TBR.TBR > g_time_base_sync) {
+        g_ticks += ireg.TBR.TBR - g_time_base_sync;
+    }
+    g_time_base_sync = ireg.TBR.TBR;
+}
+
+/// Recalculate the time base value the CPU core compares against
+static void UpdateNextEvent() {
+    if (g_event_queue.empty()) {
+        g_next_event_time_base = ~0ULL;
+    } else if (g_event_queue.front().time <= g_ticks) {
+        g_next_event_time_base = g_time_base_sync;
+    } else {
+        g_next_event_time_base = g_time_base_sync + (g_event_queue.front().time - g_ticks);
+    }
+}
+
+void Init() {
+    g_event_types.clear();
+    g_event_queue.clear();
+    g_event_order = 0;
+    g_ticks = 0;
+    g_time_base_sync = ireg.TBR.TBR;
+    g_next_event_time_base = ~0ULL;
+}
+
+void Shutdown() {
+    g_event_queue.clear();
+    g_event_types.clear();
+    g_next_event_time_base = ~0ULL;
+}
+
+int RegisterEvent(const char* name, EventCallback callback) {
+    EventType type = { callback, name };
+    g_event_types.push_back(type);
+    return (int)g_event_types.size() - 1;
+}
+
+void ScheduleEvent(s64 cycles_into_future, int event_type, u64 userdata) {
+    _ASSERT_MSG(TCORE, event_type >= 0 && event_type < (int)g_event_types.size(),
+        "invalid event type %d", event_type);
+    Sync();
+
+    Event event;
+    event.time = g_ticks + ((cycles_into_future > 0) ? cycles_into_future : 0);
+    event.order = g_event_order++;
+    event.type = event_type;
+    event.userdata = userdata;
+
+    g_event_queue.push_back(event);
+    std::push_heap(g_event_queue.begin(), g_event_queue.end(), EventLater());
+    UpdateNextEvent();
+}
+
+void UnscheduleEvent(int event_type) {
+    size_t count = g_event_queue.size();
+    for (size_t i = 0; i < g_event_queue.size(); ) {
+        if (g_event_queue[i].type == event_type) {
+            g_event_queue[i] = g_event_queue.back();
+            g_event_queue.pop_back();
+        } else {
+            i++;
+        }
+    }
+    if (g_event_queue.size() != count) {
+        std::make_heap(g_event_queue.begin(), g_event_queue.end(), EventLater());
+        UpdateNextEvent();
+    }
+}
+
+bool IsScheduled(int event_type) {
+    for (size_t i = 0; i < g_event_queue.size(); i++) {
+        if (g_event_queue[i].type == event_type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+u64 GetTicks() {
+    Sync();
+    return g_ticks;
+}
+
+s64 GetTicksUntilNextEvent() {
+    Sync();
+    if (g_event_queue.empty()) {
+        return 0x7FFFFFFFFFFFFFFFLL;
+    }
+    return (s64)(g_event_queue.front().time - g_ticks);
+}
+
+void Advance() {
+    Sync();
+
+    // Callbacks may schedule new events, so always re-check the front of the heap
+    while (!g_event_queue.empty() && g_event_queue.front().time <= g_ticks) {
+        Event event = g_event_queue.front();
+        std::pop_heap(g_event_queue.begin(), g_event_queue.end(), EventLater());
+        g_event_queue.pop_back();
+
+        g_event_types[event.type].callback(event.userdata, (s64)(g_ticks - event.time));
+    }
+    UpdateNextEvent();
+}
+
+void TimeBaseWritten(u64 old_time_base) {
+    if (old_time_base > g_time_base_sync) {
+        g_ticks += old_time_base - g_time_base_sync;
+    }
+    g_time_base_sync = ireg.TBR.TBR;
+    UpdateNextEvent();
+}
+
+void DoState(state::Serializer& s) {
+    if (!s.is_reading()) {
+        Sync();
+    }
+    s.Do(g_ticks);
+    s.Do(g_time_base_sync);
+    s.Do(g_event_order);
+
+    u32 count = (u32)g_event_queue.size();
+    s.Do(count);
+
+    std::vector<Event> events(g_event_queue);
+    events.resize(count);
+
+    if (s.is_reading()) {
+        g_event_queue.clear();
+    }
+    for (u32 i = 0; i < count && s.ok(); i++) {
+        Event& event = events[i];
+        std::string name;
+
+        if (!s.is_reading()) {
+            name = g_event_types[event.type].name;
+        }
+        s.Do(event.time);
+        s.Do(event.order);
+        s.Do(event.userdata);
+        s.DoString(name);
+
+        if (s.is_reading()) {
+            event.type = -1;
+            for (size_t type = 0; type < g_event_types.size(); type++) {
+                if (name == g_event_types[type].name) {
+                    event.type = (int)type;
+                    break;
+                }
+            }
+            if (event.type < 0) {
+                LOG_ERROR(TCORE, "state has unknown event type %s, dropped", name.c_str());
+                continue;
+            }
+            g_event_queue.push_back(event);
+        }
+    }
+    if (s.is_reading()) {
+        std::make_heap(g_event_queue.begin(), g_event_queue.end(), EventLater());
+        UpdateNextEvent();
+    }
+}
+
+} // namespace
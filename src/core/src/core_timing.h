@@ -0,0 +1,96 @@
+/*!
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * \file    core_timing.h
+ * \author  ShizZy <shizzy247@gmail.com>
+ * \date    2013-02-05
+ * \brief   Guest cycle timestamped event queue used to drive the Flipper hardware
+ *
+ * \section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef CORE_CORE_TIMING_H_
+#define CORE_CORE_TIMING_H_
+
+#include "common.h"
+#include "state.h"
+
+namespace core_timing {
+
+/*!
+ * \brief Event handler, called once the event's deadline has passed
+ * \param userdata Value passed to ScheduleEvent
+ * \param cycles_late Number of guest cycles the event was dispatched after its deadline
+ */
+typedef void (*EventCallback)(u64 userdata, s64 cycles_late);
+
+/// Initialize the event queue, drops all event types and pending events
+void Init();
+
+/// Shutdown the event queue
+void Shutdown();
+
+/*!
+ * \brief Register a new type of event
+ * \param name Name of the event, used for logging
+ * \param callback Function called when an event of this type is due
+ * \return Event type handle passed to ScheduleEvent
+ */
+int RegisterEvent(const char* name, EventCallback callback);
+
+/*!
+ * \brief Schedule an event
+ * \param cycles_into_future Guest cycles from now until the event is due, <= 0 means as soon as
+ *      possible
+ * \param event_type Event type returned by RegisterEvent
+ * \param userdata Value passed to the event callback
+ */
+void ScheduleEvent(s64 cycles_into_future, int event_type, u64 userdata = 0);
+
+/// Remove all pending events of a type
+void UnscheduleEvent(int event_type);
+
+/// Returns true if an event of the given type is pending
+bool IsScheduled(int event_type);
+
+/// Returns the current guest cycle count, this is monotonic unlike the guest time base
+u64 GetTicks();
+
+/// Returns the number of guest cycles until the next event is due
+s64 GetTicksUntilNextEvent();
+
+/// Dispatch all events that are due
+void Advance();
+
+/*!
+ * \brief Must be called when the time base register was changed other than by running code
+ * \param old_time_base Value of the time base before it was written
+ */
+void TimeBaseWritten(u64 old_time_base);
+
+/*!
+ * \brief Save/load the pending events. Events are matched up by the name they were registered with,
+ *      so all event types must be registered before a state is loaded.
+ * \param s Serializer
+ */
+void DoState(state::Serializer& s);
+
+/// Time base value at which the next event is due, checked by the CPU core after each block
+extern u64 g_next_event_time_base;
+
+} // namespace
+
+#endif // CORE_CORE_TIMING_H_
@@ -0,0 +1,275 @@
+/*!
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * \file    fastmem.cpp
+ * \author  ShizZy <shizzy247@gmail.com>
+ * \date    2013-02-06
+ * \brief   Host mapped guest address space, guest accesses become a single host load/store
+ *
+ * \section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include "common.h"
+#include "log.h"
+
+#include "memory.h"
+#include "fastmem.h"
+
+#ifdef EMU_FASTMEM
+#include <signal.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace fastmem {
+
+u8* g_base = NULL;
+
+#ifdef EMU_FASTMEM
+
+/// Guest addresses below this are RAM mirrors
+static const u32 kRAMEnd = 0xC8000000;
+
+/// Guest address of the first L2 mirror
+static const u32 kL2Start = 0xE0000000;
+
+/// Offset of the L2 backing in the shared memory object, right after RAM
+static const u64 kL2Offset = RAM2_SIZE;
+
+static struct sigaction g_old_segv;
+
+/// ucontext register slot for each x86-64 register encoding
+static const int kGregIndex[16] = {
+    REG_RAX, REG_RCX, REG_RDX, REG_RBX, REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+    REG_R8, REG_R9, REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15
+};
+
+/*!
+ * \brief Emulate a faulting guest memory access and step over the host instruction
+ * \param regs Register state of the faulting thread
+ * \param offset Offset of the faulting access into the guest address space
+ * \return True if the instruction was one of the fastmem access forms and has been completed
+ */
+static bool HandleAccess(greg_t* regs, u32 offset) {
+    const u8* code = (const u8*)regs[REG_RIP];
+    const u8* p = code;
+    bool operand16 = false;
+    bool is_write = false;
+    bool zero_extend = true;
+    int size;
+    u8 rex = 0;
+
+    if (*p == 0x66) {
+        operand16 = true;
+        p++;
+    }
+    if ((*p & 0xF0) == 0x40) {
+        rex = *p++;
+    }
+    // 64-bit accesses are never generated
+    if (rex & 0x08) {
+        return false;
+    }
+    switch (*p++) {
+    case 0x88: // mov m8, r8
+        size = 1;
+        is_write = true;
+        break;
+    case 0x89: // mov m16/m32, r16/r32
+        size = operand16 ? 2 : 4;
+        is_write = true;
+        break;
+    case 0x8B: // mov r16/r32, m16/m32
+        size = operand16 ? 2 : 4;
+        zero_extend = !operand16;
+        break;
+    case 0x0F:
+        if (*p == 0xB6) { // movzx r32, m8
+            size = 1;
+        } else if (*p == 0xB7) { // movzx r32, m16
+            size = 2;
+        } else {
+            return false;
+        }
+        p++;
+        break;
+    default:
+        return false;
+    }
+
+    // Skip the memory operand
+    u8 modrm = *p++;
+    int mod = modrm >> 6;
+    int reg = ((modrm >> 3) & 7) | ((rex & 0x04) ? 8 : 0);
+    int rm = modrm & 7;
+
+    if (mod == 3) {
+        return false;
+    }
+    if (rm == 4) {
+        u8 sib = *p++;
+        if (mod == 0 && (sib & 7) == 5) {
+            p += 4;
+        }
+    } else if (mod == 0 && rm == 5) {
+        p += 4;
+    }
+    if (mod == 1) {
+        p += 1;
+    } else if (mod == 2) {
+        p += 4;
+    }
+
+    // AH/CH/DH/BH when there is no REX prefix
+    int shift = 0;
+    if (size == 1 && !rex && reg >= 4) {
+        reg -= 4;
+        shift = 8;
+    }
+    greg_t* host_reg = &regs[kGregIndex[reg]];
+
+    // Undo the word swap applied by the accessor
+    u32 addr = offset ^ ((size == 1) ? 3 : ((size == 2) ? 2 : 0));
+
+    if (is_write) {
+        u32 data = (u32)((u64)*host_reg >> shift);
+        switch (size) {
+        case 1: Memory_SlowWrite8(addr, (u8)data); break;
+        case 2: Memory_SlowWrite16(addr, (u16)data); break;
+        default: Memory_SlowWrite32(addr, data); break;
+        }
+    } else {
+        u32 data;
+        switch (size) {
+        case 1: data = Memory_SlowRead8(addr); break;
+        case 2: data = Memory_SlowRead16(addr); break;
+        default: data = Memory_SlowRead32(addr); break;
+        }
+        if (zero_extend) {
+            *host_reg = (greg_t)(u64)data;
+        } else {
+            *host_reg = (greg_t)(((u64)*host_reg & ~0xFFFFULL) | (data & 0xFFFF));
+        }
+    }
+    regs[REG_RIP] += (greg_t)(p - code);
+    return true;
+}
+
+static void FaultHandler(int sig, siginfo_t* info, void* raw_context) {
+    ucontext_t* context = (ucontext_t*)raw_context;
+    u8* fault = (u8*)info->si_addr;
+
+    if (g_base && fault >= g_base && fault < (g_base + kRegionSize)) {
+        if (HandleAccess(context->uc_mcontext.gregs, (u32)(fault - g_base))) {
+            return;
+        }
+    }
+    // Not a guest access, pass it on to whoever handled SIGSEGV before us
+    if (g_old_segv.sa_flags & SA_SIGINFO) {
+        g_old_segv.sa_sigaction(sig, info, raw_context);
+    } else if (g_old_segv.sa_handler == SIG_DFL || g_old_segv.sa_handler == SIG_IGN) {
+        // Returning re-executes the faulting instruction, which now crashes as usual
+        sigaction(SIGSEGV, &g_old_segv, NULL);
+    } else {
+        g_old_segv.sa_handler(sig);
+    }
+}
+
+/// Map a view of the shared memory object, at a fixed address if one is given
+static u8* MapView(int fd, u64 offset, size_t size, u8* address) {
+    int flags = MAP_SHARED | (address ? MAP_FIXED : 0);
+    void* view = mmap(address, size, PROT_READ | PROT_WRITE, flags, fd, offset);
+    return (view == MAP_FAILED) ? NULL : (u8*)view;
+}
+
+bool Init(u8** ram, u8** l2) {
+    if (g_base) {
+        return true;
+    }
+#ifdef __NR_memfd_create
+    int fd = (int)syscall(__NR_memfd_create, "gekko-ram", 0);
+#else
+    int fd = -1;
+#endif
+    if (fd < 0) {
+        LOG_NOTICE(TMEM, "fastmem unavailable, memfd_create not supported");
+        return false;
+    }
+    if (ftruncate(fd, kL2Offset + L2_SIZE) != 0) {
+        LOG_ERROR(TMEM, "fastmem failed to size shared memory");
+        close(fd);
+        return false;
+    }
+    void* region = mmap(NULL, kRegionSize, PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED) {
+        LOG_ERROR(TMEM, "fastmem failed to reserve guest address space");
+        close(fd);
+        return false;
+    }
+    u8* base = (u8*)region;
+    u8* ram_view = MapView(fd, 0, RAM2_SIZE, NULL);
+    u8* l2_view = MapView(fd, kL2Offset, L2_SIZE, NULL);
+    bool ok = (ram_view != NULL) && (l2_view != NULL);
+
+    for (u64 addr = 0; ok && addr < kRAMEnd; addr += RAM_SIZE) {
+        ok = (MapView(fd, 0, RAM_SIZE, base + addr) != NULL);
+    }
+    // Only the first L2 mirror is mapped, the others go through the fault handler
+    if (ok) {
+        ok = (MapView(fd, kL2Offset, L2_SIZE, base + kL2Start) != NULL);
+    }
+    // The mappings keep the shared memory object alive
+    close(fd);
+
+    if (ok) {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = FaultHandler;
+        sa.sa_flags = SA_SIGINFO;
+        sigemptyset(&sa.sa_mask);
+        ok = (sigaction(SIGSEGV, &sa, &g_old_segv) == 0);
+    }
+    if (!ok) {
+        LOG_ERROR(TMEM, "fastmem failed to map guest memory");
+        munmap(region, kRegionSize);
+        if (ram_view) {
+            munmap(ram_view, RAM2_SIZE);
+        }
+        if (l2_view) {
+            munmap(l2_view, L2_SIZE);
+        }
+        return false;
+    }
+    g_base = base;
+    *ram = ram_view;
+    *l2 = l2_view;
+
+    LOG_NOTICE(TMEM, "fastmem initialized ok, guest address space at %p", g_base);
+    return true;
+}
+
+#else
+
+bool Init(u8** ram, u8** l2) {
+    return false;
+}
+
+#endif // EMU_FASTMEM
+
+} // namespace
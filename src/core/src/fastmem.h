@@ -0,0 +1,104 @@
+/*!
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * \file    fastmem.h
+ * \author  ShizZy <shizzy247@gmail.com>
+ * \date    2013-02-06
+ * \brief   Host mapped guest address space, guest accesses become a single host load/store
+ *
+ * \section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef CORE_FASTMEM_H_
+#define CORE_FASTMEM_H_
+
+#include "common.h"
+
+// Fastmem needs a 64-bit address space, shared memory mappings and a way to recover from faults
+#if defined(EMU_ARCHITECTURE_X64) && EMU_PLATFORM == PLATFORM_LINUX
+#define EMU_FASTMEM
+#endif
+
+/*!
+ * The whole 32-bit guest address space is reserved as one 4GB block of host memory. RAM is
+ * mirrored into it everywhere the guest sees RAM, and the first L2 mirror is mapped as well. All
+ * other pages (EFB, hardware registers, IPL) are left inaccessible: touching them faults, and the
+ * fault handler completes the access through the regular Memory_Slow* functions before resuming
+ * the host code after the faulting instruction.
+ *
+ * Only the plain mov/movzx forms emitted by the accessors below and by the recompiler can be
+ * resumed. Guest memory keeps its word swapped layout, so 8-bit accesses use (addr ^ 3) and 16-bit
+ * accesses (addr ^ 2), and unaligned 16/32-bit accesses must take the slow path.
+ */
+namespace fastmem {
+
+/// Size of the host reservation, covers the whole guest address space
+static const u64 kRegionSize = 0x100000000ULL;
+
+/// Base of the guest address space in host memory, NULL if fastmem is not active
+extern u8* g_base;
+
+/*!
+ * \brief Reserve the guest address space and create the shared RAM/L2 backing
+ * \param ram Receives the host view of main RAM (RAM2_SIZE bytes)
+ * \param l2 Receives the host view of the L2 locked cache (L2_SIZE bytes)
+ * \return True on success, false if fastmem is not available on this host
+ */
+bool Init(u8** ram, u8** l2);
+
+#ifdef EMU_FASTMEM
+
+inline u8 Read8(u32 addr) {
+    u32 value;
+    __asm__ __volatile__("movzbl (%1,%2), %0" : "=r"(value) : "r"(g_base), "r"((u64)(addr ^ 3))
+        : "memory");
+    return (u8)value;
+}
+
+inline u16 Read16(u32 addr) {
+    u32 value;
+    __asm__ __volatile__("movzwl (%1,%2), %0" : "=r"(value) : "r"(g_base), "r"((u64)(addr ^ 2))
+        : "memory");
+    return (u16)value;
+}
+
+inline u32 Read32(u32 addr) {
+    u32 value;
+    __asm__ __volatile__("movl (%1,%2), %0" : "=r"(value) : "r"(g_base), "r"((u64)addr)
+        : "memory");
+    return value;
+}
+
+inline void Write8(u32 addr, u8 data) {
+    __asm__ __volatile__("movb %0, (%1,%2)" : : "q"(data), "r"(g_base), "r"((u64)(addr ^ 3))
+        : "memory");
+}
+
+inline void Write16(u32 addr, u16 data) {
+    __asm__ __volatile__("movw %0, (%1,%2)" : : "r"(data), "r"(g_base), "r"((u64)(addr ^ 2))
+        : "memory");
+}
+
+inline void Write32(u32 addr, u32 data) {
+    __asm__ __volatile__("movl %0, (%1,%2)" : : "r"(data), "r"(g_base), "r"((u64)addr)
+        : "memory");
+}
+
+#endif // EMU_FASTMEM
+
+} // namespace
+
+#endif // CORE_FASTMEM_H_
@@ -7,6 +7,8 @@
 #include "powerpc/cpu_core_regs.h"
 #include "dvd/loader.h"
 #include "hle_crc.h"
+#include "hle_general.h"
+#include "hle_dsp.h"
 
 #include <fstream>
 using namespace std;
@@ -700,3 +702,13 @@ void HLE_FindFuncsAndGenerateCRCs()
 }
 
 ////////////////////////////////////////////////////////////
+
+// Desc: Save/Load HLE State. The patch table is rebuilt from the game when it boots, only state
+// kept by the HLE functions themselves is saved. DVD file handles are host files, they aren't.
+//
+
+void HLE_DoState(state::Serializer& s)
+{
+	HLE_GeneralDoState(s);
+	dsphle_dostate(s);
+}
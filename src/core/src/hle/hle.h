@@ -6,6 +6,8 @@
 
 #pragma warning(disable:4786)
 
+#include "state.h"
+
 ////////////////////////////////////////////////////////////
 
 #define HLETYPE						void __cdecl
@@ -110,6 +112,7 @@ bool HLE_MapGetDebugSymbolFunctionAddress(const std::string& _name, u32& _addr);
 void HLE_FindFuncsAndGenerateCRCs();
 u32 HLE_DetectFunctionSize(u32 addr);
 u32 HLE_GenerateFunctionCRC(u32 Addr, u32 FuncSize);
+void HLE_DoState(state::Serializer& s);
 
 ////////////////////////////////////////////////////////////
 
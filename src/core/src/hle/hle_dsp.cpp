@@ -135,7 +135,7 @@ void ucode_zww_sendmsg(u32 msg, int irq) {
 	if (irq) {
 		REGDSP16(DSP_CSR)  |= DSP_CSR_DSPINT;
 		dspCSRDSPInt = DSP_CSR_DSPINT;
-		//PI_RequestInterrupt(PI_MASK_DSP);
+		DSP_SendMailInterrupt();
 	}
 	write_msg_queue(msg);
 }
@@ -247,3 +247,27 @@ void ucode_zww_processcmd(u32 * data,int size) {
 	//else ucode_zww_sendmsg(0xf3550000|(data[0]>>16),0);
 	ucode_zww_sendmsg(0xf3550000|(data[0]>>16),0);
 }
+
+/* save/load the message queue and the state of the running ucode */
+void dsphle_dostate(state::Serializer& s) {
+	s.Do(DSPucode);
+	s.DoArray(messagequeue, MESSAGEQUEUESIZE);
+	s.Do(messagequeue_readloc);
+	s.Do(messagequeue_writeloc);
+
+	/* parambuf points into ucode_loader itself, store it as an offset */
+	int paramoffset = ucode_loader.parambuf ? (int)((u8*)ucode_loader.parambuf - (u8*)&ucode_loader) : -1;
+	s.Do(ucode_loader.command);
+	s.Do(ucode_loader.DMA_RAMaddr);
+	s.Do(ucode_loader.DMA_IRAMaddr);
+	s.Do(ucode_loader.DMA_size);
+	s.Do(ucode_loader.DMA_DRAMaddr);
+	s.Do(ucode_loader.DMA_execaddr);
+	s.Do(ucode_loader.paramsleft);
+	s.Do(paramoffset);
+	if (s.is_reading()) {
+		ucode_loader.parambuf = (paramoffset < 0) ? NULL : (u32*)((u8*)&ucode_loader + paramoffset);
+	}
+
+	s.Do(ucode_zww);
+}
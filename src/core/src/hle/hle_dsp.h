@@ -1,3 +1,5 @@
+#include "state.h"
+
 enum {
 	DSPUCODE_HARDROM,
 	DSPUCODE_LOADER,
@@ -12,6 +14,7 @@ void pop_msg_queue(void);
 void write_msg_queue(u32 msg);
 
 void dsphle_init(void);
+void dsphle_dostate(state::Serializer& s);
 void ucode_loader_parse(u32 message);
 
 void ucode_zww_init(void);
@@ -18,6 +18,16 @@ u32		__OSDefaultThread;
 u32		dvdfilehandle[128];
 u32		filehandle_ptr[128];
 
+// Desc: Save/Load the OS globals tracked by the HLE functions
+//
+
+void HLE_GeneralDoState(state::Serializer& s)
+{
+	s.Do(__OSPhysicalContext);
+	s.Do(__OSCurrentContext);
+	s.Do(__OSDefaultThread);
+}
+
 // Desc: Standard C
 ////////////////////////////////////////////////////////////
 /*
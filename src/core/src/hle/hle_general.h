@@ -4,6 +4,8 @@
 #ifndef _HLE_GENERAL_H_
 #define _HLE_GENERAL_H_
 
+#include "state.h"
+
 ////////////////////////////////////////////////////////////
 // DVD
 ////////////////////////////////////////////////////////////
@@ -11,6 +13,8 @@
 extern u32 dvdfilehandle[128];
 extern u32 filehandle_ptr[128];
 
+void HLE_GeneralDoState(state::Serializer& s);
+
 struct DVDDiskID
 {
     char      gameName[4];
@@ -2,6 +2,7 @@
 // (c) 2005,2006 Gekko Team
 
 #include "common.h"
+#include "core_timing.h"
 #include "hw.h"
 #include "hw_pe.h"
 #include "hw_vi.h"
@@ -18,25 +19,16 @@
 
 ////////////////////////////////////////////////////////////
 
-// Desc: Update Flipper Hardware
+// Desc: Update Flipper Hardware - Dispatches hardware events that are due
+// and checks for pending interrupts, called by the CPU core after each block
 //
 
 u32 EMU_FASTCALL Flipper_Update(void)
 {
-	static u32 FlipCount = 0;
-
-	FlipCount++;
-
-	if(!(FlipCount & 0x7F))
+	if(ireg.TBR.TBR >= core_timing::g_next_event_time_base)
 	{
-		FlipCount = 0;
-		{
-			DSP_Update();
-			EXI_Update();
-			VI_Update();
-			AI_Update();
-            PE_Update();
-		}
+		GX_Update();
+		core_timing::Advance();
 	}
 
 	return PI_CheckForInterrupts();
@@ -47,6 +39,8 @@ u32 EMU_FASTCALL Flipper_Update(void)
 
 void Flipper_Open(void)
 {
+	core_timing::Init();
+
 	CP_Open();
 	PE_Open();
 	PI_Open();
@@ -67,6 +61,25 @@ void Flipper_Close(void)
 {
 	EXI_Close();
 	DI_Close();
+
+	core_timing::Shutdown();
+}
+
+// Desc: Save/Load Flipper Hardware State
+//
+
+void Flipper_DoState(state::Serializer& s)
+{
+	CP_DoState(s);
+	PE_DoState(s);
+	PI_DoState(s);
+	VI_DoState(s);
+	SI_DoState(s);
+	MI_DoState(s);
+	DSP_DoState(s);
+	EXI_DoState(s);
+	AI_DoState(s);
+	DI_DoState(s);
 }
 
 
@@ -4,6 +4,8 @@
 #ifndef _FLIPPER_H_
 #define _FLIPPER_H_
 
+#include "state.h"
+
 ////////////////////////////////////////////////////////////
 
 #define CP_Regs						0x00
@@ -77,6 +79,7 @@ static u32 GEX_Empty_Handler[] =
 
 void				Flipper_Open(void);
 void				Flipper_Close(void);
+void				Flipper_DoState(state::Serializer& s);
 
 u32     EMU_FASTCALL    Flipper_Update(void);
 
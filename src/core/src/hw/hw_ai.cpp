@@ -2,10 +2,12 @@
 // (c) 2005,2006 Gekko Team
 
 #include "common.h"
+#include "core_timing.h"
 #include "hw.h"
 #include "hw_ai.h"
 #include "hw_pi.h"
 #include "hw_dsp.h"
+#include "powerpc/cpu_core.h"
 
 //
 
@@ -13,6 +15,7 @@ u8		AIRegisters[REG_SIZE];
 
 s32		g_AISampleRate;
 u32		AICRInterrupt = 0;
+int		AISampleEvent;
 
 ////////////////////////////////////////////////////////////
 // AI - Audio Interface
@@ -23,6 +26,14 @@ void AI_SetSampleRate(long _rate)
 	g_AISampleRate = _rate;
 }
 
+// Desc: Get the number of CPU ticks per audio sample
+//
+
+static s64 AI_GetSampleTime(void)
+{
+	return cpu->GetTicksPerSecond() / g_AISampleRate;
+}
+
 ////////////////////////////////////////////////////////////
 
 // Desc: Read/Write from/to AI Hardware
@@ -90,6 +101,10 @@ void EMU_FASTCALL AI_Write32(u32 addr, u32 data)
 			AI_SetSampleRate(32000);
 
 		AICRInterrupt = REGAI32(AI_CR) & (AI_CR_PSTAT | AI_CR_AIINTVLD);
+
+		// Start counting samples, the event stops itself once streaming is disabled
+		if(AICRInterrupt && !core_timing::IsScheduled(AISampleEvent))
+			core_timing::ScheduleEvent(AI_GetSampleTime(), AISampleEvent);
 		return;
 
 	case AI_IT:
@@ -105,10 +120,10 @@ void EMU_FASTCALL AI_Write32(u32 addr, u32 data)
 
 ////////////////////////////////////////////////////////////
 
-// Desc: Update AI Hardware
+// Desc: Update AI Hardware - Sample event callback, runs once per sample
 //
 
-void AI_Update(void)
+static void AI_Update(u64 userdata, s64 cycles_late)
 {
 	// Sample counter (interrupt)
 
@@ -123,6 +138,8 @@ void AI_Update(void)
 			PI_RequestInterrupt(PI_MASK_AI);
 		}
     }
+
+	core_timing::ScheduleEvent(AI_GetSampleTime() - cycles_late, AISampleEvent);
 }
 
 // Desc: Initialize AI Hardware
@@ -132,6 +149,19 @@ void AI_Open(void)
 {
     LOG_NOTICE(TAI, "initialized ok");
 	memset(&AIRegisters, 0, sizeof(AIRegisters));
+
+	AICRInterrupt = 0;
+	AISampleEvent = core_timing::RegisterEvent("AI sample", AI_Update);
+}
+
+// Desc: Save/Load AI State
+//
+
+void AI_DoState(state::Serializer& s)
+{
+	s.DoArray(AIRegisters, REG_SIZE);
+	s.Do(g_AISampleRate);
+	s.Do(AICRInterrupt);
 }
 
 ////////////////////////////////////////////////////////////
@@ -4,6 +4,8 @@
 #ifndef _HW_AI_H_
 #define _HW_AI_H_
 
+#include "state.h"
+
 ////////////////////////////////////////////////////////////
 
 #ifndef MEM_NATIVE_LE32
@@ -35,7 +37,7 @@ extern s32		g_AISampleRate;
 ////////////////////////////////////////////////////////////
 
 void AI_Open(void);
-void AI_Update(void);
+void AI_DoState(state::Serializer& s);
 
 ////////////////////////////////////////////////////////////
 
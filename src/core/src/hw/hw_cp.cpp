@@ -42,6 +42,9 @@ void EMU_FASTCALL CP_Write8(u32 addr, u32 data)
 
 u16 EMU_FASTCALL CP_Read16(u32 addr)
 {
+	// Status and FIFO pointers must reflect everything written so far
+	GX_Update();
+
 	switch(addr)
 	{
 		case CP_SR:
@@ -82,6 +85,9 @@ u16 EMU_FASTCALL CP_Read16(u32 addr)
 
 void EMU_FASTCALL CP_Write16(u32 addr, u32 data)
 {
+	// Commands written before a CP change (e.g. a breakpoint) are decoded first
+	GX_Update();
+
 	switch(addr)
 	{
 		case CP_SR:
@@ -195,5 +201,29 @@ void CP_Open(void)
 	CP_WPAR_Write32 = PI_Fifo_Write32;
 }
 
+// Desc: Save/Load CP State
+//
+
+void CP_DoState(state::Serializer& s)
+{
+	s.DoArray(CPRegisters, REG_SIZE);
+	s.Do(commandprocessor);
+
+	// Reattach the FIFO the WPAR was pointing at
+	if(s.is_reading())
+	{
+		if(commandprocessor.gp_link_enable)
+		{
+			CP_WPAR_Write8 = GX_Fifo_Write8;
+			CP_WPAR_Write16 = GX_Fifo_Write16;
+			CP_WPAR_Write32 = GX_Fifo_Write32;
+		}else{
+			CP_WPAR_Write8 = PI_Fifo_Write8;
+			CP_WPAR_Write16 = PI_Fifo_Write16;
+			CP_WPAR_Write32 = PI_Fifo_Write32;
+		}
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -4,6 +4,8 @@
 #ifndef _HW_CP_H_
 #define _HW_CP_H_
 
+#include "state.h"
+
 ////////////////////////////////////////////////////////////////////////////////
 
 #ifndef MEM_NATIVE_LE32
@@ -82,6 +84,7 @@ extern sCP commandprocessor;
 ////////////////////////////////////////////////////////////////////////////////
 
 void CP_Open(void);
+void CP_DoState(state::Serializer& s);
 void EMU_FASTCALL CP_Update(u32 _addr);
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "memory.h"
+#include "core_timing.h"
 #include "hw.h"
 #include "hw_di.h"
 #include "hw_pi.h"
@@ -11,6 +12,7 @@
 sDI hw_di;
 
 u8 *DVDDataBuff;
+int DITransferEvent;
 
 ////////////////////////////////////////////////////////////
 // DI - DVD Interface
@@ -113,6 +115,18 @@ void DIProcessCmd()
 						hw_di.CmdBuff[0], hw_di.CmdBuff[1], hw_di.CmdBuff[2], hw_di.DMAMemory, hw_di.DMALength, hw_di.IMMBuf, hw_di.cr);
 	}
 
+	// Data is already in memory, signal completion after the time the drive would take
+	core_timing::ScheduleEvent(DI_TRANSFER_TIME((hw_di.cr & DI_CR_DMA) ? hw_di.CmdBuff[2] : 4),
+		DITransferEvent);
+}
+
+// Desc: Complete a DI command - Event callback
+//
+
+static void DITransferComplete(u64 userdata, s64 cycles_late)
+{
+	hw_di.cr &= ~DI_CR_TSTART;
+
 	//if the transfer interrupt is wanted, then assert it
 	hw_di.sr |= DI_SR_TCINT;
 	if(hw_di.sr & DI_SR_TCINTMASK)
@@ -307,6 +321,16 @@ void DI_Open(void)
 	memset(&hw_di, 0, sizeof(hw_di));
 
 	DVDDataBuff = (u8*)malloc(1024*1024);
+
+	DITransferEvent = core_timing::RegisterEvent("DI transfer", DITransferComplete);
+}
+
+// Desc: Save/Load DI State
+//
+
+void DI_DoState(state::Serializer& s)
+{
+	s.Do(hw_di);
 }
 
 void DI_Close(void)
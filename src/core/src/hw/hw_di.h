@@ -4,6 +4,8 @@
 #ifndef _HW_DI_HEADER_
 #define _HW_DI_HEADER_
 
+#include "state.h"
+
 #include "common.h"
 
 typedef struct t_sDI
@@ -71,7 +73,10 @@ extern sDI hw_di;
 #define DI_CR_DMA			(1 << 1)
 #define DI_CR_TSTART		(1 << 0)
 
+#define DI_TRANSFER_TIME(len)	(256 + ((len) >> 3))	// CPU ticks for a command moving len bytes
+
 void DI_Open(void);
+void DI_DoState(state::Serializer& s);
 void DI_Close(void);
 
 u8		EMU_FASTCALL	DI_Read8(u32 addr);
@@ -2,6 +2,7 @@
 // (c) 2005,2006 Gekko Team
 
 #include "common.h"
+#include "core_timing.h"
 #include "powerpc/cpu_core.h"
 #include "hw.h"
 #include "hw_dsp.h"
@@ -17,12 +18,14 @@
 sDSP	dsp;
 u8		DSPRegisters[REG_SIZE];
 u8		ARAM[ARAM_SIZE];
-s64		g_DSPDMATime;
+u8		ARAM_DirtyPage[ARAM_NUM_PAGES];
 u32		mbox_cpu_dsp; /* from the cpu to the dsp */
 u32		mbox_dsp_cpu; /* from the dsp to the cpu */
 u32		dspDMALenENBSet = 0;
 u32		dspCSRDSPIntMask = 0;
 u32		dspCSRDSPInt = 0;
+int		DSPDMAEvent;
+int		DSPMailboxEvent;
 
 u16		g_AR_INFO;
 u16		g_AR_MODE;
@@ -102,6 +105,13 @@ void AudioRam_DMA(u32 _type, u32 _maddr, u32 _aaddr, u32 _size)
 
 				for(i = i * 4; i < _size; i++)
 					ARAM[_aaddr + i] = Memory_Read8(_maddr + i);
+
+				// Snapshots only copy the ARAM pages that have been written
+				if(_size)
+				{
+					for(i = _aaddr >> MEM_PAGE_SHIFT; i <= ((_aaddr + _size - 1) >> MEM_PAGE_SHIFT) && i < ARAM_NUM_PAGES; i++)
+						ARAM_DirtyPage[i] = 1;
+				}
 			}
 
 			REGDSP32(DSP_AR_DMA_CNT) &= 0x80000000;								// Reset count register
@@ -270,6 +280,10 @@ void EMU_FASTCALL DSP_Write16(u32 addr, u32 data)
 
 		REGDSP16(DSP_CSR) &= ~DSP_CSR_DMAINT;		// hack
 
+		// A mailbox interrupt may still be pending, or was just unmasked
+		if (dspCSRDSPInt && dspCSRDSPIntMask)
+			PI_RequestInterrupt(PI_MASK_DSP);
+
 		return;
 
 	case DSP_AR_DMA_MMADDR:
@@ -316,6 +330,10 @@ void EMU_FASTCALL DSP_Write16(u32 addr, u32 data)
 		dspDMALenENBSet = (data & DSP_DMALEN_ENB);
 		if(data & DSP_DMALEN_ENB)
 		{
+			// First block starts right away, following ones once the previous has played
+			if(!core_timing::IsScheduled(DSPDMAEvent))
+				core_timing::ScheduleEvent(0, DSPDMAEvent);
+
 			//printf("AI DMA from RAM len = %08x? %08x\n",data,REGDSP32(DSP_DMA_ADDR));
 			//REGDSP16(DSP_DMA_CNT) = REGDSP16(DSP_DMA_LEN) & ~DSP_DMALEN_ENB;
 
@@ -376,27 +394,36 @@ void EMU_FASTCALL DSP_Write32(u32 addr, u32 data)
 
 ////////////////////////////////////////////////////////////
 
-// Desc: Update DSP Hardware
+// Desc: Update DSP DMA - Event callback, runs each time an audio DMA block starts
 //
 
-void DSP_Update(void)
+static void DSP_UpdateDMA(u64 userdata, s64 cycles_late)
 {
 	// DSP DMA (interrupt)
 
-	if(!dspDMALenENBSet || (ireg.TBR.TBR < (u64)g_DSPDMATime))
-	{}
-	else
-	{
-		REGDSP16(DSP_DMA_CNT) = REGDSP16(DSP_DMA_LEN) & ~DSP_DMALEN_ENB;
-		g_DSPDMATime = cpu->GetTicks() + DSP_GetDMATime(REGDSP16(DSP_DMA_CNT) * 32, g_AISampleRate);
+	if(!dspDMALenENBSet)
+		return;
 
-		REGDSP16(DSP_CSR) |= DSP_CSR_AIDINT;
-		if(REGDSP16(DSP_CSR) & DSP_CSR_AIDINTMSK)
-		{
-			PI_RequestInterrupt(PI_MASK_DSP);
-		}
+	REGDSP16(DSP_DMA_CNT) = REGDSP16(DSP_DMA_LEN) & ~DSP_DMALEN_ENB;
+
+	// An empty block must still take some time, or the event would keep firing
+	s64 block_time = DSP_GetDMATime(REGDSP16(DSP_DMA_CNT) * 32, g_AISampleRate);
+	if(block_time < 1)
+		block_time = 1;
+	core_timing::ScheduleEvent(block_time - cycles_late, DSPDMAEvent);
+
+	REGDSP16(DSP_CSR) |= DSP_CSR_AIDINT;
+	if(REGDSP16(DSP_CSR) & DSP_CSR_AIDINTMSK)
+	{
+		PI_RequestInterrupt(PI_MASK_DSP);
 	}
+}
 
+// Desc: Update DSP Mailbox - Event callback, delivers a DSP->CPU mail interrupt
+//
+
+static void DSP_UpdateMailbox(u64 userdata, s64 cycles_late)
+{
 	if (!dspCSRDSPInt || !dspCSRDSPIntMask)
 		return;
 	else
@@ -405,6 +432,14 @@ void DSP_Update(void)
 	}
 }
 
+// Desc: Raise the DSP interrupt for a mail sent by the DSP
+//
+
+void DSP_SendMailInterrupt(void)
+{
+	core_timing::ScheduleEvent(DSP_MAIL_LATENCY, DSPMailboxEvent);
+}
+
 // Desc: Initialize DSP Hardware
 //
 
@@ -415,17 +450,39 @@ void DSP_Open(void)
 	memset(&dsp, 0, sizeof(sDSP));
 	memset(DSPRegisters, 0, sizeof(DSPRegisters));
 	memset(ARAM, 0, sizeof(ARAM));
+	memset(ARAM_DirtyPage, 0, sizeof(ARAM_DirtyPage));
 
 	mbox_cpu_dsp = 0;
 	mbox_dsp_cpu = 0;
 
 	dsphle_init();
 
-	g_DSPDMATime = 0;
 	g_AISampleRate = 32000;
 	g_AR_INFO = 0;
 	g_AR_MODE = 1;
         g_AR_REFRESH = 156;
+
+	dspDMALenENBSet = 0;
+	dspCSRDSPInt = 0;
+	DSPDMAEvent = core_timing::RegisterEvent("DSP DMA", DSP_UpdateDMA);
+	DSPMailboxEvent = core_timing::RegisterEvent("DSP mailbox", DSP_UpdateMailbox);
+}
+
+// Desc: Save/Load DSP State, ARAM is saved page by page with RAM
+//
+
+void DSP_DoState(state::Serializer& s)
+{
+	s.Do(dsp);
+	s.DoArray(DSPRegisters, REG_SIZE);
+	s.Do(mbox_cpu_dsp);
+	s.Do(mbox_dsp_cpu);
+	s.Do(dspDMALenENBSet);
+	s.Do(dspCSRDSPIntMask);
+	s.Do(dspCSRDSPInt);
+	s.Do(g_AR_INFO);
+	s.Do(g_AR_MODE);
+	s.Do(g_AR_REFRESH);
 }
 
 ////////////////////////////////////////////////////////////
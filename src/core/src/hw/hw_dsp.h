@@ -3,6 +3,9 @@
 #ifndef _HW_DSP_H_
 #define _HW_DSP_H_
 
+#include "memory.h"
+#include "state.h"
+
 ////////////////////////////////////////////////////////////
 
 #ifndef MEM_NATIVE_LE32
@@ -49,9 +52,12 @@ extern u8 DSPRegisters[REG_SIZE];
 
 #define DSP_DMALEN_ENB			(1 << 15)
 
+#define DSP_MAIL_LATENCY		1024		// CPU ticks from a DSP mail to its interrupt
+
 ////////////////////////////////////////////////////////////
 
 #define ARAM_SIZE				(16 * 1024 * 1024)						// 16MB
+#define ARAM_NUM_PAGES			(ARAM_SIZE >> MEM_PAGE_SHIFT)
 #define ARAM_DMA_TYPE			(REGDSP32(DSP_AR_DMA_CNT) >> 31)
 #define ARAM_DMA_SIZE			(REGDSP32(DSP_AR_DMA_CNT) & ~0x80000000)
 
@@ -67,10 +73,14 @@ typedef struct t_sDSP
 extern sDSP dsp;
 extern u32 dspCSRDSPInt;
 
+extern u8 ARAM[ARAM_SIZE];
+extern u8 ARAM_DirtyPage[ARAM_NUM_PAGES];	// Pages written by DMA, used by snapshots
+
 ////////////////////////////////////////////////////////////
 
 void DSP_Open(void);
-void DSP_Update(void);
+void DSP_DoState(state::Serializer& s);
+void DSP_SendMailInterrupt(void);
 
 u8		EMU_FASTCALL	DSP_Read8(u32 addr);
 void	EMU_FASTCALL	DSP_Write8(u32 addr, u32 data);
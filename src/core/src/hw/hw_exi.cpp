@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "memory.h"
+#include "core_timing.h"
 #include "hw.h"
 #include "hw_exi.h"
 #include "hw_pi.h"
@@ -15,6 +16,7 @@
 sEXI	exi;
 u8		*IPLRom = 0;
 u8		*SRAM = 0;
+int		EXITransferEvent;
 
 u64		EXIMask = ((u64)(EXI_CSR_EXIINTMASK | EXI_CSR_EXTINTMASK | EXI_CSR_TCINTMASK) << 32) |
 				  (EXI_CSR_EXIINTMASK | EXI_CSR_EXTINTMASK | EXI_CSR_TCINTMASK);
@@ -289,10 +291,9 @@ void EMU_FASTCALL EXI_Write32(u32 addr, u32 data)
 					EXI_Transfer[(CRVal*8) + Device](addr);
 			}
 
-			exi.cr[CRVal] &= ~EXI_CR_TSTART;				// Complete Transfer Start
-			exi.csr[CRVal] |= EXI_CSR_TCINT;			// Enable CSR Interrupt
-
-			EXI_Update();
+			// The transfer itself is instant, complete it after the time it takes on the bus
+			core_timing::ScheduleEvent(EXI_TRANSFER_TIME((exi.cr[CRVal] & EXI_CR_DMA) ?
+				exi.len[CRVal] : (((exi.cr[CRVal] >> 4) & 3) + 1)), EXITransferEvent, CRVal);
 		}
 		return;
 
@@ -368,6 +369,17 @@ void EXI_Update(void)
 	}
 }
 
+// Desc: Complete an EXI transfer - Event callback, userdata is the channel
+//
+
+static void EXI_TransferComplete(u64 userdata, s64 cycles_late)
+{
+	exi.cr[userdata] &= ~EXI_CR_TSTART;				// Complete Transfer Start
+	exi.csr[userdata] |= EXI_CSR_TCINT;				// Enable CSR Interrupt
+
+	EXI_Update();
+}
+
 // Desc: Initialize EXI Hardware
 //
 
@@ -437,6 +449,8 @@ void EXI_Open(void)
 	exi.csr[0] = EXI_CSR_EXT | EXI_CSR_EXTINT;
 	exi.csr[1] = exi.csr[0];
 
+	EXITransferEvent = core_timing::RegisterEvent("EXI transfer", EXI_TransferComplete);
+
 	MemCard_Open();
 
 	LOG_NOTICE(TEXI, "initialized ok");
@@ -452,4 +466,15 @@ void EXI_Close(void)
 		free(SRAM);
 }
 
+// Desc: Save/Load EXI State, the IPL ROM is rebuilt by EXI_Open
+//
+
+void EXI_DoState(state::Serializer& s)
+{
+	s.Do(exi);
+	s.DoArray(SRAM, 64);
+
+	MemCard_DoState(s);
+}
+
 ////////////////////////////////////////////////////////////
@@ -4,6 +4,8 @@
 #ifndef _HW_EXI_H_
 #define _HW_EXI_H_
 
+#include "state.h"
+
 ////////////////////////////////////////////////////////////
 
 #define EXI_CSR0		0xCC006800
@@ -38,6 +40,8 @@
 #define EXI_CR_DMA					(1 << 1)
 #define EXI_CR_RW					(3 << 2)
 
+#define EXI_TRANSFER_TIME(len)		(64 + (len))	// CPU ticks for a transfer of len bytes
+
 typedef struct t_sEXI
 {
 	u32 csr[3];			// Channel parameter register.
@@ -57,12 +61,14 @@ extern sEXI exi;
 void EXI_Open(void);
 void EXI_Update(void);
 void EXI_Close(void);
+void EXI_DoState(state::Serializer& s);
 
 extern u32 MemCardInterruptSet[2];
 extern u32 MemCardBusy[3];
 
 void MemCard_Open();
 void MemCard_Close();
+void MemCard_DoState(state::Serializer& s);
 void MemCard_Update();
 u32 MemCard_InterruptSet(u32 Channel);
 void MemCard_Transfer(u32 addr);
@@ -378,4 +378,16 @@ void MemCard_Close()
 		free(MemCardData[Channel]);
 	}
 */
+}
+
+// Card contents are stored in their own files and aren't part of the state
+void MemCard_DoState(state::Serializer& s)
+{
+	s.DoArray(WriteBuff, 4);
+	s.Do(WriteBuffPtr);
+	s.Do(WriteBlockCount);
+	s.DoArray(MemCardStatus, 2);
+	s.DoArray(MemCardInterruptSet, 2);
+	s.DoArray(MemCardErasing, 2);
+	s.DoArray(MemCardBusy, 3);
 }
\ No newline at end of file
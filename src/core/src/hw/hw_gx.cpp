@@ -20,31 +20,40 @@
 // GX - Graphics Processor
 ////////////////////////////////////////////////////////////////////////////////
 
+#define GX_FIFO_BURST_SIZE  32  // Write gather pipe burst size
+
+// Desc: When the GP runs on the CPU thread, decode the FIFO each time a write
+// gather burst has been filled instead of after every write
+//
+
+static inline void GX_Fifo_CheckBurst(u32 start_pos)
+{
+    if (((start_pos ^ gp::g_fifo_write_pos) & ~(GX_FIFO_BURST_SIZE - 1)) &&
+        !common::g_config->enable_multicore()) {
+        gp::Fifo_DecodeCommands();
+    }
+}
+
 // Desc: Read/Write from/to GX Hardware
 //
 
 void EMU_FASTCALL GX_Fifo_Write8(u32 addr, u32 data)
 {
-    gp::g_fifo_buffer[gp::g_fifo_write_ptr++] = data;
-    if (!common::g_config->enable_multicore()) {
-        gp::Fifo_DecodeCommand();
-    }
+    u32 start_pos = gp::g_fifo_write_pos;
+    gp::Fifo_Push8(data);
+    GX_Fifo_CheckBurst(start_pos);
 }
 
 void EMU_FASTCALL GX_Fifo_Write16(u32 addr, u32 data)
 {
-    *(u16*)(gp::g_fifo_buffer + gp::g_fifo_write_ptr) = BSWAP16(data);
-    gp::g_fifo_write_ptr += 2;
-    if (!common::g_config->enable_multicore()) {
-        gp::Fifo_DecodeCommand();
-    }
+    u32 start_pos = gp::g_fifo_write_pos;
+    gp::Fifo_Push16(data);
+    GX_Fifo_CheckBurst(start_pos);
 }
 
 void EMU_FASTCALL GX_Fifo_Write32(u32 addr, u32 data) {
-    static u8 cmd = FIFO_GET8(0);
-    
-    *(u32*)(gp::g_fifo_buffer + gp::g_fifo_write_ptr) = BSWAP32(data);
-    gp::g_fifo_write_ptr += 4;
+    u32 start_pos = gp::g_fifo_write_pos;
+    gp::Fifo_Push32(data);
     
     /*if ((data == 0x45000002) && ((cmd & 0xf8) == 0x60)) {
 
@@ -55,9 +64,7 @@ void EMU_FASTCALL GX_Fifo_Write32(u32 addr, u32 data) {
         GX_PE_FINISH = 1;
         PE_Update();
     }*/
-    if (!common::g_config->enable_multicore()) {
-        gp::Fifo_DecodeCommand();
-    }
+    GX_Fifo_CheckBurst(start_pos);
 }
 
 
@@ -73,6 +80,20 @@ u32 EMU_FASTCALL GX_Fifo_Read32(u32 addr)
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Desc: Decode everything that's complete in the FIFO when the GP runs on the
+// CPU thread. Called at the end of a timeslice and on CP register accesses, so
+// a partial burst doesn't sit in the FIFO
+//
+
+void GX_Update(void)
+{
+    if (!common::g_config->enable_multicore()) {
+        gp::Fifo_DecodeCommands();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 // Desc: Open GX Hardware
 //
 
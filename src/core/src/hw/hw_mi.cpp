@@ -114,3 +114,11 @@ void MI_Close(void)
 {
 	//VirtualFree(addr, size, type);
 }
+
+// Desc: Save/Load MI State
+//
+
+void MI_DoState(state::Serializer& s)
+{
+	s.DoArray(MIRegisters, REG_SIZE);
+}
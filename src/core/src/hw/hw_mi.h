@@ -3,6 +3,8 @@
 
 #ifndef _HW_MI_H_
 #define _HW_MI_H_
+
+#include "state.h"
 ////////////////////////////////////////////////////////////
 
 #ifndef MEM_NATIVE_LE32
@@ -36,6 +38,7 @@ extern u8 MIRegisters[REG_SIZE];
 
 void MI_Open(void);
 void MI_Close(void);
+void MI_DoState(state::Serializer& s);
 
 u8		EMU_FASTCALL	MI_Read8(u32 addr);
 void	EMU_FASTCALL	MI_Write8(u32 addr, u32 data);
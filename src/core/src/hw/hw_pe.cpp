@@ -2,6 +2,7 @@
 // (c) 2005,2006 Gekko Team
 
 #include "common.h"
+#include "core_timing.h"
 #include "hw.h"
 #include "hw_pe.h"
 #include "hw_pi.h"
@@ -24,6 +25,8 @@
 #define PE_SR_INT_TOKEN		0x2
 #define PE_SR_INT_FINISH	0x1
 
+#define PE_POLL_TIME		1024		// CPU ticks between checks for GP tokens
+
 #ifndef MEM_NATIVE_LE32
 # define REGPE16(X)			(*((u16 *) &PERegisters[REG_SIZE - (X & REG_MASK) - 2]))
 # define REGPE32(X)			(*((u32 *) &PERegisters[REG_SIZE - (X & REG_MASK) - 4]))
@@ -35,6 +38,7 @@
 u32 GX_PE_FINISH;
 u32 GX_PE_TOKEN;
 u16 GX_PE_TOKEN_VALUE;
+int PEPollEvent;
 
 // PE Registers store Alpha configuration, Z configuration,
 // Dest Alpha, Alpha Mode, and the PE TOKEN
@@ -134,10 +138,32 @@ void PE_Update() {
     }
 }
 
+// Desc: Poll PE Hardware - Event callback, the GP may run on its own thread so the
+// token/finish flags it raises are picked up periodically
+//
+
+static void PE_Poll(u64 userdata, s64 cycles_late) {
+    PE_Update();
+    core_timing::ScheduleEvent(PE_POLL_TIME - cycles_late, PEPollEvent);
+}
+
 // Desc: Initialize PE Hardware
 //
 
 void PE_Open() {
     LOG_NOTICE(TPE, "initialized ok");
     memset(PERegisters, 0, sizeof(PERegisters));
+
+    PEPollEvent = core_timing::RegisterEvent("PE poll", PE_Poll);
+    core_timing::ScheduleEvent(PE_POLL_TIME, PEPollEvent);
+}
+
+// Desc: Save/Load PE State
+//
+
+void PE_DoState(state::Serializer& s) {
+    s.DoArray(PERegisters, REG_SIZE);
+    s.Do(GX_PE_FINISH);
+    s.Do(GX_PE_TOKEN);
+    s.Do(GX_PE_TOKEN_VALUE);
 }
@@ -4,7 +4,10 @@
 #ifndef _HW_PE_H_
 #define _HW_PE_H_
 
+#include "state.h"
+
 void PE_Open(void);
+void PE_DoState(state::Serializer& s);
 void PE_Update(void);
 
 void PE_Token(u16 *token);
@@ -196,4 +196,13 @@ void PI_Open(void)
 	PIInterrupt = 0;
 }
 
+// Desc: Save/Load PI State
+//
+
+void PI_DoState(state::Serializer& s)
+{
+	s.DoArray(PIRegisters, REG_SIZE);
+	s.Do(PIInterrupt);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
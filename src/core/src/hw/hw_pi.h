@@ -4,6 +4,8 @@
 #ifndef _HW_PI_H_
 #define _HW_PI_H_
 
+#include "state.h"
+
 ////////////////////////////////////////////////////////////////////////////////
 
 #define REGPI16(X)			(*((u16 *) &PIRegisters[REG_SIZE - (X & REG_MASK) - 2]))
@@ -48,6 +50,7 @@ u32		PI_CheckForInterrupts();
 void	PI_RequestInterrupt(u32 mask);
 void	PI_ClearInterrupt(unsigned int mask);
 void	PI_Open(void);
+void	PI_DoState(state::Serializer& s);
 void	PI_Update(void);
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -482,3 +482,12 @@ void SI_Open(void)
         SI_POLL_ENB2 |
         SI_POLL_ENB3 );
 }
+
+// Desc: Save/Load SI State
+//
+
+void SI_DoState(state::Serializer& s)
+{
+	s.Do(si);
+	s.DoArray(SIRegisters, REG_SIZE);
+}
@@ -4,6 +4,8 @@
 #ifndef _HW_SI_H_
 #define _HW_SI_H_
 
+#include "state.h"
+
 ////////////////////////////////////////////////////////////
 
 #ifndef MEM_NATIVE_LE32
@@ -122,6 +124,7 @@ inline static u32 PadGetWord1(u32 nPad)
 ////////////////////////////////////////////////////////////
 
 void SI_Open(void);
+void SI_DoState(state::Serializer& s);
 void SI_Poll(void);
 void SI_ProcessCommand(void);
 
@@ -2,6 +2,7 @@
 // (c) 2005,2008 Gekko Team / Wiimu Project
 
 #include "common.h"
+#include "core_timing.h"
 #include "hw.h"
 #include "hw_vi.h"
 #include "hw_pi.h"
@@ -13,6 +14,7 @@
 
 sVI		vi;
 u8		VIRegisters[REG_SIZE];
+int		VIScanlineEvent;
 
 ////////////////////////////////////////////////////////////////////////////////
 // VI - Video Interface
@@ -300,55 +302,51 @@ void VI_YCbCr2RGB(void)
 	}
 }
 
-// Desc: Update VI hardware (Per Scanline)
+// Desc: Update VI hardware (Per Scanline) - Scanline event callback
 //
 
-void VI_Update(void)
+static void VI_Update(u64 userdata, s64 cycles_late)
 {
-	if(ireg.TBR.TBR >= vi.timer)
-	{
-		// Reset Timer
-		vi.timer = ireg.TBR.TBR + vi.tickcount;
-
-		VI_SCANLINE++;
+	VI_SCANLINE++;
 
-		if( VI_SCANLINE == vi.vct[0] ||
-			VI_SCANLINE == vi.vct[1] ||
-			VI_SCANLINE == vi.vct[2] ||
-			VI_SCANLINE == vi.vct[3]
-			)
+	if( VI_SCANLINE == vi.vct[0] ||
+		VI_SCANLINE == vi.vct[1] ||
+		VI_SCANLINE == vi.vct[2] ||
+		VI_SCANLINE == vi.vct[3]
+		)
+	{
+		// Check VSync Interrupts
+
+		if(REGVI32(VI_DI0) & VI_DI_ENB)
+			REGVI32(VI_DI0) |= VI_DI_INT;
+		if(REGVI32(VI_DI1) & VI_DI_ENB)
+			REGVI32(VI_DI1) |= VI_DI_INT;
+		if(REGVI32(VI_DI2) & VI_DI_ENB)
+			REGVI32(VI_DI2) |= VI_DI_INT;
+		if(REGVI32(VI_DI3) & VI_DI_ENB)
+			REGVI32(VI_DI3) |= VI_DI_INT;
+
+		if((REGVI32(VI_DI0) | REGVI32(VI_DI1) | REGVI32(VI_DI2) | REGVI32(VI_DI3))
+			& VI_DI_ENB)
 		{
-			// Check VSync Interrupts
-
-			if(REGVI32(VI_DI0) & VI_DI_ENB)
-				REGVI32(VI_DI0) |= VI_DI_INT;
-			if(REGVI32(VI_DI1) & VI_DI_ENB)
-				REGVI32(VI_DI1) |= VI_DI_INT;
-			if(REGVI32(VI_DI2) & VI_DI_ENB)
-				REGVI32(VI_DI2) |= VI_DI_INT;
-			if(REGVI32(VI_DI3) & VI_DI_ENB)
-				REGVI32(VI_DI3) |= VI_DI_INT;
-
-			if((REGVI32(VI_DI0) | REGVI32(VI_DI1) | REGVI32(VI_DI2) | REGVI32(VI_DI3))
-				& VI_DI_ENB)
-			{
-				PI_RequestInterrupt(PI_MASK_VI);
-			}
+			PI_RequestInterrupt(PI_MASK_VI);
 		}
+	}
 
-		if(VI_SCANLINE > vi.vretrace)
-		{
-			VI_SCANLINE = 1;
+	if(VI_SCANLINE > vi.vretrace)
+	{
+		VI_SCANLINE = 1;
+		vi.frame_count++;
 
-			// Poll Joypads
+		// Poll Joypads
 
-			SI_Poll();
+		SI_Poll();
 
-			// Set Television Mode
+		// Set Television Mode
 
-			VI_SetMode();
+		VI_SetMode();
 
-			// Update Framebuffer (if enabled)
+		// Update Framebuffer (if enabled)
 #pragma todo(Reimplement enable framebuffer feature)
 //			if(cfg.enb_framebuffer)
 //			{
@@ -356,8 +354,10 @@ void VI_Update(void)
 //              OPENGL_DrawFramebuffer();
 //              OPENGL_Render();
 //            }
-		}
 	}
+
+	// Schedule the next scanline, the mode may have changed the line length
+	core_timing::ScheduleEvent((s64)vi.tickcount - cycles_late, VIScanlineEvent);
 }
 
 // Desc: Initialize VI Hardware
@@ -373,13 +373,36 @@ void VI_Open(void)
 	// Assume NTSC until program changes it.
 	vi.is_xfb = false;
 	vi.is_autosync = true;
+	vi.frame_count = 0;
 	vi.framerate = 30;
 	vi.vretrace = VI_NTSC_NON_INTER;
 	vi.tickcount = (((cpu->GetTicksPerSecond() / vi.framerate) / vi.vretrace));
-	vi.timer = 0;
+
+	VIScanlineEvent = core_timing::RegisterEvent("VI scanline", VI_Update);
+	core_timing::ScheduleEvent(vi.tickcount, VIScanlineEvent);
 
 	// Point FB in RAM
 	vi.xfbbuf = &Mem_RAM[0];
 }
 
+// Desc: Save/Load VI State, fb_data is regenerated from the XFB every frame
+//
+
+void VI_DoState(state::Serializer& s)
+{
+	s.DoArray(VIRegisters, REG_SIZE);
+	s.Do(vi.format);
+	s.Do(vi.framerate);
+	s.Do(vi.vretrace);
+	s.Do(vi.tickcount);
+	s.DoArray(vi.vct, 4);
+	s.Do(vi.xfb_addr);
+	s.Do(vi.is_interlaced);
+	s.Do(vi.is_xfb);
+	s.Do(vi.is_autosync);
+
+	if(s.is_reading())
+		vi.xfbbuf = &Mem_RAM[vi.xfb_addr];
+}
+
 ////////////////////////////////////////////////////////////////////////////////
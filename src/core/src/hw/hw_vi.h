@@ -4,6 +4,8 @@
 #ifndef _HW_VI_H_
 #define _HW_VI_H_
 
+#include "state.h"
+
 ////////////////////////////////////////////////////////////////////////////////
 
 #define REGVI16(X)			(*((u16 *) &VIRegisters[REG_SIZE - (X & REG_MASK) - 2]))
@@ -65,7 +67,6 @@ typedef struct t_sVI
 	u16		vretrace;		// Lines Per Frame
 	u32		tickcount;		// Ticks per frame
 	u16		vct[4];			// Vertical Interrupt Position
-	u64		timer;			// Timer for Cycles left
 
 	u32		xfb_addr;		// Address of the external frame buffer.
 
@@ -74,6 +75,7 @@ typedef struct t_sVI
 	bool	is_autosync;	// Used for new demos
 
 	u8*		xfbbuf;			// Pointer to XFB
+	u32		frame_count;	// Frames scanned out since VI_Open
 	u8		fb_data[(480 * 640 * 4)];
 }sVI;
 
@@ -82,7 +84,7 @@ extern sVI vi;
 ////////////////////////////////////////////////////////////////////////////////
 
 void VI_Open(void);
-void VI_Update(void);
+void VI_DoState(state::Serializer& s);
 
 void VI_YCbCr2RGB(void);
 
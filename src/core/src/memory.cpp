@@ -2,7 +2,9 @@
 // (c) 2005,2008 Gekko Team
 
 #include "common.h"
+#include "config.h"
 #include "memory.h"
+#include "fastmem.h"
 #include "hw/hw.h"
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -11,6 +13,7 @@
 //			1/15/06		-	File Created. (ShizZy)
 //			x/x/06		-	Various Updates (Lightning)
 //			2/25/06		-	Implemented early Wii 64mb RAM2 support (ShizZy)
+//			2/6/13		-	Fastmem, RAM/L2 mapped into a host guest address space (ShizZy)
 //
 //			Missing:
 //						
@@ -21,13 +24,21 @@
 
 #pragma push(align)
 #pragma align 4096
-u8 Mem_L2[L2_SIZE]; // L2 Cache
+static u8 Mem_L2Buffer[L2_SIZE]; // L2 Cache
 //u8 Mem_RAM[RAM_SIZE]; // Ram 24mb
-//u8 *Mem_RAM = 0;
 //u8 Mem_RAM2[RAM2_SIZE]; // Ram2 64mb (Wii)
-u8 Mem_RAM[RAM2_SIZE]; // Ram2 64mb (Wii)
+static u8 Mem_RAMBuffer[RAM2_SIZE]; // Ram2 64mb (Wii)
 #pragma pop(align)
 
+// Point at the buffers above, or at the shared fastmem views once fastmem is up
+u8 *Mem_L2 = Mem_L2Buffer;
+u8 *Mem_RAM = Mem_RAMBuffer;
+
+u8 Mem_CodePage[MEM_NUM_PAGES]; // MEM_PAGE_* flags of each RAM page
+u8 Mem_DirtyPage[MEM_NUM_PAGES]; // Pages written since write tracking was last armed
+u32 Mem_VideoStamp[MEM_NUM_PAGES]; // Mem_VideoClock at the last write seen by the video caches
+volatile u32 Mem_VideoClock = 0; // Counts writes to MEM_PAGE_VIDEO and MEM_PAGE_TEXTURE pages
+
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "hw/hw_pe.h"
@@ -41,6 +52,8 @@ u8 Mem_RAM[RAM2_SIZE]; // Ram2 64mb (Wii)
 #include "hw/hw_di.h"
 #include "hw/hw_cp.h"
 
+#include "powerpc/cpu_core.h"
+
 //dummy value incase a read is done to an invalid area to limit code in the dynarec
 static u32 EMU_FASTCALL Read0Mem(u32 Addr)
 {
@@ -108,8 +121,18 @@ void Memory_Open(void)
 //	if(!Mem_RAM)
 //		Mem_RAM = (u8 *)VirtualAlloc(NULL, RAM_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
 
+	// Map RAM/L2 into the fastmem address space, this is only done once
+	if(!fastmem::g_base && common::g_config && common::g_config->enable_fastmem())
+		fastmem::Init(&Mem_RAM, &Mem_L2);
+
 	memset(Mem_RAM, 0, RAM_SIZE);
 	memset(Mem_L2, 0, L2_SIZE);
+	memset(Mem_CodePage, 0, sizeof(Mem_CodePage));
+	memset(Mem_DirtyPage, 0, sizeof(Mem_DirtyPage));
+
+	// RAM was cleared without going through the write checks, every cached list and texture
+	// is stale
+	Memory_StampVideoPages(0, RAM_SIZE);
 
 	LOG_NOTICE(TMEM, "initialized ok");
 }
@@ -117,6 +140,119 @@ void Memory_Open(void)
 void Memory_Close(void)
 {
 //	VirtualFree(Mem_RAM, 0, MEM_RELEASE);
+
+	// The fastmem mappings are kept until exit, the video core may still be reading RAM
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Code Page Tracking
+//
+
+// Desc: Flag a RAM page as holding code the CPU core has decoded/compiled
+//
+
+void Memory_MarkCodePage(u32 addr)
+{
+	common::AtomicOr(Mem_CodePage[(addr & RAM_MASK) >> MEM_PAGE_SHIFT], MEM_PAGE_CODE);
+}
+
+// Desc: A flagged page has been written to, record it as dirty and drop everything the
+//		 CPU core derived from it. Clearing the flags lets later writes take the fast path,
+//		 and the video core rechecks the display lists and textures read from a page stamped
+//		 by Memory_StampVideoPages.
+//		 The video core sets its flags from the GPU thread, all updates of Mem_CodePage are
+//		 atomic so neither thread loses a flag the other one just set or cleared.
+//
+
+void Memory_InvalidateCodePage(u32 addr)
+{
+	addr &= RAM_MASK;
+	u32 page = addr >> MEM_PAGE_SHIFT;
+	u8 flags = common::AtomicExchange(Mem_CodePage[page], 0);
+
+	if(flags & MEM_PAGE_TRACK_WRITE)
+		Mem_DirtyPage[page] = 1;
+
+	if(flags & (MEM_PAGE_VIDEO | MEM_PAGE_TEXTURE))
+		Memory_StampVideoPages(addr, 1);
+
+	if((flags & MEM_PAGE_CODE) && cpu)
+		cpu->InvalidateCode(addr & ~MEM_PAGE_MASK, MEM_PAGE_SIZE);
+}
+
+// Desc: Clear the dirty pages and arm write tracking on all of RAM, used by snapshots to
+//		 find the pages that changed since the previous one. Guest writes (fastmem and JIT
+//		 stores included) already leave the fast path on a flagged page, so this costs one
+//		 slow write per page and snapshot.
+//
+
+void Memory_TrackWrites(void)
+{
+	for(int i = 0; i < MEM_NUM_PAGES; i++)
+		common::AtomicOr(Mem_CodePage[i], MEM_PAGE_TRACK_WRITE);
+
+	memset(Mem_DirtyPage, 0, sizeof(Mem_DirtyPage));
+}
+
+// Desc: Host code writing RAM through Mem_RAM directly (HLE, FIFO player) bypasses the
+//		 accessors, it has to report the range itself
+//
+
+void Memory_MarkDirty(u32 addr, u32 size)
+{
+	if(!size)
+		return;
+
+	u32 first = (addr & RAM_MASK) >> MEM_PAGE_SHIFT;
+	u32 last = ((addr + size - 1) & RAM_MASK) >> MEM_PAGE_SHIFT;
+
+	for(u32 page = first; ; page = (page + 1) & (MEM_NUM_PAGES - 1))
+	{
+		if(Mem_CodePage[page])
+			Memory_InvalidateCodePage(page << MEM_PAGE_SHIFT);
+		if(page == last)
+			break;
+	}
+}
+
+// Desc: Mark a range as written for the video core's display list and texture caches,
+//		 without touching the other flags. Called for guest writes to MEM_PAGE_VIDEO and
+//		 MEM_PAGE_TEXTURE pages, and by the video core for EFB copies, which are kept on the
+//		 host GPU rather than written to RAM.
+//
+
+void Memory_StampVideoPages(u32 addr, u32 size)
+{
+	if(!size)
+		return;
+
+	u32 first = (addr & RAM_MASK) >> MEM_PAGE_SHIFT;
+	u32 last = ((addr + size - 1) & RAM_MASK) >> MEM_PAGE_SHIFT;
+
+	// The CPU and the GPU thread both stamp pages
+	common::AtomicIncrement(Mem_VideoClock);
+	u32 stamp = common::AtomicLoad(Mem_VideoClock);
+
+	for(u32 page = first; ; page = (page + 1) & (MEM_NUM_PAGES - 1))
+	{
+		Mem_VideoStamp[page] = stamp;
+		if(page == last)
+			break;
+	}
+}
+
+// Desc: Replace the contents of a RAM page, used when a save state is loaded
+//
+
+void Memory_LoadPage(u32 page, const u8* data)
+{
+	u32 addr = page << MEM_PAGE_SHIFT;
+
+	if(Mem_CodePage[page] & (MEM_PAGE_CODE | MEM_PAGE_VIDEO | MEM_PAGE_TEXTURE))
+		Memory_InvalidateCodePage(addr);
+
+	memcpy(&Mem_RAM[addr], data, MEM_PAGE_SIZE);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -124,7 +260,7 @@ void Memory_Close(void)
 // Memory Reads
 //
 
-u8 EMU_FASTCALL Memory_Read8(u32 addr)
+u8 EMU_FASTCALL Memory_SlowRead8(u32 addr)
 {
 //	if (addr >= 0x90000000 && addr < 0x94000000) // MEM 2 (Wii)
 //		return Mem_RAM2[(addr ^ 3) & RAM2_MASK];
@@ -155,7 +291,7 @@ u8 EMU_FASTCALL Memory_Read8(u32 addr)
 
 //
 
-u16 EMU_FASTCALL Memory_Read16(u32 addr)
+u16 EMU_FASTCALL Memory_SlowRead16(u32 addr)
 {
 /*	if (addr >= 0x90000000 && addr < 0x94000000) // MEM 2 (Wii)
 	{
@@ -202,7 +338,7 @@ u16 EMU_FASTCALL Memory_Read16(u32 addr)
 
 //
 
-u32 EMU_FASTCALL Memory_Read32(u32 addr)
+u32 EMU_FASTCALL Memory_SlowRead32(u32 addr)
 {
 /*	if (addr >= 0x90000000 && addr < 0x94000000) // MEM 2 (Wii)
 	{
@@ -265,7 +401,7 @@ u64 EMU_FASTCALL Memory_Read64(u32 addr)
 // Memory Writes
 //
 
-void EMU_FASTCALL Memory_Write8(u32 addr, u32 data)
+void EMU_FASTCALL Memory_SlowWrite8(u32 addr, u32 data)
 {
 /*	if(((addr ^ 3) & RAM_MASK) == (0x803C4BDC & RAM_MASK))
 	{
@@ -280,6 +416,7 @@ void EMU_FASTCALL Memory_Write8(u32 addr, u32 data)
 	}
 */	if( addr < 0xC8000000 )				// Logical RAM
 	{
+		MEMORY_CHECK_CODE_WRITE(addr);
 		Mem_RAM[(addr ^ 3) & RAM_MASK] = data;
 		return;
 	}
@@ -306,7 +443,7 @@ void EMU_FASTCALL Memory_Write8(u32 addr, u32 data)
 
 //
 
-void EMU_FASTCALL Memory_Write16(u32 addr, u32 data)
+void EMU_FASTCALL Memory_SlowWrite16(u32 addr, u32 data)
 {
 /*	if((((addr & RAM_MASK) <= (0x803C4BDC & RAM_MASK)) && (((addr & RAM_MASK)+1) >= (0x803C4BDC & RAM_MASK))))
 	{
@@ -321,11 +458,13 @@ void EMU_FASTCALL Memory_Write16(u32 addr, u32 data)
 	}
 */	if( addr < 0xC8000000 )				// Logical RAM
 	{
+		MEMORY_CHECK_CODE_WRITE(addr);
 		if(!(addr & 1))
 			*(u16 *)(&Mem_RAM[(addr ^ 2) & RAM_MASK]) = data;
 		else
 		{
 			addr = addr & RAM_MASK;
+			MEMORY_CHECK_CODE_WRITE(addr + 1);
 			Mem_RAM[(addr + 1) ^ 3] = (u8)data;
 			Mem_RAM[(addr + 0) ^ 3] = (u8)(data >> 8);
 		}
@@ -362,7 +501,7 @@ void EMU_FASTCALL Memory_Write16(u32 addr, u32 data)
 
 //
 
-void EMU_FASTCALL Memory_Write32(u32 addr, u32 data)
+void EMU_FASTCALL Memory_SlowWrite32(u32 addr, u32 data)
 {
 /*	if((((addr & RAM_MASK) <= (0x803C4BDC & RAM_MASK)) && (((addr & RAM_MASK)+3) >= (0x803C4BDC & RAM_MASK))))
 	{
@@ -378,10 +517,12 @@ void EMU_FASTCALL Memory_Write32(u32 addr, u32 data)
 */	if( addr < 0xC8000000 )				// Logical RAM
 	{
 		addr &= RAM_MASK;
+		MEMORY_CHECK_CODE_WRITE(addr);
 		if(!(addr & 3))
 			*(u32 *)(&Mem_RAM[addr]) = data;
 		else
 		{
+			MEMORY_CHECK_CODE_WRITE(addr + 3);
 			Mem_RAM[(addr + 3) ^ 3] = (u8)data;
 			Mem_RAM[(addr + 2) ^ 3] = (u8)(data >> 8);
 			Mem_RAM[(addr + 1) ^ 3] = (u8)(data >> 16);
@@ -426,7 +567,91 @@ void EMU_FASTCALL Memory_Write32(u32 addr, u32 data)
 void EMU_FASTCALL Memory_Write64(u32 addr, u64 data)
 {
 	addr &= RAM_MASK;
+	MEMORY_CHECK_CODE_WRITE(addr);
+	MEMORY_CHECK_CODE_WRITE(addr + 7);
 	*(u32 *)(&Mem_RAM[addr]) = (u32)(data >> 32);
 	*(u32 *)(&Mem_RAM[addr + 4]) = (u32)data;
 	return;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Memory Access
+//
+// With fastmem RAM and L2 are a single host load/store away. Anything else faults
+// and the fastmem handler completes it through the Memory_Slow* functions above.
+// Unaligned accesses and writes to pages holding decoded code take the slow path.
+//
+
+u8 EMU_FASTCALL Memory_Read8(u32 addr)
+{
+#ifdef EMU_FASTMEM
+	if(fastmem::g_base)
+		return fastmem::Read8(addr);
+#endif
+	return Memory_SlowRead8(addr);
+}
+
+//
+
+u16 EMU_FASTCALL Memory_Read16(u32 addr)
+{
+#ifdef EMU_FASTMEM
+	if(fastmem::g_base && !(addr & 1))
+		return fastmem::Read16(addr);
+#endif
+	return Memory_SlowRead16(addr);
+}
+
+//
+
+u32 EMU_FASTCALL Memory_Read32(u32 addr)
+{
+#ifdef EMU_FASTMEM
+	if(fastmem::g_base && !(addr & 3))
+		return fastmem::Read32(addr);
+#endif
+	return Memory_SlowRead32(addr);
+}
+
+//
+
+void EMU_FASTCALL Memory_Write8(u32 addr, u32 data)
+{
+#ifdef EMU_FASTMEM
+	if(fastmem::g_base && !Mem_CodePage[(addr & RAM_MASK) >> MEM_PAGE_SHIFT])
+	{
+		fastmem::Write8(addr, (u8)data);
+		return;
+	}
+#endif
+	Memory_SlowWrite8(addr, data);
+}
+
+//
+
+void EMU_FASTCALL Memory_Write16(u32 addr, u32 data)
+{
+#ifdef EMU_FASTMEM
+	if(fastmem::g_base && !(addr & 1) && !Mem_CodePage[(addr & RAM_MASK) >> MEM_PAGE_SHIFT])
+	{
+		fastmem::Write16(addr, (u16)data);
+		return;
+	}
+#endif
+	Memory_SlowWrite16(addr, data);
+}
+
+//
+
+void EMU_FASTCALL Memory_Write32(u32 addr, u32 data)
+{
+#ifdef EMU_FASTMEM
+	if(fastmem::g_base && !(addr & 3) && !Mem_CodePage[(addr & RAM_MASK) >> MEM_PAGE_SHIFT])
+	{
+		fastmem::Write32(addr, data);
+		return;
+	}
+#endif
+	Memory_SlowWrite32(addr, data);
+}
@@ -21,6 +21,11 @@
 #define REG_SIZE					0x100
 #define REG_MASK					0xFF
 
+#define MEM_PAGE_SHIFT				12
+#define MEM_PAGE_SIZE				(1 << MEM_PAGE_SHIFT)
+#define MEM_PAGE_MASK				(MEM_PAGE_SIZE - 1)
+#define MEM_NUM_PAGES				(RAM_SIZE >> MEM_PAGE_SHIFT)
+
 #define MEM8(X)						*MEMPTR8(X)
 #define MEM16(X)					*MEMPTR16(X)
 #define MEM32(X)					*MEMPTR32(X)
@@ -54,17 +59,38 @@
 #define DATA32(data)				BSWAP32(data)
 #define DATA64(data)				BSWAP64(data)
 
-extern u8 Mem_L2[L2_SIZE];
+extern u8 *Mem_L2;
 //extern u8 Mem_RAM[RAM_SIZE];
-//extern u8 *Mem_RAM;
 //extern u8 Mem_RAM2[RAM2_SIZE];
-extern u8 Mem_RAM[RAM2_SIZE];
+extern u8 *Mem_RAM;					// RAM2_SIZE bytes, host mapped when fastmem is active
+extern u8 Mem_CodePage[MEM_NUM_PAGES];	// MEM_PAGE_* flags, writes to a flagged page take the slow path
+extern u8 Mem_DirtyPage[MEM_NUM_PAGES];	// Pages written since the last Memory_TrackWrites
+extern u32 Mem_VideoStamp[MEM_NUM_PAGES];	// Mem_VideoClock when a MEM_PAGE_VIDEO/TEXTURE page was last written
+extern volatile u32 Mem_VideoClock;		// Incremented on every Memory_StampVideoPages
+
+// Mem_CodePage flags
+#define MEM_PAGE_CODE				0x01	// The CPU core has decoded/compiled code from the page
+#define MEM_PAGE_TRACK_WRITE		0x02	// Record the first write to the page in Mem_DirtyPage
+#define MEM_PAGE_VIDEO				0x04	// The video core has cached a display list from the page
+#define MEM_PAGE_TEXTURE			0x08	// The video core has cached a texture from the page
 		
 ////////////////////////////////////////////////////////////
 
 void Memory_Open(void);
 void Memory_Close(void);
 
+void Memory_MarkCodePage(u32 addr);
+void Memory_InvalidateCodePage(u32 addr);
+
+void Memory_TrackWrites(void);
+void Memory_MarkDirty(u32 addr, u32 size);
+void Memory_LoadPage(u32 page, const u8* data);
+void Memory_StampVideoPages(u32 addr, u32 size);
+
+// Notify the CPU core/write tracking when a guest write lands on a flagged page
+#define MEMORY_CHECK_CODE_WRITE(addr)	if(Mem_CodePage[((addr) & RAM_MASK) >> MEM_PAGE_SHIFT]) \
+											Memory_InvalidateCodePage(addr)
+
 //
 
 u8 EMU_FASTCALL Memory_Read8(u32 addr);
@@ -77,6 +103,15 @@ void EMU_FASTCALL Memory_Write16(u32 addr, u32 data);
 void EMU_FASTCALL Memory_Write32(u32 addr, u32 data);
 void EMU_FASTCALL Memory_Write64(u32 addr, u64 data);
 
+// Full address decoding, never goes through the fastmem mapping
+u8 EMU_FASTCALL Memory_SlowRead8(u32 addr);
+u16 EMU_FASTCALL Memory_SlowRead16(u32 addr);
+u32 EMU_FASTCALL Memory_SlowRead32(u32 addr);
+
+void EMU_FASTCALL Memory_SlowWrite8(u32 addr, u32 data);
+void EMU_FASTCALL Memory_SlowWrite16(u32 addr, u32 data);
+void EMU_FASTCALL Memory_SlowWrite32(u32 addr, u32 data);
+
 ////////////////////////////////////////////////////////////
 
 //
@@ -272,6 +272,13 @@ GekkoF GekkoCPU::Exception(tGekkoException which)
 	printf("GekkoCPU:Exception\n");
 }
 
+// Desc: Notify the core that guest code in [addr, addr+size) may have changed
+//
+
+GekkoF GekkoCPU::InvalidateCode(u32 addr, u32 size)
+{
+}
+
 u64 GekkoCPU::GetTicks()
 {
 	return ireg.TBR.TBR;
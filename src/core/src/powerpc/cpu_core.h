@@ -110,6 +110,7 @@ public:
 	virtual GekkoF Halt();
 	virtual GekkoF Exception(tGekkoException which);
 	virtual u32 GetTicksPerSecond();
+	virtual GekkoF InvalidateCode(u32 addr, u32 size);
 
 	GekkoF StartPipe(u32 IsClient);
 	void SendPipeData(void *Data, u32 DataLen);
@@ -288,7 +289,10 @@ extern class GekkoCPU*	cpu;
 #define I_XER	1
 #define I_LR	8
 #define I_CTR	9
+#define I_DSISR	18
+#define I_DAR	19
 #define I_DEC	22
+#define I_SDR1	25
 #define I_SRR0	26
 #define I_SRR1	27
 #define I_TBL	284
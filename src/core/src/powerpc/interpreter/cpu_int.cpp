@@ -12,11 +12,14 @@
 #include "log.h"
 
 #include "core.h"
+#include "core_timing.h"
 #include "cpu_int.h"
+#include "cpu_int_quantize.h"
 #include "hw/hw.h"
 #include "powerpc/cpu_core.h"
 #include "powerpc/cpu_core_regs.h"
 #include "powerpc/cpu_opsgroup.h"
+#include "powerpc/mmu.h"
 #include "powerpc/disassembler/ppc_disasm.h"
 
 u32			GekkoCPUInterpreter::RotMask[32][32];
@@ -34,6 +37,11 @@ u32			GekkoCPUInterpreter::exception;
 
 u32			GekkoCPUInterpreter::LastFinishedOp;
 
+GekkoCPUInterpreter::DecodedOp*	GekkoCPUInterpreter::DecodeCache[MEM_NUM_PAGES];
+
+GekkoCPUInterpreter::IdleLoopEntry	GekkoCPUInterpreter::IdleLoopCache[IDLE_LOOP_CACHE_SIZE];
+bool		GekkoCPUInterpreter::IdleSkipping;
+
 //#define		PRINT_INSTR_USAGE
 #ifdef PRINT_INSTR_USAGE
 u32			InstrID;
@@ -97,6 +105,8 @@ GekkoCPUInterpreter::GekkoCPUInterpreter()
 	for(i=0; GekkoIntOpsGroupMain[i].Position != -1; i++)
 		GekkoCPUOpset[GekkoIntOpsGroupMain[i].Position] = GekkoIntOpsGroupMain[i].OpPtr;
 
+	memset(DecodeCache, 0, sizeof(DecodeCache));
+
 	memset(&ireg, 0, sizeof(ireg));
 	LOG_NOTICE(TPOWERPC, "interpreter initialized ok");
 }
@@ -143,6 +153,12 @@ GekkoCPUInterpreter::~GekkoCPUInterpreter()
 		Halt();
 		hGekkoThread = NULL;
 	}
+
+	for(x = 0; x < MEM_NUM_PAGES; x++)
+	{
+		delete[] DecodeCache[x];
+		DecodeCache[x] = NULL;
+	}
 }
 
 GekkoF GekkoCPUInterpreter::Open(u32 entry_point)
@@ -154,7 +170,9 @@ GekkoF GekkoCPUInterpreter::Open(u32 entry_point)
 
 	mode = 0;
 
+	u64 old_tbr = ireg.TBR.TBR;
 	ireg.TBR.TBR = 0;
+	core_timing::TimeBaseWritten(old_tbr);	// Hardware events are already scheduled
 	opcode = 0;
 	PClast = 0;
 
@@ -171,6 +189,9 @@ GekkoF GekkoCPUInterpreter::Open(u32 entry_point)
 	for(i = 0; i < 1024; i++) ireg.spr[ i ] = 0x0;
 	for(i = 0; i < 16; i++) ireg.sr[i] = 0x0;
 
+	mmu::Init();
+	psq::Init();
+
 	// Fill Rot Mask
     for(mb=0; mb<32; mb++)
     {
@@ -222,6 +243,12 @@ GekkoF GekkoCPUInterpreter::Open(u32 entry_point)
 	if(DumpOp0)
 		GekkoCPUOpset[0] = GekkoInt(DUMP_OPS);
 
+	FlushDecodeCache();
+
+	// Idle loops are fast-forwarded to the next hardware event if enabled
+	memset(IdleLoopCache, 0, sizeof(IdleLoopCache));
+	IdleSkipping = (common::g_config != NULL) && common::g_config->enable_idle_skipping();
+
 	LastFinishedOp = entry_point;
 
 	if(PipeHandle)
@@ -521,6 +548,234 @@ GekkoF GekkoCPUInterpreter::Exception(tGekkoException which)
 	exception = 1;
 }
 
+////////////////////////////////////////////////////////////
+
+// Desc: Resolve an instruction word down to its leaf handler
+//
+
+optable GekkoCPUInterpreter::ResolveOp(u32 op)
+{
+	opcode = op;
+	optable iPtr = GekkoCPUOpset[OPCD];
+
+	if(iPtr == GekkoInt(Ops_Group4))
+		iPtr = GekkoCPUOpsGroup4Table[XO3];
+	else if(iPtr == GekkoInt(Ops_Group19))
+		iPtr = GekkoCPUOpsGroup19Table[XO0];
+	else if(iPtr == GekkoInt(Ops_Group31))
+		iPtr = GekkoCPUOpsGroup31Table[XO0];
+	else if(iPtr == GekkoInt(Ops_Group59))
+		iPtr = GekkoCPUOpsGroup59Table[XO3];
+	else if(iPtr == GekkoInt(Ops_Group63))
+		iPtr = GekkoCPUOpsGroup63Table[XO3];
+
+	if(iPtr == GekkoInt(Ops_Group4XO0))
+		iPtr = GekkoCPUOpsGroup4XO0Table[XO0];
+	else if(iPtr == GekkoInt(Ops_Group63XO0))
+		iPtr = GekkoCPUOpsGroup63XO0Table[XO0];
+
+	return iPtr;
+}
+
+// Desc: Fetch the decoded instruction at addr, decoding it on a miss
+//
+
+GekkoCPUInterpreter::DecodedOp* GekkoCPUInterpreter::DecodeOp(u32 addr)
+{
+	u32 offset = addr & RAM_MASK;
+	DecodedOp* page = DecodeCache[offset >> MEM_PAGE_SHIFT];
+
+	if(!page)
+	{
+		page = new DecodedOp[DECODE_OPS_PER_PAGE];
+		memset(page, 0, sizeof(DecodedOp) * DECODE_OPS_PER_PAGE);
+		DecodeCache[offset >> MEM_PAGE_SHIFT] = page;
+	}
+
+	DecodedOp* op = &page[(offset & MEM_PAGE_MASK) >> 2];
+
+	if(!op->Handler)
+	{
+		op->Opcode = *(u32*)(&Mem_RAM[offset]);
+		op->Handler = ResolveOp(op->Opcode);
+
+		// Writes to this page now have to come back and invalidate us
+		Memory_MarkCodePage(offset);
+	}
+
+	return op;
+}
+
+// Desc: Drop all decoded instructions
+//
+
+GekkoF GekkoCPUInterpreter::FlushDecodeCache()
+{
+	for(int i = 0; i < MEM_NUM_PAGES; i++)
+	{
+		if(DecodeCache[i])
+			memset(DecodeCache[i], 0, sizeof(DecodedOp) * DECODE_OPS_PER_PAGE);
+	}
+}
+
+// Desc: Guest code in [addr, addr+size) changed (icbi or a write to a code page)
+//
+
+GekkoF GekkoCPUInterpreter::InvalidateCode(u32 addr, u32 size)
+{
+	u32 offset = addr & RAM_MASK & ~3;
+	u32 end = (addr & RAM_MASK) + size;
+
+	if(end > RAM_SIZE)
+		end = RAM_SIZE;
+
+	for(; offset < end; offset += 4)
+	{
+		DecodedOp* page = DecodeCache[offset >> MEM_PAGE_SHIFT];
+
+		if(page)
+			page[(offset & MEM_PAGE_MASK) >> 2].Handler = NULL;
+	}
+
+	// Drop idle loop results for loops that run into the range
+	u32 start = addr & RAM_MASK;
+	u32 back = (IDLE_LOOP_MAX_LENGTH - 1) * 4;
+
+	start = (start > back) ? (start - back) : 0;
+
+	for(int i = 0; i < IDLE_LOOP_CACHE_SIZE; i++)
+	{
+		u32 loop = IdleLoopCache[i].Address & RAM_MASK;
+
+		if(IdleLoopCache[i].Address && loop >= start && loop < end)
+			IdleLoopCache[i].Address = 0;
+	}
+}
+
+// Desc: Check whether the loop starting at addr only polls memory, i.e. each
+// iteration does exactly the same thing until an interrupt or hardware changes
+// what it reads. Loops like this wait for a VI/PI flag or an interrupt handler.
+//
+
+bool GekkoCPUInterpreter::AnalyzeIdleLoop(u32 addr)
+{
+	u32 written = 0;		// GPRs written by the loop
+	u32 read_first = 0;		// GPRs read before the loop writes them
+
+	for(u32 i = 0; i < IDLE_LOOP_MAX_LENGTH; i++)
+	{
+		u32 pc = addr + (i * 4);
+		u32 op = *(u32*)(&Mem_RAM[pc & RAM_MASK]);
+		u32 d = (op >> 21) & 0x1F;
+		u32 a = (op >> 16) & 0x1F;
+		u32 b = (op >> 11) & 0x1F;
+		u32 reads = 0;
+		u32 writes = 0;
+
+		switch(op >> 26)
+		{
+		case 10:	// cmpli
+		case 11:	// cmpi
+			reads = (1 << a);
+			break;
+
+		case 21:	// rlwinmx
+		case 24:	// ori
+		case 28:	// andi.
+			reads = (1 << d);
+			writes = (1 << a);
+			break;
+
+		case 32:	// lwz
+		case 34:	// lbz
+		case 40:	// lhz
+			reads = a ? (1 << a) : 0;
+			writes = (1 << d);
+			break;
+
+		case 31:
+			switch((op >> 1) & 0x3FF)
+			{
+			case 0:		// cmp
+			case 32:	// cmpl
+				reads = (1 << a) | (1 << b);
+				break;
+
+			case 23:	// lwzx
+			case 87:	// lbzx
+			case 279:	// lhzx
+				reads = (a ? (1 << a) : 0) | (1 << b);
+				writes = (1 << d);
+				break;
+
+			default:
+				return false;
+			}
+			break;
+
+		case 16:	// bcx - must close the loop without touching CTR or LR
+			if(!(d & 0x04) || (op & 3))
+				return false;
+			if((pc + EXTS(op & 0xFFFC, 16)) != addr)
+				return false;
+			return !(read_first & written);
+
+		case 18:	// bx
+			if(op & 3)
+				return false;
+			if((pc + EXTS(op & 0x03FFFFFC, 26)) != addr)
+				return false;
+			return !(read_first & written);
+
+		default:
+			return false;
+		}
+
+		read_first |= reads & ~written;
+		written |= writes;
+	}
+
+	return false;
+}
+
+// Desc: Lookup whether the loop starting at addr is an idle loop
+//
+
+bool GekkoCPUInterpreter::IsIdleLoop(u32 addr)
+{
+	IdleLoopEntry* entry = &IdleLoopCache[(addr >> 2) & (IDLE_LOOP_CACHE_SIZE - 1)];
+
+	if(entry->Address != addr)
+	{
+		entry->Address = addr;
+		entry->IsIdle = AnalyzeIdleLoop(addr);
+
+		// Writes to the loop now have to come back and invalidate us
+		Memory_MarkCodePage(addr);
+		Memory_MarkCodePage(addr + (IDLE_LOOP_MAX_LENGTH - 1) * 4);
+	}
+
+	return entry->IsIdle != 0;
+}
+
+// Desc: Fast-forward the time base over an idle loop, up to the next hardware
+// event or decrementer underflow, whichever comes first
+//
+
+GekkoF GekkoCPUInterpreter::SkipIdleLoop()
+{
+	s64 cycles = core_timing::GetTicksUntilNextEvent();
+
+	if(cycles > (s64)DEC)
+		cycles = DEC;
+
+	if(cycles <= 0)
+		return;
+
+	ireg.TBR.TBR += cycles;
+	DEC -= (u32)cycles;
+}
+
 u32 GekkoCPUInterpreter::GetTicksPerSecond()
 {
 	return (GEKKO_CLOCK / 4) / 3;
@@ -535,6 +790,7 @@ GekkoF GekkoCPUInterpreter::ExecuteInstruction(void)
 	static int is_dec=0;
 	u32		InstCount;
 	u32		Ret;
+	u32		LoopPC;
 
 	if(DumpOp0)
 	{
@@ -639,6 +895,7 @@ SkipFlipperUpdate:
 //	Flipper_Update();
 #else
 	InstCount = 0;
+	LoopPC = ireg.PC;
 
 	for(;;)
 	{
@@ -653,13 +910,18 @@ SkipFlipperUpdate:
 			break;
 		}*/
 
-		opcode = PTR_PC;
-		GekkoFP iPtr = GekkoCPUOpset[OPCD];
+		// Instruction fetch, an ISI leaves us at the exception vector
+		u32 fetch_addr = ireg.PC;
+		if(mmu::g_translate && !mmu::TranslateInstruction(&fetch_addr))
+			break;
+
+		DecodedOp* op = DecodeOp(fetch_addr);
+		opcode = op->Opcode;
 
 #ifdef PRINT_INSTR_USAGE
 		InstrID = OPCD << 10;
 #endif
-		iPtr();
+		op->Handler();
 		InstCount++;
 
 #ifdef PRINT_INSTR_USAGE
@@ -684,6 +946,11 @@ SkipFlipperUpdate:
 	DEC -= InstCount;
 	ireg.IC += InstCount;
 
+	// Spinning in a loop that only waits on hardware, jump ahead to the next event
+	if(IdleSkipping && !mmu::g_translate && (branch == OPCODE_BRANCH) && (ireg.PC == LoopPC) &&
+		IsIdleLoop(LoopPC))
+		SkipIdleLoop();
+
 	if(branch && !(branch & OPCODE_RFI))
 	{
 		Ret = Flipper_Update();
@@ -47,6 +47,33 @@ private:
 	static u32			RotMask[32][32];
 	static u32			LastFinishedOp;
 
+	// Decoded instruction, cached per guest PC so the hot path skips
+	// the fetch and the extended opcode table walk
+	typedef struct
+	{
+		optable	Handler;		// Leaf handler, NULL if not decoded yet
+		u32		Opcode;			// Instruction word, operands are decoded from it
+	} DecodedOp;
+
+#define DECODE_OPS_PER_PAGE	(MEM_PAGE_SIZE >> 2)
+	static DecodedOp*	DecodeCache[MEM_NUM_PAGES];
+
+	static DecodedOp*	DecodeOp(u32 addr);
+	static GekkoF		FlushDecodeCache();
+
+	// Result of the idle loop analysis, cached per loop start address
+	typedef struct
+	{
+		u32		Address;		// Loop start address, 0 if unused
+		u32		IsIdle;			// Nonzero if the loop only polls
+	} IdleLoopEntry;
+
+#define IDLE_LOOP_CACHE_SIZE	256
+#define IDLE_LOOP_MAX_LENGTH	8
+	static IdleLoopEntry	IdleLoopCache[IDLE_LOOP_CACHE_SIZE];
+
+	static bool			AnalyzeIdleLoop(u32 addr);
+
 	static OpData GekkoIntOpsGroup4XO0[];
 	static OpData GekkoIntOpsGroup4[];
 	static OpData GekkoIntOpsGroup19[];
@@ -65,9 +92,6 @@ private:
 	static u32			LastNewStack[CPU_OPSTORE_COUNT * 64];
 	static u32			LastOpEntry;
 
-	static u32			branch;
-	static u32			exception;
-
 #define OPCODE_BRANCH	1
 #define OPCODE_RFI		2
 
@@ -81,6 +105,15 @@ private:
 	static GekkoIntOpDecl(Ops_Group63XO0);
 
 protected:
+	static u32			branch;
+	static u32			exception;
+
+	static optable		ResolveOp(u32 op);
+
+	static bool			IdleSkipping;
+	static bool			IsIdleLoop(u32 addr);
+	static GekkoF		SkipIdleLoop();
+
 	static GekkoF	Tick();
 
 public:
@@ -100,6 +133,7 @@ public:
 	GekkoF	Start();
 
 	GekkoF	Exception(tGekkoException which);
+	GekkoF	InvalidateCode(u32 addr, u32 size);
 
 	u32	GetTicksPerSecond();
 
@@ -3,12 +3,16 @@
 ////////////////////////////////////////////////////////////
 
 #include "common.h"
+#include "profiler.h"
+#include "core_timing.h"
 #include "cpu_int.h"
+#include "cpu_int_quantize.h"
 #include "hw/hw_cp.h"
 #include "hle/hle.h"
 #include "dvd/realdvd.h"
 #include "dvd/loader.h"
 #include "powerpc/cpu_core_regs.h"
+#include "powerpc/mmu.h"
 #include "powerpc/disassembler/ppc_disasm.h"
 
 ////////////////////////////////////////////////////////////
@@ -254,6 +258,8 @@ GekkoIntOp(HLE)
     hle_addr = Memory_Read32(ireg.PC+8);
 
     ExecuteFunctionHLE = (HLEFuncPtr)g_hle_func_table[hle_addr & (MAX_HLE_FUNCTIONS-1)];
+
+	common::profiler::ScopedTimer timer(common::profiler::kSection_HLE);
 	ExecuteFunctionHLE();
 }
 
@@ -713,6 +719,8 @@ GekkoIntOp(EXTSH)
 GekkoIntOp(ICBI)
 {
 	//Instruction Cache Block Invalidate
+	u32 ea = (rA) ? (RRA + RRB) : RRB;
+	cpu->InvalidateCode(ea & ~31, 32);
 }
 
 GekkoIntOp(ISYNC)
@@ -810,6 +818,7 @@ GekkoIntOp(MTSPR)
 	u32 reg = ((rB << 5) | rA);
 	u32 data;
 	u32 i;
+	u64 old_tbr = ireg.TBR.TBR;
 //	u32 OldVal;
 
 //	OldVal = ireg.spr[reg];
@@ -820,10 +829,12 @@ GekkoIntOp(MTSPR)
 	{
 	case I_TBL:
 		ireg.TBR.TBL = RRS;
+		core_timing::TimeBaseWritten(old_tbr);
 		break;
 
 	case I_TBU:
 		ireg.TBR.TBU = RRS;
+		core_timing::TimeBaseWritten(old_tbr);
 		break;
 
 	case I_DMAL:
@@ -852,6 +863,19 @@ GekkoIntOp(MTSPR)
 	case I_WPAR:
 		CP_Update(RRS);
 		break;		
+
+	case I_IBAT0U: case I_IBAT0L: case I_IBAT1U: case I_IBAT1L:
+	case I_IBAT2U: case I_IBAT2L: case I_IBAT3U: case I_IBAT3L:
+	case I_DBAT0U: case I_DBAT0L: case I_DBAT1U: case I_DBAT1L:
+	case I_DBAT2U: case I_DBAT2L: case I_DBAT3U: case I_DBAT3L:
+	case I_SDR1:
+		mmu::UpdateTranslation();
+		break;
+
+	case I_GQR: case (I_GQR + 1): case (I_GQR + 2): case (I_GQR + 3):
+	case (I_GQR + 4): case (I_GQR + 5): case (I_GQR + 6): case (I_GQR + 7):
+		psq::UpdateQuantizer(reg - I_GQR);
+		break;
 /*
 	case I_GQR:
 	case (I_GQR + 1):
@@ -873,11 +897,13 @@ GekkoIntOp(MTSPR)
 GekkoIntOp(MTSR)
 {
 	ireg.sr[rA & 0xf] = RRS;
+	mmu::InvalidateTLB();
 }
 
 GekkoIntOp(MTSRIN)
 {
 	ireg.sr[RRB >> 28] = RRS;
+	mmu::InvalidateTLB();
 }
 
 GekkoIntOp(MULHW)
@@ -1159,11 +1185,13 @@ GekkoIntOp(SYNC)
 GekkoIntOp(TLBIA)
 {
 	//Translation Lookaside Buffer Invalidate All
+	mmu::InvalidateTLB();
 }
 
 GekkoIntOp(TLBIE)
 {
 	//Translation Lookaside Buffer Invalidate Entry
+	mmu::InvalidateTLBEntry(RRB);
 }
 
 GekkoIntOp(TLBSYNC)
@@ -1197,52 +1225,81 @@ GekkoIntOp(XORIS)
 
 GekkoIntOp(LBZ)
 {
-	RRD = (rA) ? Memory_Read8( RRA + SIMM ) : Memory_Read8( SIMM );
+	u8 data;
+	if(!mmu::Read8( (rA) ? ( RRA + SIMM ) : SIMM, &data ))
+		return;
+	RRD = data;
 }
 
 GekkoIntOp(LBZU)
 {
 	u32 X = RRA + SIMM;
-	RRD = Memory_Read8( X );
+	u8 data;
+	if(!mmu::Read8( X, &data ))
+		return;
+	RRD = data;
 	RRA = X;
 }
 
 GekkoIntOp(LBZUX)
 {
 	u32 X = RRA + RRB;
-	RRD = Memory_Read8( X );
+	u8 data;
+	if(!mmu::Read8( X, &data ))
+		return;
+	RRD = data;
 	RRA = X;
 }
 
 GekkoIntOp(LBZX)
 {
-	RRD = (rA) ? Memory_Read8( RRA + RRB ) : Memory_Read8( RRB );
+	u8 data;
+	if(!mmu::Read8( (rA) ? ( RRA + RRB ) : RRB, &data ))
+		return;
+	RRD = data;
 }
 
 GekkoIntOp(LFD)
 {
-	FBRD = (rA) ? Memory_Read64( RRA + SIMM ) : Memory_Read64( SIMM );
+	u64 data;
+	if(!mmu::Read64( (rA) ? ( RRA + SIMM ) : SIMM, &data ))
+		return;
+	FBRD = data;
 }
 
 GekkoIntOp(LFDU)
 {
-	FBRD = Memory_Read64( ( RRA += SIMM ) );
+	u32 X = RRA + SIMM;
+	u64 data;
+	if(!mmu::Read64( X, &data ))
+		return;
+	FBRD = data;
+	RRA = X;
 }
 
 GekkoIntOp(LFDUX)
 {
-	FBRD = Memory_Read64( ( RRA += RRB ) );
+	u32 X = RRA + RRB;
+	u64 data;
+	if(!mmu::Read64( X, &data ))
+		return;
+	FBRD = data;
+	RRA = X;
 }
 
 GekkoIntOp(LFDX)
 {
-	FBRD = (rA) ? Memory_Read64( RRA + RRB ) : Memory_Read64( RRB );
+	u64 data;
+	if(!mmu::Read64( (rA) ? ( RRA + RRB ) : RRB, &data ))
+		return;
+	FBRD = data;
 }
 
 GekkoIntOp(LFS)
 {
 	t32 temp;
-	temp._u32 = (rA) ? Memory_Read32( RRA + SIMM ) : Memory_Read32( SIMM );
+	if(!mmu::Read32( (rA) ? ( RRA + SIMM ) : SIMM, &temp._u32 ))
+		return;
 
 	if(HID2 & HID2_PSE)
 	{
@@ -1254,8 +1311,10 @@ GekkoIntOp(LFS)
 
 GekkoIntOp(LFSU)
 {
+	u32 X = RRA + SIMM;
 	t32 temp;
-	temp._u32 = Memory_Read32( ( RRA += SIMM ) );
+	if(!mmu::Read32( X, &temp._u32 ))
+		return;
 
 	if(HID2 & HID2_PSE)
 	{
@@ -1263,12 +1322,15 @@ GekkoIntOp(LFSU)
 	}else{
 		FPRD = (double)temp._f32;
 	}
+	RRA = X;
 }
 
 GekkoIntOp(LFSUX)
 {
+	u32 X = RRA + RRB;
 	t32 temp;
-	temp._u32 = Memory_Read32( RRA += RRB );
+	if(!mmu::Read32( X, &temp._u32 ))
+		return;
 
 	if(HID2 & HID2_PSE)
 	{
@@ -1276,12 +1338,14 @@ GekkoIntOp(LFSUX)
 	}else{
 		FPRD = (double)temp._f32;
 	}
+	RRA = X;
 }
 
 GekkoIntOp(LFSX)
 {
 	t32 temp;
-	temp._u32 = (rA) ? Memory_Read32( RRA + RRB ) : Memory_Read32( RRB );
+	if(!mmu::Read32( (rA) ? ( RRA + RRB ) : RRB, &temp._u32 ))
+		return;
 
 	if(HID2 & HID2_PSE)
 	{
@@ -1293,63 +1357,125 @@ GekkoIntOp(LFSX)
 
 GekkoIntOp(LHA)
 {
-	RRD = EXTS16((rA) ? Memory_Read16( RRA + SIMM ) : Memory_Read16( SIMM ));
+	u16 data;
+	if(!mmu::Read16( (rA) ? ( RRA + SIMM ) : SIMM, &data ))
+		return;
+	RRD = EXTS16(data);
 }
 
 GekkoIntOp(LHAU)
 {
 	u32 X = RRA + SIMM;
-	RRD = EXTS16(Memory_Read16( X ));
+	u16 data;
+	if(!mmu::Read16( X, &data ))
+		return;
+	RRD = EXTS16(data);
 	RRA = X;
 }
 
 GekkoIntOp(LHAUX)
 {
 	u32 X = RRA + RRB;
-	RRD = EXTS16(Memory_Read16( X ));
+	u16 data;
+	if(!mmu::Read16( X, &data ))
+		return;
+	RRD = EXTS16(data);
 	RRA = X;
 }
 
 GekkoIntOp(LHAX)
 {
-	RRD = EXTS16((rA) ? Memory_Read16( RRA + RRB ) : Memory_Read16( RRB ));
+	u16 data;
+	if(!mmu::Read16( (rA) ? ( RRA + RRB ) : RRB, &data ))
+		return;
+	RRD = EXTS16(data);
 }
 
 GekkoIntOp(LHBRX)
 {
-	RRD = BSWAP16( (rA) ? Memory_Read16( RRA + RRB ) : Memory_Read16( RRB ) );
+	u16 data;
+	if(!mmu::Read16( (rA) ? ( RRA + RRB ) : RRB, &data ))
+		return;
+	RRD = BSWAP16( data );
 }
 
 GekkoIntOp(LHZ)
 {
-	RRD = (rA) ? Memory_Read16( RRA + SIMM ) : Memory_Read16( SIMM );
+	u16 data;
+	if(!mmu::Read16( (rA) ? ( RRA + SIMM ) : SIMM, &data ))
+		return;
+	RRD = data;
 }
 
 GekkoIntOp(LHZU)
 {
 	u32 X = RRA + SIMM;
-	RRD = Memory_Read16( X );
+	u16 data;
+	if(!mmu::Read16( X, &data ))
+		return;
+	RRD = data;
 	RRA = X;
 }
 
 GekkoIntOp(LHZUX)
 {
 	u32 X = RRA + RRB;
-	RRD = Memory_Read16( X );
+	u16 data;
+	if(!mmu::Read16( X, &data ))
+		return;
+	RRD = data;
 	RRA = X;
 }
 
 GekkoIntOp(LHZX)
 {
-	RRD = (rA) ? Memory_Read16( RRA + RRB ) : Memory_Read16( RRB );
+	u16 data;
+	if(!mmu::Read16( (rA) ? ( RRA + RRB ) : RRB, &data ))
+		return;
+	RRD = data;
 }
 
 GekkoIntOp(LMW)
 {
 	u32 ea = ( rA ) ? ( RRA + SIMM ) : SIMM;
+	u32 data;
 
 	for(int i = rD; i < 32; i++, ea += 4 )
-		ireg.gpr[i] = Memory_Read32(ea);
+	{
+		if(!mmu::Read32(ea, &data))
+			return;
+		ireg.gpr[i] = data;
+	}
+}
+
+// Loads the last 1-3 bytes of a string into the high bytes of a register, false on a DSI
+static bool Gekko_LoadStringTail(u32 EA, u32 n, u32* data)
+{
+	u32 word;
+	u16 half;
+	u8 byte;
+
+	switch(n)
+	{
+		case 3:
+			if(!mmu::Read32(EA, &word))
+				return false;
+			*data = word & 0xFFFFFF00;
+			break;
+
+		case 2:
+			if(!mmu::Read16(EA, &half))
+				return false;
+			*data = (u32)half << 16;
+			break;
+
+		case 1:
+			if(!mmu::Read8(EA, &byte))
+				return false;
+			*data = (u32)byte << 24;
+			break;
+	}
+	return true;
 }
 
 GekkoIntOp(LSWI)
@@ -1357,6 +1483,7 @@ GekkoIntOp(LSWI)
 	u32 EA = 0;
 	u32 n = 32;
 	u32 r;
+	u32 data;
 
 	if(rA)
 		EA = RRA;
@@ -1366,26 +1493,18 @@ GekkoIntOp(LSWI)
 	r = rD;
 	while(n > 4)
 	{
-		ireg.gpr[r] = Memory_Read32(EA);
+		if(!mmu::Read32(EA, &data))
+			return;
+		ireg.gpr[r] = data;
 		r = (r + 1) % 32;
 		EA+=4;
 		n-=4;
 	};
 
-	switch(n)
-	{
-		case 3:
-			ireg.gpr[r] = Memory_Read32(EA) & 0xFFFFFF00;
-			break;
-
-		case 2:
-			ireg.gpr[r] = Memory_Read16(EA) << 16;
-			break;
-
-		case 1:
-			ireg.gpr[r] = Memory_Read8(EA) << 24;
-			break;
-	}
+	if(!Gekko_LoadStringTail(EA, n, &data))
+		return;
+	if(n)
+		ireg.gpr[r] = data;
 }
 
 GekkoIntOp(LSWX)
@@ -1393,6 +1512,7 @@ GekkoIntOp(LSWX)
 	u32 EA = RRB;
 	u32 n = XER >> 24;
 	u32 r;
+	u32 data;
 
 	if(rA)
 		EA += RRA;
@@ -1400,41 +1520,39 @@ GekkoIntOp(LSWX)
 	r = rD;
 	while(n > 4)
 	{
-		ireg.gpr[r] = Memory_Read32(EA);
+		if(!mmu::Read32(EA, &data))
+			return;
+		ireg.gpr[r] = data;
 		r = (r + 1) % 32;
 		EA+=4;
 		n-=4;
 	};
 
-	switch(n)
-	{
-		case 3:
-			ireg.gpr[r] = Memory_Read32(EA) & 0xFFFFFF00;
-			break;
-
-		case 2:
-			ireg.gpr[r] = Memory_Read16(EA) << 16;
-			break;
-
-		case 1:
-			ireg.gpr[r] = Memory_Read8(EA) << 24;
-			break;
-	}
+	if(!Gekko_LoadStringTail(EA, n, &data))
+		return;
+	if(n)
+		ireg.gpr[r] = data;
 }
 
 GekkoIntOp(LWARX)
 {
 	u32 EA = RRB;
+	u32 data;
 	if(rA)
 		EA += RRA;
-	RRD = Memory_Read32(EA);
+	if(!mmu::Read32(EA, &data))
+		return;
+	RRD = data;
 	GekkoCPUInterpreter::is_reserved = 1;
 	GekkoCPUInterpreter::reserved_addr = EA;
 }
 
 GekkoIntOp(LWBRX)
 {
-	RRD = BSWAP32( (rA) ? Memory_Read32( RRA + RRB ) : Memory_Read32( RRB ) );
+	u32 data;
+	if(!mmu::Read32( (rA) ? ( RRA + RRB ) : RRB, &data ))
+		return;
+	RRD = BSWAP32( data );
 }
 
 GekkoIntOp(LWZ)
@@ -1464,105 +1582,131 @@ DoLWZRead:
 		mov [edx], eax
 	};
 #else
-	RRD = (rA) ? Memory_Read32( RRA + SIMM ) : Memory_Read32( SIMM );
+	u32 data;
+	if(!mmu::Read32( (rA) ? ( RRA + SIMM ) : SIMM, &data ))
+		return;
+	RRD = data;
 #endif
 }
 
 GekkoIntOp(LWZU)
 {
 	u32 X = RRA + SIMM;
-	RRD = Memory_Read32( X );
+	u32 data;
+	if(!mmu::Read32( X, &data ))
+		return;
+	RRD = data;
 	RRA = X;
 }
 
 GekkoIntOp(LWZUX)
 {
 	u32 X = RRA + RRB;
-	RRD = Memory_Read32( X );
+	u32 data;
+	if(!mmu::Read32( X, &data ))
+		return;
+	RRD = data;
 	RRA = X;
 }
 
 GekkoIntOp(LWZX)
 {
-	RRD = (rA) ? Memory_Read32( RRA + RRB ) : Memory_Read32( RRB );
+	u32 data;
+	if(!mmu::Read32( (rA) ? ( RRA + RRB ) : RRB, &data ))
+		return;
+	RRD = data;
 }
 
 ////////////////////////////////////////////////////////////
 
 GekkoIntOp(STB)
 {
-	if(rA) Memory_Write8( RRA + SIMM, RRS );
-	else Memory_Write8( SIMM, RRS );
+	if(rA) mmu::Write8( RRA + SIMM, RRS );
+	else mmu::Write8( SIMM, RRS );
 }
 
 GekkoIntOp(STBU)
 {
 	u32 X = RRA + SIMM;
-	Memory_Write8( X, RRS );
+	if(!mmu::Write8( X, RRS ))
+		return;
 	RRA = X;
 }
 
 GekkoIntOp(STBUX)
 {
 	u32 X = RRA + RRB;
-	Memory_Write8( X , RRS );
+	if(!mmu::Write8( X , RRS ))
+		return;
 	RRA = X;
 }
 
 GekkoIntOp(STBX)
 {
-	if(rA) Memory_Write8( RRA + RRB, RRS );
-	else Memory_Write8( RRB, RRS );
+	if(rA) mmu::Write8( RRA + RRB, RRS );
+	else mmu::Write8( RRB, RRS );
 }
 
 GekkoIntOp(STFD)
 {
-	if(rA) Memory_Write64( RRA + SIMM, FBRS );
-	else Memory_Write64( SIMM, FBRS );
+	if(rA) mmu::Write64( RRA + SIMM, FBRS );
+	else mmu::Write64( SIMM, FBRS );
 }
 
 GekkoIntOp(STFDU)
 {
-	Memory_Write64( ( RRA += SIMM ) , FBRS );
+	u32 X = RRA + SIMM;
+	if(!mmu::Write64( X , FBRS ))
+		return;
+	RRA = X;
 }
 
 GekkoIntOp(STFDUX)
 {
-	Memory_Write64( ( RRA += RRB ) , FBRS );
+	u32 X = RRA + RRB;
+	if(!mmu::Write64( X , FBRS ))
+		return;
+	RRA = X;
 }
 
 GekkoIntOp(STFDX)
 {
-	if(rA) Memory_Write64( RRA + RRB, FBRS );
-	else Memory_Write64( RRB, FBRS );
+	if(rA) mmu::Write64( RRA + RRB, FBRS );
+	else mmu::Write64( RRB, FBRS );
 }
 
 GekkoIntOp(STFIWX)
 {
-	if(rA) Memory_Write32( RRA + RRB, *(u32 *)&FPRS );
-	else Memory_Write32( RRB, *(u32 *)&FPRS );
+	if(rA) mmu::Write32( RRA + RRB, *(u32 *)&FPRS );
+	else mmu::Write32( RRB, *(u32 *)&FPRS );
 }
 
 GekkoIntOp(STFS)
 {
 	t32 data;
 	data._f32 = (f32)FPRS;
-	if(rA) Memory_Write32( RRA + SIMM, data._u32);
-	else Memory_Write32( SIMM, data._u32);
+	if(rA) mmu::Write32( RRA + SIMM, data._u32);
+	else mmu::Write32( SIMM, data._u32);
 }
 
 GekkoIntOp(STFSU)
 {
+	u32 X = RRA + SIMM;
 	t32 data;
 	data._f32 = (f32)FPRS;
-	Memory_Write32( RRA += SIMM, data._u32 );
+	if(!mmu::Write32( X, data._u32 ))
+		return;
+	RRA = X;
 }
 
 GekkoIntOp(STFSUX)
 {
+	u32 X = RRA + RRB;
 	t32 data;
 	data._f32 = (f32)FPRS;
-	Memory_Write32( RRA += RRB, data._u32);
+	if(!mmu::Write32( X, data._u32 ))
+		return;
+	RRA = X;
 }
 
 GekkoIntOp(STFSX)
@@ -1570,40 +1714,42 @@ GekkoIntOp(STFSX)
 	t32 data;
 	data._f32 = (f32)FPRS;
 
-	if(rA) Memory_Write32( RRA + RRB, data._u32 );
-	else Memory_Write32( RRB, data._u32 );
+	if(rA) mmu::Write32( RRA + RRB, data._u32 );
+	else mmu::Write32( RRB, data._u32 );
 }
 
 GekkoIntOp(STH)
 {
-	if(rA) Memory_Write16( RRA + SIMM, RRS );
-	else Memory_Write16( SIMM, RRS );
+	if(rA) mmu::Write16( RRA + SIMM, RRS );
+	else mmu::Write16( SIMM, RRS );
 }
 
 GekkoIntOp(STHBRX) 
 {
-	if(rA) Memory_Write16( RRA + RRB, BSWAP16( RRS & 0xFFFF ) );
-	else Memory_Write16( RRB, BSWAP16( RRS & 0xFFFF ) );
+	if(rA) mmu::Write16( RRA + RRB, BSWAP16( RRS & 0xFFFF ) );
+	else mmu::Write16( RRB, BSWAP16( RRS & 0xFFFF ) );
 }
 
 GekkoIntOp(STHU)
 {
 	u32 X = RRA + SIMM;
-	Memory_Write16( X , RRS );
+	if(!mmu::Write16( X , RRS ))
+		return;
 	RRA = X;
 }
 
 GekkoIntOp(STHUX)
 {
 	u32 X = RRA + RRB;
-	Memory_Write16( X , RRS );
+	if(!mmu::Write16( X , RRS ))
+		return;
 	RRA = X;
 }
 
 GekkoIntOp(STHX)
 {
-	if(rA) Memory_Write16( RRA + RRB, RRS );
-	else Memory_Write16( RRB, RRS );
+	if(rA) mmu::Write16( RRA + RRB, RRS );
+	else mmu::Write16( RRB, RRS );
 }
 
 GekkoIntOp(STMW)
@@ -1612,7 +1758,29 @@ GekkoIntOp(STMW)
 
 	for(int i = rS; i < 32; i++, ea += 4 )
 	{
-		Memory_Write32( ea, ireg.gpr[i] );
+		if(!mmu::Write32( ea, ireg.gpr[i] ))
+			return;
+	}
+}
+
+// Stores the high 1-3 bytes of a register as the end of a string
+static void Gekko_StoreStringTail(u32 EA, u32 n, u32 data)
+{
+	switch(n)
+	{
+		case 3:
+			if(!mmu::Write16(EA, data >> 16))
+				return;
+			mmu::Write8(EA, (data >> 8) & 0xFF);
+			break;
+
+		case 2:
+			mmu::Write16(EA, data >> 16);
+			break;
+
+		case 1:
+			mmu::Write8(EA, data >> 24);
+			break;
 	}
 }
 
@@ -1630,27 +1798,14 @@ GekkoIntOp(STSWI)
 	r = rD;
 	while(n > 4)
 	{
-		Memory_Write32(EA, ireg.gpr[r]);
+		if(!mmu::Write32(EA, ireg.gpr[r]))
+			return;
 		r = (r + 1) % 32;
 		EA+=4;
 		n-=4;
 	};
 
-	switch(n)
-	{
-		case 3:
-			Memory_Write16(EA, ireg.gpr[r] >> 16);
-			Memory_Write8(EA, (ireg.gpr[r] >> 8) & 0xFF);
-			break;
-
-		case 2:
-			Memory_Write16(EA, ireg.gpr[r] >> 16);
-			break;
-
-		case 1:
-			Memory_Write8(EA, ireg.gpr[r] >> 24);
-			break;
-	}
+	Gekko_StoreStringTail(EA, n, ireg.gpr[r]);
 }
 
 GekkoIntOp(STSWX)
@@ -1665,27 +1820,14 @@ GekkoIntOp(STSWX)
 	r = rD;
 	while(n > 4)
 	{
-		Memory_Write32(EA, ireg.gpr[r]);
+		if(!mmu::Write32(EA, ireg.gpr[r]))
+			return;
 		r = (r + 1) % 32;
 		EA+=4;
 		n-=4;
 	};
 
-	switch(n)
-	{
-		case 3:
-			Memory_Write16(EA, ireg.gpr[r] >> 16);
-			Memory_Write8(EA, (ireg.gpr[r] >> 8) & 0xFF);
-			break;
-
-		case 2:
-			Memory_Write16(EA, ireg.gpr[r] >> 16);
-			break;
-
-		case 1:
-			Memory_Write8(EA, ireg.gpr[r] >> 24);
-			break;
-	}
+	Gekko_StoreStringTail(EA, n, ireg.gpr[r]);
 }
 
 GekkoIntOp(STW)
@@ -1713,15 +1855,15 @@ DoSTWWrite:
 		call Memory_Write32
 	};
 #else
-	if(rA) Memory_Write32( RRA + SIMM, RRS );
-	else   Memory_Write32( SIMM, RRS );
+	if(rA) mmu::Write32( RRA + SIMM, RRS );
+	else   mmu::Write32( SIMM, RRS );
 #endif
 }
 
 GekkoIntOp(STWBRX) 
 {
-	if(rA) Memory_Write32( RRA + RRB, BSWAP32( RRS ) );
-	else Memory_Write32( RRB, BSWAP32( RRS ) );
+	if(rA) mmu::Write32( RRA + RRB, BSWAP32( RRS ) );
+	else mmu::Write32( RRB, BSWAP32( RRS ) );
 }
 
 GekkoIntOp(STWCX)
@@ -1732,7 +1874,8 @@ GekkoIntOp(STWCX)
 		EA = RRB;
 		if(rA)
 			EA += RRA;
-		Memory_Write32(EA, RRS);
+		if(!mmu::Write32(EA, RRS))
+			return;
 		GekkoCPUInterpreter::is_reserved = 0;
 		ireg.CR |= 4;	
 	}
@@ -1743,453 +1886,98 @@ GekkoIntOp(STWCX)
 GekkoIntOp(STWU)
 {
 	u32 X = RRA + SIMM;
-	Memory_Write32( X, RRS );
+	if(!mmu::Write32( X, RRS ))
+		return;
 	RRA = X;
 }
 
 GekkoIntOp(STWUX)
 {
 	u32 X = RRA + RRB;
-	Memory_Write32( X, RRS );
+	if(!mmu::Write32( X, RRS ))
+		return;
 	RRA = X;
 }
 
 GekkoIntOp(STWX)
 {
-	if(rA) Memory_Write32( RRA + RRB, RRS );
-	else Memory_Write32( RRB, RRS );
+	if(rA) mmu::Write32( RRA + RRB, RRS );
+	else mmu::Write32( RRB, RRS );
 }
 
+// Desc: Paired-single quantized loads and stores, the conversion handlers are
+// picked per GQR whenever one is written (see cpu_int_quantize.cpp)
+//
+
 GekkoIntOp(PSQ_L)
 {
-    u32 data0, data1;
-    int type = GQR_LD_TYPE(PSI);
-    int scale = (u8)GQR_LD_SCALE(PSI);
-
-    u32 addr = (rA) ? (RRA + PSIMM) : PSIMM;
-
-	switch(type)
-	{
-		case 4:
-			data0 = Memory_Read8(addr);
-			break;
-
-		case 6:
-			data0 = (s8)Memory_Read8(addr);
-			break;
+	const psq::Quantizer& q = psq::g_quantizers[PSI];
+	u32 addr = (rA) ? (RRA + PSIMM) : PSIMM;
 
-		case 5:
-			data0 = Memory_Read16(addr);
-			break;
-
-		case 7:
-			data0 = (s16)Memory_Read16(addr);
-			break;
-
-		default:
-			data0 = Memory_Read32(addr);
-	}
-
-    PS0D = (f64)dequantize(data0, type, scale);
-
-	if(PSW)
-    {
-        PS1D = 1.0f;
-    }
-    else
-    {
-		switch(type)
-		{
-			case 4:
-				data1 = Memory_Read8(addr+1);
-				break;
-
-			case 6:
-				data1 = (s8)Memory_Read8(addr+1);
-				break;
-
-			case 5:
-				data1 = Memory_Read16(addr+2);
-				break;
-
-			case 7:
-				data1 = (s16)Memory_Read16(addr+2);
-				break;
-
-			default:
-				data1 = Memory_Read32(addr+4);
-		}
-
-        PS1D = (f64)dequantize(data1, type, scale);
-    }
+	q.load[PSW](addr, q.load_scale, &ireg.fpr[rD]);
 }
 
 GekkoIntOp(PSQ_LX)
 {
-    u32 data0, data1;
-    int type = GQR_LD_TYPE(PSI_X);
-    int scale = (u8)GQR_LD_SCALE(PSI_X);
-
-    u32 addr = (rA) ? (RRA + RRB) : RRB;
-
-	switch(type)
-	{
-		case 4:
-			data0 = Memory_Read8(addr);
-			break;
-
-		case 6:
-			data0 = (s8)Memory_Read8(addr);
-			break;
-
-		case 5:
-			data0 = Memory_Read16(addr);
-			break;
-
-		case 7:
-			data0 = (s16)Memory_Read16(addr);
-			break;
-
-		default:
-			data0 = Memory_Read32(addr);
-	}
-
-    PS0D = (f64)dequantize(data0, type, scale);
+	const psq::Quantizer& q = psq::g_quantizers[PSI_X];
+	u32 addr = (rA) ? (RRA + RRB) : RRB;
 
-	if(PSW_X)
-    {
-        PS1D = 1.0f;
-    }
-    else
-    {
-		switch(type)
-		{
-			case 4:
-				data1 = Memory_Read8(addr+1);
-				break;
-
-			case 6:
-				data1 = (s8)Memory_Read8(addr+1);
-				break;
-
-			case 5:
-				data1 = Memory_Read16(addr+2);
-				break;
-
-			case 7:
-				data1 = (s16)Memory_Read16(addr+2);
-				break;
-
-			default:
-				data1 = Memory_Read32(addr+4);
-		}
-
-        PS1D = (f64)dequantize(data1, type, scale);
-    }
+	q.load[PSW_X](addr, q.load_scale, &ireg.fpr[rD]);
 }
 
 GekkoIntOp(PSQ_LU)
 {
-    u32 data0, data1;
-    int type = GQR_LD_TYPE(PSI);
-    int scale = (u8)GQR_LD_SCALE(PSI);
-
-    u32 addr = (rA) ? (RRA + PSIMM) : PSIMM;
-
-	switch(type)
-	{
-		case 4:
-			data0 = Memory_Read8(addr);
-			break;
-
-		case 6:
-			data0 = (s8)Memory_Read8(addr);
-			break;
-
-		case 5:
-			data0 = Memory_Read16(addr);
-			break;
-
-		case 7:
-			data0 = (s16)Memory_Read16(addr);
-			break;
-
-		default:
-			data0 = Memory_Read32(addr);
-	}
-
-    PS0D = (f64)dequantize(data0, type, scale);
-
-	if(PSW)
-    {
-        PS1D = 1.0f;
-    }
-    else
-    {
-		switch(type)
-		{
-			case 4:
-				data1 = Memory_Read8(addr+1);
-				break;
-
-			case 6:
-				data1 = (s8)Memory_Read8(addr+1);
-				break;
-
-			case 5:
-				data1 = Memory_Read16(addr+2);
-				break;
-
-			case 7:
-				data1 = (s16)Memory_Read16(addr+2);
-				break;
-
-			default:
-				data1 = Memory_Read32(addr+4);
-		}
-
-        PS1D = (f64)dequantize(data1, type, scale);
-    }
+	const psq::Quantizer& q = psq::g_quantizers[PSI];
+	u32 addr = (rA) ? (RRA + PSIMM) : PSIMM;
 
+	if(!q.load[PSW](addr, q.load_scale, &ireg.fpr[rD]))
+		return;
 	RRA = addr;
 }
 
 GekkoIntOp(PSQ_LUX)
 {
-    u32 data0, data1;
-    int type = GQR_LD_TYPE(PSI_X);
-    int scale = (u8)GQR_LD_SCALE(PSI_X);
-
-    u32 addr = (rA) ? (RRA + RRB) : RRB;
-
-	switch(type)
-	{
-		case 4:
-		case 6:
-			data0 = Memory_Read8(addr);
-			break;
-
-		case 5:
-		case 7:
-			data0 = Memory_Read16(addr);
-			break;
-
-		default:
-			data0 = Memory_Read32(addr);
-	}
-
-    PS0D = (f64)dequantize(data0, type, scale);
-
-	if(PSW_X)
-    {
-        PS1D = 1.0f;
-    }
-    else
-    {
-		switch(type)
-		{
-			case 4:
-				data1 = Memory_Read8(addr+1);
-				break;
-
-			case 6:
-				data1 = (s8)Memory_Read8(addr+1);
-				break;
-
-			case 5:
-				data1 = Memory_Read16(addr+2);
-				break;
-
-			case 7:
-				data1 = (s16)Memory_Read16(addr+2);
-				break;
-
-			default:
-				data1 = Memory_Read32(addr+4);
-		}
-
-        PS1D = (f64)dequantize(data1, type, scale);
-    }
+	const psq::Quantizer& q = psq::g_quantizers[PSI_X];
+	u32 addr = (rA) ? (RRA + RRB) : RRB;
 
+	if(!q.load[PSW_X](addr, q.load_scale, &ireg.fpr[rD]))
+		return;
 	RRA = addr;
 }
 
 GekkoIntOp(PSQ_ST)
 {
-     int type = GQR_ST_TYPE(PSI);
-     int scale = GQR_ST_SCALE(PSI);
-
-     u32 addr = (rA) ? (RRA + PSIMM) : PSIMM;
+	const psq::Quantizer& q = psq::g_quantizers[PSI];
+	u32 addr = (rA) ? (RRA + PSIMM) : PSIMM;
 
-     if(PSW)
-     {
-		switch(type)
-		{
-		case 4:
-		case 6:
-			Memory_Write8(addr, quantize((f32)PS0S, type, scale));
-			return;
-		case 5:
-		case 7:
-			Memory_Write16(addr, quantize((f32)PS0S, type, scale));
-			return;
-		}
-        
-		Memory_Write32(addr, quantize((f32)PS0S, type, scale));
-     }
-     else
-     {
-		switch(type)
-		{
-		case 4:
-		case 6:
-			Memory_Write8(addr, quantize((f32)PS0S, type, scale));
-			Memory_Write8(addr + 1, quantize((f32)PS1S, type, scale));
-			return;
-		case 5:
-		case 7:
-			Memory_Write16(addr, quantize((f32)PS0S, type, scale));
-			Memory_Write16(addr + 2, quantize((f32)PS1S, type, scale));
-			return;
-		}
-        
-		Memory_Write32(addr, quantize((f32)PS0S, type, scale));
-		Memory_Write32(addr + 4, quantize((f32)PS1S, type, scale));
-     }
+	q.store[PSW](addr, q.store_scale, &ireg.fpr[rS]);
 }
 
 GekkoIntOp(PSQ_STX)
 {
-     int type = GQR_ST_TYPE(PSI_X);
-     int scale = GQR_ST_SCALE(PSI_X);
-
-     u32 addr = (rA) ? (RRA + RRB) : RRB;
+	const psq::Quantizer& q = psq::g_quantizers[PSI_X];
+	u32 addr = (rA) ? (RRA + RRB) : RRB;
 
-     if(PSW_X)
-     {
-		switch(type)
-		{
-		case 4:
-		case 6:
-			Memory_Write8(addr, quantize((f32)PS0S, type, scale));
-			return;
-		case 5:
-		case 7:
-			Memory_Write16(addr, quantize((f32)PS0S, type, scale));
-			return;
-		}
-        
-		Memory_Write32(addr, quantize((f32)PS0S, type, scale));
-     }
-     else
-     {
-		switch(type)
-		{
-		case 4:
-		case 6:
-			Memory_Write8(addr, quantize((f32)PS0S, type, scale));
-			Memory_Write8(addr + 1, quantize((f32)PS1S, type, scale));
-			return;
-		case 5:
-		case 7:
-			Memory_Write16(addr, quantize((f32)PS0S, type, scale));
-			Memory_Write16(addr + 2, quantize((f32)PS1S, type, scale));
-			return;
-		}
-        
-		Memory_Write32(addr, quantize((f32)PS0S, type, scale));
-		Memory_Write32(addr + 4, quantize((f32)PS1S, type, scale));
-     }
+	q.store[PSW_X](addr, q.store_scale, &ireg.fpr[rS]);
 }
 
 GekkoIntOp(PSQ_STU)
 {
-     int type = GQR_ST_TYPE(PSI);
-     int scale = GQR_ST_SCALE(PSI);
+	const psq::Quantizer& q = psq::g_quantizers[PSI];
+	u32 addr = RRA + PSIMM;
 
-	 u32 addr = (RRA + PSIMM);
-
-     if(PSW)
-     {
-		switch(type)
-		{
-		case 4:
-		case 6:
-			Memory_Write8(addr, quantize((f32)PS0S, type, scale));
-			return;
-		case 5:
-		case 7:
-			Memory_Write16(addr, quantize((f32)PS0S, type, scale));
-			return;
-		}
-        
-		Memory_Write32(addr, quantize((f32)PS0S, type, scale));
-     }
-     else
-     {
-		switch(type)
-		{
-		case 4:
-		case 6:
-			Memory_Write8(addr, quantize((f32)PS0S, type, scale));
-			Memory_Write8(addr + 1, quantize((f32)PS1S, type, scale));
-			return;
-		case 5:
-		case 7:
-			Memory_Write16(addr, quantize((f32)PS0S, type, scale));
-			Memory_Write16(addr + 2, quantize((f32)PS1S, type, scale));
-			return;
-		}
-        
-		Memory_Write32(addr, quantize((f32)PS0S, type, scale));
-		Memory_Write32(addr + 4, quantize((f32)PS1S, type, scale));
-     }
-	 RRA = addr;
+	if(!q.store[PSW](addr, q.store_scale, &ireg.fpr[rS]))
+		return;
+	RRA = addr;
 }
 
 GekkoIntOp(PSQ_STUX)
 {
-     int type = GQR_ST_TYPE(PSI_X);
-     int scale = GQR_ST_SCALE(PSI_X);
-
-     u32 addr = (rA) ? (RRA + RRB) : RRB;
-
-     if(PSW_X)
-     {
-		switch(type)
-		{
-		case 4:
-		case 6:
-			Memory_Write8(addr, quantize((f32)PS0S, type, scale));
-			return;
-		case 5:
-		case 7:
-			Memory_Write16(addr, quantize((f32)PS0S, type, scale));
-			return;
-		}
-        
-		Memory_Write32(addr, quantize((f32)PS0S, type, scale));
-     }
-     else
-     {
-		switch(type)
-		{
-		case 4:
-		case 6:
-			Memory_Write8(addr, quantize((f32)PS0S, type, scale));
-			Memory_Write8(addr + 1, quantize((f32)PS1S, type, scale));
-			return;
-		case 5:
-		case 7:
-			Memory_Write16(addr, quantize((f32)PS0S, type, scale));
-			Memory_Write16(addr + 2, quantize((f32)PS1S, type, scale));
-			return;
-		}
-        
-		Memory_Write32(addr, quantize((f32)PS0S, type, scale));
-		Memory_Write32(addr + 4, quantize((f32)PS1S, type, scale));
-     }
+	const psq::Quantizer& q = psq::g_quantizers[PSI_X];
+	u32 addr = (rA) ? (RRA + RRB) : RRB;
 
+	if(!q.store[PSW_X](addr, q.store_scale, &ireg.fpr[rS]))
+		return;
 	RRA = addr;
 }
 
@@ -0,0 +1,325 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    cpu_int_quantize.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-08
+ * @brief   Paired-single quantized load/store handlers, selected per GQR
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include "common.h"
+
+#include "powerpc/cpu_core.h"
+#include "powerpc/cpu_core_regs.h"
+#include "powerpc/mmu.h"
+#include "cpu_int_quantize.h"
+
+// SSE2 is part of x86-64, 32-bit builds only get it when the compiler targets it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PSQ_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace psq {
+
+/// GQR type field
+enum {
+    kTypeFloat  = 0,
+    kTypeU8     = 4,
+    kTypeU16    = 5,
+    kTypeS8     = 6,
+    kTypeS16    = 7
+};
+
+/// Memory layout and clamping range of each quantized type
+template <int kType> struct Element;
+
+template <> struct Element<kTypeU8> {
+    typedef u8 Type;
+    static const int kSize = 1;
+    static f32 Min() { return 0.0f; }
+    static f32 Max() { return 255.0f; }
+};
+
+template <> struct Element<kTypeU16> {
+    typedef u16 Type;
+    static const int kSize = 2;
+    static f32 Min() { return 0.0f; }
+    static f32 Max() { return 65535.0f; }
+};
+
+template <> struct Element<kTypeS8> {
+    typedef s8 Type;
+    static const int kSize = 1;
+    static f32 Min() { return -128.0f; }
+    static f32 Max() { return 127.0f; }
+};
+
+template <> struct Element<kTypeS16> {
+    typedef s16 Type;
+    static const int kSize = 2;
+    static f32 Min() { return -32768.0f; }
+    static f32 Max() { return 32767.0f; }
+};
+
+Quantizer g_quantizers[8];
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory access
+
+/// Read both elements, with a single access when they share an aligned word
+template <int kSize> static inline bool ReadPair(u32 addr, u32* e0, u32* e1) {
+    if (kSize == 1 && !(addr & 1)) {
+        u16 data;
+        if (!mmu::Read16(addr, &data)) {
+            return false;
+        }
+        *e0 = data >> 8;
+        *e1 = data & 0xFF;
+    } else if (kSize == 2 && !(addr & 3)) {
+        u32 data;
+        if (!mmu::Read32(addr, &data)) {
+            return false;
+        }
+        *e0 = data >> 16;
+        *e1 = data & 0xFFFF;
+    } else if (kSize == 1) {
+        u8 d0, d1;
+        if (!mmu::Read8(addr, &d0) || !mmu::Read8(addr + 1, &d1)) {
+            return false;
+        }
+        *e0 = d0;
+        *e1 = d1;
+    } else {
+        u16 d0, d1;
+        if (!mmu::Read16(addr, &d0) || !mmu::Read16(addr + 2, &d1)) {
+            return false;
+        }
+        *e0 = d0;
+        *e1 = d1;
+    }
+    return true;
+}
+
+template <int kSize> static inline bool WritePair(u32 addr, u32 e0, u32 e1) {
+    if (kSize == 1 && !(addr & 1)) {
+        return mmu::Write16(addr, ((e0 & 0xFF) << 8) | (e1 & 0xFF));
+    } else if (kSize == 2 && !(addr & 3)) {
+        return mmu::Write32(addr, ((e0 & 0xFFFF) << 16) | (e1 & 0xFFFF));
+    } else if (kSize == 1) {
+        return mmu::Write8(addr, e0) && mmu::Write8(addr + 1, e1);
+    }
+    return mmu::Write16(addr, e0) && mmu::Write16(addr + 2, e1);
+}
+
+template <int kSize> static inline bool ReadSingle(u32 addr, u32* e0) {
+    if (kSize == 1) {
+        u8 data;
+        if (!mmu::Read8(addr, &data)) {
+            return false;
+        }
+        *e0 = data;
+    } else {
+        u16 data;
+        if (!mmu::Read16(addr, &data)) {
+            return false;
+        }
+        *e0 = data;
+    }
+    return true;
+}
+
+template <int kSize> static inline bool WriteSingle(u32 addr, u32 e0) {
+    if (kSize == 1) {
+        return mmu::Write8(addr, e0);
+    }
+    return mmu::Write16(addr, e0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Loads
+
+template <int kType> static bool LoadPair(u32 addr, f32 scale, t128* ps) {
+    typedef typename Element<kType>::Type Type;
+    u32 e0, e1;
+
+    if (!ReadPair<Element<kType>::kSize>(addr, &e0, &e1)) {
+        return false;
+    }
+
+#ifdef PSQ_USE_SSE2
+    __m128i values = _mm_set_epi32(0, 0, (s32)(Type)e1, (s32)(Type)e0);
+    __m128d result = _mm_mul_pd(_mm_cvtepi32_pd(values), _mm_set1_pd(scale));
+    _mm_store_pd(&ps->ps0._f64, result);
+#else
+    ps->ps0._f64 = (f64)((f32)(Type)e0 * scale);
+    ps->ps1._f64 = (f64)((f32)(Type)e1 * scale);
+#endif
+    return true;
+}
+
+template <int kType> static bool LoadSingle(u32 addr, f32 scale, t128* ps) {
+    typedef typename Element<kType>::Type Type;
+    u32 e0;
+
+    if (!ReadSingle<Element<kType>::kSize>(addr, &e0)) {
+        return false;
+    }
+    ps->ps0._f64 = (f64)((f32)(Type)e0 * scale);
+    ps->ps1._f64 = 1.0;
+    return true;
+}
+
+static bool LoadPairFloat(u32 addr, f32 scale, t128* ps) {
+    u32 w0, w1;
+
+    if (!mmu::Read32(addr, &w0) || !mmu::Read32(addr + 4, &w1)) {
+        return false;
+    }
+
+#ifdef PSQ_USE_SSE2
+    __m128 values = _mm_castsi128_ps(_mm_set_epi32(0, 0, w1, w0));
+    _mm_store_pd(&ps->ps0._f64, _mm_cvtps_pd(values));
+#else
+    ps->ps0._f64 = (f64)*(f32*)&w0;
+    ps->ps1._f64 = (f64)*(f32*)&w1;
+#endif
+    return true;
+}
+
+static bool LoadSingleFloat(u32 addr, f32 scale, t128* ps) {
+    u32 w0;
+
+    if (!mmu::Read32(addr, &w0)) {
+        return false;
+    }
+    ps->ps0._f64 = (f64)*(f32*)&w0;
+    ps->ps1._f64 = 1.0;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stores
+
+/// Scalar quantization of one element, same rounding and clamping as GekkoCPU::quantize
+template <int kType> static inline u32 QuantizeElement(f64 value, f32 scale) {
+    f32 data = (f32)value * scale;
+
+    if (data < Element<kType>::Min()) {
+        data = Element<kType>::Min();
+    } else if (data > Element<kType>::Max()) {
+        data = Element<kType>::Max();
+    }
+    return (u32)(s32)data;
+}
+
+template <int kType> static bool StorePair(u32 addr, f32 scale, const t128* ps) {
+    u32 e0, e1;
+
+#ifdef PSQ_USE_SSE2
+    __m128 values = _mm_mul_ps(_mm_cvtpd_ps(_mm_load_pd(&ps->ps0._f64)), _mm_set1_ps(scale));
+
+    // Operand order lets NaN through, it truncates to 0x80000000 which stores as 0
+    values = _mm_max_ps(_mm_set1_ps(Element<kType>::Min()), values);
+    values = _mm_min_ps(_mm_set1_ps(Element<kType>::Max()), values);
+
+    __m128i result = _mm_cvttps_epi32(values);
+    e0 = (u32)_mm_cvtsi128_si32(result);
+    e1 = (u32)_mm_cvtsi128_si32(_mm_srli_si128(result, 4));
+#else
+    e0 = QuantizeElement<kType>(ps->ps0._f64, scale);
+    e1 = QuantizeElement<kType>(ps->ps1._f64, scale);
+#endif
+    return WritePair<Element<kType>::kSize>(addr, e0, e1);
+}
+
+template <int kType> static bool StoreSingle(u32 addr, f32 scale, const t128* ps) {
+    return WriteSingle<Element<kType>::kSize>(addr, QuantizeElement<kType>(ps->ps0._f64, scale));
+}
+
+static bool StorePairFloat(u32 addr, f32 scale, const t128* ps) {
+    f32 f0 = (f32)ps->ps0._f64;
+    f32 f1 = (f32)ps->ps1._f64;
+
+    return mmu::Write32(addr, *(u32*)&f0) && mmu::Write32(addr + 4, *(u32*)&f1);
+}
+
+static bool StoreSingleFloat(u32 addr, f32 scale, const t128* ps) {
+    f32 f0 = (f32)ps->ps0._f64;
+
+    return mmu::Write32(addr, *(u32*)&f0);
+}
+
+// Types 1-3 are reserved. Loads treat them as float, stores as float with the scale still applied.
+
+static bool StorePairScaledFloat(u32 addr, f32 scale, const t128* ps) {
+    f32 f0 = (f32)ps->ps0._f64 * scale;
+    f32 f1 = (f32)ps->ps1._f64 * scale;
+
+    return mmu::Write32(addr, *(u32*)&f0) && mmu::Write32(addr + 4, *(u32*)&f1);
+}
+
+static bool StoreSingleScaledFloat(u32 addr, f32 scale, const t128* ps) {
+    f32 f0 = (f32)ps->ps0._f64 * scale;
+
+    return mmu::Write32(addr, *(u32*)&f0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Handler selection
+
+static const LoadFunc kLoadPair[8] = {
+    LoadPairFloat, LoadPairFloat, LoadPairFloat, LoadPairFloat,
+    LoadPair<kTypeU8>, LoadPair<kTypeU16>, LoadPair<kTypeS8>, LoadPair<kTypeS16>
+};
+
+static const LoadFunc kLoadSingle[8] = {
+    LoadSingleFloat, LoadSingleFloat, LoadSingleFloat, LoadSingleFloat,
+    LoadSingle<kTypeU8>, LoadSingle<kTypeU16>, LoadSingle<kTypeS8>, LoadSingle<kTypeS16>
+};
+
+static const StoreFunc kStorePair[8] = {
+    StorePairFloat, StorePairScaledFloat, StorePairScaledFloat, StorePairScaledFloat,
+    StorePair<kTypeU8>, StorePair<kTypeU16>, StorePair<kTypeS8>, StorePair<kTypeS16>
+};
+
+static const StoreFunc kStoreSingle[8] = {
+    StoreSingleFloat, StoreSingleScaledFloat, StoreSingleScaledFloat, StoreSingleScaledFloat,
+    StoreSingle<kTypeU8>, StoreSingle<kTypeU16>, StoreSingle<kTypeS8>, StoreSingle<kTypeS16>
+};
+
+void Init() {
+    for (int i = 0; i < 8; i++) {
+        UpdateQuantizer(i);
+    }
+}
+
+void UpdateQuantizer(int index) {
+    Quantizer& quantizer = g_quantizers[index & 7];
+    int load_type = GQR_LD_TYPE(index);
+    int store_type = GQR_ST_TYPE(index);
+
+    quantizer.load[0] = kLoadPair[load_type];
+    quantizer.load[1] = kLoadSingle[load_type];
+    quantizer.store[0] = kStorePair[store_type];
+    quantizer.store[1] = kStoreSingle[store_type];
+    quantizer.load_scale = GekkoCPU::ldScale[GQR_LD_SCALE(index)];
+    quantizer.store_scale = GekkoCPU::stScale[GQR_ST_SCALE(index)];
+}
+
+} // namespace
@@ -0,0 +1,74 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    cpu_int_quantize.h
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-08
+ * @brief   Paired-single quantized load/store handlers, selected per GQR
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef CORE_POWERPC_INTERPRETER_CPU_INT_QUANTIZE_H_
+#define CORE_POWERPC_INTERPRETER_CPU_INT_QUANTIZE_H_
+
+#include "common.h"
+
+/**
+ * psq_l/psq_st decode the type and scale of their GQR on every execution, then convert one lane
+ * at a time. Instead, each GQR keeps a pair of load and store handlers specialized for its type
+ * (and for the W bit, single or paired), plus the scale factor already looked up. The handlers
+ * are only rebuilt when the GQR is written, and convert both lanes at once with SSE2.
+ */
+namespace psq {
+
+/**
+ * Load and dequantize into a paired-single register
+ * @param addr Effective address
+ * @param scale Dequantization factor, ldScale of the GQR
+ * @param ps Destination FPR, ps1 is set to 1.0 by the single forms
+ * @return False if the access raised a DSI, ps is left untouched
+ */
+typedef bool (*LoadFunc)(u32 addr, f32 scale, t128* ps);
+
+/**
+ * Quantize and store a paired-single register
+ * @param addr Effective address
+ * @param scale Quantization factor, stScale of the GQR
+ * @param ps Source FPR
+ * @return False if the access raised a DSI
+ */
+typedef bool (*StoreFunc)(u32 addr, f32 scale, const t128* ps);
+
+/// Handlers for one GQR, indexed by the W bit of the instruction
+struct Quantizer {
+    LoadFunc    load[2];
+    StoreFunc   store[2];
+    f32         load_scale;
+    f32         store_scale;
+};
+
+extern Quantizer g_quantizers[8];
+
+/// Select the handlers for all GQRs, called when the CPU core is opened
+void Init();
+
+/// Select the handlers for a GQR after it was written
+void UpdateQuantizer(int index);
+
+} // namespace
+
+#endif // CORE_POWERPC_INTERPRETER_CPU_INT_QUANTIZE_H_
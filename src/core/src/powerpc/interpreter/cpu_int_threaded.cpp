@@ -0,0 +1,429 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    cpu_int_threaded.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-04
+ * @brief   Threaded-code flavor of the Gekko interpreter
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include "common.h"
+#include "log.h"
+
+#include "hw/hw.h"
+#include "powerpc/cpu_core_regs.h"
+#include "powerpc/mmu.h"
+#include "cpu_int_threaded.h"
+
+GekkoCPUInterpreterThreaded::GekkoCPUInterpreterThreaded() : is_dec_(0), code_changed_(false) {
+    memset(block_pages_, 0, sizeof(block_pages_));
+#ifdef __GNUC__
+    LOG_NOTICE(TPOWERPC, "threaded interpreter initialized ok");
+#else
+    LOG_NOTICE(TPOWERPC, "threaded dispatch not supported by this compiler, using interpreter");
+#endif
+}
+
+GekkoCPUInterpreterThreaded::~GekkoCPUInterpreterThreaded() {
+    ClearCache();
+    FreeRetiredOps();
+}
+
+GekkoF GekkoCPUInterpreterThreaded::Open(u32 entry_point) {
+    GekkoCPUInterpreter::Open(entry_point);
+    ClearCache();
+    is_dec_ = 0;
+}
+
+/// Execute one guest block, with the same timing bookkeeping as the interpreter
+GekkoF GekkoCPUInterpreterThreaded::ExecuteInstruction() {
+#ifdef __GNUC__
+    // Indexed by OpKind
+    static const void* const labels[kNumOpKinds] = {
+        &&op_generic, &&op_generic_end, &&op_block_end, &&op_li, &&op_addi, &&op_ori,
+        &&op_xori, &&op_rlwinm, &&op_cmpi, &&op_cmpli, &&op_lwz, &&op_stw, &&op_b
+    };
+    ThreadedOp* op;
+    u32 inst_count = 0;
+    u32 start_pc = ireg.PC;
+
+    // Single stepping and op dumping are debugging features, leave them to the interpreter. So is
+    // running with MMU translation, the threaded code is built from untranslated addresses.
+    if (step || DumpOp0 || mmu::g_translate) {
+        GekkoCPUInterpreter::ExecuteInstruction();
+        return;
+    }
+    // Nothing is executing from the retired records anymore
+    FreeRetiredOps();
+
+    branch = 0;
+    code_changed_ = false;
+    op = GetBlock(ireg.PC, labels)->ops;
+
+#define THREADED_DISPATCH() do { op++; goto *op->label; } while (0)
+
+    goto *op->label;
+
+op_generic:
+    ireg.PC = op->address;
+    opcode = op->opcode;
+    op->handler();
+    inst_count++;
+    if (branch) {
+        goto block_done;
+    }
+    // A store overwrote code, the rest of this block may be stale
+    if (code_changed_) {
+        goto block_leave;
+    }
+    THREADED_DISPATCH();
+
+op_generic_end:
+    ireg.PC = op->address;
+    opcode = op->opcode;
+    op->handler();
+    inst_count++;
+    if (!branch) {
+        ireg.PC += 4;
+    }
+    goto block_done;
+
+op_block_end:
+    ireg.PC = op->address;
+    goto block_done;
+
+op_li:
+    ireg.gpr[op->d] = op->imm;
+    inst_count++;
+    THREADED_DISPATCH();
+
+op_addi:
+    ireg.gpr[op->d] = ireg.gpr[op->a] + op->imm;
+    inst_count++;
+    THREADED_DISPATCH();
+
+op_ori:
+    ireg.gpr[op->a] = ireg.gpr[op->d] | op->imm;
+    inst_count++;
+    THREADED_DISPATCH();
+
+op_xori:
+    ireg.gpr[op->a] = ireg.gpr[op->d] ^ op->imm;
+    inst_count++;
+    THREADED_DISPATCH();
+
+op_rlwinm:
+    ireg.gpr[op->a] = Gekko_Rotl(ireg.gpr[op->d], op->b) & op->imm;
+    inst_count++;
+    THREADED_DISPATCH();
+
+op_cmpi:
+    {
+        s32 x = (s32)ireg.gpr[op->a];
+        s32 y = (s32)op->imm;
+        u32 bits = (x < y) ? BIT_0 : ((x > y) ? BIT_1 : BIT_2);
+        if (XER_SO) {
+            bits |= BIT_3;
+        }
+        ireg.CR = (ireg.CR & ~(0xF0000000 >> op->d)) | (bits >> op->d);
+    }
+    inst_count++;
+    THREADED_DISPATCH();
+
+op_cmpli:
+    {
+        u32 x = ireg.gpr[op->a];
+        u32 y = op->imm;
+        u32 bits = (x < y) ? BIT_0 : ((x > y) ? BIT_1 : BIT_2);
+        if (XER_SO) {
+            bits |= BIT_3;
+        }
+        ireg.CR = (ireg.CR & ~(0xF0000000 >> op->d)) | (bits >> op->d);
+    }
+    inst_count++;
+    THREADED_DISPATCH();
+
+op_lwz:
+    ireg.PC = op->address;
+    ireg.gpr[op->d] = Memory_Read32(ireg.gpr[op->a] + op->imm);
+    inst_count++;
+    THREADED_DISPATCH();
+
+op_stw:
+    ireg.PC = op->address;
+    Memory_Write32(ireg.gpr[op->a] + op->imm, ireg.gpr[op->d]);
+    inst_count++;
+    if (code_changed_) {
+        goto block_leave;
+    }
+    THREADED_DISPATCH();
+
+op_b:
+    cpu->PClast = op->address;
+    if (op->b) {
+        LR = op->address + 4;
+    }
+    ireg.PC = op->imm;
+    branch = OPCODE_BRANCH;
+    inst_count++;
+    goto block_done;
+
+#undef THREADED_DISPATCH
+
+block_leave:
+    ireg.PC = op->address + 4;
+
+block_done:
+    ireg.TBR.TBR += inst_count;
+
+    if (DEC < inst_count) {
+        is_dec_ = MSR_BIT_EE;
+    }
+    DEC -= inst_count;
+    ireg.IC += inst_count;
+
+    // Spinning in a loop that only waits on hardware, jump ahead to the next event
+    if (IdleSkipping && branch == OPCODE_BRANCH && ireg.PC == start_pc && IsIdleLoop(start_pc)) {
+        SkipIdleLoop();
+    }
+    if (branch && !(branch & OPCODE_RFI)) {
+        if (!Flipper_Update() && (ireg.MSR & is_dec_)) {
+            is_dec_ = 0;
+            cpu->Exception(GEX_DEC);
+        }
+        exception = 0;
+    }
+    branch = 0;
+#else
+    GekkoCPUInterpreter::ExecuteInstruction();
+#endif
+}
+
+GekkoF GekkoCPUInterpreterThreaded::InvalidateCode(u32 addr, u32 size) {
+    // Also used when single stepping through the interpreter
+    GekkoCPUInterpreter::InvalidateCode(addr, size);
+
+    u32 start = addr & RAM_MASK;
+    u32 end = start + size;
+    u32 back = (kMaxBlockInstructions - 1) * 4;
+
+    if (end > RAM_SIZE) {
+        end = RAM_SIZE;
+    }
+    // A block starting before the range may still run into it
+    u32 first = (start > back) ? ((start - back) & ~3) : 0;
+
+    for (u32 offset = first; offset < end; ) {
+        Block* page = block_pages_[offset >> MEM_PAGE_SHIFT];
+        if (NULL == page) {
+            offset = (offset & ~MEM_PAGE_MASK) + MEM_PAGE_SIZE;
+            continue;
+        }
+        Block* block = &page[(offset & MEM_PAGE_MASK) >> 2];
+        if (block->ops && (offset + block->num_instructions * 4) > start) {
+            // The block may be the one currently executing, free it once it has exited
+            retired_ops_.push_back(block->ops);
+            block->ops = NULL;
+            code_changed_ = true;
+        }
+        offset += 4;
+    }
+}
+
+GekkoCPUInterpreterThreaded::Block* GekkoCPUInterpreterThreaded::GetBlock(u32 address,
+    const void* const* labels) {
+
+    u32 offset = address & RAM_MASK;
+    Block*& page = block_pages_[offset >> MEM_PAGE_SHIFT];
+
+    if (NULL == page) {
+        page = new Block[kBlocksPerPage];
+        memset(page, 0, sizeof(Block) * kBlocksPerPage);
+    }
+    Block* block = &page[(offset & MEM_PAGE_MASK) >> 2];
+
+    if (NULL == block->ops || block->address != address) {
+        delete[] block->ops;
+        CompileBlock(block, address, labels);
+    }
+    return block;
+}
+
+void GekkoCPUInterpreterThreaded::CompileBlock(Block* block, u32 address,
+    const void* const* labels) {
+
+    ThreadedOp ops[kMaxBlockInstructions + 1];
+    u32 pc = address;
+    int count = 0;
+    bool done = false;
+
+    // Writes to this page now have to come back and invalidate us
+    Memory_MarkCodePage(address);
+
+    while (!done && count < kMaxBlockInstructions) {
+        // Blocks never straddle a page, so page invalidation always catches them
+        if (count && !(pc & MEM_PAGE_MASK)) {
+            break;
+        }
+        done = CompileInstruction(&ops[count], pc, *(u32*)(&Mem_RAM[pc & RAM_MASK]), labels);
+        pc += 4;
+        count++;
+    }
+    if (!done) {
+        memset(&ops[count], 0, sizeof(ThreadedOp));
+        ops[count].label = labels[kOpBlockEnd];
+        ops[count].address = pc;
+        count++;
+    }
+    block->ops = new ThreadedOp[count];
+    memcpy(block->ops, ops, sizeof(ThreadedOp) * count);
+    block->address = address;
+    block->num_instructions = (pc - address) >> 2;
+}
+
+bool GekkoCPUInterpreterThreaded::CompileInstruction(ThreadedOp* op, u32 address, u32 inst,
+    const void* const* labels) {
+
+    u32 d = (inst >> 21) & 0x1F;
+    u32 a = (inst >> 16) & 0x1F;
+    u32 simm = (u32)(s32)(s16)(inst & 0xFFFF);
+    u32 uimm = inst & 0xFFFF;
+    OpKind kind = kOpGeneric;
+
+    memset(op, 0, sizeof(ThreadedOp));
+    op->opcode = inst;
+    op->address = address;
+    op->d = d;
+    op->a = a;
+
+    switch (inst >> 26) {
+    case 3:     // HLE
+    case 16:    // bcx
+    case 17:    // sc
+        kind = kOpGenericEnd;
+        break;
+
+    case 10:    // cmpli
+        op->d = 4 * ((inst >> 23) & 7);
+        op->imm = uimm;
+        kind = kOpCmpli;
+        break;
+
+    case 11:    // cmpi
+        op->d = 4 * ((inst >> 23) & 7);
+        op->imm = simm;
+        kind = kOpCmpi;
+        break;
+
+    case 14:    // addi
+        op->imm = simm;
+        kind = a ? kOpAddi : kOpLi;
+        break;
+
+    case 15:    // addis
+        op->imm = simm << 16;
+        kind = a ? kOpAddi : kOpLi;
+        break;
+
+    case 18:    // bx
+        op->imm = EXTS(inst & 0x03FFFFFC, 26);
+        if (!(inst & 2)) {
+            op->imm += address;
+        }
+        op->b = inst & 1;
+        kind = kOpB;
+        break;
+
+    case 21:    // rlwinmx
+        if (!(inst & 1)) {
+            u32 mb = (inst >> 6) & 0x1F;
+            u32 me = (inst >> 1) & 0x1F;
+            u32 mask = (0xFFFFFFFF >> mb) ^ ((me >= 31) ? 0 : (0xFFFFFFFF >> (me + 1)));
+            op->imm = (mb > me) ? ~mask : mask;
+            op->b = (inst >> 11) & 0x1F;
+            kind = kOpRlwinm;
+        }
+        break;
+
+    case 24:    // ori
+        op->imm = uimm;
+        kind = kOpOri;
+        break;
+
+    case 25:    // oris
+        op->imm = uimm << 16;
+        kind = kOpOri;
+        break;
+
+    case 26:    // xori
+        op->imm = uimm;
+        kind = kOpXori;
+        break;
+
+    case 27:    // xoris
+        op->imm = uimm << 16;
+        kind = kOpXori;
+        break;
+
+    case 32:    // lwz
+        if (a) {
+            op->imm = simm;
+            kind = kOpLwz;
+        }
+        break;
+
+    case 36:    // stw
+        if (a) {
+            op->imm = simm;
+            kind = kOpStw;
+        }
+        break;
+    }
+
+    if (kind == kOpGeneric || kind == kOpGenericEnd) {
+        op->handler = ResolveOp(inst);
+
+        // bclrx, bcctrx and rfi always leave the block, the cr ops in group 19 do not
+        if (op->handler == GekkoInt(BCLRX) || op->handler == GekkoInt(BCCTRX) ||
+            op->handler == GekkoInt(RFI)) {
+            kind = kOpGenericEnd;
+        }
+    }
+    op->label = labels[kind];
+
+    return (kind == kOpGenericEnd || kind == kOpB);
+}
+
+void GekkoCPUInterpreterThreaded::ClearCache() {
+    for (int i = 0; i < MEM_NUM_PAGES; i++) {
+        if (block_pages_[i]) {
+            for (int j = 0; j < kBlocksPerPage; j++) {
+                delete[] block_pages_[i][j].ops;
+            }
+            delete[] block_pages_[i];
+            block_pages_[i] = NULL;
+        }
+    }
+}
+
+void GekkoCPUInterpreterThreaded::FreeRetiredOps() {
+    for (size_t i = 0; i < retired_ops_.size(); i++) {
+        delete[] retired_ops_[i];
+    }
+    retired_ops_.clear();
+}
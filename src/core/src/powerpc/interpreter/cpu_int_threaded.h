@@ -0,0 +1,119 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    cpu_int_threaded.h
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-04
+ * @brief   Threaded-code flavor of the Gekko interpreter
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef CORE_POWERPC_INTERPRETER_CPU_INT_THREADED_H_
+#define CORE_POWERPC_INTERPRETER_CPU_INT_THREADED_H_
+
+#include <vector>
+
+#include "common.h"
+#include "memory.h"
+
+#include "cpu_int.h"
+
+/**
+ * Interpreter that translates guest basic blocks into arrays of dispatch records and runs them
+ * with computed-goto (labels-as-values) tail dispatch. The most common integer instructions are
+ * implemented inline on pre-extracted operands, everything else calls the regular interpreter
+ * handler. Falls back to the plain interpreter on compilers without labels-as-values.
+ */
+class GekkoCPUInterpreterThreaded : public GekkoCPUInterpreter {
+public:
+    GekkoCPUInterpreterThreaded();
+    ~GekkoCPUInterpreterThreaded();
+
+    GekkoF  ExecuteInstruction();
+    GekkoF  Open(u32 entry_point);
+    GekkoF  InvalidateCode(u32 addr, u32 size);
+
+private:
+    /// Inline implementations, indexes into the dispatch label table
+    enum OpKind {
+        kOpGeneric = 0,     ///< Call the interpreter handler
+        kOpGenericEnd,      ///< Call the interpreter handler, always ends the block (sc, HLE)
+        kOpBlockEnd,        ///< Block length limit reached
+        kOpLi,
+        kOpAddi,
+        kOpOri,
+        kOpXori,
+        kOpRlwinm,
+        kOpCmpi,
+        kOpCmpli,
+        kOpLwz,
+        kOpStw,
+        kOpB,
+        kNumOpKinds
+    };
+
+    /// Dispatch record for a single guest instruction
+    struct ThreadedOp {
+        const void* label;      ///< Dispatch target
+        optable     handler;    ///< Interpreter handler (generic records only)
+        u32         opcode;     ///< Instruction word
+        u32         address;    ///< Guest address of the instruction
+        u32         d;          ///< rD/rS, or CR field shift for compares
+        u32         a;          ///< rA
+        u32         b;          ///< Shift amount / link flag
+        u32         imm;        ///< Immediate, rotate mask or branch target
+    };
+
+    /// Compiled guest basic block
+    struct Block {
+        ThreadedOp* ops;                ///< Dispatch records (NULL if not compiled)
+        u32         address;            ///< Full guest address the block was compiled for
+        u32         num_instructions;   ///< Number of guest instructions spanned by the block
+    };
+
+    static const int kMaxBlockInstructions  = 64;
+    static const int kBlocksPerPage         = (MEM_PAGE_SIZE >> 2);
+
+    /**
+     * Lookup the block for a guest address, compiling it if necessary
+     * @param address Guest address of the first instruction in the block
+     * @param labels Dispatch label table, indexed by OpKind
+     * @return Compiled block
+     */
+    Block* GetBlock(u32 address, const void* const* labels);
+
+    /// Translate a guest basic block into dispatch records
+    void CompileBlock(Block* block, u32 address, const void* const* labels);
+
+    /// Decode a single instruction into a dispatch record, returns true if it ends the block
+    bool CompileInstruction(ThreadedOp* op, u32 address, u32 inst, const void* const* labels);
+
+    /// Release all compiled blocks
+    void ClearCache();
+
+    /// Free dispatch records of invalidated blocks, only safe while no block is running
+    void FreeRetiredOps();
+
+    Block*                      block_pages_[MEM_NUM_PAGES];    ///< Lazily allocated block tables
+    std::vector<ThreadedOp*>    retired_ops_;                   ///< Records awaiting release
+    int                         is_dec_;                        ///< Decrementer underflow pending
+    bool                        code_changed_;                  ///< Running block was invalidated
+
+    DISALLOW_COPY_AND_ASSIGN(GekkoCPUInterpreterThreaded);
+};
+
+#endif // CORE_POWERPC_INTERPRETER_CPU_INT_THREADED_H_
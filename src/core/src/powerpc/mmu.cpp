@@ -0,0 +1,286 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    mmu.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-07
+ * @brief   Gekko BAT and page table address translation, backed by a software TLB
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include "common.h"
+#include "log.h"
+#include "memory.h"
+
+#include "powerpc/cpu_core.h"
+#include "powerpc/cpu_core_regs.h"
+#include "mmu.h"
+
+namespace mmu {
+
+// Segment register bits
+static const u32 kSegmentT          = 0x80000000;   ///< Direct-store segment
+static const u32 kSegmentKs         = 0x40000000;   ///< Supervisor protection key
+static const u32 kSegmentKp         = 0x20000000;   ///< User protection key
+static const u32 kSegmentN          = 0x10000000;   ///< No-execute
+static const u32 kSegmentVSIDMask   = 0x00FFFFFF;
+
+// PTE bits
+static const u32 kPTEValid          = 0x80000000;
+static const u32 kPTEReferenced     = 0x00000100;
+static const u32 kPTEChanged        = 0x00000080;
+
+// DSISR / SRR1 fault reasons
+static const u32 kFaultNotFound     = 0x40000000;
+static const u32 kFaultDirectStore  = 0x10000000;
+static const u32 kFaultProtection   = 0x08000000;
+static const u32 kFaultStore        = 0x02000000;
+
+bool g_translate = false;
+
+u32 g_ibat_table[kBATTableSize];
+u32 g_dbat_table[kBATTableSize];
+TLBEntry g_itlb[kTLBSize];
+TLBEntry g_dtlb[kTLBSize];
+
+/// Move the physical EFB and hardware areas to where the fixed memory map decodes them
+static u32 PhysicalToDecoded(u32 addr) {
+    if (addr >= 0x08000000 && addr < 0x10000000) {
+        return addr | 0xC0000000;
+    }
+    return addr;
+}
+
+/// Returns true if the fixed memory map already decodes a BAT block the way it's mapped
+static bool IsNativeBlock(u32 ea, u32 pa, u32 size) {
+    // Dolphin OS windows, cached at 0x80000000 and uncached at 0xC0000000
+    if ((ea == (0x80000000 | pa) || ea == (0xC0000000 | pa)) && (pa + size) <= 0x10000000) {
+        return true;
+    }
+    // Identity mappings of RAM and of the locked L2 area
+    return (ea == pa) && ((pa + size) <= RAM_SIZE || pa >= 0xE0000000);
+}
+
+/**
+ * Build the per 128KB block lookup table for a set of BATs
+ * @param table Table to fill
+ * @param first_spr SPR number of the BAT0 upper register
+ * @return True if all valid BATs match the fixed memory map
+ */
+static bool BuildBATTable(u32* table, int first_spr) {
+    bool native = true;
+
+    memset(table, 0, sizeof(u32) * kBATTableSize);
+
+    // BAT0 has priority on overlaps, so fill starting from BAT3
+    for (int i = 3; i >= 0; i--) {
+        u32 upper = ireg.spr[first_spr + (i * 2)];
+        u32 lower = ireg.spr[first_spr + (i * 2) + 1];
+        u32 valid = upper & (kBATValidUser | kBATValidSuper);
+        u32 pp = lower & 3;
+
+        if (!valid) {
+            continue;
+        }
+        u32 bl = (upper >> 2) & 0x7FF;
+        u32 ea = upper & ~(bl << kBATShift) & ~kBATMask;
+        u32 pa = lower & ~(bl << kBATShift) & ~kBATMask;
+        u32 size = (bl + 1) << kBATShift;
+        // PP 0 blocks still match, so they win over the page table and deny every access
+        u32 flags = kBATMatch | (pp ? valid : 0) | ((pp == 2) ? kBATWritable : 0);
+
+        if (!pp || !IsNativeBlock(ea, pa, size)) {
+            native = false;
+        }
+        for (u32 offset = 0; offset < size; offset += (1 << kBATShift)) {
+            table[(ea + offset) >> kBATShift] = PhysicalToDecoded(pa + offset) | flags;
+        }
+    }
+    return native;
+}
+
+void Init() {
+    InvalidateTLB();
+    UpdateTranslation();
+}
+
+void UpdateTranslation() {
+    bool native_ibats = BuildBATTable(g_ibat_table, I_IBAT0U);
+    bool native_dbats = BuildBATTable(g_dbat_table, I_DBAT0U);
+    bool translate = !native_ibats || !native_dbats || (ireg.spr[I_SDR1] != 0);
+
+    if (translate != g_translate) {
+        LOG_NOTICE(TPOWERPC, "MMU translation %s", translate ? "enabled" : "disabled");
+    }
+    g_translate = translate;
+    InvalidateTLB();
+}
+
+void InvalidateTLB() {
+    memset(g_itlb, 0, sizeof(g_itlb));
+    memset(g_dtlb, 0, sizeof(g_dtlb));
+}
+
+void InvalidateTLBEntry(u32 addr) {
+    u32 index = (addr >> MEM_PAGE_SHIFT) & (kTLBSize - 1);
+    g_itlb[index].tag = 0;
+    g_dtlb[index].tag = 0;
+}
+
+/// Read a word of the page table, which lives in physical RAM
+static inline u32 ReadPhysical32(u32 addr) {
+    return *(u32*)&Mem_RAM[addr & RAM_MASK];
+}
+
+static inline void WritePhysical32(u32 addr, u32 data) {
+    *(u32*)&Mem_RAM[addr & RAM_MASK] = data;
+}
+
+/**
+ * Search the page table for the PTE of an effective address
+ * @param addr Effective address
+ * @param sr Segment register for the address
+ * @param is_write True to set the changed bit
+ * @param pte Receives the second PTE word (RPN, R/C bits, PP)
+ * @return True if a matching PTE was found
+ */
+static bool LookupPTE(u32 addr, u32 sr, bool is_write, u32* pte) {
+    u32 sdr1 = ireg.spr[I_SDR1];
+    u32 vsid = sr & kSegmentVSIDMask;
+    u32 page_index = (addr >> MEM_PAGE_SHIFT) & 0xFFFF;
+    u32 hash = ((vsid & 0x7FFFF) ^ page_index) & 0x7FFFF;
+
+    for (u32 h = 0; h < 2; h++) {
+        u32 pteg = (sdr1 & 0xFE000000) |
+            (((((sdr1 >> 16) & 0x1FF) | ((hash >> 10) & sdr1 & 0x1FF))) << 16) |
+            ((hash & 0x3FF) << 6);
+        u32 match = kPTEValid | (vsid << 7) | (h << 6) | (page_index >> 10);
+
+        for (u32 i = 0; i < 8; i++) {
+            if (ReadPhysical32(pteg + (i * 8)) != match) {
+                continue;
+            }
+            u32 word = ReadPhysical32(pteg + (i * 8) + 4);
+            u32 rc = kPTEReferenced | (is_write ? kPTEChanged : 0);
+
+            if ((word & rc) != rc) {
+                word |= rc;
+                WritePhysical32(pteg + (i * 8) + 4, word);
+            }
+            *pte = word;
+            return true;
+        }
+        // Secondary hash
+        hash = ~hash & 0x7FFFF;
+    }
+    return false;
+}
+
+/// Returns the PP access rights for the current privilege level: 0 none, 1 read, 2 read/write
+static u32 PageAccess(u32 sr, u32 pp) {
+    u32 key = (ireg.MSR & MSR_BIT_PR) ? (sr & kSegmentKp) : (sr & kSegmentKs);
+
+    if (!key) {
+        return (pp == 3) ? 1 : 2;
+    }
+    return (pp == 0) ? 0 : ((pp == 2) ? 2 : 1);
+}
+
+static void RaiseDSI(u32 addr, u32 reason, bool is_write) {
+    ireg.spr[I_DAR] = addr;
+    ireg.spr[I_DSISR] = reason | (is_write ? kFaultStore : 0);
+    cpu->Exception(GekkoCPU::GEX_DSI);
+}
+
+static void RaiseISI(u32 reason) {
+    cpu->Exception(GekkoCPU::GEX_ISI);
+    SRR1 |= reason;
+}
+
+bool TranslateDataMiss(u32* addr, bool is_write) {
+    u32 ea = *addr;
+
+    // A BAT matched but doesn't allow the access (read-only, no access or not valid in this
+    // mode), it has priority over the page table
+    if (g_dbat_table[ea >> kBATShift] & kBATMatch) {
+        RaiseDSI(ea, kFaultProtection, is_write);
+        return false;
+    }
+    u32 sr = ireg.sr[ea >> 28];
+    if (sr & kSegmentT) {
+        RaiseDSI(ea, kFaultDirectStore, is_write);
+        return false;
+    }
+    u32 pte;
+    if (!LookupPTE(ea, sr, false, &pte)) {
+        RaiseDSI(ea, kFaultNotFound, is_write);
+        return false;
+    }
+    u32 access = PageAccess(sr, pte & 3);
+    if (access < (is_write ? 2u : 1u)) {
+        RaiseDSI(ea, kFaultProtection, is_write);
+        return false;
+    }
+    // Only record the change once the store is known to go through
+    if (is_write && !(pte & kPTEChanged)) {
+        LookupPTE(ea, sr, true, &pte);
+    }
+    TLBEntry& entry = g_dtlb[(ea >> MEM_PAGE_SHIFT) & (kTLBSize - 1)];
+    u32 page = PhysicalToDecoded(pte & ~MEM_PAGE_MASK);
+
+    // Stores can hit once the changed bit is set
+    entry.tag = (ea & ~MEM_PAGE_MASK) | kTLBValid |
+        (((pte & kPTEChanged) && access == 2) ? kTLBChanged : 0);
+    entry.page = page;
+
+    *addr = page | (ea & MEM_PAGE_MASK);
+    return true;
+}
+
+bool TranslateInstructionMiss(u32* addr) {
+    u32 ea = *addr;
+
+    // A BAT matched but doesn't allow fetching (no access or not valid in this mode)
+    if (g_ibat_table[ea >> kBATShift] & kBATMatch) {
+        RaiseISI(kFaultProtection);
+        return false;
+    }
+    u32 sr = ireg.sr[ea >> 28];
+    if (sr & (kSegmentT | kSegmentN)) {
+        RaiseISI(kFaultDirectStore);
+        return false;
+    }
+    u32 pte;
+    if (!LookupPTE(ea, sr, false, &pte)) {
+        RaiseISI(kFaultNotFound);
+        return false;
+    }
+    if (!PageAccess(sr, pte & 3)) {
+        RaiseISI(kFaultProtection);
+        return false;
+    }
+    TLBEntry& entry = g_itlb[(ea >> MEM_PAGE_SHIFT) & (kTLBSize - 1)];
+    u32 page = PhysicalToDecoded(pte & ~MEM_PAGE_MASK);
+
+    entry.tag = (ea & ~MEM_PAGE_MASK) | kTLBValid;
+    entry.page = page;
+
+    *addr = page | (ea & MEM_PAGE_MASK);
+    return true;
+}
+
+} // namespace
@@ -0,0 +1,216 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    mmu.h
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-07
+ * @brief   Gekko BAT and page table address translation, backed by a software TLB
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef CORE_POWERPC_MMU_H_
+#define CORE_POWERPC_MMU_H_
+
+#include "common.h"
+
+#include "memory.h"
+#include "powerpc/cpu_core_regs.h"
+
+/**
+ * The memory accessors decode effective addresses with a fixed memory map: everything below
+ * 0xC8000000 is RAM, 0xCC000000 is hardware and so on. That is exactly what the standard BAT setup
+ * of the Dolphin OS produces, so translation is only switched on (g_translate) once the guest
+ * programs a BAT the fixed map can't express, or points SDR1 at a page table.
+ *
+ * Translated addresses are handed back in the form the fixed map decodes, i.e. physical RAM stays
+ * as is and the physical EFB/hardware areas are moved up to 0xC8000000/0xCC000000.
+ */
+namespace mmu {
+
+static const int kBATShift          = 17;                       ///< Smallest BAT block is 128KB
+static const u32 kBATMask           = (1 << kBATShift) - 1;
+static const int kBATTableSize      = 1 << (32 - kBATShift);
+
+// Flags in the low bits of a BAT table entry
+static const u32 kBATValidUser      = 0x1;                      ///< Vp, block valid in user mode
+static const u32 kBATValidSuper     = 0x2;                      ///< Vs, block valid in supervisor mode
+static const u32 kBATWritable       = 0x4;                      ///< PP allows writes
+static const u32 kBATMatch          = 0x8;  ///< A BAT covers the block, even if it denies access
+
+static const int kTLBSize           = 128;                      ///< Entries per TLB, direct mapped
+
+// Flags in the low bits of a TLB entry tag
+static const u32 kTLBValid          = 0x1;
+static const u32 kTLBChanged        = 0x2;  ///< PTE C bit already set and PP allows writes
+
+/// Cached page table translation
+struct TLBEntry {
+    u32 tag;    ///< Effective page address | kTLB* flags
+    u32 page;   ///< Translated page address
+};
+
+/// Nonzero once the guest BAT/page table setup differs from the fixed memory map
+extern bool g_translate;
+
+extern u32 g_ibat_table[kBATTableSize];     ///< Translated 128KB block | kBAT* flags, per EA block
+extern u32 g_dbat_table[kBATTableSize];
+extern TLBEntry g_itlb[kTLBSize];
+extern TLBEntry g_dtlb[kTLBSize];
+
+/// Reset translation state, called when the CPU core is opened
+void Init();
+
+/// Rebuild the BAT tables and re-evaluate g_translate, called when a BAT or SDR1 is written
+void UpdateTranslation();
+
+/// Drop all cached page translations (tlbia, segment register or SDR1 writes)
+void InvalidateTLB();
+
+/// Drop the cached page translations for an effective address (tlbie)
+void InvalidateTLBEntry(u32 addr);
+
+/// Slow path of TranslateData, walks the page table and raises a DSI on failure
+bool TranslateDataMiss(u32* addr, bool is_write);
+
+/// Slow path of TranslateInstruction, walks the page table and raises an ISI on failure
+bool TranslateInstructionMiss(u32* addr);
+
+/**
+ * Translate a data effective address, only needs to be called while g_translate is set
+ * @param addr Effective address, replaced with the translated address
+ * @param is_write True for stores
+ * @return False if a DSI exception was raised, the access must be dropped
+ */
+inline bool TranslateData(u32* addr, bool is_write) {
+    if (!(ireg.MSR & MSR_BIT_DR)) {
+        return true;
+    }
+    u32 need = ((ireg.MSR & MSR_BIT_PR) ? kBATValidUser : kBATValidSuper) |
+        (is_write ? kBATWritable : 0);
+    u32 bat = g_dbat_table[*addr >> kBATShift];
+
+    if ((bat & need) == need) {
+        *addr = (bat & ~kBATMask) | (*addr & kBATMask);
+        return true;
+    }
+    const TLBEntry& entry = g_dtlb[(*addr >> MEM_PAGE_SHIFT) & (kTLBSize - 1)];
+
+    // Reads don't care whether the page has been changed yet
+    if ((entry.tag | (is_write ? 0 : kTLBChanged)) ==
+        ((*addr & ~MEM_PAGE_MASK) | kTLBValid | kTLBChanged)) {
+        *addr = entry.page | (*addr & MEM_PAGE_MASK);
+        return true;
+    }
+    return TranslateDataMiss(addr, is_write);
+}
+
+/**
+ * Translate an instruction effective address, only needs to be called while g_translate is set
+ * @param addr Effective address, replaced with the translated address
+ * @return False if an ISI exception was raised
+ */
+inline bool TranslateInstruction(u32* addr) {
+    if (!(ireg.MSR & MSR_BIT_IR)) {
+        return true;
+    }
+    u32 need = (ireg.MSR & MSR_BIT_PR) ? kBATValidUser : kBATValidSuper;
+    u32 bat = g_ibat_table[*addr >> kBATShift];
+
+    if (bat & need) {
+        *addr = (bat & ~kBATMask) | (*addr & kBATMask);
+        return true;
+    }
+    const TLBEntry& entry = g_itlb[(*addr >> MEM_PAGE_SHIFT) & (kTLBSize - 1)];
+
+    if ((entry.tag & ~kTLBChanged) == ((*addr & ~MEM_PAGE_MASK) | kTLBValid)) {
+        *addr = entry.page | (*addr & MEM_PAGE_MASK);
+        return true;
+    }
+    return TranslateInstructionMiss(addr);
+}
+
+// CPU data accesses. Hardware DMA works on physical addresses and keeps using Memory_* directly.
+// They return false if the access raised a DSI, the instruction must then leave all registers
+// untouched, as it is restarted once the exception handler returns.
+
+inline bool Read8(u32 addr, u8* data) {
+    if (g_translate && !TranslateData(&addr, false)) {
+        return false;
+    }
+    *data = Memory_Read8(addr);
+    return true;
+}
+
+inline bool Read16(u32 addr, u16* data) {
+    if (g_translate && !TranslateData(&addr, false)) {
+        return false;
+    }
+    *data = Memory_Read16(addr);
+    return true;
+}
+
+inline bool Read32(u32 addr, u32* data) {
+    if (g_translate && !TranslateData(&addr, false)) {
+        return false;
+    }
+    *data = Memory_Read32(addr);
+    return true;
+}
+
+inline bool Read64(u32 addr, u64* data) {
+    if (g_translate && !TranslateData(&addr, false)) {
+        return false;
+    }
+    *data = Memory_Read64(addr);
+    return true;
+}
+
+inline bool Write8(u32 addr, u32 data) {
+    if (g_translate && !TranslateData(&addr, true)) {
+        return false;
+    }
+    Memory_Write8(addr, data);
+    return true;
+}
+
+inline bool Write16(u32 addr, u32 data) {
+    if (g_translate && !TranslateData(&addr, true)) {
+        return false;
+    }
+    Memory_Write16(addr, data);
+    return true;
+}
+
+inline bool Write32(u32 addr, u32 data) {
+    if (g_translate && !TranslateData(&addr, true)) {
+        return false;
+    }
+    Memory_Write32(addr, data);
+    return true;
+}
+
+inline bool Write64(u32 addr, u64 data) {
+    if (g_translate && !TranslateData(&addr, true)) {
+        return false;
+    }
+    Memory_Write64(addr, data);
+    return true;
+}
+
+} // namespace
+
+#endif // CORE_POWERPC_MMU_H_
@@ -0,0 +1,178 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    cpu_rec_x64.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-02
+ * @brief   Basic block dynamic recompiler for x86-64 Linux hosts
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include <sys/mman.h>
+
+#include "common.h"
+#include "log.h"
+
+#include "hw/hw.h"
+#include "powerpc/cpu_core_regs.h"
+#include "powerpc/mmu.h"
+#include "cpu_rec_x64.h"
+
+GekkoCPURecompilerX64::GekkoCPURecompilerX64() : code_buffer_(NULL), is_dec_(0) {
+    memset(block_pages_, 0, sizeof(block_pages_));
+
+    void* buffer = mmap(NULL, kCodeBufferSize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (buffer == MAP_FAILED) {
+        LOG_ERROR(TPOWERPC, "recompiler failed to allocate code buffer, using interpreter");
+        return;
+    }
+    code_buffer_ = (u8*)buffer;
+    emit_.set_code_ptr(code_buffer_);
+    ProtectCodeBuffer(false);
+
+    LOG_NOTICE(TPOWERPC, "x86-64 recompiler initialized ok");
+}
+
+GekkoCPURecompilerX64::~GekkoCPURecompilerX64() {
+    ClearCache();
+    if (code_buffer_) {
+        munmap(code_buffer_, kCodeBufferSize);
+        code_buffer_ = NULL;
+    }
+}
+
+GekkoCPU::CPUType GekkoCPURecompilerX64::GetCPUType() {
+    return GekkoCPU::DynaRec;
+}
+
+GekkoF GekkoCPURecompilerX64::Open(u32 entry_point) {
+    GekkoCPUInterpreter::Open(entry_point);
+    ClearCache();
+    is_dec_ = 0;
+}
+
+/// Execute one compiled block, with the same timing bookkeeping as the interpreter
+GekkoF GekkoCPURecompilerX64::ExecuteInstruction() {
+    // Single stepping and op dumping are debugging features, leave them to the interpreter. So is
+    // running with MMU translation, compiled blocks access memory through the fixed memory map.
+    if (step || DumpOp0 || mmu::g_translate || NULL == code_buffer_) {
+        GekkoCPUInterpreter::ExecuteInstruction();
+        return;
+    }
+    branch = 0;
+
+    u32 start_pc = ireg.PC;
+    Block* block = GetBlock(start_pc);
+    u32 inst_count = block->code();
+
+    ireg.TBR.TBR += inst_count;
+
+    if (DEC < inst_count) {
+        is_dec_ = MSR_BIT_EE;
+    }
+    DEC -= inst_count;
+    ireg.IC += inst_count;
+
+    // Spinning in a loop that only waits on hardware, jump ahead to the next event
+    if (IdleSkipping && branch == OPCODE_BRANCH && ireg.PC == start_pc && IsIdleLoop(start_pc)) {
+        SkipIdleLoop();
+    }
+    if (branch && !(branch & OPCODE_RFI)) {
+        if (!Flipper_Update() && (ireg.MSR & is_dec_)) {
+            is_dec_ = 0;
+            cpu->Exception(GEX_DEC);
+        }
+        exception = 0;
+    }
+    branch = 0;
+}
+
+GekkoF GekkoCPURecompilerX64::InvalidateCode(u32 addr, u32 size) {
+    // Also used when single stepping through the interpreter
+    GekkoCPUInterpreter::InvalidateCode(addr, size);
+
+    u32 start = addr & RAM_MASK;
+    u32 end = start + size;
+    u32 back = (kMaxBlockInstructions - 1) * 4;
+
+    if (end > RAM_SIZE) {
+        end = RAM_SIZE;
+    }
+    // A block starting before the range may still run into it
+    u32 first = (start > back) ? ((start - back) & ~3) : 0;
+
+    for (u32 offset = first; offset < end; ) {
+        Block* page = block_pages_[offset >> kPageShift];
+        if (NULL == page) {
+            offset = (offset & ~(kPageSize - 1)) + kPageSize;
+            continue;
+        }
+        Block* block = &page[(offset & (kPageSize - 1)) >> 2];
+        if (block->code && (offset + block->num_instructions * 4) > start) {
+            block->code = NULL;
+        }
+        offset += 4;
+    }
+}
+
+GekkoCPURecompilerX64::Block* GekkoCPURecompilerX64::GetBlock(u32 address) {
+    u32 offset = address & RAM_MASK;
+    Block*& page = block_pages_[offset >> kPageShift];
+
+    if (NULL == page) {
+        page = new Block[kBlocksPerPage];
+        memset(page, 0, sizeof(Block) * kBlocksPerPage);
+    }
+    Block* block = &page[(offset & (kPageSize - 1)) >> 2];
+
+    if (NULL == block->code || block->address != address) {
+        // Out of code space - throw everything away and start over
+        u32 worst_case = (kMaxBlockInstructions + 1) * kMaxInstructionBytes;
+        if ((emit_.code_ptr() + worst_case) > (code_buffer_ + kCodeBufferSize)) {
+            LOG_NOTICE(TPOWERPC, "recompiler code buffer full, flushing");
+            ClearCache();
+            return GetBlock(address);
+        }
+        CompileBlock(block, address);
+    }
+    return block;
+}
+
+void GekkoCPURecompilerX64::ClearCache() {
+    for (int i = 0; i < kNumPages; i++) {
+        delete[] block_pages_[i];
+        block_pages_[i] = NULL;
+    }
+    emit_.set_code_ptr(code_buffer_);
+}
+
+void GekkoCPURecompilerX64::ProtectCodeBuffer(bool writable) {
+    int prot = writable ? (PROT_READ | PROT_WRITE) : (PROT_READ | PROT_EXEC);
+    if (mprotect(code_buffer_, kCodeBufferSize, prot) != 0) {
+        LOG_ERROR(TPOWERPC, "recompiler failed to change code buffer protection");
+    }
+}
+
+/// Execute a single guest instruction with the interpreter
+u32 GekkoCPURecompilerX64::RunInterpreterOp(u32 pc, u32 op) {
+    ireg.PC = pc;
+    opcode = op;
+    GekkoCPUOpset[op >> 26]();
+    return branch;
+}
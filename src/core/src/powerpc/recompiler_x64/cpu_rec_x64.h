@@ -0,0 +1,150 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    cpu_rec_x64.h
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-02
+ * @brief   Basic block dynamic recompiler for x86-64 Linux hosts
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef CORE_POWERPC_RECOMPILER_X64_CPU_REC_X64_H_
+#define CORE_POWERPC_RECOMPILER_X64_CPU_REC_X64_H_
+
+#include "common.h"
+#include "memory.h"
+
+#include "powerpc/cpu_core.h"
+#include "powerpc/interpreter/cpu_int.h"
+#include "x64_emitter.h"
+
+/**
+ * Translates guest basic blocks into native x86-64 code. Integer arithmetic, compares, integer
+ * loads/stores and direct branches are emitted natively; every other instruction is compiled to a
+ * call into the corresponding interpreter handler, so the two cores always share semantics.
+ */
+class GekkoCPURecompilerX64 : public GekkoCPUInterpreter {
+public:
+    GekkoCPURecompilerX64();
+    ~GekkoCPURecompilerX64();
+
+    GekkoF  ExecuteInstruction();
+    CPUType GetCPUType();
+    GekkoF  Open(u32 entry_point);
+
+    /**
+     * Discard all compiled blocks that overlap a range of guest memory
+     * @param addr Guest address of the first modified byte
+     * @param size Size of the modified range in bytes
+     */
+    GekkoF  InvalidateCode(u32 addr, u32 size);
+
+private:
+    /// Compiled block entry point, returns the number of guest instructions executed
+    typedef u32 (*BlockFunc)(void);
+
+    /// Compiled guest basic block
+    struct Block {
+        BlockFunc   code;               ///< Native entry point (NULL if not compiled)
+        u32         address;            ///< Full guest address the block was compiled for
+        u32         num_instructions;   ///< Number of guest instructions spanned by the block
+    };
+
+    static const int kMaxBlockInstructions  = 256;                  ///< Guest instructions per block
+    static const int kMaxInstructionBytes   = 160;                  ///< Worst case native op size
+    static const int kCodeBufferSize        = 32 * 1024 * 1024;     ///< Native code space
+    static const int kPageShift             = 12;
+    static const int kPageSize              = (1 << kPageShift);
+    static const int kNumPages              = (RAM_SIZE >> kPageShift);
+    static const int kBlocksPerPage         = (kPageSize >> 2);
+
+    /**
+     * Lookup the compiled block for a guest address, compiling it if necessary
+     * @param address Guest address of the first instruction in the block
+     * @return Compiled block
+     */
+    Block* GetBlock(u32 address);
+
+    /**
+     * Compile a guest basic block into the code buffer
+     * @param block Block entry to fill in
+     * @param address Guest address of the first instruction in the block
+     */
+    void CompileBlock(Block* block, u32 address);
+
+    /**
+     * Emit native code for a single guest instruction
+     * @param pc Guest address of the instruction
+     * @param op Guest instruction word
+     * @param count Number of guest instructions in the block including this one
+     * @return True if the instruction ends the block
+     */
+    bool CompileInstruction(u32 pc, u32 op, u32 count);
+
+    /// Emit a call into the interpreter for an instruction without a native implementation
+    void EmitFallback(u32 pc, u32 op, u32 count, bool ends_block);
+
+    /// Emit a direct (b/bl/ba/bla) branch
+    void EmitBranch(u32 pc, u32 op, u32 count);
+
+    /// Emit a conditional (bc) branch
+    void EmitBranchConditional(u32 pc, u32 op, u32 count);
+
+    /// Emit a CR field update from the flags of a preceding x86 compare
+    void EmitCompare(u32 crf, bool is_signed);
+
+    /// Emit an integer load, the effective address is expected in ECX
+    void EmitLoad(u32 op, int size, bool sign_extend, bool update);
+
+    /// Emit an integer store, the effective address is expected in ECX
+    void EmitStore(u32 op, int size, bool update);
+
+    /// Emit ECX = (rA|0) + SIMM
+    void EmitAddressImm(u32 op);
+
+    /// Emit ECX = (rA|0) + rB
+    void EmitAddressReg(u32 op);
+
+    /// Emit the block epilogue, returning count in EAX
+    void EmitExit(u32 count);
+
+    /// Emit code to flag the current block as having taken a branch
+    void EmitSetBranch();
+
+    // Guest register access, RBX holds &ireg while a block is executing
+    void LoadGPR(X64Emitter::Reg reg, int gpr);
+    void StoreGPR(int gpr, X64Emitter::Reg reg);
+    static s32 RegOffset(const void* ptr);
+
+    /// Execute a single instruction with the interpreter, returns the interpreter branch flag
+    static u32 RunInterpreterOp(u32 pc, u32 op);
+
+    /// Release all compiled code
+    void ClearCache();
+
+    /// Toggle the code buffer between writable and executable
+    void ProtectCodeBuffer(bool writable);
+
+    u8*         code_buffer_;                   ///< mmap'd native code space
+    X64Emitter  emit_;                          ///< Emitter writing into code_buffer_
+    Block*      block_pages_[kNumPages];        ///< Lazily allocated per page block tables
+    int         is_dec_;                        ///< Decrementer underflow pending
+
+    DISALLOW_COPY_AND_ASSIGN(GekkoCPURecompilerX64);
+};
+
+#endif // CORE_POWERPC_RECOMPILER_X64_CPU_REC_X64_H_
@@ -0,0 +1,655 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    cpu_rec_x64_opcodes.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-02
+ * @brief   Block compiler and native instruction emitters for the x86-64 recompiler
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include <vector>
+
+#include "common.h"
+#include "memory.h"
+#include "fastmem.h"
+
+#include "powerpc/cpu_core_regs.h"
+#include "cpu_rec_x64.h"
+
+// Register usage inside a compiled block:
+//  RBX - &ireg
+//  R12 - effective address preserved across memory handler calls
+//  RAX, RCX, RDX, RSI, RDI - scratch
+static const X64Emitter::Reg EAX = X64Emitter::RAX;
+static const X64Emitter::Reg ECX = X64Emitter::RCX;
+static const X64Emitter::Reg EDX = X64Emitter::RDX;
+static const X64Emitter::Reg EBX = X64Emitter::RBX;
+static const X64Emitter::Reg ESI = X64Emitter::RSI;
+static const X64Emitter::Reg EDI = X64Emitter::RDI;
+static const X64Emitter::Reg R12 = X64Emitter::R12;
+static const X64Emitter::Reg R13 = X64Emitter::R13;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Block compiler
+
+void GekkoCPURecompilerX64::CompileBlock(Block* block, u32 address) {
+    ProtectCodeBuffer(true);
+
+    u8* start = emit_.code_ptr();
+
+    // Three pushes leave RSP 16-byte aligned for calls out of the block
+    emit_.PUSH_R64(EBX);
+    emit_.PUSH_R64(R12);
+    emit_.PUSH_R64(R13);
+    emit_.MOV_RI64(EBX, (u64)(uintptr_t)&ireg);
+
+    u32 pc = address;
+    u32 count = 0;
+
+    for (;;) {
+        u32 op = *(u32*)&Mem_RAM[pc & RAM_MASK];
+        count++;
+
+        // Guest writes to this page must come back and invalidate the block
+        Memory_MarkCodePage(pc);
+
+        if (CompileInstruction(pc, op, count)) {
+            break;
+        }
+        pc += 4;
+
+        if (count >= kMaxBlockInstructions) {
+            emit_.MOV_MI32(EBX, RegOffset(&ireg.PC), pc);
+            EmitExit(count);
+            break;
+        }
+    }
+    block->code = (BlockFunc)start;
+    block->address = address;
+    block->num_instructions = count;
+
+    ProtectCodeBuffer(false);
+}
+
+bool GekkoCPURecompilerX64::CompileInstruction(u32 pc, u32 op, u32 count) {
+    opcode = op; // Operand decode macros work off of the current opcode
+
+    switch (OPCD) {
+    case 3: // HLE
+        EmitFallback(pc, op, count, true);
+        return true;
+
+    case 7: // mulli
+        LoadGPR(EAX, rA);
+        emit_.IMUL_RRI32(EAX, EAX, SIMM);
+        StoreGPR(rD, EAX);
+        return false;
+
+    case 10: // cmpli
+        LoadGPR(EAX, rA);
+        emit_.ALU_RI32(X64Emitter::ALU_CMP, EAX, UIMM);
+        EmitCompare(CRFD, false);
+        return false;
+
+    case 11: // cmpi
+        LoadGPR(EAX, rA);
+        emit_.ALU_RI32(X64Emitter::ALU_CMP, EAX, (s32)SIMM);
+        EmitCompare(CRFD, true);
+        return false;
+
+    case 14: // addi
+        if (rA) {
+            LoadGPR(EAX, rA);
+            emit_.ALU_RI32(X64Emitter::ALU_ADD, EAX, (s32)SIMM);
+            StoreGPR(rD, EAX);
+        } else {
+            emit_.MOV_MI32(EBX, RegOffset(&ireg.gpr[rD]), (s32)SIMM);
+        }
+        return false;
+
+    case 15: // addis
+        if (rA) {
+            LoadGPR(EAX, rA);
+            emit_.ALU_RI32(X64Emitter::ALU_ADD, EAX, (u32)SIMM << 16);
+            StoreGPR(rD, EAX);
+        } else {
+            emit_.MOV_MI32(EBX, RegOffset(&ireg.gpr[rD]), (u32)SIMM << 16);
+        }
+        return false;
+
+    case 16: // bcx
+        EmitBranchConditional(pc, op, count);
+        return true;
+
+    case 17: // sc
+        EmitFallback(pc, op, count, true);
+        return true;
+
+    case 19: // bclrx, bcctrx, rfi and cr ops - only the branches end the block
+        EmitFallback(pc, op, count, false);
+        return false;
+
+    case 18: // bx
+        EmitBranch(pc, op, count);
+        return true;
+
+    case 21: // rlwinmx
+    {
+        u32 mb = MB;
+        u32 me = ME;
+        u32 mask = ((u32)-1 >> mb) ^ ((me >= 31) ? 0 : ((u32)-1) >> (me + 1));
+        if (mb > me) {
+            mask = ~mask;
+        }
+        LoadGPR(EAX, rS);
+        if (SH) {
+            emit_.SHIFT_RI32(X64Emitter::SHIFT_ROL, EAX, SH);
+        }
+        emit_.ALU_RI32(X64Emitter::ALU_AND, EAX, mask);
+        StoreGPR(rA, EAX);
+        if (RC) {
+            emit_.TEST_RR32(EAX, EAX);
+            EmitCompare(0, true);
+        }
+        return false;
+    }
+
+    case 24: // ori
+    case 25: // oris
+    case 26: // xori
+    case 27: // xoris
+    case 28: // andi.
+    case 29: // andis.
+    {
+        static const X64Emitter::AluOp alu_ops[] = {
+            X64Emitter::ALU_OR, X64Emitter::ALU_XOR, X64Emitter::ALU_AND
+        };
+        u32 imm = (OPCD & 1) ? ((u32)UIMM << 16) : UIMM;
+        LoadGPR(EAX, rS);
+        emit_.ALU_RI32(alu_ops[(OPCD - 24) >> 1], EAX, imm);
+        StoreGPR(rA, EAX);
+        if (OPCD >= 28) {
+            emit_.TEST_RR32(EAX, EAX);
+            EmitCompare(0, true);
+        }
+        return false;
+    }
+
+    case 31:
+        switch (XO0) {
+        case 0: // cmp
+        case 32: // cmpl
+            LoadGPR(EAX, rA);
+            emit_.ALU_RM32(X64Emitter::ALU_CMP, EAX, EBX, RegOffset(&ireg.gpr[rB]));
+            EmitCompare(CRFD, (XO0 == 0));
+            return false;
+
+        case 19: // mfcr
+            emit_.MOV_RM32(EAX, EBX, RegOffset(&ireg.CR));
+            StoreGPR(rD, EAX);
+            return false;
+
+        case 28: // andx
+        case 316: // xorx
+        case 444: // orx
+        case 60: // andcx
+        case 124: // norx
+        case 476: // nandx
+        case 284: // eqvx
+            LoadGPR(EAX, rB);
+            if (XO0 == 60) {
+                emit_.NOT_R32(EAX);
+            }
+            switch (XO0) {
+            case 28: case 60: case 476:
+                emit_.ALU_RM32(X64Emitter::ALU_AND, EAX, EBX, RegOffset(&ireg.gpr[rS]));
+                break;
+            case 316: case 284:
+                emit_.ALU_RM32(X64Emitter::ALU_XOR, EAX, EBX, RegOffset(&ireg.gpr[rS]));
+                break;
+            default:
+                emit_.ALU_RM32(X64Emitter::ALU_OR, EAX, EBX, RegOffset(&ireg.gpr[rS]));
+                break;
+            }
+            if (XO0 == 124 || XO0 == 476 || XO0 == 284) {
+                emit_.NOT_R32(EAX);
+            }
+            StoreGPR(rA, EAX);
+            if (RC) {
+                emit_.TEST_RR32(EAX, EAX);
+                EmitCompare(0, true);
+            }
+            return false;
+
+        case 266: // addx
+        case 40: // subfx
+        case 104: // negx
+        case 235: // mullwx
+            switch (XO0) {
+            case 266:
+                LoadGPR(EAX, rA);
+                emit_.ALU_RM32(X64Emitter::ALU_ADD, EAX, EBX, RegOffset(&ireg.gpr[rB]));
+                break;
+            case 40:
+                LoadGPR(EAX, rB);
+                emit_.ALU_RM32(X64Emitter::ALU_SUB, EAX, EBX, RegOffset(&ireg.gpr[rA]));
+                break;
+            case 104:
+                LoadGPR(EAX, rA);
+                emit_.NEG_R32(EAX);
+                break;
+            case 235:
+                LoadGPR(EAX, rA);
+                LoadGPR(ECX, rB);
+                emit_.IMUL_RR32(EAX, ECX);
+                break;
+            }
+            StoreGPR(rD, EAX);
+            if (RC) {
+                emit_.TEST_RR32(EAX, EAX);
+                EmitCompare(0, true);
+            }
+            return false;
+
+        case 922: // extshx
+        case 954: // extsbx
+            LoadGPR(EAX, rS);
+            if (XO0 == 922) {
+                emit_.MOVSX_R32R16(EAX, EAX);
+            } else {
+                emit_.MOVSX_R32R8(EAX, EAX);
+            }
+            StoreGPR(rA, EAX);
+            if (RC) {
+                emit_.TEST_RR32(EAX, EAX);
+                EmitCompare(0, true);
+            }
+            return false;
+
+        case 339: // mfspr
+        {
+            u32 spr = (rB << 5) | rA;
+            if (spr == I_LR || spr == I_CTR) {
+                emit_.MOV_RM32(EAX, EBX, RegOffset(&ireg.spr[spr]));
+                StoreGPR(rD, EAX);
+                return false;
+            }
+            break;
+        }
+
+        case 467: // mtspr
+        {
+            u32 spr = (rB << 5) | rA;
+            if (spr == I_LR || spr == I_CTR) {
+                LoadGPR(EAX, rS);
+                emit_.MOV_MR32(EBX, RegOffset(&ireg.spr[spr]), EAX);
+                return false;
+            }
+            break;
+        }
+
+        case 23: // lwzx
+            EmitAddressReg(op);
+            EmitLoad(op, 32, false, false);
+            return false;
+        case 87: // lbzx
+            EmitAddressReg(op);
+            EmitLoad(op, 8, false, false);
+            return false;
+        case 279: // lhzx
+            EmitAddressReg(op);
+            EmitLoad(op, 16, false, false);
+            return false;
+        case 343: // lhax
+            EmitAddressReg(op);
+            EmitLoad(op, 16, true, false);
+            return false;
+        case 151: // stwx
+            EmitAddressReg(op);
+            EmitStore(op, 32, false);
+            return false;
+        case 215: // stbx
+            EmitAddressReg(op);
+            EmitStore(op, 8, false);
+            return false;
+        case 407: // sthx
+            EmitAddressReg(op);
+            EmitStore(op, 16, false);
+            return false;
+        }
+        break;
+
+    case 32: // lwz
+    case 33: // lwzu
+    case 34: // lbz
+    case 35: // lbzu
+    case 40: // lhz
+    case 41: // lhzu
+    case 42: // lha
+    case 43: // lhau
+    {
+        bool update = (OPCD & 1) != 0;
+        if (update && (rA == 0 || rA == rD)) {
+            break; // Invalid form, let the interpreter deal with it
+        }
+        int size = (OPCD < 34) ? 32 : ((OPCD < 40) ? 8 : 16);
+        EmitAddressImm(op);
+        EmitLoad(op, size, OPCD >= 42, update);
+        return false;
+    }
+
+    case 36: // stw
+    case 37: // stwu
+    case 38: // stb
+    case 39: // stbu
+    case 44: // sth
+    case 45: // sthu
+    {
+        bool update = (OPCD & 1) != 0;
+        if (update && rA == 0) {
+            break;
+        }
+        int size = (OPCD < 38) ? 32 : ((OPCD < 44) ? 8 : 16);
+        EmitAddressImm(op);
+        EmitStore(op, size, update);
+        return false;
+    }
+    }
+
+    EmitFallback(pc, op, count, false);
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Emitters
+
+s32 GekkoCPURecompilerX64::RegOffset(const void* ptr) {
+    return (s32)((const u8*)ptr - (const u8*)&ireg);
+}
+
+void GekkoCPURecompilerX64::LoadGPR(X64Emitter::Reg reg, int gpr) {
+    emit_.MOV_RM32(reg, EBX, RegOffset(&ireg.gpr[gpr]));
+}
+
+void GekkoCPURecompilerX64::StoreGPR(int gpr, X64Emitter::Reg reg) {
+    emit_.MOV_MR32(EBX, RegOffset(&ireg.gpr[gpr]), reg);
+}
+
+void GekkoCPURecompilerX64::EmitExit(u32 count) {
+    emit_.MOV_RI32(EAX, count);
+    emit_.POP_R64(R13);
+    emit_.POP_R64(R12);
+    emit_.POP_R64(EBX);
+    emit_.RET();
+}
+
+void GekkoCPURecompilerX64::EmitSetBranch() {
+    emit_.MOV_RI64(EAX, (u64)(uintptr_t)&branch);
+    emit_.MOV_MI32(EAX, 0, OPCODE_BRANCH);
+}
+
+void GekkoCPURecompilerX64::EmitFallback(u32 pc, u32 op, u32 count, bool ends_block) {
+    emit_.MOV_RI32(EDI, pc);
+    emit_.MOV_RI32(ESI, op);
+    emit_.CALL_ABS((const void*)&RunInterpreterOp);
+    emit_.TEST_RR32(EAX, EAX);
+
+    if (ends_block) {
+        // The handler may have moved PC without branching (HLE), resume after it
+        u8* branched = emit_.Jcc_Rel32(X64Emitter::CC_NE);
+        emit_.ALU_MI32(X64Emitter::ALU_ADD, EBX, RegOffset(&ireg.PC), 4);
+        emit_.SetJumpTarget(branched);
+        EmitExit(count);
+    } else {
+        u8* no_branch = emit_.Jcc_Rel32(X64Emitter::CC_E);
+        EmitExit(count);
+        emit_.SetJumpTarget(no_branch);
+    }
+}
+
+void GekkoCPURecompilerX64::EmitBranch(u32 pc, u32 op, u32 count) {
+    u32 target = EXTS(op & 0x03FFFFFC, 26);
+    if (!(op & 2)) {
+        target += pc;
+    }
+    if (op & 1) {
+        emit_.MOV_MI32(EBX, RegOffset(&LR), pc + 4);
+    }
+    emit_.MOV_MI32(EBX, RegOffset(&ireg.PC), target);
+    EmitSetBranch();
+    EmitExit(count);
+}
+
+void GekkoCPURecompilerX64::EmitBranchConditional(u32 pc, u32 op, u32 count) {
+    u32 bo = BO;
+    u32 bi = BI;
+    u32 target = EXTS16(op & 0xFFFC);
+    if (!(op & 2)) {
+        target += pc;
+    }
+    std::vector<u8*> not_taken;
+
+    if (!(bo & 0x04)) {
+        emit_.ALU_MI32(X64Emitter::ALU_SUB, EBX, RegOffset(&CTR), 1);
+        not_taken.push_back(emit_.Jcc_Rel32((bo & 0x02) ? X64Emitter::CC_NE : X64Emitter::CC_E));
+    }
+    if (!(bo & 0x10)) {
+        emit_.TEST_MI32(EBX, RegOffset(&ireg.CR), BIT_0 >> bi);
+        not_taken.push_back(emit_.Jcc_Rel32((bo & 0x08) ? X64Emitter::CC_E : X64Emitter::CC_NE));
+    }
+    if (op & 1) {
+        emit_.MOV_MI32(EBX, RegOffset(&LR), pc + 4);
+    }
+    emit_.MOV_MI32(EBX, RegOffset(&ireg.PC), target);
+
+    if (!not_taken.empty()) {
+        u8* done = emit_.JMP_Rel32();
+        for (size_t i = 0; i < not_taken.size(); i++) {
+            emit_.SetJumpTarget(not_taken[i]);
+        }
+        emit_.MOV_MI32(EBX, RegOffset(&ireg.PC), pc + 4);
+        emit_.SetJumpTarget(done);
+    }
+    EmitSetBranch();
+    EmitExit(count);
+}
+
+/// Builds the LT/GT/EQ/SO nibble for crf from the flags left by the preceding cmp/test
+void GekkoCPURecompilerX64::EmitCompare(u32 crf, bool is_signed) {
+    u32 shift = 28 - (4 * crf);
+
+    emit_.SETcc_R8(is_signed ? X64Emitter::CC_L : X64Emitter::CC_B, EAX);
+    emit_.SETcc_R8(is_signed ? X64Emitter::CC_G : X64Emitter::CC_A, ECX);
+    emit_.SETcc_R8(X64Emitter::CC_E, EDX);
+    emit_.MOVZX_R32R8(EAX, EAX);
+    emit_.MOVZX_R32R8(ECX, ECX);
+    emit_.MOVZX_R32R8(EDX, EDX);
+    emit_.SHIFT_RI32(X64Emitter::SHIFT_SHL, EAX, 3);
+    emit_.SHIFT_RI32(X64Emitter::SHIFT_SHL, ECX, 2);
+    emit_.SHIFT_RI32(X64Emitter::SHIFT_SHL, EDX, 1);
+    emit_.ALU_RR32(X64Emitter::ALU_OR, EAX, ECX);
+    emit_.ALU_RR32(X64Emitter::ALU_OR, EAX, EDX);
+
+    // SO is copied from XER
+    emit_.MOV_RM32(ECX, EBX, RegOffset(&XER));
+    emit_.SHIFT_RI32(X64Emitter::SHIFT_SHR, ECX, 31);
+    emit_.ALU_RR32(X64Emitter::ALU_OR, EAX, ECX);
+    if (shift) {
+        emit_.SHIFT_RI32(X64Emitter::SHIFT_SHL, EAX, shift);
+    }
+    emit_.MOV_RM32(ECX, EBX, RegOffset(&ireg.CR));
+    emit_.ALU_RI32(X64Emitter::ALU_AND, ECX, ~(0xF0000000 >> (4 * crf)));
+    emit_.ALU_RR32(X64Emitter::ALU_OR, ECX, EAX);
+    emit_.MOV_MR32(EBX, RegOffset(&ireg.CR), ECX);
+}
+
+void GekkoCPURecompilerX64::EmitAddressImm(u32 op) {
+    opcode = op;
+    if (rA) {
+        LoadGPR(ECX, rA);
+        if (SIMM) {
+            emit_.ALU_RI32(X64Emitter::ALU_ADD, ECX, (s32)SIMM);
+        }
+    } else {
+        emit_.MOV_RI32(ECX, (s32)SIMM);
+    }
+}
+
+void GekkoCPURecompilerX64::EmitAddressReg(u32 op) {
+    opcode = op;
+    LoadGPR(ECX, rB);
+    if (rA) {
+        emit_.ALU_RM32(X64Emitter::ALU_ADD, ECX, EBX, RegOffset(&ireg.gpr[rA]));
+    }
+}
+
+void GekkoCPURecompilerX64::EmitLoad(u32 op, int size, bool sign_extend, bool update) {
+    opcode = op;
+    if (update) {
+        emit_.MOV_RR32(R12, ECX);
+    }
+    emit_.MOV_RR32(EDI, ECX);
+
+    u8* slow = NULL;
+    u8* done = NULL;
+#ifdef EMU_FASTMEM
+    // Direct load from the guest address space, hardware registers fault into the fastmem handler
+    if (fastmem::g_base) {
+        if (size != 8) {
+            emit_.TEST_RI32(ECX, (size >> 3) - 1);
+            slow = emit_.Jcc_Rel32(X64Emitter::CC_NE);
+        }
+        emit_.MOV_RI64(EDX, (u64)fastmem::g_base);
+        switch (size) {
+        case 8:
+            emit_.ALU_RI32(X64Emitter::ALU_XOR, ECX, 3);
+            emit_.MOVZX_RMX8(EAX, EDX, ECX);
+            break;
+        case 16:
+            emit_.ALU_RI32(X64Emitter::ALU_XOR, ECX, 2);
+            emit_.MOVZX_RMX16(EAX, EDX, ECX);
+            break;
+        default:
+            emit_.MOV_RMX32(EAX, EDX, ECX);
+            break;
+        }
+        done = emit_.JMP_Rel32();
+        if (slow) {
+            emit_.SetJumpTarget(slow);
+        }
+    }
+#endif
+    switch (size) {
+    case 8:
+        emit_.CALL_ABS((const void*)&Memory_Read8);
+        break;
+    case 16:
+        emit_.CALL_ABS((const void*)&Memory_Read16);
+        break;
+    default:
+        emit_.CALL_ABS((const void*)&Memory_Read32);
+        break;
+    }
+    if (done) {
+        emit_.SetJumpTarget(done);
+    }
+
+    // Narrow return values leave the upper bits of EAX undefined
+    if (size == 8) {
+        emit_.MOVZX_R32R8(EAX, EAX);
+    } else if (size == 16) {
+        if (sign_extend) {
+            emit_.MOVSX_R32R16(EAX, EAX);
+        } else {
+            emit_.MOVZX_R32R16(EAX, EAX);
+        }
+    }
+    StoreGPR(rD, EAX);
+
+    if (update) {
+        StoreGPR(rA, R12);
+    }
+}
+
+void GekkoCPURecompilerX64::EmitStore(u32 op, int size, bool update) {
+    opcode = op;
+    if (update) {
+        emit_.MOV_RR32(R12, ECX);
+    }
+    emit_.MOV_RR32(EDI, ECX);
+    LoadGPR(ESI, rS);
+
+    u8* slow = NULL;
+    u8* code_page = NULL;
+    u8* done = NULL;
+#ifdef EMU_FASTMEM
+    // Direct store to the guest address space, hardware registers fault into the fastmem handler
+    if (fastmem::g_base) {
+        if (size != 8) {
+            emit_.TEST_RI32(ECX, (size >> 3) - 1);
+            slow = emit_.Jcc_Rel32(X64Emitter::CC_NE);
+        }
+        // Writes to pages holding compiled code have to invalidate, leave those to Memory_Write*
+        emit_.MOV_RR32(EDX, ECX);
+        emit_.ALU_RI32(X64Emitter::ALU_AND, EDX, RAM_MASK);
+        emit_.SHIFT_RI32(X64Emitter::SHIFT_SHR, EDX, MEM_PAGE_SHIFT);
+        emit_.MOV_RI64(EAX, (u64)Mem_CodePage);
+        emit_.MOVZX_RMX8(EAX, EAX, EDX);
+        emit_.TEST_RR32(EAX, EAX);
+        code_page = emit_.Jcc_Rel32(X64Emitter::CC_NE);
+
+        emit_.MOV_RI64(EDX, (u64)fastmem::g_base);
+        switch (size) {
+        case 8:
+            emit_.ALU_RI32(X64Emitter::ALU_XOR, ECX, 3);
+            emit_.MOV_MXR8(EDX, ECX, ESI);
+            break;
+        case 16:
+            emit_.ALU_RI32(X64Emitter::ALU_XOR, ECX, 2);
+            emit_.MOV_MXR16(EDX, ECX, ESI);
+            break;
+        default:
+            emit_.MOV_MXR32(EDX, ECX, ESI);
+            break;
+        }
+        done = emit_.JMP_Rel32();
+        if (slow) {
+            emit_.SetJumpTarget(slow);
+        }
+        emit_.SetJumpTarget(code_page);
+    }
+#endif
+    switch (size) {
+    case 8:
+        emit_.CALL_ABS((const void*)&Memory_Write8);
+        break;
+    case 16:
+        emit_.CALL_ABS((const void*)&Memory_Write16);
+        break;
+    default:
+        emit_.CALL_ABS((const void*)&Memory_Write32);
+        break;
+    }
+    if (done) {
+        emit_.SetJumpTarget(done);
+    }
+
+    if (update) {
+        StoreGPR(rA, R12);
+    }
+}
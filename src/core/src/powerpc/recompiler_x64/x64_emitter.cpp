@@ -0,0 +1,387 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    x64_emitter.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-02
+ * @brief   Minimal x86-64 machine code emitter used by the dynamic recompiler
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include "x64_emitter.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Encoding helpers
+
+void X64Emitter::Rex(bool w, int reg, int index, int base, bool byte_regs) {
+    u8 rex = 0x40;
+    if (w)          rex |= 0x08;
+    if (reg & 8)    rex |= 0x04;
+    if (index & 8)  rex |= 0x02;
+    if (base & 8)   rex |= 0x01;
+    // SPL/BPL/SIL/DIL are only addressable with a REX prefix present
+    if (rex != 0x40 || (byte_regs && ((reg >= RSP && reg <= RDI) || (base >= RSP && base <= RDI)))) {
+        Write8(rex);
+    }
+}
+
+void X64Emitter::ModRM_RR(int reg, int rm) {
+    Write8(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void X64Emitter::ModRM_Mem(int reg, Reg base, s32 disp) {
+    bool short_disp = (disp >= -128 && disp <= 127);
+    u8 mod = short_disp ? 0x40 : 0x80;
+
+    Write8(mod | ((reg & 7) << 3) | (base & 7));
+    // RSP/R12 as a base always needs a SIB byte
+    if ((base & 7) == RSP) {
+        Write8(0x24);
+    }
+    if (short_disp) {
+        Write8((u8)(s8)disp);
+    } else {
+        Write32((u32)disp);
+    }
+}
+
+void X64Emitter::ModRM_MemIndex(int reg, Reg base, Reg index) {
+    // RBP/R13 as a base can only be encoded with a displacement
+    if ((base & 7) == RBP) {
+        Write8(0x44 | ((reg & 7) << 3));
+        Write8(((index & 7) << 3) | (base & 7));
+        Write8(0);
+    } else {
+        Write8(0x04 | ((reg & 7) << 3));
+        Write8(((index & 7) << 3) | (base & 7));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Moves
+
+void X64Emitter::MOV_RR32(Reg dst, Reg src) {
+    Rex(false, src, 0, dst);
+    Write8(0x89);
+    ModRM_RR(src, dst);
+}
+
+void X64Emitter::MOV_RR64(Reg dst, Reg src) {
+    Rex(true, src, 0, dst);
+    Write8(0x89);
+    ModRM_RR(src, dst);
+}
+
+void X64Emitter::MOV_RI32(Reg dst, u32 imm) {
+    Rex(false, 0, 0, dst);
+    Write8(0xB8 + (dst & 7));
+    Write32(imm);
+}
+
+void X64Emitter::MOV_RI64(Reg dst, u64 imm) {
+    if (imm <= 0xFFFFFFFF) {
+        MOV_RI32(dst, (u32)imm); // Implicitly zero extended
+        return;
+    }
+    Rex(true, 0, 0, dst);
+    Write8(0xB8 + (dst & 7));
+    Write64(imm);
+}
+
+void X64Emitter::MOV_RM32(Reg dst, Reg base, s32 disp) {
+    Rex(false, dst, 0, base);
+    Write8(0x8B);
+    ModRM_Mem(dst, base, disp);
+}
+
+void X64Emitter::MOV_MR32(Reg base, s32 disp, Reg src) {
+    Rex(false, src, 0, base);
+    Write8(0x89);
+    ModRM_Mem(src, base, disp);
+}
+
+void X64Emitter::MOV_MI32(Reg base, s32 disp, u32 imm) {
+    Rex(false, 0, 0, base);
+    Write8(0xC7);
+    ModRM_Mem(0, base, disp);
+    Write32(imm);
+}
+
+void X64Emitter::MOV_RMX32(Reg dst, Reg base, Reg index) {
+    Rex(false, dst, index, base);
+    Write8(0x8B);
+    ModRM_MemIndex(dst, base, index);
+}
+
+void X64Emitter::MOV_MXR32(Reg base, Reg index, Reg src) {
+    Rex(false, src, index, base);
+    Write8(0x89);
+    ModRM_MemIndex(src, base, index);
+}
+
+void X64Emitter::MOV_MXR16(Reg base, Reg index, Reg src) {
+    Write8(0x66);
+    Rex(false, src, index, base);
+    Write8(0x89);
+    ModRM_MemIndex(src, base, index);
+}
+
+void X64Emitter::MOV_MXR8(Reg base, Reg index, Reg src) {
+    Rex(false, src, index, base, true);
+    Write8(0x88);
+    ModRM_MemIndex(src, base, index);
+}
+
+void X64Emitter::MOVZX_R32R8(Reg dst, Reg src) {
+    Rex(false, dst, 0, src, true);
+    Write8(0x0F);
+    Write8(0xB6);
+    ModRM_RR(dst, src);
+}
+
+void X64Emitter::MOVZX_R32R16(Reg dst, Reg src) {
+    Rex(false, dst, 0, src);
+    Write8(0x0F);
+    Write8(0xB7);
+    ModRM_RR(dst, src);
+}
+
+void X64Emitter::MOVSX_R32R8(Reg dst, Reg src) {
+    Rex(false, dst, 0, src, true);
+    Write8(0x0F);
+    Write8(0xBE);
+    ModRM_RR(dst, src);
+}
+
+void X64Emitter::MOVSX_R32R16(Reg dst, Reg src) {
+    Rex(false, dst, 0, src);
+    Write8(0x0F);
+    Write8(0xBF);
+    ModRM_RR(dst, src);
+}
+
+void X64Emitter::MOVZX_RMX8(Reg dst, Reg base, Reg index) {
+    Rex(false, dst, index, base);
+    Write8(0x0F);
+    Write8(0xB6);
+    ModRM_MemIndex(dst, base, index);
+}
+
+void X64Emitter::MOVZX_RMX16(Reg dst, Reg base, Reg index) {
+    Rex(false, dst, index, base);
+    Write8(0x0F);
+    Write8(0xB7);
+    ModRM_MemIndex(dst, base, index);
+}
+
+void X64Emitter::MOVZX_RM8(Reg dst, Reg base, s32 disp) {
+    Rex(false, dst, 0, base);
+    Write8(0x0F);
+    Write8(0xB6);
+    ModRM_Mem(dst, base, disp);
+}
+
+void X64Emitter::MOVZX_RM16(Reg dst, Reg base, s32 disp) {
+    Rex(false, dst, 0, base);
+    Write8(0x0F);
+    Write8(0xB7);
+    ModRM_Mem(dst, base, disp);
+}
+
+void X64Emitter::MOV_MR16(Reg base, s32 disp, Reg src) {
+    Write8(0x66);
+    Rex(false, src, 0, base);
+    Write8(0x89);
+    ModRM_Mem(src, base, disp);
+}
+
+void X64Emitter::MOV_MR8(Reg base, s32 disp, Reg src) {
+    Rex(false, src, 0, base, true);
+    Write8(0x88);
+    ModRM_Mem(src, base, disp);
+}
+
+void X64Emitter::LEA_RM64(Reg dst, Reg base, s32 disp) {
+    Rex(true, dst, 0, base);
+    Write8(0x8D);
+    ModRM_Mem(dst, base, disp);
+}
+
+void X64Emitter::BSWAP_R32(Reg reg) {
+    Rex(false, 0, 0, reg);
+    Write8(0x0F);
+    Write8(0xC8 + (reg & 7));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arithmetic
+
+void X64Emitter::ALU_RR32(AluOp op, Reg dst, Reg src) {
+    Rex(false, src, 0, dst);
+    Write8((op << 3) | 0x01);   // op r/m32, r32
+    ModRM_RR(src, dst);
+}
+
+void X64Emitter::ALU_RI32(AluOp op, Reg dst, u32 imm) {
+    Rex(false, 0, 0, dst);
+    if ((s32)imm >= -128 && (s32)imm <= 127) {
+        Write8(0x83);
+        ModRM_RR(op, dst);
+        Write8((u8)imm);
+    } else {
+        Write8(0x81);
+        ModRM_RR(op, dst);
+        Write32(imm);
+    }
+}
+
+void X64Emitter::ALU_RM32(AluOp op, Reg dst, Reg base, s32 disp) {
+    Rex(false, dst, 0, base);
+    Write8((op << 3) | 0x03);   // op r32, r/m32
+    ModRM_Mem(dst, base, disp);
+}
+
+void X64Emitter::ALU_MI32(AluOp op, Reg base, s32 disp, u32 imm) {
+    Rex(false, 0, 0, base);
+    if ((s32)imm >= -128 && (s32)imm <= 127) {
+        Write8(0x83);
+        ModRM_Mem(op, base, disp);
+        Write8((u8)imm);
+    } else {
+        Write8(0x81);
+        ModRM_Mem(op, base, disp);
+        Write32(imm);
+    }
+}
+
+void X64Emitter::TEST_RR32(Reg a, Reg b) {
+    Rex(false, b, 0, a);
+    Write8(0x85);
+    ModRM_RR(b, a);
+}
+
+void X64Emitter::TEST_RI32(Reg reg, u32 imm) {
+    Rex(false, 0, 0, reg);
+    Write8(0xF7);
+    ModRM_RR(0, reg);
+    Write32(imm);
+}
+
+void X64Emitter::TEST_MI32(Reg base, s32 disp, u32 imm) {
+    Rex(false, 0, 0, base);
+    Write8(0xF7);
+    ModRM_Mem(0, base, disp);
+    Write32(imm);
+}
+
+void X64Emitter::IMUL_RR32(Reg dst, Reg src) {
+    Rex(false, dst, 0, src);
+    Write8(0x0F);
+    Write8(0xAF);
+    ModRM_RR(dst, src);
+}
+
+void X64Emitter::IMUL_RRI32(Reg dst, Reg src, s32 imm) {
+    Rex(false, dst, 0, src);
+    if (imm >= -128 && imm <= 127) {
+        Write8(0x6B);
+        ModRM_RR(dst, src);
+        Write8((u8)imm);
+    } else {
+        Write8(0x69);
+        ModRM_RR(dst, src);
+        Write32((u32)imm);
+    }
+}
+
+void X64Emitter::NOT_R32(Reg reg) {
+    Rex(false, 0, 0, reg);
+    Write8(0xF7);
+    ModRM_RR(2, reg);
+}
+
+void X64Emitter::NEG_R32(Reg reg) {
+    Rex(false, 0, 0, reg);
+    Write8(0xF7);
+    ModRM_RR(3, reg);
+}
+
+void X64Emitter::SHIFT_RI32(ShiftOp op, Reg reg, u8 count) {
+    Rex(false, 0, 0, reg);
+    if (count == 1) {
+        Write8(0xD1);
+        ModRM_RR(op, reg);
+    } else {
+        Write8(0xC1);
+        ModRM_RR(op, reg);
+        Write8(count);
+    }
+}
+
+void X64Emitter::SETcc_R8(Cond cond, Reg dst) {
+    Rex(false, 0, 0, dst, true);
+    Write8(0x0F);
+    Write8(0x90 + cond);
+    ModRM_RR(0, dst);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Control flow
+
+void X64Emitter::PUSH_R64(Reg reg) {
+    Rex(false, 0, 0, reg);
+    Write8(0x50 + (reg & 7));
+}
+
+void X64Emitter::POP_R64(Reg reg) {
+    Rex(false, 0, 0, reg);
+    Write8(0x58 + (reg & 7));
+}
+
+void X64Emitter::CALL_R64(Reg reg) {
+    Rex(false, 0, 0, reg);
+    Write8(0xFF);
+    ModRM_RR(2, reg);
+}
+
+void X64Emitter::CALL_ABS(const void* func) {
+    MOV_RI64(RAX, (u64)(uintptr_t)func);
+    CALL_R64(RAX);
+}
+
+void X64Emitter::RET() {
+    Write8(0xC3);
+}
+
+u8* X64Emitter::Jcc_Rel32(Cond cond) {
+    Write8(0x0F);
+    Write8(0x80 + cond);
+    u8* patch = code_;
+    Write32(0);
+    return patch;
+}
+
+u8* X64Emitter::JMP_Rel32() {
+    Write8(0xE9);
+    u8* patch = code_;
+    Write32(0);
+    return patch;
+}
+
+void X64Emitter::SetJumpTarget(u8* patch) {
+    *(s32*)patch = (s32)(code_ - (patch + 4));
+}
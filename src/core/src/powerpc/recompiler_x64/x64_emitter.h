@@ -0,0 +1,171 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    x64_emitter.h
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-02
+ * @brief   Minimal x86-64 machine code emitter used by the dynamic recompiler
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef CORE_POWERPC_RECOMPILER_X64_EMITTER_H_
+#define CORE_POWERPC_RECOMPILER_X64_EMITTER_H_
+
+#include "common.h"
+
+/// Emits x86-64 instructions into a caller supplied code buffer
+class X64Emitter {
+public:
+    /// x86-64 general purpose registers (encoding order)
+    enum Reg {
+        RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+        R8, R9, R10, R11, R12, R13, R14, R15
+    };
+
+    /// x86 condition codes, as used by Jcc/SETcc
+    enum Cond {
+        CC_O = 0, CC_NO, CC_B, CC_AE, CC_E, CC_NE, CC_BE, CC_A,
+        CC_S, CC_NS, CC_P, CC_NP, CC_L, CC_GE, CC_LE, CC_G
+    };
+
+    /// Group 1 arithmetic operations (value is the /digit of the imm form)
+    enum AluOp {
+        ALU_ADD = 0, ALU_OR = 1, ALU_AND = 4, ALU_SUB = 5, ALU_XOR = 6, ALU_CMP = 7
+    };
+
+    /// Group 2 shift operations (value is the /digit)
+    enum ShiftOp {
+        SHIFT_ROL = 0, SHIFT_ROR = 1, SHIFT_SHL = 4, SHIFT_SHR = 5, SHIFT_SAR = 7
+    };
+
+    X64Emitter() : code_(NULL) {}
+    ~X64Emitter() {}
+
+    void set_code_ptr(u8* code) { code_ = code; }
+    u8* code_ptr() const { return code_; }
+
+    // Raw data
+
+    void Write8(u8 value) { *code_++ = value; }
+    void Write16(u16 value) { *(u16*)code_ = value; code_ += 2; }
+    void Write32(u32 value) { *(u32*)code_ = value; code_ += 4; }
+    void Write64(u64 value) { *(u64*)code_ = value; code_ += 8; }
+
+    // Moves
+
+    void MOV_RR32(Reg dst, Reg src);
+    void MOV_RR64(Reg dst, Reg src);
+    void MOV_RI32(Reg dst, u32 imm);
+    void MOV_RI64(Reg dst, u64 imm);
+    /// mov dst, dword [base + disp]
+    void MOV_RM32(Reg dst, Reg base, s32 disp);
+    /// mov dword [base + disp], src
+    void MOV_MR32(Reg base, s32 disp, Reg src);
+    /// mov dword [base + disp], imm
+    void MOV_MI32(Reg base, s32 disp, u32 imm);
+    /// mov dst, dword [base + index]
+    void MOV_RMX32(Reg dst, Reg base, Reg index);
+    /// mov dword [base + index], src
+    void MOV_MXR32(Reg base, Reg index, Reg src);
+    /// mov word [base + index], src
+    void MOV_MXR16(Reg base, Reg index, Reg src);
+    /// mov byte [base + index], src
+    void MOV_MXR8(Reg base, Reg index, Reg src);
+
+    void MOVZX_R32R8(Reg dst, Reg src);
+    void MOVZX_R32R16(Reg dst, Reg src);
+    void MOVSX_R32R8(Reg dst, Reg src);
+    void MOVSX_R32R16(Reg dst, Reg src);
+    /// movzx dst, byte [base + index]
+    void MOVZX_RMX8(Reg dst, Reg base, Reg index);
+    /// movzx dst, word [base + index]
+    void MOVZX_RMX16(Reg dst, Reg base, Reg index);
+    /// movzx dst, byte [base + disp]
+    void MOVZX_RM8(Reg dst, Reg base, s32 disp);
+    /// movzx dst, word [base + disp]
+    void MOVZX_RM16(Reg dst, Reg base, s32 disp);
+    /// mov word [base + disp], src
+    void MOV_MR16(Reg base, s32 disp, Reg src);
+    /// mov byte [base + disp], src
+    void MOV_MR8(Reg base, s32 disp, Reg src);
+    /// lea dst, [base + disp]
+    void LEA_RM64(Reg dst, Reg base, s32 disp);
+    void BSWAP_R32(Reg reg);
+
+    // Arithmetic
+
+    void ALU_RR32(AluOp op, Reg dst, Reg src);
+    void ALU_RI32(AluOp op, Reg dst, u32 imm);
+    /// op dst, dword [base + disp]
+    void ALU_RM32(AluOp op, Reg dst, Reg base, s32 disp);
+    /// op dword [base + disp], imm
+    void ALU_MI32(AluOp op, Reg base, s32 disp, u32 imm);
+    void TEST_RR32(Reg a, Reg b);
+    void TEST_RI32(Reg reg, u32 imm);
+    /// test dword [base + disp], imm
+    void TEST_MI32(Reg base, s32 disp, u32 imm);
+    void IMUL_RR32(Reg dst, Reg src);
+    void IMUL_RRI32(Reg dst, Reg src, s32 imm);
+    void NOT_R32(Reg reg);
+    void NEG_R32(Reg reg);
+    void SHIFT_RI32(ShiftOp op, Reg reg, u8 count);
+    void SETcc_R8(Cond cond, Reg dst);
+
+    // Control flow
+
+    void PUSH_R64(Reg reg);
+    void POP_R64(Reg reg);
+    void CALL_R64(Reg reg);
+    /// Load a 64-bit absolute function address into RAX and call it
+    void CALL_ABS(const void* func);
+    void RET();
+
+    /**
+     * Emit a conditional forward jump with an unresolved 32-bit displacement
+     * @param cond Condition to jump on
+     * @return Pointer to the displacement, to be handed to SetJumpTarget
+     */
+    u8* Jcc_Rel32(Cond cond);
+
+    /**
+     * Emit an unconditional forward jump with an unresolved 32-bit displacement
+     * @return Pointer to the displacement, to be handed to SetJumpTarget
+     */
+    u8* JMP_Rel32();
+
+    /// Resolve a pending jump so that it lands on the current code pointer
+    void SetJumpTarget(u8* patch);
+
+private:
+    /// Emit a REX prefix if any of the fields require one
+    void Rex(bool w, int reg, int index, int base, bool byte_regs = false);
+
+    /// Emit a register-direct ModRM byte
+    void ModRM_RR(int reg, int rm);
+
+    /// Emit a ModRM/SIB/disp32 sequence addressing [base + disp]
+    void ModRM_Mem(int reg, Reg base, s32 disp);
+
+    /// Emit a ModRM/SIB sequence addressing [base + index], index must not be RSP
+    void ModRM_MemIndex(int reg, Reg base, Reg index);
+
+    u8* code_;  ///< Current emission point
+
+    DISALLOW_COPY_AND_ASSIGN(X64Emitter);
+};
+
+#endif // CORE_POWERPC_RECOMPILER_X64_EMITTER_H_
@@ -0,0 +1,431 @@
+/*!
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * \file    state.cpp
+ * \author  ShizZy <shizzy247@gmail.com>
+ * \date    2013-02-09
+ * \brief   Save states and in-memory snapshots of the emulated system
+ *
+ * \section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include <stdio.h>
+
+#include "common.h"
+#include "log.h"
+
+#include "memory.h"
+#include "core_timing.h"
+#include "hw/hw.h"
+#include "hw/hw_dsp.h"
+#include "hle/hle.h"
+#include "powerpc/cpu_core.h"
+#include "powerpc/cpu_core_regs.h"
+#include "powerpc/mmu.h"
+#include "powerpc/interpreter/cpu_int_quantize.h"
+#include "video_core.h"
+#include "state.h"
+
+namespace state {
+
+/// "GKST"
+static const u32 kFileMagic = 0x54534B47;
+
+/// State file header, followed by the serialized state, RAM and ARAM
+struct FileHeader {
+    u32 magic;
+    u32 version;
+    u32 state_size;     ///< Bytes of serialized state
+    u32 reserved;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Serializer
+
+Serializer::Serializer(Mode mode, std::vector<u8>* buffer, u32 version) :
+    mode_(mode),
+    buffer_(buffer),
+    offset_(0),
+    version_(version),
+    ok_(true) {
+}
+
+void Serializer::DoBytes(void* data, size_t size) {
+    if (mode_ == kModeWrite) {
+        const u8* bytes = (const u8*)data;
+        buffer_->insert(buffer_->end(), bytes, bytes + size);
+        return;
+    }
+    if (!ok_ || size > buffer_->size() - offset_) {
+        ok_ = false;
+        return;
+    }
+    memcpy(data, &(*buffer_)[offset_], size);
+    offset_ += size;
+}
+
+void Serializer::DoString(std::string& value) {
+    u32 size = (u32)value.size();
+    Do(size);
+
+    if (mode_ == kModeWrite) {
+        DoBytes(&value[0], size);
+    } else if (ok_ && size <= buffer_->size() - offset_) {
+        value.assign((const char*)&(*buffer_)[offset_], size);
+        offset_ += size;
+    } else {
+        ok_ = false;
+    }
+}
+
+void Serializer::DoMarker(const char* name) {
+    std::string marker(name);
+    std::string saved(marker);
+
+    DoString(saved);
+    if (ok_ && saved != marker) {
+        LOG_ERROR(TCORE, "state section %s found where %s was expected", saved.c_str(), name);
+        ok_ = false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// System state
+
+/// Save/load the CPU registers, state derived from them is rebuilt on load
+static void DoCPUState(Serializer& s) {
+    s.Do(ireg);
+    s.Do(GekkoCPU::is_dec);
+    s.Do(GekkoCPU::is_sc);
+    s.Do(GekkoCPU::is_reserved);
+    s.Do(GekkoCPU::reserved_addr);
+
+    if (s.is_reading()) {
+        mmu::UpdateTranslation();
+        psq::Init();
+    }
+}
+
+/// Keeps the GP thread parked while the system state is copied, it reads and writes guest RAM too
+class ScopedVideoPause {
+public:
+    ScopedVideoPause() { video_core::Pause(); }
+    ~ScopedVideoPause() { video_core::Resume(); }
+};
+
+void DoState(Serializer& s) {
+    // The timing state refers to the time base, so the CPU has to be loaded first
+    s.DoMarker("CPU");
+    DoCPUState(s);
+    s.DoMarker("L2");
+    s.DoArray(Mem_L2, L2_SIZE);
+    s.DoMarker("Timing");
+    core_timing::DoState(s);
+    s.DoMarker("Flipper");
+    Flipper_DoState(s);
+    s.DoMarker("HLE");
+    HLE_DoState(s);
+    s.DoMarker("Video");
+    video_core::DoState(s);
+    s.DoMarker("End");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Paged guest memory
+
+/// Reference counted copy of a RAM/ARAM page
+struct Page {
+    int refs;
+    u8  data[MEM_PAGE_SIZE];
+};
+
+static const u32 kNumPages = MEM_NUM_PAGES + ARAM_NUM_PAGES;
+
+/// Returns the host memory of a page, RAM pages come first
+static inline u8* PageMemory(u32 index) {
+    if (index < MEM_NUM_PAGES) {
+        return &Mem_RAM[index << MEM_PAGE_SHIFT];
+    }
+    return &ARAM[(index - MEM_NUM_PAGES) << MEM_PAGE_SHIFT];
+}
+
+/// Returns true if a page has been written since write tracking was last armed
+static inline bool IsPageDirty(u32 index) {
+    if (index < MEM_NUM_PAGES) {
+        return Mem_DirtyPage[index] != 0;
+    }
+    return ARAM_DirtyPage[index - MEM_NUM_PAGES] != 0;
+}
+
+/// Start recording the pages written from now on
+static void TrackWrites() {
+    Memory_TrackWrites();
+    memset(ARAM_DirtyPage, 0, sizeof(ARAM_DirtyPage));
+}
+
+/// All pages have been replaced behind the snapshots' back (state file loaded)
+static void MarkAllDirty() {
+    Memory_MarkDirty(0, RAM_SIZE);
+    memset(Mem_DirtyPage, 1, sizeof(Mem_DirtyPage));
+    memset(ARAM_DirtyPage, 1, sizeof(ARAM_DirtyPage));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// State files
+
+bool SaveToFile(const char* filename) {
+    std::vector<u8> buffer;
+    std::vector<u8> memory(RAM_SIZE + ARAM_SIZE);
+    {
+        ScopedVideoPause pause;
+        Serializer s(Serializer::kModeWrite, &buffer);
+        DoState(s);
+        memcpy(&memory[0], Mem_RAM, RAM_SIZE);
+        memcpy(&memory[RAM_SIZE], ARAM, ARAM_SIZE);
+    }
+
+    FileHeader header;
+    header.magic = kFileMagic;
+    header.version = kVersion;
+    header.state_size = (u32)buffer.size();
+    header.reserved = 0;
+
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) {
+        LOG_ERROR(TCORE, "failed to create state file %s", filename);
+        return false;
+    }
+    bool ok = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+        (fwrite(&buffer[0], buffer.size(), 1, file) == 1) &&
+        (fwrite(&memory[0], memory.size(), 1, file) == 1);
+    fclose(file);
+
+    if (!ok) {
+        LOG_ERROR(TCORE, "failed to write state file %s", filename);
+        return false;
+    }
+    LOG_NOTICE(TCORE, "saved state to %s", filename);
+    return true;
+}
+
+bool LoadFromFile(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        LOG_ERROR(TCORE, "failed to open state file %s", filename);
+        return false;
+    }
+    FileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != kFileMagic) {
+        LOG_ERROR(TCORE, "%s is not a state file", filename);
+        fclose(file);
+        return false;
+    }
+    if (header.version < kMinVersion || header.version > kVersion) {
+        LOG_ERROR(TCORE, "state file %s has unsupported version %d", filename, header.version);
+        fclose(file);
+        return false;
+    }
+    // Read everything before touching the running system
+    std::vector<u8> buffer(header.state_size);
+    std::vector<u8> memory(RAM_SIZE + ARAM_SIZE);
+    bool ok = (fread(&buffer[0], buffer.size(), 1, file) == 1) &&
+        (fread(&memory[0], memory.size(), 1, file) == 1);
+    fclose(file);
+
+    if (!ok) {
+        LOG_ERROR(TCORE, "state file %s is truncated", filename);
+        return false;
+    }
+    ScopedVideoPause pause;
+    MarkAllDirty();
+    memcpy(Mem_RAM, &memory[0], RAM_SIZE);
+    memcpy(ARAM, &memory[RAM_SIZE], ARAM_SIZE);
+
+    Serializer s(Serializer::kModeRead, &buffer, header.version);
+    DoState(s);
+
+    if (!s.ok()) {
+        LOG_ERROR(TCORE, "state file %s is corrupt", filename);
+        return false;
+    }
+    LOG_NOTICE(TCORE, "loaded state from %s", filename);
+    return true;
+}
+
+bool CheckRoundTrip() {
+    ScopedVideoPause pause;
+    std::vector<u8> saved;
+    std::vector<u8> resaved;
+
+    Serializer save(Serializer::kModeWrite, &saved);
+    DoState(save);
+    Serializer load(Serializer::kModeRead, &saved);
+    DoState(load);
+    if (!load.ok()) {
+        LOG_ERROR(TCORE, "state round trip failed to load the saved state");
+        return false;
+    }
+    Serializer resave(Serializer::kModeWrite, &resaved);
+    DoState(resave);
+
+    size_t offset = 0;
+    while (offset < saved.size() && offset < resaved.size() && saved[offset] == resaved[offset]) {
+        offset++;
+    }
+    if (offset != saved.size() || offset != resaved.size()) {
+        LOG_ERROR(TCORE, "state round trip differs at byte %d of %d (%d after reloading)",
+                  (int)offset, (int)saved.size(), (int)resaved.size());
+        return false;
+    }
+    LOG_NOTICE(TCORE, "state round trip ok (%d bytes)", (int)saved.size());
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Snapshots
+
+static inline void ReleasePage(Page* page) {
+    if (page && --page->refs == 0) {
+        delete page;
+    }
+}
+
+Snapshot::Snapshot() {
+}
+
+Snapshot::~Snapshot() {
+    for (size_t i = 0; i < pages_.size(); i++) {
+        ReleasePage(pages_[i]);
+    }
+}
+
+void Snapshot::Capture(const Snapshot* previous) {
+    ScopedVideoPause pause;
+
+    state_.clear();
+    Serializer s(Serializer::kModeWrite, &state_);
+    DoState(s);
+
+    std::vector<Page*> pages(kNumPages);
+
+    for (u32 i = 0; i < kNumPages; i++) {
+        if (previous && !IsPageDirty(i)) {
+            pages[i] = previous->pages_[i];
+            pages[i]->refs++;
+        } else {
+            pages[i] = new Page;
+            pages[i]->refs = 1;
+            memcpy(pages[i]->data, PageMemory(i), MEM_PAGE_SIZE);
+        }
+    }
+    for (size_t i = 0; i < pages_.size(); i++) {
+        ReleasePage(pages_[i]);
+    }
+    pages_.swap(pages);
+
+    TrackWrites();
+}
+
+bool Snapshot::Restore(const Snapshot* current) {
+    ScopedVideoPause pause;
+
+    // Pages shared with the current snapshot and not written since hold the same data
+    for (u32 i = 0; i < kNumPages; i++) {
+        if (current && current->pages_[i] == pages_[i] && !IsPageDirty(i)) {
+            continue;
+        }
+        if (i < MEM_NUM_PAGES) {
+            Memory_LoadPage(i, pages_[i]->data);
+        } else {
+            memcpy(PageMemory(i), pages_[i]->data, MEM_PAGE_SIZE);
+        }
+    }
+    TrackWrites();
+
+    Serializer s(Serializer::kModeRead, &state_);
+    DoState(s);
+    return s.ok();
+}
+
+size_t Snapshot::unique_size() const {
+    size_t size = state_.size();
+
+    for (size_t i = 0; i < pages_.size(); i++) {
+        if (pages_[i]->refs == 1) {
+            size += MEM_PAGE_SIZE;
+        }
+    }
+    return size;
+}
+
+SnapshotBuffer::SnapshotBuffer(size_t capacity) :
+    capacity_(capacity ? capacity : 1),
+    last_(NULL) {
+}
+
+SnapshotBuffer::~SnapshotBuffer() {
+    Clear();
+}
+
+/// Free the last restored snapshot once nothing refers to it anymore
+void SnapshotBuffer::ReleaseLast() {
+    if (last_ && (snapshots_.empty() || last_ != snapshots_.back())) {
+        delete last_;
+    }
+    last_ = NULL;
+}
+
+void SnapshotBuffer::Capture() {
+    Snapshot* snapshot = new Snapshot();
+    snapshot->Capture(last_);
+
+    ReleaseLast();
+    last_ = snapshot;
+    snapshots_.push_back(snapshot);
+
+    if (snapshots_.size() > capacity_) {
+        delete snapshots_.front();
+        snapshots_.erase(snapshots_.begin());
+    }
+}
+
+bool SnapshotBuffer::Rewind() {
+    if (snapshots_.empty()) {
+        return false;
+    }
+    Snapshot* snapshot = snapshots_.back();
+    bool ok = snapshot->Restore(last_);
+
+    // The restored snapshot leaves the ring, but the dirty pages are now relative to it
+    ReleaseLast();
+    snapshots_.pop_back();
+    last_ = snapshot;
+
+    if (!ok) {
+        LOG_ERROR(TCORE, "failed to restore snapshot");
+    }
+    return ok;
+}
+
+void SnapshotBuffer::Clear() {
+    ReleaseLast();
+    for (size_t i = 0; i < snapshots_.size(); i++) {
+        delete snapshots_[i];
+    }
+    snapshots_.clear();
+}
+
+} // namespace
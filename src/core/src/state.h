@@ -0,0 +1,202 @@
+/*!
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * \file    state.h
+ * \author  ShizZy <shizzy247@gmail.com>
+ * \date    2013-02-09
+ * \brief   Save states and in-memory snapshots of the emulated system
+ *
+ * \section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef CORE_STATE_H_
+#define CORE_STATE_H_
+
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+/*!
+ * Each emulated component owns a DoState(state::Serializer&) function that walks its state in a
+ * fixed order, state::DoState calls them all and handles the CPU registers itself. The same function saves and loads, the serializer decides which way the bytes go,
+ * so the two can't drift apart. Components that keep derived data (pointers, decode caches, host
+ * objects) rebuild it once s.is_reading() is done.
+ *
+ * The state version is bumped whenever a DoState function changes. Functions that add a field keep
+ * older states loadable with "if (s.version() >= N) s.Do(field);".
+ *
+ * Guest RAM and ARAM aren't part of the serialized state, they are saved page by page so snapshots
+ * can share the pages that didn't change (see Snapshot).
+ */
+namespace state {
+
+/// Version of the serialized state, bump when any DoState function changes
+static const u32 kVersion = 1;
+
+/// Oldest version that can still be loaded
+static const u32 kMinVersion = 1;
+
+/// Saves or loads state to/from a memory buffer
+class Serializer {
+public:
+    enum Mode {
+        kModeWrite,     ///< Append state to the buffer
+        kModeRead       ///< Consume state from the buffer
+    };
+
+    /*!
+     * \brief Create a serializer
+     * \param mode Whether to save or load
+     * \param buffer Buffer appended to (write) or read from (read)
+     * \param version Version of the state in the buffer, only differs from kVersion when reading
+     */
+    Serializer(Mode mode, std::vector<u8>* buffer, u32 version = kVersion);
+
+    bool is_reading() const { return mode_ == kModeRead; }
+    u32 version() const { return version_; }
+
+    /// False once a read ran past the end of the buffer or hit a mismatched marker
+    bool ok() const { return ok_; }
+
+    /// Flag a load as failed, for loaded values the state can't be restored from
+    void Fail() { ok_ = false; }
+
+    /// Save/load a block of raw bytes
+    void DoBytes(void* data, size_t size);
+
+    /// Save/load a plain value or POD struct
+    template <typename T> void Do(T& value) {
+        DoBytes(&value, sizeof(T));
+    }
+
+    /// Save/load an array of plain values
+    template <typename T> void DoArray(T* data, size_t count) {
+        DoBytes(data, sizeof(T) * count);
+    }
+
+    void DoString(std::string& value);
+
+    /*!
+     * \brief Save/check a section tag, a mismatch on load means a DoState function went out of
+     *      sync with the version and everything after it would be garbage
+     * \param name Section name
+     */
+    void DoMarker(const char* name);
+
+private:
+    Mode                mode_;
+    std::vector<u8>*    buffer_;
+    size_t              offset_;
+    u32                 version_;
+    bool                ok_;
+};
+
+/// Save/load everything except guest RAM and ARAM, the CPU must be stopped between blocks and the
+/// GP paused (see video_core::Pause)
+void DoState(Serializer& s);
+
+/*!
+ * \brief Save the emulated system to a file
+ * \param filename Path of the state file
+ * \return True on success
+ */
+bool SaveToFile(const char* filename);
+
+/*!
+ * \brief Load the emulated system from a file saved by SaveToFile
+ * \param filename Path of the state file
+ * \return True on success, on failure the system is left as it was unless the file was corrupt
+ */
+bool LoadFromFile(const char* filename);
+
+/*!
+ * \brief Save the state, load it back and save it again, the two saves must be identical. Checks
+ *      that every DoState function loads what it saves.
+ * \return True if the saves match
+ */
+bool CheckRoundTrip();
+
+struct Page;
+
+/*!
+ * In-memory state of the system. RAM/ARAM are kept as reference counted page copies: a snapshot
+ * only copies the pages written since the previous snapshot was captured and shares the others,
+ * so a rewind buffer of N snapshots costs N * (dirty pages + small state) rather than N * 48MB.
+ */
+class Snapshot {
+public:
+    Snapshot();
+    ~Snapshot();
+
+    /*!
+     * \brief Capture the current system state
+     * \param previous Last snapshot captured/restored, its unchanged pages are shared. NULL for a
+     *      full copy.
+     */
+    void Capture(const Snapshot* previous);
+
+    /*!
+     * \brief Restore the system to this snapshot
+     * \param current Last snapshot captured/restored, only pages that differ from it are copied.
+     *      NULL to copy every page.
+     * \return False if the state could not be loaded
+     */
+    bool Restore(const Snapshot* current);
+
+    /// Bytes of page data this snapshot owns alone
+    size_t unique_size() const;
+
+private:
+    std::vector<u8>     state_;         ///< Serialized small state
+    std::vector<Page*>  pages_;         ///< RAM pages followed by ARAM pages
+
+    Snapshot(const Snapshot&);
+    Snapshot& operator=(const Snapshot&);
+};
+
+/// Ring of snapshots captured at a fixed interval, used to rewind the emulation
+class SnapshotBuffer {
+public:
+    /// \param capacity Maximum number of snapshots, the oldest one is dropped when full
+    SnapshotBuffer(size_t capacity);
+    ~SnapshotBuffer();
+
+    /// Capture a new snapshot
+    void Capture();
+
+    /// Restore the most recent snapshot and drop it, returns false when the buffer is empty
+    bool Rewind();
+
+    /// Drop all snapshots
+    void Clear();
+
+    size_t size() const { return snapshots_.size(); }
+
+private:
+    size_t                  capacity_;
+    std::vector<Snapshot*>  snapshots_;     ///< Oldest first
+    Snapshot*               last_;          ///< Snapshot the dirty pages are relative to
+
+    void ReleaseLast();
+
+    SnapshotBuffer(const SnapshotBuffer&);
+    SnapshotBuffer& operator=(const SnapshotBuffer&);
+};
+
+} // namespace
+
+#endif // CORE_STATE_H_
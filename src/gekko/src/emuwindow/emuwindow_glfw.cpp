@@ -32,6 +32,14 @@ static void OnKeyEvent(GLFWwindow win, int key, int action) {
     EmuWindow_GLFW* emuwin = (EmuWindow_GLFW*)glfwGetWindowUserPointer(win);
 	input_common::GCController::GCButtonState state;
 
+    // Save states are left to the main loop, events are polled in the middle of emulation
+    if (key == GLFW_KEY_F5 || key == GLFW_KEY_F7) {
+        if (action == GLFW_PRESS) {
+            emuwin->set_state_request((key == GLFW_KEY_F5) ? EmuWindow_GLFW::kStateRequest_Save :
+                EmuWindow_GLFW::kStateRequest_Load);
+        }
+        return;
+    }
 	if (action == GLFW_PRESS) {
 		state = input_common::GCController::PRESSED;
 	} else {
@@ -49,7 +57,7 @@ static void OnWindowSizeEvent(GLFWwindow win, int width, int height) {
 }
 
 /// EmuWindow_GLFW constructor
-EmuWindow_GLFW::EmuWindow_GLFW() {
+EmuWindow_GLFW::EmuWindow_GLFW() : state_request_(kStateRequest_None) {
     // Initialize the window
     if(glfwInit() != GL_TRUE) {
         LOG_ERROR(TVIDEO, "Failed to initialize GLFW! Exiting...");
@@ -98,3 +106,10 @@ void EmuWindow_GLFW::MakeCurrent() {
 void EmuWindow_GLFW::DoneCurrent() {
     glfwMakeContextCurrent(NULL);
 }
+
+/// Returns the state hotkey pressed since the last call and clears it
+EmuWindow_GLFW::StateRequest EmuWindow_GLFW::TakeStateRequest() {
+    StateRequest request = state_request_;
+    state_request_ = kStateRequest_None;
+    return request;
+}
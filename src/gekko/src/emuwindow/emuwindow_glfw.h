@@ -32,6 +32,13 @@
 
 class EmuWindow_GLFW : public EmuWindow {
 public:
+    /// State hotkey pressed since the last TakeStateRequest
+    enum StateRequest {
+        kStateRequest_None = 0,
+        kStateRequest_Save,             ///< F5
+        kStateRequest_Load              ///< F7
+    };
+
     EmuWindow_GLFW();
     ~EmuWindow_GLFW();
 
@@ -47,9 +54,15 @@ public:
     /// Releases (dunno if this is the "right" word) the GLFW context from the caller thread
     void DoneCurrent();
 
+    /// Returns the state hotkey pressed since the last call and clears it
+    StateRequest TakeStateRequest();
+
+    void set_state_request(StateRequest request) { state_request_ = request; }
+
 	GLFWwindow render_window_;      ///< Internal GLFW render window
 
 private:
+    StateRequest state_request_;    ///< Serviced by the main loop, hotkeys come in the middle of SI
 
 };
 
@@ -0,0 +1,48 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    emuwindow_headless.h
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Implementation of EmuWindow class without a window, used with the null renderer
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef VIDEO_CORE_EMUWINDOW_HEADLESS_
+#define VIDEO_CORE_EMUWINDOW_HEADLESS_
+
+#include "video/emuwindow.h"
+
+class EmuWindow_Headless : public EmuWindow {
+public:
+    EmuWindow_Headless() { }
+    ~EmuWindow_Headless() { }
+
+    /// Swap buffers to display the next frame
+    void SwapBuffers() { }
+
+    /// Polls window events
+    void PollEvents() { }
+
+    /// Makes the graphics context current for the caller thread
+    void MakeCurrent() { }
+
+    /// Releases the graphics context from the caller thread
+    void DoneCurrent() { }
+};
+
+#endif // VIDEO_CORE_EMUWINDOW_HEADLESS_
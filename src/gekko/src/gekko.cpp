@@ -32,17 +32,24 @@
 #include "config.h"
 #include "xml.h"
 #include "x86_utils.h"
+#include "profiler.h"
 
 #include "core.h"
+#include "core_timing.h"
 #include "dvd/loader.h"
 #include "powerpc/cpu_core.h"
+#include "powerpc/cpu_core_regs.h"
 #include "hw/hw.h"
+#include "hw/hw_vi.h"
 #include "video_core.h"
+#include "renderer_null/renderer_null.h"
+#include "renderer_soft/renderer_soft.h"
 
 #ifndef USE_NEW_VIDEO_CORE
 #include "video/opengl.h"
 #endif
 #include "emuwindow/emuwindow_glfw.h"
+#include "emuwindow/emuwindow_headless.h"
 
 #include "gekko.h"
 #include "fifo_player.h"
@@ -55,9 +62,190 @@
 
 //#define PLAY_FIFO_RECORDING
 
+/// Command line options
+struct Options {
+    bool        headless;       ///< Run without a window on the null renderer
+    bool        software;       ///< Run without a window on the software renderer
+    bool        benchmark;      ///< Time the run and print a report when it ends
+    bool        checksum;       ///< Hash vertices and textures on the null renderer
+    u32         frames;         ///< Stop after this many VI frames, 0 for no limit
+    u64         cycles;         ///< Stop after this many guest cycles, 0 for no limit
+    const char* boot_file;      ///< File to boot instead of the configured default, or NULL
+    const char* dump_xfb;       ///< Directory to dump XFB copies to, or NULL
+    const char* state_file;     ///< State file of the F5/F7 hotkeys
+    const char* load_state;     ///< State file to load once booted, or NULL
+    bool        check_state;    ///< Check the state survives a save/load round trip at the end
+};
+
+/// Benchmark counters, sampled when the CPU is started
+struct Benchmark {
+    u64 start_ticks;            ///< Host ticks
+    u64 start_cycles;           ///< Guest cycles
+    u32 start_frames;           ///< VI frames
+    int start_gp_frames;        ///< XFB copies
+    u64 instructions;           ///< Guest instructions executed since the start
+};
+
+static void PrintUsage() {
+    printf("usage: " APP_NAME " [options] [file]\n"
+        "  file            DOL/ELF/GCM to boot, default is the one in the config\n"
+        "  --headless      no window, draw with the null renderer\n"
+        "  --software      no window, draw with the software renderer\n"
+        "  --dump-xfb DIR  write every XFB copy to DIR as a TGA (software renderer only)\n"
+        "  --frames N      stop after N VI frames and print a benchmark report\n"
+        "  --cycles N      stop after N guest cycles and print a benchmark report\n"
+        "  --checksum      hash all vertices and textures (null renderer only)\n"
+        "  --state FILE    state file saved with F5 and loaded with F7, default gekko.sav\n"
+        "  --load-state FILE  load a state file once booted\n"
+        "  --check-state   save, load and save the state again when the run ends, and\n"
+        "                  check the two saves match\n");
+}
+
+/// Parse the command line, returns false if it was invalid
+static bool ParseOptions(int argc, char** argv, Options* options) {
+    memset(options, 0, sizeof(Options));
+    options->state_file = "gekko.sav";
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--headless")) {
+            options->headless = true;
+        } else if (!strcmp(argv[i], "--software")) {
+            options->software = true;
+        } else if (!strcmp(argv[i], "--dump-xfb") && (i + 1) < argc) {
+            options->dump_xfb = argv[++i];
+        } else if (!strcmp(argv[i], "--checksum")) {
+            options->checksum = true;
+        } else if (!strcmp(argv[i], "--state") && (i + 1) < argc) {
+            options->state_file = argv[++i];
+        } else if (!strcmp(argv[i], "--load-state") && (i + 1) < argc) {
+            options->load_state = argv[++i];
+        } else if (!strcmp(argv[i], "--check-state")) {
+            options->check_state = true;
+        } else if (!strcmp(argv[i], "--frames") && (i + 1) < argc) {
+            options->frames = strtoul(argv[++i], NULL, 10);
+            options->benchmark = true;
+        } else if (!strcmp(argv[i], "--cycles") && (i + 1) < argc) {
+            options->cycles = strtoull(argv[++i], NULL, 10);
+            options->benchmark = true;
+        } else if (argv[i][0] != '-' && options->boot_file == NULL) {
+            options->boot_file = argv[i];
+        } else {
+            return false;
+        }
+    }
+    // A headless run has nothing to show but the report
+    if (options->headless) {
+        options->benchmark = true;
+    }
+    return true;
+}
+
+static void StartBenchmark(Benchmark* benchmark) {
+    common::profiler::SetEnabled(true);
+    benchmark->start_ticks = common::profiler::GetTicks();
+    benchmark->start_cycles = core_timing::GetTicks();
+    benchmark->start_frames = vi.frame_count;
+    benchmark->start_gp_frames = video_core::g_current_frame;
+    benchmark->instructions = 0;
+}
+
+/// Returns true once the run has reached its frame or cycle limit
+static bool IsBenchmarkDone(const Options& options, const Benchmark& benchmark) {
+    if (options.frames && (vi.frame_count - benchmark.start_frames) >= options.frames) {
+        return true;
+    }
+    if (options.cycles && (core_timing::GetTicks() - benchmark.start_cycles) >= options.cycles) {
+        return true;
+    }
+    return false;
+}
+
+static void PrintBenchmarkReport(const Benchmark& benchmark) {
+    using namespace common::profiler;
+
+    f64 seconds = TicksToSeconds(GetTicks() - benchmark.start_ticks);
+    u64 cycles = core_timing::GetTicks() - benchmark.start_cycles;
+    u32 frames = vi.frame_count - benchmark.start_frames;
+    int gp_frames = video_core::g_current_frame - benchmark.start_gp_frames;
+    f64 section[kSection_NumberOf];
+
+    if (seconds <= 0.0) {
+        seconds = 1e-9;
+    }
+    for (int i = 0; i < kSection_NumberOf; i++) {
+        section[i] = TicksToSeconds(g_section_ticks[i]);
+    }
+    // Report the time spent in each section itself, the sections nest
+    bool gp_on_cpu_thread = !common::g_config->enable_multicore();
+    section[kSection_CPU] -= section[kSection_HLE];
+    if (gp_on_cpu_thread) {
+        section[kSection_CPU] -= section[kSection_GPDecode];
+    }
+    section[kSection_GPDecode] -= section[kSection_TextureDecode];
+
+    printf("benchmark: %d VI frames, %d GP frames, %llu guest cycles in %.2f s (%.1f%% speed)\n",
+        frames, gp_frames, (unsigned long long)cycles, seconds,
+        100.0 * ((f64)cycles / (f64)cpu->GetTicksPerSecond()) / seconds);
+    printf("    emulated MIPS:      %.2f\n", (f64)benchmark.instructions / seconds / 1000000.0);
+    printf("    VI frames/s:        %.2f\n", frames / seconds);
+    printf("    GP frames/s:        %.2f\n", gp_frames / seconds);
+    for (int i = 0; i < kSection_NumberOf; i++) {
+        printf("    %-20s%.3f s  %5.1f%%  %llu calls%s\n", SectionName((Section)i), section[i],
+            100.0 * section[i] / seconds, (unsigned long long)g_section_calls[i],
+            (!gp_on_cpu_thread && i >= kSection_GPDecode && i <= kSection_TextureDecode) ?
+            "  (GP thread)" : "");
+    }
+
+    RendererNull* renderer_null = dynamic_cast<RendererNull*>(video_core::g_renderer);
+    if (renderer_null == NULL) {
+        return;
+    }
+    const RendererNull::Statistics& stats = renderer_null->stats();
+
+    printf("    primitives:         %llu (%llu vertices, %llu indices)\n", 
+        (unsigned long long)stats.primitives, (unsigned long long)stats.vertices, 
+        (unsigned long long)stats.indices);
+    printf("    draw calls:         %llu (%llu avoided by batching)\n", 
+        (unsigned long long)stats.draws, (unsigned long long)(stats.primitives - stats.draws));
+    printf("    BP/CP/XF writes:    %llu/%llu/%llu\n", (unsigned long long)stats.bp_writes,
+        (unsigned long long)stats.cp_writes, (unsigned long long)stats.xf_writes);
+    printf("    XFB/EFB copies:     %llu/%llu, %llu clears\n", (unsigned long long)stats.xfb_copies,
+        (unsigned long long)stats.efb_copies, (unsigned long long)stats.clears);
+    printf("    shaders created:    %llu\n", (unsigned long long)stats.shaders_created);
+    printf("    textures created:   %llu (%llu KB decoded)\n", 
+        (unsigned long long)stats.textures_created, (unsigned long long)stats.texture_bytes / 1024);
+    if (renderer_null->enable_checksums()) {
+        printf("    vertex checksum:    %016llx\n", (unsigned long long)stats.vertex_checksum);
+        printf("    texture checksum:   %016llx\n", (unsigned long long)stats.texture_checksum);
+    }
+}
+
+/// Save or load the state if its hotkey was pressed, called between CPU slices
+static void HandleStateHotkeys(EmuWindow_GLFW* window, const char* filename) {
+    switch (window->TakeStateRequest()) {
+    case EmuWindow_GLFW::kStateRequest_Save:
+        core::SaveState(filename);
+        break;
+    case EmuWindow_GLFW::kStateRequest_Load:
+        core::LoadState(filename);
+        break;
+    default:
+        break;
+    }
+}
+
 /// Application entry point
 int __cdecl main(int argc, char **argv) {
     u32 tight_loop;
+    Options options;
+    Benchmark benchmark;
+    int result = E_OK;
+
+    if (!ParseOptions(argc, argv, &options)) {
+        PrintUsage();
+        return E_ERR;
+    }
+    memset(&benchmark, 0, sizeof(benchmark));
 
     LOG_NOTICE(TMASTER, APP_NAME " starting...\n");
 
@@ -72,13 +260,42 @@ int __cdecl main(int argc, char **argv) {
     config_manager.ReloadConfig(NULL);
     core::SetConfigManager(&config_manager);
 
-    EmuWindow_GLFW* emu_window = new EmuWindow_GLFW;
+    if (options.boot_file != NULL) {
+        common::g_config->set_default_boot_file(options.boot_file, strlen(options.boot_file) + 1);
+    }
+    EmuWindow_GLFW* glfw_window = NULL;
+    EmuWindow_Headless* headless_window = NULL;
+    EmuWindow* emu_window;
+
+    if (options.headless) {
+        common::g_config->set_current_renderer(common::Config::RENDERER_NULL);
+        common::g_config->set_enable_auto_boot(true);
+        emu_window = headless_window = new EmuWindow_Headless;
+    } else if (options.software) {
+        common::g_config->set_current_renderer(common::Config::RENDERER_SOFTWARE);
+        common::g_config->set_enable_auto_boot(true);
+        emu_window = headless_window = new EmuWindow_Headless;
+    } else {
+        emu_window = glfw_window = new EmuWindow_GLFW;
+    }
 
     if (E_OK != core::Init(emu_window)) {
         LOG_ERROR(TMASTER, "core initialization failed, exiting...");
         core::Kill();
         exit(1);
     }
+    if (options.checksum) {
+        RendererNull* renderer_null = dynamic_cast<RendererNull*>(video_core::g_renderer);
+        if (renderer_null != NULL) {
+            renderer_null->set_enable_checksums(true);
+        }
+    }
+    if (options.dump_xfb != NULL) {
+        RendererSoft* renderer_soft = dynamic_cast<RendererSoft*>(video_core::g_renderer);
+        if (renderer_soft != NULL) {
+            renderer_soft->set_dump_path(options.dump_xfb);
+        }
+    }
 
 #ifndef PLAY_FIFO_RECORDING
     // Load a game or die...
@@ -97,15 +314,45 @@ int __cdecl main(int argc, char **argv) {
         if (core::SYS_RUNNING == core::g_state) {
             if(!(cpu->is_on)) {
                 cpu->Start(); // Initialize and start CPU.
+                if (options.load_state != NULL && !core::LoadState(options.load_state)) {
+                    core::SetState(core::SYS_DIE);
+                    result = E_ERR;
+                    break;
+                }
+                if (options.benchmark) {
+                    StartBenchmark(&benchmark);
+                }
             } else {
+                common::profiler::ScopedTimer timer(common::profiler::kSection_CPU);
+                u32 instruction_count = ireg.IC;
+
                 for(tight_loop = 0; tight_loop < 10000; ++tight_loop) {
                     cpu->execStep();
                 }
+                if (options.benchmark) {
+                    benchmark.instructions += (u32)(ireg.IC - instruction_count);
+                    if (IsBenchmarkDone(options, benchmark)) {
+                        core::SetState(core::SYS_DIE);
+                    }
+                }
+                if (glfw_window != NULL) {
+                    HandleStateHotkeys(glfw_window, options.state_file);
+                }
             }
         } else if (core::SYS_HALTED == core::g_state) {
             core::Stop();
         }
     }
+    if (options.benchmark && benchmark.start_ticks) {
+        PrintBenchmarkReport(benchmark);
+    }
+    if (options.check_state && cpu->is_on) {
+        bool ok = core::CheckState();
+        printf("state round trip: %s\n", ok ? "ok" : "FAILED");
+        if (!ok) {
+            result = E_ERR;
+        }
+    }
     core::Kill();
 #else
     // load fifo log and replay it
@@ -122,7 +369,8 @@ int __cdecl main(int argc, char **argv) {
     // TODO: Wait for video core to finish - PlayFile should handle this
     while (1);
 #endif
-    delete emu_window;
+    delete glfw_window;
+    delete headless_window;
 
-	return E_OK;
+	return result;
 }
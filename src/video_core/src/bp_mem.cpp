@@ -49,6 +49,10 @@ namespace gp {
 
 BPMemory g_bp_regs; ///< BP memory/registers
 
+static u32  g_texture_dirty     = 0xFF; ///< Texture units with registers written since last loaded
+static u32  g_texture_used      = 0;    ///< Texture units referenced by the TEV order
+static bool g_tev_order_dirty   = true; ///< TEV order written since g_texture_used was computed
+
 /// Sets the scissor box
 void BP_SetScissorBox() {
     // The scissor rectangle specifies an area of the screen outside of which all primitives are 
@@ -102,9 +106,18 @@ void BP_RegisterWrite(u8 addr, u32 data) {
             addr != BP_REG_TEXINVALIDATE && addr != BP_REG_TEXMODESYNC) {
         return;
     }
+    // Draw the primitives batched with the old state
+    VertexManager_DrawBatch();
+
 	// Write data to bp memory
     g_bp_regs.mem[addr] = data;
 
+    // Texture units are loaded again by the next draw using them
+    if ((addr >= BP_REG_TX_SETMODE0 && addr < BP_REG_TX_SETTLUT + 4) ||
+        (addr >= BP_REG_TX_SETMODE0_4 && addr < BP_REG_TX_SETLUT_4 + 4)) {
+        g_texture_dirty |= 1 << ((addr & 3) | ((addr & 0x20) >> 3));
+    }
+
     // Write to renderer
     video_core::g_renderer->WriteBP(addr, data);
 
@@ -169,7 +182,6 @@ void BP_RegisterWrite(u8 addr, u32 data) {
             video_core::g_renderer->SwapBuffers();
             if (fifo_player::IsRecording())
                 fifo_player::FrameFinished();
-            Fifo_Reset();
             GX_PE_FINISH = 1;
             video_core::g_current_frame++;
             video_core::g_texture_manager->Purge();
@@ -258,11 +270,33 @@ void BP_RegisterWrite(u8 addr, u32 data) {
 	        u32 tlut_addr = (g_bp_regs.mem[0x65] & 0x3ff) << 5;
 
 	        memcpy(&tmem[tlut_addr & TMEM_MASK], &Mem_RAM[mem_addr & RAM_MASK], cnt);
+            g_texture_dirty = 0xFF;
             LOG_DEBUG(TGP, "BP-> TX_LOADTLUTx");
             break;
         }
         break;
 
+    case BP_REG_TEXINVALIDATE: // TX_INVALIDATE
+        g_texture_dirty = 0xFF;
+        break;
+
+    // TX_SETIMAGE3 is the last image register GX writes for a texture, start decoding it early
+    case BP_REG_TX_SETIMAGE3 + 0:
+    case BP_REG_TX_SETIMAGE3 + 1:
+    case BP_REG_TX_SETIMAGE3 + 2:
+    case BP_REG_TX_SETIMAGE3 + 3:
+    case BP_REG_TX_SETIMAGE3_4 + 0:
+    case BP_REG_TX_SETIMAGE3_4 + 1:
+    case BP_REG_TX_SETIMAGE3_4 + 2:
+    case BP_REG_TX_SETIMAGE3_4 + 3:
+        {
+            int set = (addr & 0x20) >> 5;
+            int index = addr & 3;
+            video_core::g_texture_manager->Prefetch(g_bp_regs.tex[set].image_0[index],
+                g_bp_regs.tex[set].image_3[index]);
+        }
+        break;
+
     // TEV combiner registers
     case BP_REG_TEV_COLOR_ENV + 0:
     case BP_REG_TEV_COLOR_ENV + 2:
@@ -314,6 +348,7 @@ void BP_RegisterWrite(u8 addr, u32 data) {
         {
             int index = addr - BP_REG_TREF;
             video_core::g_shader_manager->UpdateTevOrder(index, g_bp_regs.tevorder[index]);
+            g_tev_order_dirty = true;
         }
         break;
 
@@ -326,17 +361,59 @@ void BP_RegisterWrite(u8 addr, u32 data) {
 
 /// Load a texture
 void BP_LoadTexture() {
+    if (g_tev_order_dirty) {
+        g_texture_used = 0;
+        for (int stage = 0; stage < kGCMaxTevStages; stage++) {
+            g_texture_used |= 1 << g_bp_regs.tevorder[stage >> 1].get_texmap(stage);
+        }
+        g_tev_order_dirty = false;
+    }
+    // Lookup and hash only the textures whose registers or source memory changed, the others are
+    // still bound from the last draw that used them
     for (int num = 0; num < kGCMaxActiveTextures; num++) {
+        if (!(g_texture_used & (1 << num))) {
+            continue;
+        }
+        if (!(g_texture_dirty & (1 << num)) && video_core::g_texture_manager->Revalidate(num)) {
+            continue;
+        }
         int set = (num & 4) >> 2;
-        int index = num & 7;
-        for (int stage = 0; stage < kGCMaxTevStages; stage++) {
-            if (g_bp_regs.tevorder[stage >> 1].get_texmap(stage) == num) {
-                video_core::g_texture_manager->UpdateData(num, g_bp_regs.tex[set].image_0[index],
-                    g_bp_regs.tex[set].image_3[index]);
-                video_core::g_texture_manager->Bind(num);
-                video_core::g_texture_manager->UpdateParameters(num, 
-                    g_bp_regs.tex[set].mode_0[index], g_bp_regs.tex[set].mode_1[index]);
-                break;
+        int index = num & 3;
+        video_core::g_texture_manager->UpdateData(num, g_bp_regs.tex[set].image_0[index],
+            g_bp_regs.tex[set].image_3[index], g_bp_regs.tex[set].tlut[index]);
+        video_core::g_texture_manager->Bind(num);
+        video_core::g_texture_manager->UpdateParameters(num, 
+            g_bp_regs.tex[set].mode_0[index], g_bp_regs.tex[set].mode_1[index]);
+    }
+    g_texture_dirty &= ~g_texture_used;
+}
+
+/// Returns true for BP registers that start an operation when written, rather than hold state
+static bool BP_IsCommandRegister(u8 addr) {
+    return (addr == BP_REG_PE_DRAWDONE   || addr == BP_REG_PE_TOKEN   ||
+            addr == BP_REG_PE_TOKEN_INT  || addr == BP_REG_CLEARBBOX1 ||
+            addr == BP_REG_CLEARBBOX2    || addr == BP_REG_EFB_COPY   ||
+            addr == BP_REG_LOADTLUT0     || addr == BP_REG_LOADTLUT1  ||
+            addr == BP_REG_TEXINVALIDATE || addr == BP_REG_TEXMODESYNC);
+}
+
+/// Save/load BP memory
+void BP_DoState(state::Serializer& s) {
+    BPMemory regs = g_bp_regs;
+
+    s.DoArray(regs.mem, 0x100);
+
+    if (s.is_reading()) {
+        g_texture_dirty = 0xFF;
+        g_tev_order_dirty = true;
+
+        // Replay state registers through BP_RegisterWrite, command registers are only restored
+        for (int addr = 0; addr < 0x100; addr++) {
+            if (BP_IsCommandRegister(addr)) {
+                g_bp_regs.mem[addr] = regs.mem[addr];
+            } else {
+                g_bp_regs.mem[addr] = ~regs.mem[addr];
+                BP_RegisterWrite(addr, regs.mem[addr]);
             }
         }
     }
@@ -345,6 +422,9 @@ void BP_LoadTexture() {
 /// Initialize BP
 void BP_Init() {
     memset(&g_bp_regs, 0, sizeof(g_bp_regs));
+    g_texture_dirty = 0xFF;
+    g_texture_used = 0;
+    g_tev_order_dirty = true;
 
     // Clear EFB on startup with alpha of 1.0f
     // TODO(ShizZy): Remove hard coded EFB rect size (still need a video_core or renderer interface
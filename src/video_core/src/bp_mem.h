@@ -28,6 +28,7 @@
 #include "types.h"
 #include "gx_types.h"
 #include "texture_decoder.h"
+#include "state.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // BP registers
@@ -625,6 +626,9 @@ void BP_SetLinePointSize();
 /// Initialize BP
 void BP_Init();
 
+/// Save/load BP memory, registers are written again on load to update the renderer state
+void BP_DoState(state::Serializer& s);
+
 } // namespace
 
 #endif // VIDEO_CORE_BP_MEM_H_
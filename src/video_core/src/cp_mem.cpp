@@ -25,6 +25,7 @@
 #include "common.h"
 #include "cp_mem.h"
 #include "video_core.h"
+#include "vertex_manager.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Graphics Processor namespace
@@ -39,6 +40,11 @@ void CP_RegisterWrite(u8 addr, u32 data) {
     if (g_cp_regs.mem[addr] == data) {
         return;
     }
+    // Array bases and strides are only used to load vertices, the rest is drawing state that the
+    // batched primitives must be drawn with
+    if (addr < CP_REG_ARRAY_BASE || addr >= CP_REG_ARRAY_STRIDE + 0x10) {
+        VertexManager_DrawBatch();
+    }
     g_cp_regs.mem[addr] = data;
 
     switch (addr) {
@@ -100,4 +106,19 @@ void CP_Init() {
     memset(&g_cp_regs, 0, sizeof(g_cp_regs));
 }
 
+/// Save/load CP memory
+void CP_DoState(state::Serializer& s) {
+    CPMemory regs = g_cp_regs;
+
+    s.DoArray(regs.mem, 0x100);
+
+    // Write every register again so the shader manager picks up the matrix index flags
+    if (s.is_reading()) {
+        for (int addr = 0; addr < 0x100; addr++) {
+            g_cp_regs.mem[addr] = ~regs.mem[addr];
+            CP_RegisterWrite(addr, regs.mem[addr]);
+        }
+    }
+}
+
 } // namespace
@@ -29,6 +29,7 @@
 
 #include "gx_types.h"
 #include "fifo.h"
+#include "state.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // CP register decoding
@@ -269,6 +270,8 @@ static const u8 kVertexTextureSize[16] = {
 #define CP_REG_VAT_A        0x70
 #define CP_REG_VAT_B        0x80
 #define CP_REG_VAT_C        0x90
+#define CP_REG_ARRAY_BASE   0xA0
+#define CP_REG_ARRAY_STRIDE 0xB0
 
 #define CP_DATA_POS_ADDR(idx)			(gp::g_cp_regs.mem[0xa0] + (idx) * gp::g_cp_regs.mem[0xb0])
 #define CP_DATA_NRM_ADDR(idx)			(gp::g_cp_regs.mem[0xa1] + (idx) * gp::g_cp_regs.mem[0xb1])
@@ -314,6 +317,9 @@ void CP_RegisterWrite(u8 addr, u32 data);
 /// Initialize CP
 void CP_Init();
 
+/// Save/load CP memory
+void CP_DoState(state::Serializer& s);
+
 } // namespace
 
 #endif // VIDEO_CORE_CP_MEM_
\ No newline at end of file
@@ -0,0 +1,194 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    display_list_cache.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-17
+ * @brief   Cache of display lists, in FIFO byte order and with their decoded vertices
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include "common.h"
+#include "memory.h"
+
+#include "fifo.h"
+#include "display_list_cache.h"
+
+namespace gp {
+
+typedef std::map<u64, DisplayListCacheEntry*> DisplayListCacheMap;
+
+static const u32 kMaxCacheBytes     = 64 * 1024 * 1024;     ///< Lists and vertices kept at most
+static const u32 kListPadding       = 64;   ///< Zeroes after a list, for commands cut off by its end
+
+static DisplayListCacheMap      g_dl_cache;             ///< Cached lists by (address, size)
+static u32                      g_dl_cache_bytes = 0;   ///< Memory used by lists and vertices
+static DisplayListCacheEntry*   g_dl_cache_current = NULL;  ///< List being executed, if any
+
+/// Memory used by a cache entry
+static u32 DisplayListCache_EntryBytes(const DisplayListCacheEntry* entry) {
+    u32 bytes = (u32)entry->data.size();
+    std::map<u32, DisplayListBatch>::const_iterator itr = entry->batches.begin();
+    for (; itr != entry->batches.end(); ++itr) {
+        bytes += (u32)(itr->second.vertices.size() * sizeof(GXVertex));
+    }
+    return bytes;
+}
+
+/// Hash a list in RAM, whole words are hashed since RAM is stored word swapped
+static common::Hash64 DisplayListCache_HashList(u32 addr, u32 size) {
+    u32 start = addr & ~3;
+    u32 end = (addr + size + 3) & ~3;
+    return common::GetHash64(&Mem_RAM[start], end - start, 0);
+}
+
+/// Remove an entry from the cache
+static void DisplayListCache_Remove(DisplayListCacheMap::iterator itr) {
+    g_dl_cache_bytes -= DisplayListCache_EntryBytes(itr->second);
+    delete itr->second;
+    g_dl_cache.erase(itr);
+}
+
+DisplayListCacheEntry* DisplayListCache_Fetch(u32 addr, u32 size) {
+    if (0 == size || size > FIFO_MAX_COMMAND || addr + size > RAM_SIZE) {
+        return NULL;
+    }
+    u64 id = ((u64)addr << 32) | size;
+    u32 first_page = addr >> MEM_PAGE_SHIFT;
+    u32 last_page = (addr + size - 1) >> MEM_PAGE_SHIFT;
+
+    DisplayListCacheMap::iterator itr = g_dl_cache.find(id);
+    if (itr != g_dl_cache.end()) {
+        // A write to a flagged page stamps it with a newer clock. The flags are shared by all the
+        // lists on the page, the stamps tell which of them have seen the write.
+        u32 page = first_page;
+        while (page <= last_page && (s32)(Mem_VideoStamp[page] - itr->second->stamp) <= 0) {
+            page++;
+        }
+        if (page > last_page) {
+            return itr->second;
+        }
+    }
+
+    // Flag the pages and take the stamp before the list is read, so a write from now on is seen
+    // next time. The CPU thread updates the flags too, so they're only changed atomically.
+    for (u32 page = first_page; page <= last_page; page++) {
+        common::AtomicOr(Mem_CodePage[page], MEM_PAGE_VIDEO);
+    }
+    u32 stamp = common::AtomicLoad(Mem_VideoClock);
+    common::Hash64 hash = DisplayListCache_HashList(addr, size);
+
+    if (itr != g_dl_cache.end()) {
+        if (itr->second->hash == hash) {
+            itr->second->stamp = stamp;
+            return itr->second;
+        }
+        // Entries can't be freed while a list calls another one
+        if (g_dl_cache_current) {
+            return NULL;
+        }
+        DisplayListCache_Remove(itr);
+    }
+    if (g_dl_cache_bytes + size + kListPadding > kMaxCacheBytes) {
+        if (g_dl_cache_current) {
+            return NULL;
+        }
+        LOG_NOTICE(TGP, "display list cache full (%d lists), flushing", (int)g_dl_cache.size());
+        DisplayListCache_Clear();
+    }
+
+    DisplayListCacheEntry* entry = new DisplayListCacheEntry();
+    entry->addr = addr;
+    entry->size = size;
+    entry->hash = hash;
+    entry->stamp = stamp;
+    entry->data.resize(size + kListPadding, 0);
+    for (u32 i = 0; i < size; i++) {
+        entry->data[i] = Mem_RAM[(addr + i) ^ 3];
+    }
+    g_dl_cache[id] = entry;
+    g_dl_cache_bytes += (u32)entry->data.size();
+
+    return entry;
+}
+
+DisplayListCacheEntry* DisplayListCache_SetCurrent(DisplayListCacheEntry* entry) {
+    DisplayListCacheEntry* prev = g_dl_cache_current;
+    g_dl_cache_current = entry;
+    return prev;
+}
+
+const GXVertex* DisplayListCache_GetBatch(const u8* src, const VertexLoaderKey& key, int count,
+    GXVertex** record) {
+    DisplayListCacheEntry* entry = g_dl_cache_current;
+    *record = NULL;
+
+    if (NULL == entry || count <= 0 || src < &entry->data[0] ||
+        src >= &entry->data[0] + entry->size) {
+        return NULL;
+    }
+    u32 offset = (u32)(src - &entry->data[0]);
+
+    std::map<u32, DisplayListBatch>::iterator itr = entry->batches.find(offset);
+    if (itr != entry->batches.end()) {
+        DisplayListBatch& batch = itr->second;
+        if (batch.vertices.size() == (size_t)count &&
+            0 == memcmp(&batch.key, &key, sizeof(key))) {
+            return &batch.vertices[0];
+        }
+        // Drawn with a different vertex format than last time, keep the latest
+        g_dl_cache_bytes -= (u32)(batch.vertices.size() * sizeof(GXVertex));
+        entry->batches.erase(itr);
+    }
+
+    u32 bytes = count * sizeof(GXVertex);
+    if (g_dl_cache_bytes + bytes > kMaxCacheBytes) {
+        return NULL;
+    }
+    DisplayListBatch& batch = entry->batches[offset];
+    batch.key = key;
+    batch.vertices.resize(count);
+    g_dl_cache_bytes += bytes;
+
+    *record = &batch.vertices[0];
+    return NULL;
+}
+
+void DisplayListCache_Clear() {
+    _ASSERT_MSG(TGP, NULL == g_dl_cache_current, "Display list cache cleared while in use!");
+
+    DisplayListCacheMap::iterator itr = g_dl_cache.begin();
+    for (; itr != g_dl_cache.end(); ++itr) {
+        delete itr->second;
+    }
+    g_dl_cache.clear();
+    g_dl_cache_bytes = 0;
+}
+
+/// Initialize the display list cache
+void DisplayListCache_Init() {
+    g_dl_cache_current = NULL;
+    DisplayListCache_Clear();
+}
+
+/// Shutdown the display list cache
+void DisplayListCache_Shutdown() {
+    g_dl_cache_current = NULL;
+    DisplayListCache_Clear();
+}
+
+} // namespace
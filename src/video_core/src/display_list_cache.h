@@ -0,0 +1,99 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    display_list_cache.h
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-17
+ * @brief   Cache of display lists, in FIFO byte order and with their decoded vertices
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef VIDEO_CORE_DISPLAY_LIST_CACHE_H_
+#define VIDEO_CORE_DISPLAY_LIST_CACHE_H_
+
+#include <map>
+#include <vector>
+
+#include "common.h"
+#include "hash.h"
+
+#include "gx_types.h"
+#include "vertex_loader_compiler.h"
+
+namespace gp {
+
+/// Vertices of a primitive as decoded the first time its display list was called
+struct DisplayListBatch {
+    VertexLoaderKey         key;            ///< Vertex format the vertices were decoded with
+    std::vector<GXVertex>   vertices;
+};
+
+/**
+ * Display list copied out of RAM. The copy is in FIFO byte order, so it's executed with the
+ * FIFO pop methods instead of swizzling every byte out of RAM. Primitives with no indexed
+ * components only depend on the list and the vertex format, their vertices are kept by offset
+ * into the list and copied straight to the VBO when the list is called again.
+ */
+struct DisplayListCacheEntry {
+    u32                             addr;
+    u32                             size;
+    common::Hash64                  hash;   ///< Hash of the list in RAM
+    u32                             stamp;  ///< Mem_VideoClock when hash was last checked
+    std::vector<u8>                 data;   ///< List in FIFO byte order, padded past size
+    std::map<u32, DisplayListBatch> batches;///< Decoded primitives by offset of their vertex data
+};
+
+/**
+ * Lookup a display list, copying it into the cache if it isn't there or has changed. Lists are
+ * revalidated by hash when one of their pages was written to since they were last checked.
+ * @param addr RAM address of the list
+ * @param size Size of the list in bytes
+ * @return Cache entry, NULL if the list can't be cached
+ */
+DisplayListCacheEntry* DisplayListCache_Fetch(u32 addr, u32 size);
+
+/**
+ * Set the display list that is being executed out of the cache
+ * @param entry Entry being executed, NULL when done
+ * @return Entry that was being executed before, to be restored when done
+ */
+DisplayListCacheEntry* DisplayListCache_SetCurrent(DisplayListCacheEntry* entry);
+
+/**
+ * Lookup the decoded vertices of a primitive in the display list being executed
+ * @param src Vertex data of the primitive (returned by Fifo_PopBlock)
+ * @param key Vertex format of the primitive, must not have indexed components
+ * @param count Number of vertices
+ * @param record Set to where the decoded vertices should be stored if they aren't cached yet,
+ *               NULL if they shouldn't be
+ * @return Cached vertices, NULL if they must be decoded
+ */
+const GXVertex* DisplayListCache_GetBatch(const u8* src, const VertexLoaderKey& key, int count,
+    GXVertex** record);
+
+/// Discard all cached display lists
+void DisplayListCache_Clear();
+
+/// Initialize the display list cache
+void DisplayListCache_Init();
+
+/// Shutdown the display list cache
+void DisplayListCache_Shutdown();
+
+} // namespace
+
+#endif // VIDEO_CORE_DISPLAY_LIST_CACHE_H_
@@ -23,12 +23,16 @@
  */
 
 #include "common.h"
+#include "config.h"
 #include "memory.h"
 #include "std_mutex.h"
+#include "std_condition_variable.h"
+#include "profiler.h"
 #include "core.h"
 
 #include "video_core.h"
 #include "vertex_loader.h"
+#include "display_list_cache.h"
 #include "fifo.h"
 #include "fifo_player.h"
 #include "bp_mem.h"
@@ -45,15 +49,39 @@ GPFuncPtr g_exec_op[0x20];      ///< GPOpcode table
 u8 g_cur_cmd = 0;               ///< Current command to be executed
 u8 g_cur_vat = 0;               ///< Current vertex attribute table
 
-u32 volatile g_fifo_write_ptr;  ///< FIFO write location
-u8* volatile g_fifo_read_ptr;   ///< FIFO read location
-u8* volatile g_fifo_end_ptr;    ///< End of the primary FIFO buffer
+u32 volatile g_fifo_write_pos;  ///< Bytes pushed into the FIFO, only the CPU writes it
+u32 volatile g_fifo_read_pos;   ///< Bytes decoded from the FIFO, only the GP writes it
+u32 g_fifo_write_limit;         ///< CPU's copy of g_fifo_read_pos + FIFO_SIZE
+u32 volatile g_fifo_gp_waiting; ///< Set while the GP thread is parked waiting for data
+u8* g_fifo_read_ptr;            ///< Read location of the command being decoded
 
 u8* volatile g_dl_read_ptr;     ///< Display list read location
 
-u8 g_fifo_buffer[FIFO_SIZE];    ///< Primary FIFO buffer storage - Don't use directly
+/// Ring buffer storage, commands that wrap around are copied past the end - Don't use directly
+u8 g_fifo_buffer[FIFO_SIZE + FIFO_MAX_COMMAND];
 
-u32 volatile g_reset_fifo;      ///< Used to synchronize CPU-GPU threads
+/**
+ * The FIFO is a single producer, single consumer ring. The CPU thread pushes data and publishes it
+ * by storing g_fifo_write_pos with release semantics, the GP thread loads it with acquire semantics
+ * and publishes the space it has freed up the same way through g_fifo_read_pos. Both positions
+ * count bytes and are only masked when indexing, so a full ring can be told apart from an empty
+ * one. A thread that has to wait parks on a condition variable, the other thread only takes the
+ * mutex when the waiting flag is set.
+ */
+static u32 g_fifo_decode_pos;           ///< Start of the next command, published as g_fifo_read_pos
+static u32 g_fifo_seen_pos;             ///< g_fifo_write_pos when the GP last ran out of commands
+static u32 g_fifo_required_size;        ///< Size of the incomplete command at g_fifo_decode_pos
+static u32 volatile g_fifo_cpu_waiting; ///< Set while the CPU thread is parked waiting for space
+static u32 volatile g_fifo_quit;        ///< Set on shutdown to release parked threads
+static bool g_fifo_gp_parked;           ///< Set while the GP thread sleeps, under g_fifo_mutex
+static bool g_fifo_gp_paused;           ///< Keeps the GP parked, see Fifo_PauseGP
+static std::mutex g_fifo_mutex;
+static std::condition_variable g_fifo_data_cv;  ///< Signaled when data is pushed
+static std::condition_variable g_fifo_space_cv; ///< Signaled when data is decoded
+static std::condition_variable g_fifo_parked_cv;    ///< Signaled when the GP thread parks
+
+/// Number of times the GP polls for data before it parks
+static const int kFifoSpinCount = 1000;
 
 u32 g_dl_read_addr;             ///< Display list read address     
 u32 g_dl_read_offset;           ///< Display list read offset
@@ -62,6 +90,10 @@ u8 (*Fifo_Pop8)();              ///< Pointer to FIFO 8-bit pop method (DL or FIF
 u16 (*Fifo_Pop16)();            ///< Pointer to FIFO 16-bit pop method (DL or FIFO)   
 u32 (*Fifo_Pop24)();            ///< Pointer to FIFO 24-bit pop method (DL or FIFO)   
 u32 (*Fifo_Pop32)();            ///< Pointer to FIFO 32-bit pop method (DL or FIFO)   
+const u8* (*Fifo_PopBlock)(u32);///< Pointer to FIFO block pop method (DL or FIFO)
+
+/// Display list data popped as a block, copied out of RAM in FIFO byte order
+static u8 g_dl_block_buffer[FIFO_MAX_COMMAND];
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // FIFO read/write routines
@@ -150,12 +182,40 @@ static inline u32 __displaylist_pop_32() {
     return res;
 }
 
+/**
+ * @brief Pop a block of data off FIFO, increment read pointer
+ * @param size Size of the block in bytes
+ * @return Pointer to the block, commands are always contiguous in the FIFO buffer
+ */
+static const u8* __fifo_pop_block(u32 size) {
+    const u8* res = g_fifo_read_ptr;
+    g_fifo_read_ptr+=size;
+    return res;
+}
+
+/**
+ * @brief Pop a block of data off a display list, increment read pointer
+ * @param size Size of the block in bytes
+ * @return Pointer to a copy of the block in FIFO byte order
+ */
+static const u8* __displaylist_pop_block(u32 size) {
+    _ASSERT_MSG(TGP, size <= FIFO_MAX_COMMAND, "Display list block too large, size=%d!", size);
+
+    u32 addr = g_dl_read_addr + g_dl_read_offset;
+    for (u32 i = 0; i < size; i++) {
+        g_dl_block_buffer[i] = Mem_RAM[((addr + i) ^ 3) & RAM_MASK];
+    }
+    g_dl_read_offset+=size;
+    return g_dl_block_buffer;
+}
+
 /// Sets the GP in FIFO read mode
 static inline void _set_fifo_read_normal() {
     Fifo_Pop8  = __fifo_pop_8;
     Fifo_Pop16 = __fifo_pop_16;
     Fifo_Pop24 = __fifo_pop_24;
     Fifo_Pop32 = __fifo_pop_32;
+    Fifo_PopBlock = __fifo_pop_block;
 }
 
 /// Sets the GP in display list read mode
@@ -164,6 +224,7 @@ static inline void _set_fifo_read_displaylists() {
     Fifo_Pop16 = __displaylist_pop_16;
     Fifo_Pop24 = __displaylist_pop_24;
     Fifo_Pop32 = __displaylist_pop_32;
+    Fifo_PopBlock = __displaylist_pop_block;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -258,10 +319,34 @@ GP_OPCODE(CALL_DISPLAYLIST) {
 	u32 addr = Fifo_Pop32() & RAM_MASK;
     u32 size = Fifo_Pop32();
 
-    g_dl_read_addr = addr;
-    g_dl_read_offset = 0;
     LOG_DEBUG(TGP, "CALL_DISPLAYLIST: addr=%08x size=%08x", addr, size);
 
+    // Lists in the cache are already in FIFO byte order, run them like FIFO data
+    DisplayListCacheEntry* entry = DisplayListCache_Fetch(addr, size);
+    if (entry) {
+        bool in_displaylist = (Fifo_Pop8 != __fifo_pop_8);
+        u8* fifo_read_ptr = g_fifo_read_ptr;
+        DisplayListCacheEntry* prev_entry = DisplayListCache_SetCurrent(entry);
+
+        _set_fifo_read_normal();
+        g_fifo_read_ptr = &entry->data[0];
+
+        u8* end = g_fifo_read_ptr + size;
+        while (g_fifo_read_ptr < end) {
+            g_cur_cmd = Fifo_Pop8();
+            g_cur_vat = g_cur_cmd & 0x7;
+            g_exec_op[GP_OPMASK(g_cur_cmd)]();
+        }
+        DisplayListCache_SetCurrent(prev_entry);
+        g_fifo_read_ptr = fifo_read_ptr;
+        if (in_displaylist) {
+            _set_fifo_read_displaylists();
+        }
+        return;
+    }
+
+    g_dl_read_addr = addr;
+    g_dl_read_offset = 0;
     _set_fifo_read_displaylists();
 
     while (g_dl_read_offset < size) {
@@ -339,20 +424,29 @@ GP_OPCODE(DRAW_POINTS) {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // FIFO flow control
 
-/// Returns true if the current command in the FIFO is ready to be decoded
-bool Fifo_NextCommandReady() {
-    static int last_required_size = -1;
-
-    // We haven't started (at the beginning), or something went terrible wrong...
-    if (g_fifo_read_ptr == (g_fifo_buffer + g_fifo_write_ptr)) {
-        return false;
+/**
+ * Make sure the next bytes of the FIFO can be read straight from g_fifo_read_ptr. If they wrap
+ * around the end of the ring, the part at the start is copied past the end.
+ * @param size Number of bytes needed, they must already be in the FIFO
+ */
+static inline void Fifo_MakeContiguous(u32 size) {
+    u32 offset = g_fifo_decode_pos & FIFO_MASK;
+    if (offset + size > FIFO_SIZE) {
+        _ASSERT_MSG(TGP, size <= FIFO_MAX_COMMAND, "GP command too large (%d bytes)!", size);
+        memcpy(g_fifo_buffer + FIFO_SIZE, g_fifo_buffer, offset + size - FIFO_SIZE);
     }
-    // Otherwise, read_ptr < write_ptr:
-    uintptr_t bytes_in_fifo = (g_fifo_buffer + g_fifo_write_ptr) - g_fifo_read_ptr;
+}
 
-    // Last size still right...
-	if ((last_required_size != -1) && (last_required_size > (s32)bytes_in_fifo)) {
-	    return false;
+/**
+ * Returns true if the current command in the FIFO is ready to be decoded
+ * @param write_pos Write position loaded by the caller, only data before it is looked at
+ */
+static bool Fifo_NextCommandReady(u32 write_pos) {
+    u32 bytes_in_fifo = write_pos - g_fifo_decode_pos;
+
+    // Nothing new, or still not enough for the last command
+    if (bytes_in_fifo == 0 || g_fifo_required_size > bytes_in_fifo) {
+        return false;
     }
 
     // Get current command and vat
@@ -360,35 +454,24 @@ bool Fifo_NextCommandReady() {
     g_cur_vat = g_cur_cmd & 0x7;
 
     // Determine opcode size
+    u32 size = 0;
     switch(GP_OPMASK(g_cur_cmd))
     {
     case 0: // NOP
-        last_required_size = -1;
-        return true;
+    case 9: // INVALID_VTX_CACHE
+        size = 1;
+        break;
     
     case 1: // LOAD_CP
-        if(bytes_in_fifo >= 6) {
-            last_required_size = -1;
-            return true;
-        }
-        last_required_size = 6;
+        size = 6;
         break; 
     
     case 2: // LOAD XF
-        if (bytes_in_fifo >= 5) { // if header is present
+        size = 5;
+        if (bytes_in_fifo >= size) { // if header is present
+            Fifo_MakeContiguous(size);
             u32 temp = FIFO_GET32(1);
-	        u16 size  = 4 * ((temp >> 16) + 1);
-            size += 5;
-            if(bytes_in_fifo >= size)
-            {
-                last_required_size = -1;
-                return true;
-            }
-            else {
-                last_required_size = size;
-            }
-        } else {
-            last_required_size = 5;
+            size += 4 * ((temp >> 16) + 1);
         }
         break;
 
@@ -396,54 +479,38 @@ bool Fifo_NextCommandReady() {
     case 5: // " B
     case 6: // " C 
     case 7: // " D
-        if (bytes_in_fifo >= 5) {
-            last_required_size = -1;
-            return true;
-        }
-        last_required_size = 5;
+        size = 5;
         break; 
 
     case 8: // CALL_DL
-        if (bytes_in_fifo >= 9) {
-            last_required_size = -1;
-            return true;
-        }
-        last_required_size = 9;
+        size = 9;
         break; 
 
-    case 9: // INVALID_VTX_CACHE
-        last_required_size = -1;
-        return true;
-
     case 0xC: // LOAD BP
-        if (bytes_in_fifo >= 5) {
-            last_required_size = -1;
-            return true;
-        }
-        last_required_size = 5;
-        return false; 
+        size = 5;
+        break;
 
     default: 		
         if(g_cur_cmd & 0x80) { // Draw command
-            if(bytes_in_fifo >= 3) {    // See if header exists
-                u16 numverts = FIFO_GET16(1);
-                u16 vertsize = VertexLoader_GetVertexSize();
-                u16 size = 3;
-
-                size += numverts * vertsize;
-                if(bytes_in_fifo >= size) {
-                    last_required_size = -1;
-                    return true;
-                } else {
-                    last_required_size = size;
-                }
-            } else {
-                last_required_size = 3;
+            size = 3;
+            if(bytes_in_fifo >= size) {    // See if header exists
+                Fifo_MakeContiguous(size);
+                u32 numverts = FIFO_GET16(1);
+                size += numverts * VertexLoader_GetVertexSize();
             }
+            break;
         }
+        // Let the unknown opcode handler report it
+        size = 1;
+        break;
+    }
+    if (bytes_in_fifo < size) {
+        g_fifo_required_size = size;
         return false;
     }
-    return false;
+    g_fifo_required_size = 0;
+    Fifo_MakeContiguous(size);
+    return true;
 }
 
 int Fifo_GetCommandLength(u8* read_ptr)
@@ -508,42 +575,139 @@ int Fifo_GetCommandLength(u8* read_ptr)
     return command_size;
 }
 
-/// Called at end of frame to reset FIFO
-void Fifo_Reset() {
-    if (g_fifo_write_ptr > FIFO_TAIL_END) {
+/// Release the decoded part of the FIFO to the CPU thread, waking it if it's waiting for space
+static void Fifo_ReleaseSpace() {
+    common::AtomicStoreRelease(g_fifo_read_pos, g_fifo_decode_pos);
 
-        // Move FIFO to beginning
-        g_fifo_write_ptr    = 0;
-        g_fifo_read_ptr     = g_fifo_buffer;
-        memset(g_fifo_buffer, 0, FIFO_SIZE);
-
-        g_reset_fifo = 0;
+    // Orders the store above with the load below, see Fifo_WaitForSpace
+    common::AtomicFence();
+    if (common::AtomicLoad(g_fifo_cpu_waiting)) {
+        std::lock_guard<std::mutex> lock(g_fifo_mutex);
+        common::AtomicStore(g_fifo_cpu_waiting, 0);
+        g_fifo_space_cv.notify_one();
     }
 }
 
-/// Decodes current FIFO command
-void Fifo_DecodeCommand() {
-
-    int bytes_in_fifo = g_fifo_write_ptr - (g_fifo_read_ptr - g_fifo_buffer);
-
-    if (bytes_in_fifo < 1) {
-        if (!g_reset_fifo) {
-            return;
-        }
+/**
+ * Decodes every complete command in the FIFO in one go. The write position is only loaded once,
+ * commands pushed while decoding are left for the next call. The decoded space is handed back to
+ * the CPU at the end, or right away if the CPU is waiting for it.
+ */
+int Fifo_DecodeCommands() {
+    g_fifo_seen_pos = common::AtomicLoadAcquire(g_fifo_write_pos);
+    if (!Fifo_NextCommandReady(g_fifo_seen_pos)) {
+        return 0;
     }
-    _ASSERT_MSG(TGP, g_fifo_write_ptr >=  (g_fifo_read_ptr - g_fifo_buffer), 
-        "GP decoding read_ptr > wrote_ptr, this should never happen!");
-        
-    // Get the next GP opcode and decode it
-    if (Fifo_NextCommandReady()) {
+    common::profiler::ScopedTimer timer(common::profiler::kSection_GPDecode);
+
+    int num_commands = 0;
+    do {
         // TODO: Display list handling...
         if (GP_OPMASK(g_cur_cmd) != 8 && fifo_player::IsRecording())
         {
             fifo_player::Write(g_fifo_read_ptr, Fifo_GetCommandLength(g_fifo_read_ptr));
         }
         g_exec_op[GP_OPMASK(Fifo_Pop8())]();
+
+        // The read pointer may have run past the end of the ring
+        g_fifo_decode_pos += (u32)(g_fifo_read_ptr - (g_fifo_buffer + 
+            (g_fifo_decode_pos & FIFO_MASK)));
+        g_fifo_read_ptr = g_fifo_buffer + (g_fifo_decode_pos & FIFO_MASK);
+        num_commands++;
+
+        if (common::AtomicLoad(g_fifo_cpu_waiting)) {
+            Fifo_ReleaseSpace();
+        }
+    } while (Fifo_NextCommandReady(g_fifo_seen_pos));
+
+    Fifo_ReleaseSpace();
+    return num_commands;
+}
+
+/**
+ * Park the GP thread until more data is pushed. The waiting flag is set before the write position
+ * is checked again, and Fifo_Commit stores the write position before it checks the flag, so one of
+ * the two threads always sees the other's store.
+ */
+bool Fifo_WaitForData() {
+    // Data usually follows quickly, so poll for a bit before going to sleep
+    for (int i = 0; i < kFifoSpinCount; i++) {
+        if (common::AtomicLoadAcquire(g_fifo_write_pos) != g_fifo_seen_pos) {
+            return true;
+        }
+    }
+    std::unique_lock<std::mutex> lock(g_fifo_mutex);
+    for (;;) {
+        common::AtomicStore(g_fifo_gp_waiting, 1);
+        common::AtomicFence();
+        if (g_fifo_quit || (!g_fifo_gp_paused &&
+            common::AtomicLoadAcquire(g_fifo_write_pos) != g_fifo_seen_pos)) {
+            break;
+        }
+        g_fifo_gp_parked = true;
+        g_fifo_parked_cv.notify_all();
+        g_fifo_data_cv.wait(lock);
+        g_fifo_gp_parked = false;
+    }
+    common::AtomicStore(g_fifo_gp_waiting, 0);
+    return !g_fifo_quit;
+}
+
+/**
+ * Wait for the GP thread to decode every complete command and park, and keep it parked until
+ * Fifo_ResumeGP. The CPU thread doesn't push meanwhile, so once the GP has parked on the current
+ * write position it has nothing left to decode.
+ */
+void Fifo_PauseGP() {
+    std::unique_lock<std::mutex> lock(g_fifo_mutex);
+    while (!g_fifo_quit &&
+        !(g_fifo_gp_parked && g_fifo_seen_pos == common::AtomicLoad(g_fifo_write_pos))) {
+        g_fifo_parked_cv.wait(lock);
+    }
+    g_fifo_gp_paused = true;
+}
+
+/// Let the GP thread decode again after Fifo_PauseGP
+void Fifo_ResumeGP() {
+    std::lock_guard<std::mutex> lock(g_fifo_mutex);
+    g_fifo_gp_paused = false;
+    g_fifo_data_cv.notify_one();
+}
+
+/// Wake the GP thread after data was pushed
+void Fifo_WakeGP() {
+    std::lock_guard<std::mutex> lock(g_fifo_mutex);
+    common::AtomicStore(g_fifo_gp_waiting, 0);
+    g_fifo_data_cv.notify_one();
+}
+
+/// Wait until the GP has decoded enough of the FIFO to push more data
+void Fifo_WaitForSpace(u32 size) {
+    u32 write_pos = g_fifo_write_pos;
+
+    g_fifo_write_limit = common::AtomicLoadAcquire(g_fifo_read_pos) + FIFO_SIZE;
+    if ((u32)(g_fifo_write_limit - write_pos) >= size) {
+        return;
+    }
+    // The GP runs on this thread, make room by decoding
+    if (!common::g_config->enable_multicore()) {
+        Fifo_DecodeCommands();
+        g_fifo_write_limit = g_fifo_read_pos + FIFO_SIZE;
+        _ASSERT_MSG(TGP, (u32)(g_fifo_write_limit - write_pos) >= size, 
+            "GP FIFO overflow, a command is larger than the FIFO!");
+        return;
+    }
+    std::unique_lock<std::mutex> lock(g_fifo_mutex);
+    for (;;) {
+        common::AtomicStore(g_fifo_cpu_waiting, 1);
+        common::AtomicFence();
+        g_fifo_write_limit = common::AtomicLoadAcquire(g_fifo_read_pos) + FIFO_SIZE;
+        if (g_fifo_quit || (u32)(g_fifo_write_limit - write_pos) >= size) {
+            break;
+        }
+        g_fifo_space_cv.wait(lock);
     }
-    return;
+    common::AtomicStore(g_fifo_cpu_waiting, 0);
 }
 
 /// Initialize GP FIFO
@@ -551,15 +715,20 @@ void Fifo_Init() {
     _set_fifo_read_normal();
 
     // FIFO pointers
-    g_fifo_write_ptr    = 0;
+    g_fifo_write_pos    = 0;
+    g_fifo_read_pos     = 0;
+    g_fifo_write_limit  = FIFO_SIZE;
     g_fifo_read_ptr     = g_fifo_buffer;
+    g_fifo_decode_pos   = 0;
+    g_fifo_seen_pos     = 0;
+    g_fifo_required_size = 0;
 
-    g_reset_fifo        = 0;
+    g_fifo_gp_waiting   = 0;
+    g_fifo_cpu_waiting  = 0;
+    g_fifo_quit         = 0;
+    g_fifo_gp_parked    = false;
+    g_fifo_gp_paused    = false;
 
-    // Zero FIFO memory
-	memset(g_fifo_buffer, 0, FIFO_SIZE);
-
-    g_reset_fifo = 0;
     g_dl_read_addr = 0;
     g_dl_read_offset = 0;
 
@@ -588,8 +757,51 @@ void Fifo_Init() {
 	GP_SETOP(GP_OPMASK(GP_DRAW_POINTS), GPOPCODE_DRAW_POINTS);
 }
 
-/// Shutdown GP FIFO
+/// Shutdown GP FIFO, wakes up threads waiting on it
 void Fifo_Shutdown() {
+    std::lock_guard<std::mutex> lock(g_fifo_mutex);
+    g_fifo_quit = 1;
+    g_fifo_data_cv.notify_all();
+    g_fifo_space_cv.notify_all();
+    g_fifo_parked_cv.notify_all();
+}
+
+/// Save/load the commands waiting in the FIFO
+void Fifo_DoState(state::Serializer& s) {
+    u32 size = g_fifo_write_pos - g_fifo_read_pos;
+
+    s.Do(size);
+
+    // Pending commands are moved to the start of the buffer on load, and the GP looks at them
+    // from scratch, an incomplete command it was waiting on is gone
+    if (s.is_reading()) {
+        g_fifo_read_pos = 0;
+        g_fifo_decode_pos = 0;
+        g_fifo_read_ptr = g_fifo_buffer;
+        g_fifo_write_pos = 0;
+        g_fifo_write_limit = FIFO_SIZE;
+        g_fifo_seen_pos = 0;
+        g_fifo_required_size = 0;
+
+        // The commands are followed by the rest of the state, it can't be read past them
+        if (size > FIFO_SIZE) {
+            LOG_ERROR(TGP, "saved FIFO holds %d bytes, more than the %d byte buffer", size,
+                      FIFO_SIZE);
+            s.Fail();
+            return;
+        }
+        g_fifo_write_pos = size;
+    }
+    // They may wrap around the end of the ring when saving
+    u32 offset = g_fifo_read_pos & FIFO_MASK;
+    u32 first_size = MIN(size, FIFO_SIZE - offset);
+    s.DoArray(g_fifo_buffer + offset, first_size);
+    s.DoArray(g_fifo_buffer, size - first_size);
+
+    // The GP may be parked on the old write position
+    if (s.is_reading()) {
+        Fifo_WakeGP();
+    }
 }
 
 } // namespace
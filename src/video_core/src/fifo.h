@@ -26,6 +26,7 @@
 #define VIDEO_CORE_FIFO_H_
 
 #include "common.h"
+#include "state.h"
 
 typedef void(*GPFuncPtr)(void); ///< Function pointer GP opcodes
 
@@ -41,9 +42,9 @@ typedef void(*GPFuncPtr)(void); ///< Function pointer GP opcodes
 #define GP_SETOP(n, op)         g_exec_op[n] = (GPFuncPtr)op
 
 // FIFO information
-#define FIFO_SIZE           (128 * 1024 * 1024)         // 128mb
-#define FIFO_TAIL_END       (120 * 1024 * 1024)         // First 120mb of FIFO
+#define FIFO_SIZE           (32 * 1024 * 1024)          // 32mb ring buffer
 #define FIFO_MASK           (FIFO_SIZE - 1)             // Mask
+#define FIFO_MAX_COMMAND    (9 * 1024 * 1024)           // Largest command (65535 129-byte vertices)
 
 /// Get last byte from FIFO
 #define FIFO_GET8(ofs)      *(gp::g_fifo_read_ptr + ofs)
@@ -86,50 +87,116 @@ namespace gp {
 extern u8 g_cur_cmd;                        ///< Current command to be executed
 extern u8 g_cur_vat;                        ///< Current vertex attribute table
 
-extern u32 volatile g_fifo_write_ptr;       ///< FIFO write location
-extern u8* volatile g_fifo_read_ptr;        ///< FIFO read location
-extern SDL_mutex*  g_fifo_write_ptr_mutex;  ///< Mutex for accessing g_fifo_write_ptr
+extern u32 volatile g_fifo_write_pos;       ///< Bytes pushed into the FIFO, only the CPU writes it
+extern u32 volatile g_fifo_read_pos;        ///< Bytes decoded from the FIFO, only the GP writes it
+extern u32 g_fifo_write_limit;              ///< CPU's copy of g_fifo_read_pos + FIFO_SIZE
+extern u32 volatile g_fifo_gp_waiting;      ///< Set while the GP thread is parked waiting for data
+extern u8* g_fifo_read_ptr;                 ///< Read location of the command being decoded
 
-extern u8 g_fifo_buffer[FIFO_SIZE];         ///< Primary FIFO buffer storage - Don't use directly
+/// Ring buffer storage, commands that wrap around are copied past the end - Don't use directly
+extern u8 g_fifo_buffer[FIFO_SIZE + FIFO_MAX_COMMAND];
 
 extern u8 (*Fifo_Pop8)();                   ///< Pointer to FIFO 8-bit pop method (DL or FIFO) 
 extern u16 (*Fifo_Pop16)();                 ///< Pointer to FIFO 16-bit pop method (DL or FIFO)
 extern u32 (*Fifo_Pop24)();                 ///< Pointer to FIFO 24-bit pop method (DL or FIFO)
 extern u32 (*Fifo_Pop32)();                 ///< Pointer to FIFO 32-bit pop method (DL or FIFO)
 
+/**
+ * Pointer to FIFO block pop method (DL or FIFO), pops size bytes at once
+ * @return Pointer to the data, in FIFO byte order. Valid until the next block pop
+ */
+extern const u8* (*Fifo_PopBlock)(u32 size);
+
+/**
+ * Wait until the GP has decoded enough of the FIFO to push more data, slow path of Fifo_Push*
+ * @param size Number of bytes that are about to be pushed
+ */
+void Fifo_WaitForSpace(u32 size);
+
+/// Wake the GP thread after data was pushed, slow path of Fifo_Commit
+void Fifo_WakeGP();
+
+/// Publish pushed data to the GP thread
+static inline void Fifo_Commit(u32 write_pos) {
+    common::AtomicStoreRelease(g_fifo_write_pos, write_pos);
+
+    // Orders the store above with the load below, see Fifo_WaitForData
+    common::AtomicFence();
+    if (common::AtomicLoad(g_fifo_gp_waiting)) {
+        Fifo_WakeGP();
+    }
+}
+
 /// Push 8-bit byte into the FIFO
 static inline void Fifo_Push8(u8 data) {
-    g_fifo_buffer[g_fifo_write_ptr] = data;
-    g_fifo_write_ptr++;
+    u32 write_pos = g_fifo_write_pos;
+    if ((u32)(g_fifo_write_limit - write_pos) < 1) {
+        Fifo_WaitForSpace(1);
+    }
+    g_fifo_buffer[write_pos & FIFO_MASK] = data;
+    Fifo_Commit(write_pos + 1);
 }
 
 /// Push 16-bit halfword into the FIFO
 static inline void Fifo_Push16(u16 data) {
-    *(u16*)(g_fifo_buffer + g_fifo_write_ptr) = BSWAP16(data);
-    g_fifo_write_ptr += 2;
+    u32 write_pos = g_fifo_write_pos;
+    if ((write_pos & FIFO_MASK) > (FIFO_SIZE - 2)) { // Wraps around the end
+        Fifo_Push8(data >> 8);
+        Fifo_Push8(data & 0xFF);
+        return;
+    }
+    if ((u32)(g_fifo_write_limit - write_pos) < 2) {
+        Fifo_WaitForSpace(2);
+    }
+    *(u16*)(g_fifo_buffer + (write_pos & FIFO_MASK)) = BSWAP16(data);
+    Fifo_Commit(write_pos + 2);
 }
 
 /// Push 32-bit word into the FIFO
 static inline void Fifo_Push32(u32 data) {
-    *(u32*)(g_fifo_buffer + g_fifo_write_ptr) = BSWAP32(data);
-    g_fifo_write_ptr += 4;
+    u32 write_pos = g_fifo_write_pos;
+    if ((write_pos & FIFO_MASK) > (FIFO_SIZE - 4)) { // Wraps around the end
+        Fifo_Push16(data >> 16);
+        Fifo_Push16(data & 0xFFFF);
+        return;
+    }
+    if ((u32)(g_fifo_write_limit - write_pos) < 4) {
+        Fifo_WaitForSpace(4);
+    }
+    *(u32*)(g_fifo_buffer + (write_pos & FIFO_MASK)) = BSWAP32(data);
+    Fifo_Commit(write_pos + 4);
 }
 
-/// Called by CPU core to catch up
-void Fifo_Synchronize();
+/**
+ * Decodes all complete commands in the FIFO
+ * @return Number of commands decoded, 0 if no complete command is waiting
+ */
+int Fifo_DecodeCommands();
+
+/**
+ * Park the GP thread until more data is pushed, call when Fifo_DecodeCommands returns 0
+ * @return False if the FIFO was shut down while waiting
+ */
+bool Fifo_WaitForData();
 
-/// Decodes current FIFO command
-void Fifo_DecodeCommand();
+/**
+ * Wait for the GP thread to decode all complete commands and park, then keep it parked. Only call
+ * from the CPU thread while the GP runs on its own thread.
+ */
+void Fifo_PauseGP();
 
-/// Called at end of frame to reset FIFO
-void Fifo_Reset();
+/// Let the GP thread decode again after Fifo_PauseGP
+void Fifo_ResumeGP();
 
 /// Initialize GP FIFO
 void Fifo_Init();
 
-/// Shutdown GP FIFO
+/// Shutdown GP FIFO, wakes up threads waiting on it
 void Fifo_Shutdown();
 
+/// Save/load the commands waiting in the FIFO, the GP must be paused (see Fifo_PauseGP)
+void Fifo_DoState(state::Serializer& s);
+
 } // namespace
 
 #endif // VIDEO_CORE_FIFO_H_
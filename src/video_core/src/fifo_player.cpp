@@ -246,6 +246,7 @@ void PlayFile(FPFile& in)
                 {
                     // TODO: Wait for GPU thread to catch up before doing this
                     FPMemUpdateInfo* update_info = (FPMemUpdateInfo*)&(*(in.raw_data.begin() + element->offset));
+                    Memory_MarkDirty(update_info->addr, update_info->size);
                     memcpy(&Mem_RAM[update_info->addr & RAM_MASK], &*(in.raw_data.begin() + element->offset + 2), update_info->size);
 
                     break;
@@ -31,6 +31,7 @@
 #include "gx_types.h"
 #include "video/emuwindow.h"
 #include "vertex_loader.h"
+#include "vertex_manager.h"
 #include "shader_manager.h"
 #include "texture_manager.h"
 
@@ -55,7 +56,7 @@ public:
     RendererBase() : current_fps_(0), current_frame_(0), texture_interface_(NULL) {
     }
 
-    ~RendererBase() {
+    virtual ~RendererBase() {
     }
 
     /**
@@ -81,13 +82,16 @@ public:
     virtual void WriteXF(u16 addr, int length, u32* data) = 0;
 
     /**
-     * Begin renderering of a primitive
+     * Begin renderering of a primitive. The vertex manager batches GX primitives into one call,
+     * which can be drawn with the state at the time of EndPrimitive.
      * @param prim Primitive type (e.g. GX_TRIANGLES)
-     * @param count Number of vertices to be drawn (used for appropriate memory management, only)
+     * @param count Maximum number of vertices to be drawn (used for memory management, only)
+     * @param layout Packed layout of the vertices, valid until EndPrimitive
      * @param vbo Pointer to VBO, which will be set by API in this function
      * @param vbo_offset Offset into VBO to use (in bytes)
      */
-    virtual void BeginPrimitive(GXPrimitive prim, int count, GXVertex** vbo, u32 vbo_offset) = 0;
+    virtual void BeginPrimitive(GXPrimitive prim, int count, const gp::VertexLayout& layout, 
+        u8** vbo, u32 vbo_offset) = 0;
 
     /**
      * Set the current vertex state (format and count of each vertex component)
@@ -101,8 +105,17 @@ public:
      */
     virtual void VertexPosition_UseIndexXF(u8 index) = 0;
 
-    /// End a primitive (signal renderer to draw it)
-    virtual void EndPrimitive(u32 vbo_offset, u32 vertex_num) = 0;
+    /**
+     * End a primitive (signal renderer to draw it)
+     * @param vbo_offset Offset into VBO of the vertices (in bytes)
+     * @param vertex_num Number of vertices
+     * @param indices Vertex indices to draw the primitive with, NULL to draw the vertices in order.
+     *                Indices are relative to the first vertex, the primitive type is always a list
+     * @param index_num Number of indices
+     * @param primitive_num Number of GX primitives batched into this one
+     */
+    virtual void EndPrimitive(u32 vbo_offset, u32 vertex_num, const u16* indices, 
+        u32 index_num, u32 primitive_num) = 0;
    
     /// Sets the render viewport location, width, and height
     virtual void SetViewport(int x, int y, int width, int height) = 0;
@@ -61,6 +61,9 @@ RendererGL3::RendererGL3() {
     resolution_width_ = 640;
     resolution_height_ = 480;
     vbo_handle_ = 0;
+    ibo_handle_ = 0;
+    ibo_offset_ = 0;
+    vertex_layout_ = NULL;
     last_mode_ = 0;
     blend_mode_ = 0;
     render_window_ = NULL;
@@ -117,10 +120,12 @@ void RendererGL3::VertexPosition_UseIndexXF(u8 index) {
  * Begin renderering of a primitive
  * @param prim Primitive type (e.g. GX_TRIANGLES)
  * @param count Number of vertices to be drawn (used for appropriate memory management, only)
+ * @param layout Packed layout of the vertices, valid until EndPrimitive
  * @param vbo Pointer to VBO, which will be set by API in this function
  * @param vbo_offset Offset into VBO to use (in bytes)
  */
-void RendererGL3::BeginPrimitive(GXPrimitive prim, int count, GXVertex** vbo, u32 vbo_offset) {
+void RendererGL3::BeginPrimitive(GXPrimitive prim, int count, const gp::VertexLayout& layout, 
+    u8** vbo, u32 vbo_offset) {
     // GL_QUADS is only suppported in compatibility mode. This is emulated in software by
     // converting to triangles (therefore, it should never be used). Alternatively, it works 
     // pretty well to emulate GX_QUADS via GL_LINES_ADJACENCY in a geometry shader.
@@ -130,9 +135,10 @@ void RendererGL3::BeginPrimitive(GXPrimitive prim, int count, GXVertex** vbo, u3
     // Set the renderer primitive type
     prim_type_ = prim;
     gl_prim_type_ = gl_types[(prim >> 3) - 16];
+    vertex_layout_ = &layout;
 
     // If no data sent, we are done here
-    if (0 == count) {
+    if (0 == count || 0 == layout.stride) {
         return;
     }
     // Update shader(s)
@@ -142,12 +148,16 @@ void RendererGL3::BeginPrimitive(GXPrimitive prim, int count, GXVertex** vbo, u3
     // Bind pointers to buffers
     glBindBuffer(GL_ARRAY_BUFFER, vbo_handle_);
 
-    // Map CPU to GPU mem
-    static GLbitfield access_flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
-        GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
-    *vbo = (GXVertex*)glMapBufferRange(GL_ARRAY_BUFFER, (vbo_offset * sizeof(GXVertex)), 
-        (count * sizeof(GXVertex)), access_flags);
-    if (vbo == NULL) {
+    // Map CPU to GPU mem, the VBO is orphaned when the vertex manager starts over at offset 0
+    GLbitfield access_flags = GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
+    if (0 == vbo_offset) {
+        access_flags |= GL_MAP_INVALIDATE_BUFFER_BIT;
+    } else {
+        access_flags |= GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    }
+    *vbo = (u8*)glMapBufferRange(GL_ARRAY_BUFFER, vbo_offset, (count * layout.stride), 
+        access_flags);
+    if (*vbo == NULL) {
         LOG_ERROR(TVIDEO, "Unable to map vertex buffer object to system mem!");
     }
 }
@@ -160,59 +170,83 @@ void RendererGL3::SetVertexState(const gp::VertexState& vertex_state) {
     vertex_state_ = vertex_state;
 }
 
+/**
+ * Point a vertex attribute at a component of the packed vertices, if the vertex format has it
+ * @param index Vertex attribute index
+ * @param size Number of values of the attribute
+ * @param type Type of the values
+ * @param stride Size of a packed vertex (in bytes)
+ * @param offset Offset of the component in the VBO (in bytes), ignored if component_offset is -1
+ * @param component_offset Offset of the component in the packed vertex, -1 if disabled
+ */
+static void SetVertexAttribPointer(GLuint index, GLint size, GLenum type, int stride, u32 offset,
+    int component_offset) {
+    if (component_offset < 0) {
+        return;
+    }
+    glEnableVertexAttribArray(index);
+    glVertexAttribPointer(index, size, type, GL_FALSE, stride, 
+        reinterpret_cast<void*>(offset + component_offset));
+}
+
 /// Draws a primitive from the previously decoded vertex array
-void RendererGL3::EndPrimitive(u32 vbo_offset, u32 vertex_num) {
+void RendererGL3::EndPrimitive(u32 vbo_offset, u32 vertex_num, const u16* indices, u32 index_num,
+    u32 primitive_num) {
 
     static GLuint gl_types[5] = {GL_UNSIGNED_BYTE, GL_BYTE, GL_UNSIGNED_SHORT, GL_SHORT, GL_FLOAT};
-    static GLuint gl_types_size[5] = {1, 1, 2, 2, 4};
 
     // Do nothing if no data sent
-    if (vertex_num == 0) {
+    if (vertex_num == 0 || 0 == vertex_layout_->stride) {
         return;
     }
+    const gp::VertexLayout& layout = *vertex_layout_;
+
+    _ASSERT_MSG(TVIDEO, (vbo_offset + vertex_num * layout.stride <= VBO_SIZE), 
+        "VBO is full! There is either a bug or it must be > %dMB!", 
+        (VBO_SIZE / 1048576));
+
 	glBindBuffer(GL_ARRAY_BUFFER, vbo_handle_);
+    glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, vertex_num * layout.stride);
     glUnmapBuffer(GL_ARRAY_BUFFER);
 
-    // Position
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, gl_types[vertex_state_.pos.comp_type], GL_FALSE, sizeof(GXVertex), 
-        reinterpret_cast<void*>(0));
-    // Color 0
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GXVertex), 
-        reinterpret_cast<void*>(12));
-    // Color 1
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GXVertex), 
-        reinterpret_cast<void*>(16));
-    // Normal
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 4, gl_types[vertex_state_.nrm.comp_type], GL_FALSE, sizeof(GXVertex), 
-        reinterpret_cast<void*>(20));
-    // TexCoords
+    // Attributes point into the packed vertices of this primitive, components the vertex format
+    // doesn't have are left disabled
+    SetVertexAttribPointer(0, 3, gl_types[vertex_state_.pos.comp_type], layout.stride, 
+        vbo_offset, layout.position);
+    SetVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, layout.stride, vbo_offset, layout.color[0]);
+    SetVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, layout.stride, vbo_offset, layout.color[1]);
+    SetVertexAttribPointer(3, 4, gl_types[vertex_state_.nrm.comp_type], layout.stride, 
+        vbo_offset, layout.normal);
     for (int i = 0; i < gp::g_xf_regs.num_texgen.num_texgens; i++) {
-        glEnableVertexAttribArray(i + 4);
-        glVertexAttribPointer(i + 4, 4, gl_types[vertex_state_.tex[i].comp_type], GL_FALSE, 
-            sizeof(GXVertex), reinterpret_cast<void*>(56 + (i * 8)));
+        SetVertexAttribPointer(i + 4, 2, gl_types[vertex_state_.tex[i].comp_type], layout.stride, 
+            vbo_offset, layout.texcoord[i]);
 	}
     // Position matrix index
-    glEnableVertexAttribArray(12);
-    glVertexAttribPointer(12, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GXVertex), 
-        reinterpret_cast<void*>(120));
-    // Texture coord 0-3 matrix index
-    glEnableVertexAttribArray(13);
-    glVertexAttribPointer(13, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GXVertex), 
-        reinterpret_cast<void*>(124));
-    // Texture coord 4-7 matrix index
-    glEnableVertexAttribArray(14);
-    glVertexAttribPointer(14, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GXVertex), 
-        reinterpret_cast<void*>(128));
-
-    glDrawArrays(gl_prim_type_, vbo_offset, vertex_num);
-
-    _ASSERT_MSG(TVIDEO, (vbo_offset < VBO_MAX_VERTS), 
-        "VBO is full! There is either a bug or it must be > %dMB!", 
-        (VBO_SIZE / 1048576));
+    SetVertexAttribPointer(12, 4, GL_UNSIGNED_BYTE, layout.stride, vbo_offset, layout.pm_idx);
+    // Texture coord 0-3 and 4-7 matrix indices
+    if (layout.tm_idx >= 0) {
+        SetVertexAttribPointer(13, 4, GL_UNSIGNED_BYTE, layout.stride, vbo_offset, 
+            layout.tm_idx);
+        SetVertexAttribPointer(14, 4, GL_UNSIGNED_BYTE, layout.stride, vbo_offset, 
+            layout.tm_idx + 4);
+    }
+
+    if (indices) {
+        u32 index_bytes = index_num * sizeof(u16);
+
+        // Stream the indices, orphaning the buffer when full instead of waiting on the GPU
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_handle_);
+        if (ibo_offset_ + index_bytes > IBO_SIZE) {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, IBO_SIZE, NULL, GL_STREAM_DRAW);
+            ibo_offset_ = 0;
+        }
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, ibo_offset_, index_bytes, indices);
+        glDrawElements(gl_prim_type_, index_num, GL_UNSIGNED_SHORT, 
+            reinterpret_cast<void*>(ibo_offset_));
+        ibo_offset_ += index_bytes;
+    } else {
+        glDrawArrays(gl_prim_type_, 0, vertex_num);
+    }
 
 	for (int i = 0; i < 15; i++) { 
 		glDisableVertexAttribArray(i);
@@ -684,6 +718,10 @@ void RendererGL3::Init() {
     glBindBuffer(GL_ARRAY_BUFFER, vbo_handle_);
     glBufferData(GL_ARRAY_BUFFER, VBO_SIZE, NULL, GL_DYNAMIC_DRAW);
 
+    glGenBuffers(1, &ibo_handle_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_handle_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, IBO_SIZE, NULL, GL_STREAM_DRAW);
+
     // Initialize everything else
     // --------------------------
 
@@ -33,7 +33,7 @@
 #include "renderer_base.h"
 #include "uniform_manager.h"
 
-#define VBO_MAX_VERTS               (VBO_SIZE / sizeof(GXVertex))     
+#define IBO_SIZE                    (1024 * 1024 * 2)
 #define MAX_FRAMEBUFFERS            2
 #define MAX_CACHED_TEXTURES         0x1000000
 
@@ -71,10 +71,12 @@ public:
      * Begin renderering of a primitive
      * @param prim Primitive type (e.g. GX_TRIANGLES)
      * @param count Number of vertices to be drawn (used for appropriate memory management, only)
+     * @param layout Packed layout of the vertices, valid until EndPrimitive
      * @param vbo Pointer to VBO, which will be set by API in this function
      * @param vbo_offset Offset into VBO to use (in bytes)
      */
-    void BeginPrimitive(GXPrimitive prim, int count, GXVertex** vbo, u32 vbo_offset);
+    void BeginPrimitive(GXPrimitive prim, int count, const gp::VertexLayout& layout, u8** vbo, 
+        u32 vbo_offset);
 
     /**
      * Set the current vertex state (format and count of each vertex component)
@@ -88,8 +90,16 @@ public:
      */
     void VertexPosition_UseIndexXF(u8 index);
 
-    /// End a primitive (signal renderer to draw it)
-    void EndPrimitive(u32 vbo_offset, u32 vertex_num);
+    /**
+     * End a primitive (signal renderer to draw it)
+     * @param vbo_offset Offset into VBO of the vertices (in bytes)
+     * @param vertex_num Number of vertices
+     * @param indices Vertex indices to draw the primitive with, NULL to draw the vertices in order
+     * @param index_num Number of indices
+     * @param primitive_num Number of GX primitives batched into this one
+     */
+    void EndPrimitive(u32 vbo_offset, u32 vertex_num, const u16* indices, u32 index_num, 
+        u32 primitive_num);
 
     /// Sets the renderer viewport location, width, and height
     void SetViewport(int x, int y, int width, int height);
@@ -223,6 +233,8 @@ private:
     // -------------------
 
     GLuint      vbo_handle_;                        ///< Handle of vertex buffer object
+    GLuint      ibo_handle_;                        ///< Handle of index buffer object
+    u32         ibo_offset_;                        ///< Offset of the next indices in the IBO
     GXPrimitive prim_type_;                         ///< GX primitive type (e.g. GX_QUADS)
     GLuint      gl_prim_type_;                      ///< OpenGL primitive type (e.g. GL_TRIANGLES)
     
@@ -230,6 +242,7 @@ private:
     // -------------------
 
     gp::VertexState vertex_state_;
+    const gp::VertexLayout* vertex_layout_;         ///< Layout of the current primitive
 
     // Video core stuff
     // ----------------
@@ -0,0 +1,178 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    renderer_null.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Renderer that draws nothing, for running the video core without a GL context
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include "common.h"
+
+#include "video_core.h"
+#include "vertex_manager.h"
+#include "renderer_null.h"
+#include "shader_interface.h"
+#include "texture_interface.h"
+
+/// RendererNull constructor
+RendererNull::RendererNull() {
+    render_window_ = NULL;
+    enable_checksums_ = false;
+    memset(&stats_, 0, sizeof(stats_));
+
+    // Cleared so the components a vertex format doesn't load hash the same on every run
+    vbo_ = new u8[VBO_SIZE];
+    memset(vbo_, 0, VBO_SIZE);
+    vertex_stride_ = 0;
+
+    shader_interface_ = new ShaderInterfaceNull(this);
+    texture_interface_ = new TextureInterfaceNull(this);
+}
+
+/// RendererNull destructor
+RendererNull::~RendererNull() {
+    delete[] vbo_;
+    delete shader_interface_;
+    delete texture_interface_;
+}
+
+void RendererNull::WriteBP(u8 addr, u32 data) {
+    stats_.bp_writes++;
+}
+
+void RendererNull::WriteCP(u8 addr, u32 data) {
+    stats_.cp_writes++;
+}
+
+void RendererNull::WriteXF(u16 addr, int length, u32* data) {
+    stats_.xf_writes += length;
+}
+
+/// Begin a primitive, the vertex loader writes straight into our buffer
+void RendererNull::BeginPrimitive(GXPrimitive prim, int count, const gp::VertexLayout& layout,
+    u8** vbo, u32 vbo_offset) {
+    if (0 == count) {
+        return;
+    }
+    // Keep the shader cache lookups, they are part of the CPU cost of a draw
+    video_core::g_shader_manager->Bind();
+
+    vertex_stride_ = layout.stride;
+    *vbo = vbo_ + vbo_offset;
+}
+
+void RendererNull::SetVertexState(const gp::VertexState& vertex_state) {
+}
+
+void RendererNull::VertexPosition_UseIndexXF(u8 index) {
+}
+
+/// End a primitive, the loaded vertices go into the vertex checksum
+void RendererNull::EndPrimitive(u32 vbo_offset, u32 vertex_num, const u16* indices,
+    u32 index_num, u32 primitive_num) {
+    if (vertex_num == 0) {
+        return;
+    }
+    _ASSERT_MSG(TVIDEO, (vbo_offset + vertex_num * vertex_stride_ <= VBO_SIZE), 
+        "VBO is full! There is either a bug or it must be > %dMB!", 
+        (VBO_SIZE / 1048576));
+
+    stats_.primitives += primitive_num;
+    stats_.draws++;
+    stats_.vertices += vertex_num;
+    if (indices) {
+        stats_.indices += index_num;
+    }
+    if (enable_checksums_) {
+        stats_.vertex_checksum = stats_.vertex_checksum * 33 + 
+            common::GetHash64(vbo_ + vbo_offset, vertex_num * vertex_stride_, 0);
+        if (indices) {
+            stats_.vertex_checksum = stats_.vertex_checksum * 33 + 
+                common::GetHash64((const u8*)indices, index_num * sizeof(u16), 0);
+        }
+    }
+}
+
+void RendererNull::SetViewport(int x, int y, int width, int height) {
+}
+
+/// Swap buffers, only counts the frame
+void RendererNull::SwapBuffers() {
+    current_frame_++;
+}
+
+void RendererNull::SetDepthRange(double znear, double zfar) {
+}
+
+void RendererNull::SetDepthMode() {
+}
+
+void RendererNull::SetGenerationMode() {
+}
+
+void RendererNull::SetBlendMode(const gp::BPPECMode0& pe_cmode_0,
+    const gp::BPPECMode1& pe_cmode_1, bool force_update) {
+}
+
+void RendererNull::SetLogicOpMode(const gp::BPPECMode0& pe_cmode_0) {
+}
+
+void RendererNull::SetDitherMode(const gp::BPPECMode0& pe_cmode_0) {
+}
+
+void RendererNull::SetColorMask(const gp::BPPECMode0& pe_cmode_0) {
+}
+
+void RendererNull::SetScissorBox(const Rect& rect) {
+}
+
+void RendererNull::SetLinePointSize(f32 line_width, f32 point_size) {
+}
+
+void RendererNull::CopyToXFB(const Rect& src_rect, const Rect& dst_rect) {
+    stats_.xfb_copies++;
+}
+
+void RendererNull::Clear(const Rect& rect, bool enable_color, bool enable_alpha, bool enable_z,
+    u32 color, u32 z) {
+    stats_.clears++;
+}
+
+void RendererNull::SetMode(kRenderMode flags) {
+}
+
+void RendererNull::RestoreMode(const gp::BPPECMode0& pe_cmode_0) {
+}
+
+void RendererNull::ResetRenderState() {
+}
+
+void RendererNull::RestoreRenderState() {
+}
+
+void RendererNull::SetWindow(EmuWindow* window) {
+    render_window_ = window;
+}
+
+void RendererNull::Init() {
+    LOG_NOTICE(TVIDEO, "null renderer initialized ok");
+}
+
+void RendererNull::ShutDown() {
+}
@@ -0,0 +1,127 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    renderer_null.h
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Renderer that draws nothing, for running the video core without a GL context
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef VIDEO_CORE_RENDERER_NULL_H_
+#define VIDEO_CORE_RENDERER_NULL_H_
+
+#include "common.h"
+#include "hash.h"
+#include "gx_types.h"
+#include "renderer_base.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Null Renderer
+
+/**
+ * Accepts everything the video core sends and does no GPU work. Command decode, vertex loading and
+ * texture decoding still run as usual, so this is what headless benchmarks run on. The calls are
+ * counted, and with checksums enabled the loaded vertices and decoded textures are hashed, so two
+ * runs of the same title can be compared to catch regressions in the CPU side of the pipeline.
+ */
+class RendererNull : virtual public RendererBase {
+public:
+
+    /// Counts of everything the video core sent
+    struct Statistics {
+        u64 bp_writes;
+        u64 cp_writes;
+        u64 xf_writes;
+        u64 primitives;
+        u64 draws;                          ///< Draw calls, primitives are batched into fewer
+        u64 vertices;
+        u64 indices;
+        u64 xfb_copies;
+        u64 efb_copies;
+        u64 clears;
+        u64 shaders_created;
+        u64 textures_created;
+        u64 texture_bytes;                  ///< Decoded RGBA8 bytes of created textures
+        common::Hash64 vertex_checksum;     ///< Hash of all vertices, if checksums are enabled
+        common::Hash64 texture_checksum;    ///< Hash of all created textures, if enabled
+    };
+
+    RendererNull();
+    ~RendererNull();
+
+    void WriteBP(u8 addr, u32 data);
+    void WriteCP(u8 addr, u32 data);
+    void WriteXF(u16 addr, int length, u32* data);
+
+    /**
+     * Begin renderering of a primitive, vertices are loaded into a system memory buffer
+     * @param prim Primitive type (e.g. GX_TRIANGLES)
+     * @param count Number of vertices to be drawn
+     * @param layout Packed layout of the vertices
+     * @param vbo Set to where the vertices are loaded to
+     * @param vbo_offset Offset into VBO to use (in bytes)
+     */
+    void BeginPrimitive(GXPrimitive prim, int count, const gp::VertexLayout& layout, u8** vbo,
+        u32 vbo_offset);
+
+    void SetVertexState(const gp::VertexState& vertex_state);
+    void VertexPosition_UseIndexXF(u8 index);
+    void EndPrimitive(u32 vbo_offset, u32 vertex_num, const u16* indices, u32 index_num,
+        u32 primitive_num);
+    void SetViewport(int x, int y, int width, int height);
+    void SwapBuffers();
+    void SetDepthRange(double znear, double zfar);
+    void SetDepthMode();
+    void SetGenerationMode();
+    void SetBlendMode(const gp::BPPECMode0& pe_cmode_0, const gp::BPPECMode1& pe_cmode_1,
+        bool force_update);
+    void SetLogicOpMode(const gp::BPPECMode0& pe_cmode_0);
+    void SetDitherMode(const gp::BPPECMode0& pe_cmode_0);
+    void SetColorMask(const gp::BPPECMode0& pe_cmode_0);
+    void SetScissorBox(const Rect& rect);
+    void SetLinePointSize(f32 line_width, f32 point_size);
+    void CopyToXFB(const Rect& src_rect, const Rect& dst_rect);
+    void Clear(const Rect& rect, bool enable_color, bool enable_alpha, bool enable_z,
+        u32 color, u32 z);
+    void SetMode(kRenderMode flags);
+    void RestoreMode(const gp::BPPECMode0& pe_cmode_0);
+    void ResetRenderState();
+    void RestoreRenderState();
+    void SetWindow(EmuWindow* window);
+    void Init();
+    void ShutDown();
+
+    const Statistics& stats() const { return stats_; }
+
+    bool enable_checksums() const { return enable_checksums_; }
+    void set_enable_checksums(bool val) { enable_checksums_ = val; }
+
+private:
+    friend class ShaderInterfaceNull;
+    friend class TextureInterfaceNull;
+
+    EmuWindow*  render_window_;
+    u8*         vbo_;                   ///< System memory stand-in for the VBO
+    int         vertex_stride_;         ///< Packed vertex size of the current primitive
+    Statistics  stats_;
+    bool        enable_checksums_;
+
+    DISALLOW_COPY_AND_ASSIGN(RendererNull);
+};
+
+#endif // VIDEO_CORE_RENDERER_NULL_H_
@@ -0,0 +1,50 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    shader_interface.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Null renderer shader interface, keeps the shader cache running without compiling
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include "common.h"
+
+#include "renderer_null.h"
+#include "shader_interface.h"
+
+ShaderInterfaceNull::ShaderInterfaceNull(RendererNull* parent) : parent_(parent) {
+}
+
+ShaderInterfaceNull::~ShaderInterfaceNull() {
+}
+
+/// Create a new shader, only counted
+ShaderManager::CacheEntry::BackendData* ShaderInterfaceNull::Create(const char* vs_header, 
+    const char* fs_header) {
+    parent_->stats_.shaders_created++;
+    return new ShaderManager::CacheEntry::BackendData();
+}
+
+/// Delete a shader from the backend renderer
+void ShaderInterfaceNull::Delete(ShaderManager::CacheEntry::BackendData* backend_data) {
+    delete backend_data;
+}
+
+/// Binds a shader to the backend renderer
+void ShaderInterfaceNull::Bind(const ShaderManager::CacheEntry::BackendData* backend_data) {
+}
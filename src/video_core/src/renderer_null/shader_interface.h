@@ -0,0 +1,69 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    shader_interface.h
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Null renderer shader interface, keeps the shader cache running without compiling
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef VIDEO_CORE_RENDERER_NULL_SHADER_INTERFACE_H_
+#define VIDEO_CORE_RENDERER_NULL_SHADER_INTERFACE_H_
+
+#include "shader_manager.h"
+
+class RendererNull;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Null shader interface implementation
+
+/// The shader manager still generates the headers for every TEV/XF state, they are just not compiled
+class ShaderInterfaceNull : virtual public ShaderManager::BackendInterface {
+public:
+
+    ShaderInterfaceNull(RendererNull* parent);
+    ~ShaderInterfaceNull();
+
+    /**
+     * Create a new shader in the backend renderer
+     * @param vs_header Vertex shader header definitions
+     * @param fs_header Fragment shader header definitions
+     * @return a pointer to CacheEntry::BackendData with renderer-specific shader data
+     */
+    ShaderManager::CacheEntry::BackendData* Create(const char* vs_header, const char* fs_header);
+
+    /**
+     * Delete a shader from the backend renderer
+     * @param backend_data Renderer-specific shader data used by renderer to remove it
+     */
+    void Delete(ShaderManager::CacheEntry::BackendData* backend_data);
+
+    /**
+     * Binds a shader to the backend renderer
+     * @param backend_data Pointer to renderer-specific data used for binding
+     */
+    void Bind(const ShaderManager::CacheEntry::BackendData* backend_data);
+
+private:
+
+    RendererNull* parent_;
+
+    DISALLOW_COPY_AND_ASSIGN(ShaderInterfaceNull);
+};
+
+#endif // VIDEO_CORE_RENDERER_NULL_SHADER_INTERFACE_H_
@@ -0,0 +1,74 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    texture_interface.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Null renderer texture interface, takes decoded textures without uploading them
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include "common.h"
+#include "hash.h"
+
+#include "renderer_null.h"
+#include "texture_interface.h"
+
+TextureInterfaceNull::TextureInterfaceNull(RendererNull* parent) : parent_(parent) {
+}
+
+TextureInterfaceNull::~TextureInterfaceNull() {
+}
+
+/// Create a new texture, the decoded RGBA8 data goes into the texture checksum
+TextureManager::CacheEntry::BackendData* TextureInterfaceNull::Create(int active_texture_unit, 
+    const TextureManager::CacheEntry& cache_entry, u8* raw_data) {
+    int size = cache_entry.width_ * cache_entry.height_ * 4;
+
+    // EFB copy targets have no data yet
+    if (raw_data == NULL) {
+        return new TextureManager::CacheEntry::BackendData();
+    }
+    parent_->stats_.textures_created++;
+    parent_->stats_.texture_bytes += size;
+    if (parent_->enable_checksums_) {
+        parent_->stats_.texture_checksum = parent_->stats_.texture_checksum * 33 + 
+            common::GetHash64(raw_data, size, 0);
+    }
+    return new TextureManager::CacheEntry::BackendData();
+}
+
+/// Delete a texture from the backend renderer
+void TextureInterfaceNull::Delete(TextureManager::CacheEntry::BackendData* backend_data) {
+    delete backend_data;
+}
+
+/// Update a texture with an EFB copy, only counted
+void TextureInterfaceNull::CopyEFB(const Rect& src_rect, const Rect& dst_rect,
+    const TextureManager::CacheEntry::BackendData* backend_data) {
+    parent_->stats_.efb_copies++;
+}
+
+/// Binds a texture to the backend renderer
+void TextureInterfaceNull::Bind(int active_texture_unit, 
+    const TextureManager::CacheEntry::BackendData* backend_data) {
+}
+
+/// Updates the texture parameters
+void TextureInterfaceNull::UpdateParameters(int active_texture_unit, 
+    const gp::BPTexMode0& tex_mode_0, const gp::BPTexMode1& tex_mode_1) {
+}
@@ -0,0 +1,690 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    rasterizer.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Tiled, multithreaded triangle rasterizer and pixel pipeline of the software renderer
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include <cmath>
+
+#include "common.h"
+
+#include "bp_mem.h"
+#include "rasterizer.h"
+
+static const f32 kCoordLimit = 65536.0f;   ///< Coordinates are clamped to this before int conversion
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pixel pipeline helpers
+
+/// Evaluate a plane equation at a pixel center
+static inline f32 EvalPlane(const SoftPlane& plane, f32 x, f32 y) {
+    return plane.dx * x + plane.dy * y + plane.c;
+}
+
+/// Compute the plane equation of a value given at the three vertices of a triangle
+static inline void SetupPlane(SoftPlane& plane, const SoftVertex* v[3], f32 f0, f32 f1, f32 f2,
+    f32 inv_area) {
+    const f32 x10 = v[1]->x - v[0]->x, y10 = v[1]->y - v[0]->y;
+    const f32 x20 = v[2]->x - v[0]->x, y20 = v[2]->y - v[0]->y;
+    plane.dx = ((f1 - f0) * y20 - (f2 - f0) * y10) * inv_area;
+    plane.dy = ((f2 - f0) * x10 - (f1 - f0) * x20) * inv_area;
+    plane.c = f0 - plane.dx * v[0]->x - plane.dy * v[0]->y;
+}
+
+/// Z compare, functions are ordered like GX_NEVER..GX_ALWAYS
+static inline bool DepthTest(int func, u32 z, u32 stored) {
+    switch (func) {
+    case 0: return false;
+    case 1: return z < stored;
+    case 2: return z == stored;
+    case 3: return z <= stored;
+    case 4: return z > stored;
+    case 5: return z != stored;
+    case 6: return z >= stored;
+    }
+    return true;
+}
+
+/// Alpha compare, functions are ordered like BPAlphaFunc::AlphaCompare
+static inline bool AlphaCompare(int func, int alpha, int ref) {
+    switch (func) {
+    case 0: return false;
+    case 1: return alpha < ref;
+    case 2: return alpha == ref;
+    case 3: return alpha <= ref;
+    case 4: return alpha > ref;
+    case 5: return alpha != ref;
+    case 6: return alpha >= ref;
+    }
+    return true;
+}
+
+/// Wrap a texel coordinate, mode is 0 - clamp, 1 - repeat, 2 - mirror
+static inline int WrapCoord(int i, int size, int mode) {
+    if (mode == 0) {
+        return CLAMP(i, 0, size - 1);
+    } else if (mode == 2) {
+        const int period = size * 2;
+        i %= period;
+        if (i < 0) {
+            i += period;
+        }
+        return (i < size) ? i : (period - 1 - i);
+    }
+    i %= size;
+    return (i < 0) ? (i + size) : i;
+}
+
+/// Sample a texture at normalized coordinates, untextured maps sample as white
+static void SampleTexture(const SoftSampler& sampler, f32 s, f32 t, int out[4]) {
+    const SoftTexture* texture = sampler.texture;
+    if (NULL == texture || NULL == texture->data) {
+        out[0] = out[1] = out[2] = out[3] = 255;
+        return;
+    }
+    const int w = texture->width;
+    const int h = texture->height;
+    f32 u = CLAMP(s * w, -kCoordLimit, kCoordLimit);
+    f32 v = CLAMP(t * h, -kCoordLimit, kCoordLimit);
+
+    if (!sampler.linear) {
+        const int x = WrapCoord((int)floorf(u), w, sampler.wrap_s);
+        const int y = WrapCoord((int)floorf(v), h, sampler.wrap_t);
+        const u8* texel = texture->data + (y * w + x) * 4;
+        out[0] = texel[0];
+        out[1] = texel[1];
+        out[2] = texel[2];
+        out[3] = texel[3];
+        return;
+    }
+    u -= 0.5f;
+    v -= 0.5f;
+    const f32 fu = floorf(u);
+    const f32 fv = floorf(v);
+    const int frac_u = (int)((u - fu) * 256.0f);
+    const int frac_v = (int)((v - fv) * 256.0f);
+    const int x0 = WrapCoord((int)fu, w, sampler.wrap_s);
+    const int x1 = WrapCoord((int)fu + 1, w, sampler.wrap_s);
+    const int y0 = WrapCoord((int)fv, h, sampler.wrap_t);
+    const int y1 = WrapCoord((int)fv + 1, h, sampler.wrap_t);
+    const u8* t00 = texture->data + (y0 * w + x0) * 4;
+    const u8* t01 = texture->data + (y0 * w + x1) * 4;
+    const u8* t10 = texture->data + (y1 * w + x0) * 4;
+    const u8* t11 = texture->data + (y1 * w + x1) * 4;
+    for (int i = 0; i < 4; i++) {
+        const int top = t00[i] * (256 - frac_u) + t01[i] * frac_u;
+        const int bottom = t10[i] * (256 - frac_u) + t11[i] * frac_u;
+        out[i] = (top * (256 - frac_v) + bottom * frac_v + 32768) >> 16;
+    }
+}
+
+/// Color input of a TEV stage, ordered like GX_CC_CPREV..GX_CC_ZERO
+static inline void TevColorInput(int sel, int regs[4][4], const int tex[4], const int ras[4],
+    const int konst[4], int out[3]) {
+    const int* src;
+    switch (sel) {
+    case 0: case 2: case 4: case 6:
+        src = regs[sel >> 1];
+        out[0] = src[0]; out[1] = src[1]; out[2] = src[2];
+        return;
+    case 1: case 3: case 5: case 7:
+        out[0] = out[1] = out[2] = regs[sel >> 1][3];
+        return;
+    case 8:
+        out[0] = tex[0]; out[1] = tex[1]; out[2] = tex[2];
+        return;
+    case 9:
+        out[0] = out[1] = out[2] = tex[3];
+        return;
+    case 10:
+        out[0] = ras[0]; out[1] = ras[1]; out[2] = ras[2];
+        return;
+    case 11:
+        out[0] = out[1] = out[2] = ras[3];
+        return;
+    case 12:
+        out[0] = out[1] = out[2] = 255;
+        return;
+    case 13:
+        out[0] = out[1] = out[2] = 128;
+        return;
+    case 14:
+        out[0] = konst[0]; out[1] = konst[1]; out[2] = konst[2];
+        return;
+    }
+    out[0] = out[1] = out[2] = 0;
+}
+
+/// Alpha input of a TEV stage, ordered like GX_CA_APREV..GX_CA_ZERO
+static inline int TevAlphaInput(int sel, int regs[4][4], const int tex[4], const int ras[4],
+    const int konst[4]) {
+    switch (sel) {
+    case 0: case 1: case 2: case 3:
+        return regs[sel][3];
+    case 4:
+        return tex[3];
+    case 5:
+        return ras[3];
+    case 6:
+        return konst[3];
+    }
+    return 0;
+}
+
+/**
+ * The TEV combiner equation, done like the hardware: a, b and c are 8-bit, d and the result have
+ * the 11-bit signed range of the TEV registers
+ */
+static inline int TevCombine(int a, int b, int c, int d, int bias, int sub, int clamp, int shift) {
+    a &= 0xFF;
+    b &= 0xFF;
+    c &= 0xFF;
+    c += (c >> 7);
+    const int lerp = (a * (256 - c) + b * c) >> 8;
+    int result = (sub ? (d - lerp) : (d + lerp)) + bias;
+    switch (shift) {
+    case 1: result <<= 1; break;
+    case 2: result <<= 2; break;
+    case 3: result >>= 1; break;
+    }
+    return clamp ? CLAMP(result, 0, 255) : CLAMP(result, -1024, 1023);
+}
+
+/// Blend factor of a channel, src_factor selects between the source and destination factor tables
+static inline int BlendFactor(int sel, bool src_factor, const int src[4], int src_alpha,
+    const u8* dst, int channel, bool efb_alpha) {
+    switch (sel) {
+    case 0: return 0;
+    case 1: return 255;
+    case 2: return src_factor ? dst[channel] : src[channel];
+    case 3: return 255 - (src_factor ? dst[channel] : src[channel]);
+    case 4: return src_alpha;
+    case 5: return 255 - src_alpha;
+    case 6: return efb_alpha ? dst[3] : 255;
+    case 7: return efb_alpha ? (255 - dst[3]) : 0;
+    }
+    return 0;
+}
+
+/// Logic op, ops are ordered like GX_LO_CLEAR..GX_LO_SET
+static inline int LogicOp(int op, int src, int dst) {
+    switch (op) {
+    case 0:  return 0;
+    case 1:  return src & dst;
+    case 2:  return src & ~dst;
+    case 3:  return src;
+    case 4:  return ~src & dst;
+    case 5:  return dst;
+    case 6:  return src ^ dst;
+    case 7:  return src | dst;
+    case 8:  return ~(src | dst);
+    case 9:  return ~(src ^ dst);
+    case 10: return ~dst;
+    case 11: return src | ~dst;
+    case 12: return ~src;
+    case 13: return ~src | dst;
+    case 14: return ~(src & dst);
+    }
+    return 0xFF;
+}
+
+/**
+ * Run the TEV stages and the alpha test of a pixel
+ * @param state Draw state
+ * @param colors Rasterized color channels
+ * @param texcoords Interpolated texture coordinates
+ * @param out Resulting RGBA color
+ * @return True if the pixel passed the alpha test
+ */
+static bool ShadePixel(const SoftDrawState& state, const int colors[2][4], const f32* texcoords,
+    int out[4]) {
+    static const int zero[4] = { 0, 0, 0, 0 };
+    int regs[4][4];
+    int tex[4];
+    int a[3], b[3], c[3], d[3];
+    int result[4] = { 0, 0, 0, 0 };
+
+    memcpy(regs, state.registers, sizeof(regs));
+
+    for (int i = 0; i < state.num_stages; i++) {
+        const SoftTevStage& stage = state.stages[i];
+        const int* ras = (stage.ras < 0) ? zero : colors[stage.ras];
+
+        if (stage.texmap >= 0) {
+            if (stage.texcoord >= 0) {
+                SampleTexture(state.samplers[stage.texmap], texcoords[stage.texcoord * 2],
+                    texcoords[stage.texcoord * 2 + 1], tex);
+            } else {
+                SampleTexture(state.samplers[stage.texmap], 0.0f, 0.0f, tex);
+            }
+        } else {
+            tex[0] = tex[1] = tex[2] = tex[3] = 255;
+        }
+
+        TevColorInput(stage.color_sel[0], regs, tex, ras, stage.konst, a);
+        TevColorInput(stage.color_sel[1], regs, tex, ras, stage.konst, b);
+        TevColorInput(stage.color_sel[2], regs, tex, ras, stage.konst, c);
+        TevColorInput(stage.color_sel[3], regs, tex, ras, stage.konst, d);
+        for (int j = 0; j < 3; j++) {
+            result[j] = TevCombine(a[j], b[j], c[j], d[j], stage.color_bias, stage.color_sub,
+                stage.color_clamp, stage.color_shift);
+        }
+        result[3] = TevCombine(
+            TevAlphaInput(stage.alpha_sel[0], regs, tex, ras, stage.konst),
+            TevAlphaInput(stage.alpha_sel[1], regs, tex, ras, stage.konst),
+            TevAlphaInput(stage.alpha_sel[2], regs, tex, ras, stage.konst),
+            TevAlphaInput(stage.alpha_sel[3], regs, tex, ras, stage.konst),
+            stage.alpha_bias, stage.alpha_sub, stage.alpha_clamp, stage.alpha_shift);
+
+        regs[stage.color_dest][0] = result[0];
+        regs[stage.color_dest][1] = result[1];
+        regs[stage.color_dest][2] = result[2];
+        regs[stage.alpha_dest][3] = result[3];
+    }
+    // The output of the last stage is wrapped to 8 bits
+    for (int j = 0; j < 4; j++) {
+        out[j] = result[j] & 0xFF;
+    }
+
+    const bool pass0 = AlphaCompare(state.alpha_comp[0], out[3], state.alpha_ref[0]);
+    const bool pass1 = AlphaCompare(state.alpha_comp[1], out[3], state.alpha_ref[1]);
+    switch (state.alpha_logic) {
+    case 0: return pass0 && pass1;
+    case 1: return pass0 || pass1;
+    case 2: return pass0 != pass1;
+    }
+    return pass0 == pass1;
+}
+
+/// Blend a shaded pixel into the EFB, applying the EFB format and the write masks
+static void WritePixel(const SoftDrawState& state, const int tev[4], u8* dst) {
+    int src[4] = { tev[0], tev[1], tev[2], state.dst_alpha_enable ? state.dst_alpha : tev[3] };
+    int result[4];
+
+    switch (state.pixel_format) {
+    case gp::kPixelFormat_RGBA6_Z24:
+        for (int i = 0; i < 4; i++) {
+            src[i] = (src[i] & 0xFC) | (src[i] >> 6);
+        }
+        break;
+    case gp::kPixelFormat_RGB565_Z16:
+        src[0] = (src[0] & 0xF8) | (src[0] >> 5);
+        src[1] = (src[1] & 0xFC) | (src[1] >> 6);
+        src[2] = (src[2] & 0xF8) | (src[2] >> 5);
+        src[3] = 255;
+        break;
+    default:
+        src[3] = 255;
+        break;
+    }
+
+    if (state.logic_op >= 0) {
+        for (int i = 0; i < 4; i++) {
+            result[i] = LogicOp(state.logic_op, src[i], dst[i]) & 0xFF;
+        }
+    } else if (state.blend_subtract) {
+        for (int i = 0; i < 4; i++) {
+            result[i] = MAX(dst[i] - src[i], 0);
+        }
+    } else if (state.blend_enable) {
+        // Blending uses the TEV alpha, even if the destination alpha replaces the written alpha
+        const int src_alpha = tev[3];
+        for (int i = 0; i < 4; i++) {
+            if (i == 3 && state.dst_alpha_enable) {
+                result[i] = src[i];
+                break;
+            }
+            const int sf = BlendFactor(state.blend_src, true, src, src_alpha, dst, i,
+                state.efb_alpha != 0);
+            const int df = BlendFactor(state.blend_dst, false, src, src_alpha, dst, i,
+                state.efb_alpha != 0);
+            const int value = (src[i] * sf + dst[i] * df + 127) / 255;
+            result[i] = MIN(value, 255);
+        }
+    } else {
+        memcpy(result, src, sizeof(result));
+    }
+
+    if (state.color_update) {
+        dst[0] = result[0];
+        dst[1] = result[1];
+        dst[2] = result[2];
+    }
+    if (state.alpha_update) {
+        dst[3] = result[3];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// RasterizerSoft
+
+RasterizerSoft::RasterizerSoft() {
+    color_buffer_ = new u8[kGCEFBWidth * kGCEFBHeight * 4];
+    depth_buffer_ = new u32[kGCEFBWidth * kGCEFBHeight];
+    memset(color_buffer_, 0, kGCEFBWidth * kGCEFBHeight * 4);
+    memset(depth_buffer_, 0, kGCEFBWidth * kGCEFBHeight * sizeof(u32));
+    memset(threads_, 0, sizeof(threads_));
+
+    num_threads_ = 1;
+    generation_ = 0;
+    next_tile_ = 0;
+    busy_threads_ = 0;
+    quit_ = false;
+
+    triangles_.reserve(kSoftMaxTriangles);
+}
+
+RasterizerSoft::~RasterizerSoft() {
+    ShutDown();
+    delete[] color_buffer_;
+    delete[] depth_buffer_;
+}
+
+void RasterizerSoft::Init(int num_threads) {
+    num_threads_ = CLAMP(num_threads, 1, kSoftMaxThreads);
+    quit_ = false;
+
+    // The calling thread rasterizes too, so one less worker is needed
+    for (int i = 1; i < num_threads_; i++) {
+        threads_[i] = new std::thread(WorkerThread, this);
+    }
+}
+
+void RasterizerSoft::ShutDown() {
+    Flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+        work_cv_.notify_all();
+    }
+    for (int i = 1; i < num_threads_; i++) {
+        if (threads_[i]) {
+            threads_[i]->join();
+            delete threads_[i];
+            threads_[i] = NULL;
+        }
+    }
+    num_threads_ = 1;
+}
+
+void RasterizerSoft::SetDrawState(const SoftDrawState& state) {
+    if (states_.empty() || memcmp(&states_.back(), &state, sizeof(SoftDrawState))) {
+        states_.push_back(state);
+    }
+}
+
+void RasterizerSoft::DrawTriangle(const SoftVertex& v0, const SoftVertex& v1, const SoftVertex& v2,
+    int cull_mode, const Rect& scissor) {
+
+    _ASSERT_MSG(TVIDEO, !states_.empty(), "Triangle queued without a draw state!");
+
+    // Window coordinates have y going up, so a positive area is counter-clockwise
+    f32 area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (!(area != 0.0f) || cull_mode == 3 || (cull_mode == 1 && area > 0.0f) ||
+        (cull_mode == 2 && area < 0.0f)) {
+        return;
+    }
+    const SoftVertex* v[3] = { &v0, &v1, &v2 };
+    if (area < 0.0f) {
+        v[1] = &v2;
+        v[2] = &v1;
+        area = -area;
+    }
+
+    // Bounding box of the pixel centers inside the triangle
+    f32 min_x = MIN(MIN(v[0]->x, v[1]->x), v[2]->x);
+    f32 max_x = MAX(MAX(v[0]->x, v[1]->x), v[2]->x);
+    f32 min_y = MIN(MIN(v[0]->y, v[1]->y), v[2]->y);
+    f32 max_y = MAX(MAX(v[0]->y, v[1]->y), v[2]->y);
+    min_x = CLAMP(min_x, -kCoordLimit, kCoordLimit);
+    max_x = CLAMP(max_x, -kCoordLimit, kCoordLimit);
+    min_y = CLAMP(min_y, -kCoordLimit, kCoordLimit);
+    max_y = CLAMP(max_y, -kCoordLimit, kCoordLimit);
+
+    SoftTriangle tri;
+    tri.min_x = MAX((int)ceilf(min_x - 0.5f), scissor.x0_);
+    tri.min_y = MAX((int)ceilf(min_y - 0.5f), scissor.y0_);
+    tri.max_x = MIN((int)floorf(max_x - 0.5f) + 1, scissor.x1_);
+    tri.max_y = MIN((int)floorf(max_y - 0.5f) + 1, scissor.y1_);
+    if (tri.min_x >= tri.max_x || tri.min_y >= tri.max_y) {
+        return;
+    }
+    tri.state = states_.size() - 1;
+
+    // Edge functions are positive inside, pixels exactly on an edge belong to only one of the two
+    // triangles that share it
+    for (int i = 0; i < 3; i++) {
+        const SoftVertex* a = v[i];
+        const SoftVertex* b = v[(i + 1) % 3];
+        SoftPlane& edge = tri.edges[i];
+        edge.dx = -(b->y - a->y);
+        edge.dy = b->x - a->x;
+        edge.c = -(edge.dx * a->x + edge.dy * a->y);
+        tri.edge_inclusive[i] = (edge.dx > 0.0f) || (edge.dx == 0.0f && edge.dy > 0.0f);
+    }
+
+    const f32 inv_area = 1.0f / area;
+    SetupPlane(tri.z, v, v[0]->z, v[1]->z, v[2]->z, inv_area);
+    SetupPlane(tri.inv_w, v, v[0]->inv_w, v[1]->inv_w, v[2]->inv_w, inv_area);
+    tri.num_attribs = kSoftAttrib_TexCoord + 2 * states_.back().num_texgens;
+    for (int i = 0; i < tri.num_attribs; i++) {
+        SetupPlane(tri.attribs[i], v, v[0]->attribs[i], v[1]->attribs[i], v[2]->attribs[i],
+            inv_area);
+    }
+
+    const u32 index = triangles_.size();
+    triangles_.push_back(tri);
+
+    // Bin into every tile the triangle may cover, tiles entirely outside an edge are skipped
+    const int tile_x0 = tri.min_x / kSoftTileSize;
+    const int tile_x1 = (tri.max_x - 1) / kSoftTileSize;
+    const int tile_y0 = tri.min_y / kSoftTileSize;
+    const int tile_y1 = (tri.max_y - 1) / kSoftTileSize;
+    for (int ty = tile_y0; ty <= tile_y1; ty++) {
+        for (int tx = tile_x0; tx <= tile_x1; tx++) {
+            const f32 x0 = (f32)(tx * kSoftTileSize) + 0.5f;
+            const f32 y0 = (f32)(ty * kSoftTileSize) + 0.5f;
+            const f32 x1 = x0 + (kSoftTileSize - 1);
+            const f32 y1 = y0 + (kSoftTileSize - 1);
+            bool outside = false;
+            for (int i = 0; i < 3; i++) {
+                const SoftPlane& edge = tri.edges[i];
+                if (EvalPlane(edge, (edge.dx > 0.0f) ? x1 : x0, (edge.dy > 0.0f) ? y1 : y0) < 0.0f) {
+                    outside = true;
+                    break;
+                }
+            }
+            if (!outside) {
+                bins_[ty * kSoftTilesX + tx].push_back(index);
+            }
+        }
+    }
+
+    if (triangles_.size() >= (size_t)kSoftMaxTriangles) {
+        Flush();
+    }
+}
+
+void RasterizerSoft::Flush() {
+    if (triangles_.empty()) {
+        return;
+    }
+    if (num_threads_ > 1) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        next_tile_ = 0;
+        busy_threads_ = num_threads_ - 1;
+        generation_++;
+        work_cv_.notify_all();
+        lock.unlock();
+
+        ProcessTiles();
+
+        lock.lock();
+        while (busy_threads_ > 0) {
+            done_cv_.wait(lock);
+        }
+    } else {
+        next_tile_ = 0;
+        ProcessTiles();
+    }
+
+    for (int i = 0; i < kSoftTilesX * kSoftTilesY; i++) {
+        bins_[i].clear();
+    }
+    triangles_.clear();
+
+    // Only the current state is still needed
+    if (states_.size() > 1) {
+        states_.front() = states_.back();
+        states_.resize(1);
+    }
+}
+
+void RasterizerSoft::Clear(const Rect& rect, bool enable_color, bool enable_alpha, bool enable_z,
+    u32 color, u32 z) {
+    Flush();
+
+    const u8 r = (color >> 16) & 0xFF;
+    const u8 g = (color >> 8) & 0xFF;
+    const u8 b = color & 0xFF;
+    const u8 a = (color >> 24) & 0xFF;
+    const int x0 = MAX(rect.x0_, 0);
+    const int y0 = MAX(rect.y0_, 0);
+    const int x1 = MIN(rect.x1_, kGCEFBWidth);
+    const int y1 = MIN(rect.y1_, kGCEFBHeight);
+
+    for (int y = y0; y < y1; y++) {
+        u8* dst = color_buffer_ + (y * kGCEFBWidth + x0) * 4;
+        u32* depth = depth_buffer_ + y * kGCEFBWidth + x0;
+        for (int x = x0; x < x1; x++, dst += 4, depth++) {
+            if (enable_color) {
+                dst[0] = r;
+                dst[1] = g;
+                dst[2] = b;
+            }
+            if (enable_alpha) {
+                dst[3] = a;
+            }
+            if (enable_z) {
+                *depth = z & 0xFFFFFF;
+            }
+        }
+    }
+}
+
+void RasterizerSoft::WorkerThread(RasterizerSoft* rasterizer) {
+    u32 generation = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(rasterizer->mutex_);
+            while (!rasterizer->quit_ && rasterizer->generation_ == generation) {
+                rasterizer->work_cv_.wait(lock);
+            }
+            if (rasterizer->quit_) {
+                return;
+            }
+            generation = rasterizer->generation_;
+        }
+        rasterizer->ProcessTiles();
+        {
+            std::lock_guard<std::mutex> lock(rasterizer->mutex_);
+            if (--rasterizer->busy_threads_ == 0) {
+                rasterizer->done_cv_.notify_one();
+            }
+        }
+    }
+}
+
+void RasterizerSoft::ProcessTiles() {
+    for (;;) {
+        int tile;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (next_tile_ >= kSoftTilesX * kSoftTilesY) {
+                return;
+            }
+            tile = next_tile_++;
+        }
+        const std::vector<u32>& bin = bins_[tile];
+        const int x0 = (tile % kSoftTilesX) * kSoftTileSize;
+        const int y0 = (tile / kSoftTilesX) * kSoftTileSize;
+        for (size_t i = 0; i < bin.size(); i++) {
+            DrawTriangleTile(triangles_[bin[i]], x0, y0);
+        }
+    }
+}
+
+void RasterizerSoft::DrawTriangleTile(const SoftTriangle& tri, int x0, int y0) {
+    const SoftDrawState& state = states_[tri.state];
+    const int start_x = MAX(tri.min_x, x0);
+    const int start_y = MAX(tri.min_y, y0);
+    const int end_x = MIN(tri.max_x, x0 + kSoftTileSize);
+    const int end_y = MIN(tri.max_y, y0 + kSoftTileSize);
+    const int num_texcoords = tri.num_attribs - kSoftAttrib_TexCoord;
+    int colors[2][4];
+    int tev[4];
+    f32 texcoords[2 * kGCMaxActiveTextures];
+
+    for (int y = start_y; y < end_y; y++) {
+        const f32 py = (f32)y + 0.5f;
+        for (int x = start_x; x < end_x; x++) {
+            const f32 px = (f32)x + 0.5f;
+
+            bool inside = true;
+            for (int i = 0; i < 3; i++) {
+                const f32 e = EvalPlane(tri.edges[i], px, py);
+                if (e < 0.0f || (e == 0.0f && !tri.edge_inclusive[i])) {
+                    inside = false;
+                    break;
+                }
+            }
+            if (!inside) {
+                continue;
+            }
+            const int offset = y * kGCEFBWidth + x;
+
+            // The Z test is done before texturing, but Z is only written once the alpha test passed
+            f32 z = EvalPlane(tri.z, px, py);
+            z = CLAMP(z, 0.0f, 1.0f);
+            const u32 depth = (u32)(z * 16777215.0f);
+            if (state.z_test && !DepthTest(state.z_func, depth, depth_buffer_[offset])) {
+                continue;
+            }
+
+            const f32 w = 1.0f / EvalPlane(tri.inv_w, px, py);
+            for (int i = 0; i < 8; i++) {
+                const int value = (int)(EvalPlane(tri.attribs[i], px, py) * w + 0.5f);
+                colors[i >> 2][i & 3] = CLAMP(value, 0, 255);
+            }
+            for (int i = 0; i < num_texcoords; i++) {
+                texcoords[i] = EvalPlane(tri.attribs[kSoftAttrib_TexCoord + i], px, py) * w;
+            }
+
+            if (!ShadePixel(state, colors, texcoords, tev)) {
+                continue;
+            }
+            if (state.z_test && state.z_update) {
+                depth_buffer_[offset] = depth;
+            }
+            WritePixel(state, tev, color_buffer_ + offset * 4);
+        }
+    }
+}
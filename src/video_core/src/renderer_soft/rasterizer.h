@@ -0,0 +1,248 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    rasterizer.h
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Tiled, multithreaded triangle rasterizer and pixel pipeline of the software renderer
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef VIDEO_CORE_RENDERER_SOFT_RASTERIZER_H_
+#define VIDEO_CORE_RENDERER_SOFT_RASTERIZER_H_
+
+#include <vector>
+
+#include "common.h"
+#include "std_thread.h"
+#include "std_mutex.h"
+#include "std_condition_variable.h"
+
+#include "gx_types.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Software rasterizer types
+
+static const int kSoftTileSize      = 32;   ///< Width/height of a tile (in pixels)
+static const int kSoftTilesX        = (kGCEFBWidth + kSoftTileSize - 1) / kSoftTileSize;
+static const int kSoftTilesY        = (kGCEFBHeight + kSoftTileSize - 1) / kSoftTileSize;
+static const int kSoftMaxThreads    = 64;   ///< Upper limit of rasterizer threads
+static const int kSoftMaxTriangles  = 32768;///< Queued triangles that force a flush
+
+/// Interpolated attributes: color 0 RGBA, color 1 RGBA, then S/T of each texgen
+static const int kSoftAttrib_Color0     = 0;
+static const int kSoftAttrib_Color1     = 4;
+static const int kSoftAttrib_TexCoord   = 8;
+static const int kSoftMaxAttribs        = kSoftAttrib_TexCoord + 2 * kGCMaxActiveTextures;
+
+/// Decoded RGBA8 texture, rows are stored top to bottom
+struct SoftTexture {
+    int width;
+    int height;
+    u8* data;
+};
+
+/// Texture and sampler state of a texture map
+struct SoftSampler {
+    const SoftTexture* texture;     ///< NULL if nothing is bound, samples as white
+    int wrap_s;                     ///< 0 - clamp, 1 - repeat, 2 - mirror
+    int wrap_t;
+    int linear;                     ///< Bilinear filtering if set, otherwise nearest
+};
+
+/// One TEV stage, decoded so the per-pixel code doesn't have to look at BP registers
+struct SoftTevStage {
+    int color_sel[4];               ///< Color inputs a, b, c, d
+    int color_bias;                 ///< Bias added to the result (0, 128 or -128)
+    int color_sub;
+    int color_clamp;
+    int color_shift;
+    int color_dest;
+    int alpha_sel[4];               ///< Alpha inputs a, b, c, d
+    int alpha_bias;
+    int alpha_sub;
+    int alpha_clamp;
+    int alpha_shift;
+    int alpha_dest;
+    int texmap;                     ///< Texture map sampled by the stage, -1 if none
+    int texcoord;                   ///< Texcoord used for the sample
+    int ras;                        ///< Rasterized color, 0 or 1 for the color channels, -1 for 0
+    int konst[4];                   ///< Konst color (RGB) and alpha selected for the stage
+};
+
+/**
+ * Pixel pipeline state of a draw. Captured for every primitive and shared by all triangles until it
+ * changes, so the tiles can be rasterized long after the registers have been overwritten. This is
+ * compared with memcmp, so it must be cleared before it is filled in.
+ */
+struct SoftDrawState {
+    int             num_stages;
+    SoftTevStage    stages[kGCMaxTevStages];
+    int             registers[4][4];        ///< Initial TEV registers (prev, c0, c1, c2) RGBA
+    int             num_texgens;
+
+    int             alpha_comp[2];
+    int             alpha_ref[2];
+    int             alpha_logic;
+
+    int             z_test;
+    int             z_func;
+    int             z_update;
+
+    int             blend_enable;
+    int             blend_subtract;
+    int             blend_src;
+    int             blend_dst;
+    int             logic_op;               ///< -1 if logic ops are disabled
+    int             color_update;
+    int             alpha_update;
+    int             dst_alpha_enable;
+    int             dst_alpha;
+    int             pixel_format;
+    int             efb_alpha;
+
+    SoftSampler     samplers[kGCMaxTextureMaps];
+};
+
+/// Vertex in window coordinates, attributes are divided by w for perspective correction
+struct SoftVertex {
+    f32 x, y, z;
+    f32 inv_w;
+    f32 attribs[kSoftMaxAttribs];
+};
+
+/// Plane equation of a value over the screen, value = dx * x + dy * y + c
+struct SoftPlane {
+    f32 dx, dy, c;
+};
+
+/// Triangle after setup, ready to be rasterized in any tile it touches
+struct SoftTriangle {
+    u32         state;                      ///< Index of the SoftDrawState it's drawn with
+    int         min_x, min_y;               ///< Bounding box, clipped to the scissor box
+    int         max_x, max_y;               ///< (exclusive)
+    SoftPlane   edges[3];                   ///< Edge functions, positive inside
+    int         edge_inclusive[3];          ///< Set if pixels exactly on the edge are drawn
+    SoftPlane   z;
+    SoftPlane   inv_w;
+    int         num_attribs;
+    SoftPlane   attribs[kSoftMaxAttribs];   ///< Attributes divided by w
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Software rasterizer
+
+/**
+ * Owns the EFB and draws triangles into it. Triangles are queued and binned into 32x32 pixel tiles,
+ * on a flush each tile is rasterized by one thread, which draws its triangles in the order they
+ * were queued. Tiles don't share pixels, so the output is the same for any number of threads.
+ * The EFB is stored bottom up like a GL framebuffer, so XFB copies come out in the row order
+ * video_core::DumpTGA expects.
+ */
+class RasterizerSoft {
+public:
+
+    RasterizerSoft();
+    ~RasterizerSoft();
+
+    /**
+     * Start the worker threads
+     * @param num_threads Number of threads rasterizing tiles, including the calling thread
+     */
+    void Init(int num_threads);
+
+    /// Finish queued work and stop the worker threads
+    void ShutDown();
+
+    /**
+     * Set the pixel pipeline state for triangles queued after this
+     * @param state New draw state, only stored if it differs from the current one
+     */
+    void SetDrawState(const SoftDrawState& state);
+
+    /**
+     * Set up a triangle and queue it in the tiles it touches
+     * @param v0 First vertex
+     * @param v1 Second vertex
+     * @param v2 Third vertex
+     * @param cull_mode 0 - none, 1 - counter-clockwise, 2 - clockwise, 3 - all
+     * @param scissor Scissor box in EFB pixels, bottom left inclusive, top right exclusive
+     */
+    void DrawTriangle(const SoftVertex& v0, const SoftVertex& v1, const SoftVertex& v2,
+        int cull_mode, const Rect& scissor);
+
+    /// Rasterize all queued triangles, returns once the EFB is up to date
+    void Flush();
+
+    /**
+     * Clear a region of the EFB, queued triangles are drawn first
+     * @param rect Region to clear, bottom left inclusive, top right exclusive
+     * @param enable_color Clear the RGB channels
+     * @param enable_alpha Clear the alpha channel
+     * @param enable_z Clear the depth buffer
+     * @param color ARGB8 clear color
+     * @param z 24-bit clear depth
+     */
+    void Clear(const Rect& rect, bool enable_color, bool enable_alpha, bool enable_z,
+        u32 color, u32 z);
+
+    /// Number of threads used to rasterize
+    int num_threads() const { return num_threads_; }
+
+    /// EFB color buffer, RGBA8, bottom row first
+    const u8* color_buffer() const { return color_buffer_; }
+
+    /// EFB depth buffer, 24-bit, bottom row first
+    const u32* depth_buffer() const { return depth_buffer_; }
+
+private:
+
+    /// Worker thread entry point
+    static void WorkerThread(RasterizerSoft* rasterizer);
+
+    /// Rasterize tiles until none are left in the current flush
+    void ProcessTiles();
+
+    /**
+     * Draw the part of a triangle inside a tile
+     * @param tri Triangle to draw
+     * @param x0 Tile left edge
+     * @param y0 Tile bottom edge
+     */
+    void DrawTriangleTile(const SoftTriangle& tri, int x0, int y0);
+
+    std::vector<SoftTriangle>   triangles_;
+    std::vector<SoftDrawState>  states_;
+    std::vector<u32>            bins_[kSoftTilesX * kSoftTilesY];   ///< Triangle indices per tile
+
+    u8*     color_buffer_;
+    u32*    depth_buffer_;
+
+    std::thread*            threads_[kSoftMaxThreads];
+    int                     num_threads_;
+    std::mutex              mutex_;
+    std::condition_variable work_cv_;       ///< Signaled when a flush starts or on shutdown
+    std::condition_variable done_cv_;       ///< Signaled when the last tile of a flush is done
+    u32                     generation_;    ///< Incremented on every flush
+    int                     next_tile_;     ///< Next tile to be picked up
+    int                     busy_threads_;  ///< Threads still working on the current flush
+    bool                    quit_;
+
+    DISALLOW_COPY_AND_ASSIGN(RasterizerSoft);
+};
+
+#endif // VIDEO_CORE_RENDERER_SOFT_RASTERIZER_H_
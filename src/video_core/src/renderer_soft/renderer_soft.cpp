@@ -0,0 +1,1045 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    renderer_soft.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Software renderer, draws into a system memory EFB without a GL context
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include <cmath>
+
+#include "common.h"
+#include "file_utils.h"
+#include "misc_utils.h"
+
+#include "video_core.h"
+#include "vertex_manager.h"
+#include "bp_mem.h"
+#include "cp_mem.h"
+#include "xf_mem.h"
+#include "utils.h"
+#include "renderer_soft.h"
+#include "shader_interface.h"
+#include "texture_interface.h"
+
+/// Triangles are clipped to this multiple of the viewport, the rasterizer scissors the rest
+static const f32 kGuardBand = 4.0f;
+
+/// Smallest w a vertex can have after clipping
+static const f32 kMinW = 1e-5f;
+
+/// Number of planes triangles are clipped against
+static const int kNumClipPlanes = 7;
+
+/// Maximum number of vertices of a triangle after clipping against all planes
+static const int kMaxClipVertices = 3 + kNumClipPlanes;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Transform helpers
+
+/// Read a vertex component as loaded by the vertex loader (host endian, packed by type)
+static inline f32 ReadComponent(const u8* data, int type, int index) {
+    switch (type) {
+    case GX_U8:  return (f32)data[index];
+    case GX_S8:  return (f32)((const s8*)data)[index];
+    case GX_U16: return (f32)((const u16*)data)[index];
+    case GX_S16: return (f32)((const s16*)data)[index];
+    }
+    return ((const f32*)data)[index];
+}
+
+/// Decode a vertex color to RGBA in the range 0-1
+static void DecodeVertexColor(const u8* data, int type, f32 out[4]) {
+    int r, g, b, a = 255;
+    switch (type) {
+    case GX_RGB565:
+        {
+            const u16 color = *(const u16*)data;
+            r = (color >> 11) & 0x1F;
+            g = (color >> 5) & 0x3F;
+            b = color & 0x1F;
+            r = (r << 3) | (r >> 2);
+            g = (g << 2) | (g >> 4);
+            b = (b << 3) | (b >> 2);
+        }
+        break;
+    case GX_RGB8:
+        r = data[0];
+        g = data[1];
+        b = data[2];
+        break;
+    case GX_RGBX8:
+        r = data[3];
+        g = data[2];
+        b = data[1];
+        break;
+    case GX_RGBA4:
+        {
+            const u16 color = *(const u16*)data;
+            r = ((color >> 12) & 0xF) * 0x11;
+            g = ((color >> 8) & 0xF) * 0x11;
+            b = ((color >> 4) & 0xF) * 0x11;
+            a = (color & 0xF) * 0x11;
+        }
+        break;
+    case GX_RGBA6:
+        {
+            const u32 color = (data[0] << 16) | (data[1] << 8) | data[2];
+            r = (color >> 18) & 0x3F;
+            g = (color >> 12) & 0x3F;
+            b = (color >> 6) & 0x3F;
+            a = color & 0x3F;
+            r = (r << 2) | (r >> 4);
+            g = (g << 2) | (g >> 4);
+            b = (b << 2) | (b >> 4);
+            a = (a << 2) | (a >> 4);
+        }
+        break;
+    default:
+        r = data[3];
+        g = data[2];
+        b = data[1];
+        a = data[0];
+        break;
+    }
+    out[0] = r / 255.0f;
+    out[1] = g / 255.0f;
+    out[2] = b / 255.0f;
+    out[3] = a / 255.0f;
+}
+
+/// Decode an XF RGBA8 color register to the range 0-1
+static inline void DecodeRGBA8(u32 color, f32 out[4]) {
+    out[0] = ((color >> 24) & 0xFF) / 255.0f;
+    out[1] = ((color >> 16) & 0xFF) / 255.0f;
+    out[2] = ((color >> 8) & 0xFF) / 255.0f;
+    out[3] = (color & 0xFF) / 255.0f;
+}
+
+static inline f32 Dot3(const f32* a, const f32* b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline void Normalize3(f32* v) {
+    const f32 length = sqrtf(Dot3(v, v));
+    if (length > 0.0f) {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+/// Multiply a row of an XF matrix with (x, y, z, 1)
+static inline f32 MatrixRow(const f32* row, const f32* v) {
+    return row[0] * v[0] + row[1] * v[1] + row[2] * v[2] + row[3];
+}
+
+/// Signed distance of a clip space position to a clip plane, positive inside
+static inline f32 ClipDistance(const f32* pos, int plane) {
+    switch (plane) {
+    case 0: return pos[2] + pos[3];                 // Near
+    case 1: return pos[3] - pos[2];                 // Far
+    case 2: return pos[3] - kMinW;                  // Behind the eye
+    case 3: return kGuardBand * pos[3] - pos[0];    // Guard band
+    case 4: return kGuardBand * pos[3] + pos[0];
+    case 5: return kGuardBand * pos[3] - pos[1];
+    }
+    return kGuardBand * pos[3] + pos[1];
+}
+
+/// Get the TEV konst color for a konst selector, ordered like GX_KCOLOR_*
+static void GetTevKonst(int sel, const int konst[4][4], int out[4]) {
+    static const int fractions[8] = { 255, 223, 191, 159, 128, 96, 64, 32 };
+    if (sel < 8) {
+        out[0] = out[1] = out[2] = out[3] = fractions[sel];
+    } else if (sel >= 12 && sel < 16) {
+        memcpy(out, konst[sel - 12], sizeof(int) * 4);
+    } else if (sel >= 16) {
+        // 16-19 red, 20-23 green, 24-27 blue, 28-31 alpha of konst 0-3
+        out[0] = out[1] = out[2] = out[3] = konst[sel & 3][(sel - 16) >> 2];
+    } else {
+        LOG_ERROR(TGP, "Unknown TEV konst lookup index = %d", sel);
+        out[0] = out[1] = out[2] = out[3] = 0;
+    }
+}
+
+/// RendererSoft constructor
+RendererSoft::RendererSoft() {
+    render_window_ = NULL;
+    num_threads_ = 0;
+    prim_type_ = GX_TRIANGLES;
+    num_texgens_ = 0;
+    cull_mode_ = 0;
+    memset(&vertex_state_, 0, sizeof(vertex_state_));
+    memset(&vertex_, 0, sizeof(vertex_));
+    vertex_layout_ = NULL;
+    memset(&xf_state_, 0, sizeof(xf_state_));
+    memset(&draw_state_, 0, sizeof(draw_state_));
+    memset(tev_registers_, 0, sizeof(tev_registers_));
+    memset(tev_konst_, 0, sizeof(tev_konst_));
+    memset(samplers_, 0, sizeof(samplers_));
+
+    viewport_[0] = 0.0f;
+    viewport_[1] = 0.0f;
+    viewport_[2] = (f32)kGCEFBWidth;
+    viewport_[3] = (f32)kGCEFBHeight;
+    depth_range_[0] = 0.0f;
+    depth_range_[1] = 1.0f;
+    scissor_ = Rect(0, 0, kGCEFBWidth, kGCEFBHeight);
+    line_width_ = 1.0f;
+    point_size_ = 1.0f;
+    mode_ = 0;
+
+    xfb_width_ = 0;
+    xfb_height_ = 0;
+    xfb_copies_ = 0;
+
+    vbo_ = new u8[VBO_SIZE];
+
+    shader_interface_ = new ShaderInterfaceSoft(this);
+    texture_interface_ = new TextureInterfaceSoft(this);
+}
+
+/// RendererSoft destructor
+RendererSoft::~RendererSoft() {
+    rasterizer_.ShutDown();
+    delete[] vbo_;
+    delete shader_interface_;
+    delete texture_interface_;
+}
+
+/// Write BP, keeps track of the TEV color registers and konst colors
+void RendererSoft::WriteBP(u8 addr, u32 data) {
+    if (addr < BP_REG_TEV_REGISTER_L || addr > (BP_REG_TEV_REGISTER_H + 6)) {
+        return;
+    }
+    const int index = (addr >> 1) - 0x70;
+    const bool is_konst = (data >> 23) & 1;
+    int* dest = is_konst ? tev_konst_[index] : tev_registers_[index];
+
+    // Registers are signed 11-bit, konst colors are 8-bit
+    int low = data & 0x7FF;
+    int high = (data >> 12) & 0x7FF;
+    if (is_konst) {
+        low &= 0xFF;
+        high &= 0xFF;
+    } else {
+        low = (low ^ 0x400) - 0x400;
+        high = (high ^ 0x400) - 0x400;
+    }
+    if (addr & 1) { // green/blue
+        dest[1] = high;
+        dest[2] = low;
+    } else { // red/alpha
+        dest[0] = low;
+        dest[3] = high;
+    }
+}
+
+void RendererSoft::WriteCP(u8 addr, u32 data) {
+}
+
+void RendererSoft::WriteXF(u16 addr, int length, u32* data) {
+}
+
+/// Begin a primitive, the vertex loader writes straight into our buffer
+void RendererSoft::BeginPrimitive(GXPrimitive prim, int count, const gp::VertexLayout& layout,
+    u8** vbo, u32 vbo_offset) {
+    if (0 == count) {
+        return;
+    }
+    prim_type_ = prim;
+    vertex_layout_ = &layout;
+    *vbo = vbo_ + vbo_offset;
+}
+
+void RendererSoft::SetVertexState(const gp::VertexState& vertex_state) {
+    vertex_state_ = vertex_state;
+}
+
+void RendererSoft::VertexPosition_UseIndexXF(u8 index) {
+}
+
+/// End a primitive, the loaded vertices are transformed, clipped and queued for rasterization
+void RendererSoft::EndPrimitive(u32 vbo_offset, u32 vertex_num, const u16* indices,
+    u32 index_num, u32 primitive_num) {
+    if (vertex_num == 0) {
+        return;
+    }
+    const gp::VertexLayout& layout = *vertex_layout_;
+    _ASSERT_MSG(TVIDEO, (vbo_offset + vertex_num * layout.stride <= VBO_SIZE),
+        "VBO is full! There is either a bug or it must be > %dMB!",
+        (VBO_SIZE / 1048576));
+
+    UpdateTransformState();
+    UpdateDrawState();
+    rasterizer_.SetDrawState(draw_state_);
+
+    if (clip_vertices_.size() < vertex_num) {
+        clip_vertices_.resize(vertex_num);
+    }
+    const u8* packed = vbo_ + vbo_offset;
+    for (u32 i = 0; i < vertex_num; i++, packed += layout.stride) {
+        layout.Unpack(packed, &vertex_);
+        TransformVertex(vertex_, clip_vertices_[i]);
+    }
+    const ClipVertex* v = &clip_vertices_[0];
+
+    // Indexed primitives are lists, every vertex was transformed once above
+    if (indices) {
+        switch (prim_type_) {
+        case GX_TRIANGLES:
+            for (u32 i = 0; i + 2 < index_num; i += 3) {
+                DrawTriangle(v[indices[i]], v[indices[i + 1]], v[indices[i + 2]]);
+            }
+            break;
+        case GX_LINES:
+            for (u32 i = 0; i + 1 < index_num; i += 2) {
+                DrawLine(v[indices[i]], v[indices[i + 1]]);
+            }
+            break;
+        case GX_POINTS:
+            for (u32 i = 0; i < index_num; i++) {
+                DrawPoint(v[indices[i]]);
+            }
+            break;
+        default:
+            LOG_ERROR(TVIDEO, "Unknown indexed primitive type 0x%02x", prim_type_);
+            break;
+        }
+        return;
+    }
+
+    switch (prim_type_) {
+    case GX_TRIANGLES:
+        for (u32 i = 0; i + 2 < vertex_num; i += 3) {
+            DrawTriangle(v[i], v[i + 1], v[i + 2]);
+        }
+        break;
+    case GX_TRIANGLESTRIP:
+        // Every other triangle is flipped to keep the winding of the strip
+        for (u32 i = 0; i + 2 < vertex_num; i++) {
+            if (i & 1) {
+                DrawTriangle(v[i + 1], v[i], v[i + 2]);
+            } else {
+                DrawTriangle(v[i], v[i + 1], v[i + 2]);
+            }
+        }
+        break;
+    case GX_TRIANGLEFAN:
+        for (u32 i = 1; i + 1 < vertex_num; i++) {
+            DrawTriangle(v[0], v[i], v[i + 1]);
+        }
+        break;
+    case GX_LINES:
+        for (u32 i = 0; i + 1 < vertex_num; i += 2) {
+            DrawLine(v[i], v[i + 1]);
+        }
+        break;
+    case GX_LINESTRIP:
+        for (u32 i = 0; i + 1 < vertex_num; i++) {
+            DrawLine(v[i], v[i + 1]);
+        }
+        break;
+    case GX_POINTS:
+        for (u32 i = 0; i < vertex_num; i++) {
+            DrawPoint(v[i]);
+        }
+        break;
+    default:
+        LOG_ERROR(TVIDEO, "Unknown primitive type 0x%02x", prim_type_);
+        break;
+    }
+}
+
+/// Capture the XF and CP state for the primitive that is about to be transformed
+void RendererSoft::UpdateTransformState() {
+    CPVatRegA& vat_a = gp::g_cp_regs.vat_reg_a[gp::g_cur_vat];
+    CPVatRegB& vat_b = gp::g_cp_regs.vat_reg_b[gp::g_cur_vat];
+    CPVatRegC& vat_c = gp::g_cp_regs.vat_reg_c[gp::g_cur_vat];
+    const CPVertDescLo& vcd_lo = gp::g_cp_regs.vcd_lo[0];
+    const f32* xf_mem = reinterpret_cast<const f32*>(gp::g_xf_mem);
+
+    const f32 tex_dqf[kGCMaxActiveTextures] = {
+        vat_a.get_tex0_dqf(), vat_b.get_tex1_dqf(), vat_b.get_tex2_dqf(), vat_b.get_tex3_dqf(),
+        vat_c.get_tex4_dqf(), vat_c.get_tex5_dqf(), vat_c.get_tex6_dqf(), vat_c.get_tex7_dqf()
+    };
+    const u32 tex_midx[kGCMaxActiveTextures] = {
+        gp::g_cp_regs.matrix_index_a.tex0_midx, gp::g_cp_regs.matrix_index_a.tex1_midx,
+        gp::g_cp_regs.matrix_index_a.tex2_midx, gp::g_cp_regs.matrix_index_a.tex3_midx,
+        gp::g_cp_regs.matrix_index_b.tex4_midx, gp::g_cp_regs.matrix_index_b.tex5_midx,
+        gp::g_cp_regs.matrix_index_b.tex6_midx, gp::g_cp_regs.matrix_index_b.tex7_midx
+    };
+    const u32 tex_midx_enable[kGCMaxActiveTextures] = {
+        vcd_lo.tex0_midx_enable, vcd_lo.tex1_midx_enable, vcd_lo.tex2_midx_enable,
+        vcd_lo.tex3_midx_enable, vcd_lo.tex4_midx_enable, vcd_lo.tex5_midx_enable,
+        vcd_lo.tex6_midx_enable, vcd_lo.tex7_midx_enable
+    };
+
+    xf_state_.pos_dqf = (vertex_state_.pos.comp_type != GX_F32) ? vat_a.get_pos_dqf() : 1.0f;
+    xf_state_.pos_midx = vcd_lo.pos_midx_enable ? -1 : gp::g_cp_regs.matrix_index_a.pos_normal_midx;
+    for (int i = 0; i < kGCMaxActiveTextures; i++) {
+        xf_state_.tex_dqf[i] = (vertex_state_.tex[i].comp_type != GX_F32) ? tex_dqf[i] : 1.0f;
+        xf_state_.tex_midx[i] = tex_midx_enable[i] ? -1 : (int)tex_midx[i];
+    }
+
+    xf_state_.num_color_channels = MIN((int)gp::g_xf_regs.num_color_channels.num,
+        kGCMaxVertexColors);
+    for (int chan = 0; chan < kGCMaxVertexColors; chan++) {
+        DecodeRGBA8(gp::g_xf_regs.material[chan]._u32, xf_state_.material[chan]);
+        DecodeRGBA8(gp::g_xf_regs.ambient[chan]._u32, xf_state_.ambient[chan]);
+    }
+    for (int i = 0; i < kGCMaxLights; i++) {
+        const int offset = XF_LIGHTS + (i * 0x10);
+        const f32* params = xf_mem + offset;
+        Light& light = xf_state_.lights[i];
+
+        DecodeRGBA8(gp::g_xf_mem[offset + 3], light.color);
+        memcpy(light.cos_atten, &params[4], sizeof(light.cos_atten));
+        memcpy(light.dist_atten, &params[7], sizeof(light.dist_atten));
+        memcpy(light.pos, &params[10], sizeof(light.pos));
+        memcpy(light.dir, &params[13], sizeof(light.dir));
+
+        // Dist attenuation, make sure not equal to 0
+        if (fabs(light.dist_atten[0]) < 0.00001f && fabs(light.dist_atten[1]) < 0.00001f &&
+            fabs(light.dist_atten[2]) < 0.00001f) {
+            light.dist_atten[0] = 0.00001f;
+        }
+    }
+
+    num_texgens_ = MIN((int)gp::g_xf_regs.num_texgen.num_texgens, kGCMaxActiveTextures);
+    cull_mode_ = gp::g_bp_regs.genmode.cull_mode;
+}
+
+/// Capture the pixel pipeline state for the primitive that is about to be drawn
+void RendererSoft::UpdateDrawState() {
+    static const int tev_bias[4] = { 0, 128, -128, 0 };
+    const gp::BPPECMode0& cmode0 = gp::g_bp_regs.cmode0;
+    SoftDrawState& state = draw_state_;
+
+    // Cleared so unused fields compare equal
+    memset(&state, 0, sizeof(state));
+
+    state.num_stages = gp::g_bp_regs.genmode.num_tevstages + 1;
+    state.num_texgens = num_texgens_;
+    for (int i = 0; i < state.num_stages; i++) {
+        const int reg_index = i >> 1;
+        const gp::BPTevOrder& order = gp::g_bp_regs.tevorder[reg_index];
+        const gp::BPTevCombiner& combiner = gp::g_bp_regs.combiner[i];
+        SoftTevStage& stage = state.stages[i];
+        int konst[4];
+
+        stage.color_sel[0] = combiner.color.sel_a;
+        stage.color_sel[1] = combiner.color.sel_b;
+        stage.color_sel[2] = combiner.color.sel_c;
+        stage.color_sel[3] = combiner.color.sel_d;
+        stage.color_bias = tev_bias[combiner.color.bias];
+        stage.color_sub = combiner.color.sub;
+        stage.color_clamp = combiner.color.clamp;
+        stage.color_shift = combiner.color.shift;
+        stage.color_dest = combiner.color.dest;
+
+        stage.alpha_sel[0] = combiner.alpha.sel_a;
+        stage.alpha_sel[1] = combiner.alpha.sel_b;
+        stage.alpha_sel[2] = combiner.alpha.sel_c;
+        stage.alpha_sel[3] = combiner.alpha.sel_d;
+        stage.alpha_bias = tev_bias[combiner.alpha.bias];
+        stage.alpha_sub = combiner.alpha.sub;
+        stage.alpha_clamp = combiner.alpha.clamp;
+        stage.alpha_shift = combiner.alpha.shift;
+        stage.alpha_dest = combiner.alpha.dest;
+
+        // Texcoords that aren't generated read texcoord 0
+        stage.texmap = order.get_enable(i) ? order.get_texmap(i) : -1;
+        stage.texcoord = order.get_texcoord(i);
+        if (stage.texcoord >= num_texgens_) {
+            stage.texcoord = (num_texgens_ > 0) ? 0 : -1;
+        }
+        if (stage.texmap >= 0) {
+            state.samplers[stage.texmap] = samplers_[stage.texmap];
+        }
+
+        // Color channel 0, 1, alpha bump (treated as channel 0) or zero
+        switch (order.get_colorchan(i)) {
+        case 0: stage.ras = 0; break;
+        case 1: stage.ras = 1; break;
+        case 5: case 6: stage.ras = 0; break;
+        default: stage.ras = -1; break;
+        }
+
+        GetTevKonst(gp::g_bp_regs.ksel[reg_index].get_konst_color_sel(i), tev_konst_, konst);
+        stage.konst[0] = konst[0];
+        stage.konst[1] = konst[1];
+        stage.konst[2] = konst[2];
+        GetTevKonst(gp::g_bp_regs.ksel[reg_index].get_konst_alpha_sel(i), tev_konst_, konst);
+        stage.konst[3] = konst[3];
+    }
+    memcpy(state.registers, tev_registers_, sizeof(state.registers));
+
+    state.alpha_comp[0] = gp::g_bp_regs.alpha_func.comp0;
+    state.alpha_comp[1] = gp::g_bp_regs.alpha_func.comp1;
+    state.alpha_ref[0] = gp::g_bp_regs.alpha_func.ref0;
+    state.alpha_ref[1] = gp::g_bp_regs.alpha_func.ref1;
+    state.alpha_logic = gp::g_bp_regs.alpha_func.logic;
+
+    // If the test is disabled write is disabled too
+    state.z_test = gp::g_bp_regs.zmode.test_enable;
+    state.z_func = gp::g_bp_regs.zmode.function;
+    state.z_update = gp::g_bp_regs.zmode.update_enable;
+
+    state.pixel_format = gp::g_bp_regs.zcontrol.pixel_format;
+    state.efb_alpha = gp::g_bp_regs.zcontrol.is_efb_alpha_enabled();
+    state.blend_enable = cmode0.blend_enable;
+    state.blend_subtract = cmode0.subtract;
+    state.blend_src = cmode0.src_factor;
+    state.blend_dst = cmode0.dst_factor;
+    state.logic_op = (cmode0.logicop_enable && cmode0.logic_mode != 3) ? cmode0.logic_mode : -1;
+    state.color_update = cmode0.color_update;
+    state.alpha_update = cmode0.alpha_update && state.efb_alpha;
+    state.dst_alpha_enable = gp::g_bp_regs.cmode1.enable && state.alpha_update;
+    state.dst_alpha = gp::g_bp_regs.cmode1.alpha;
+
+    if (gp::g_bp_regs.alpha_func.test_result() == gp::BPAlphaFunc::kTestResult_Fail) {
+        state.color_update = 0;
+        state.alpha_update = 0;
+    }
+    if (mode_ & kRenderMode_ZComp) {
+        state.color_update = 0;
+        state.alpha_update = 0;
+    }
+    if (mode_ & kRenderMode_Multipass) {
+        state.z_test = 1;
+        state.z_func = 2; // Equal
+        state.z_update = 0;
+    }
+    if (mode_ & kRenderMode_UseDstAlpha) {
+        state.color_update = 0;
+        state.alpha_update = 1;
+        state.blend_enable = 0;
+        state.blend_subtract = 0;
+    }
+}
+
+/// Run the XF on a vertex: position, normal and texcoord transforms, and lighting
+void RendererSoft::TransformVertex(const GXVertex& in, ClipVertex& out) {
+    const f32* xf_mem = reinterpret_cast<const f32*>(gp::g_xf_mem);
+    const f32* projection = gp::g_projection_matrix;
+    const TransformState& xf = xf_state_;
+    f32 model_pos[3];
+    f32 pos[3];
+    f32 model_normal[3] = { 0.0f, 0.0f, 0.0f };
+    f32 normal[3] = { 0.0f, 0.0f, 0.0f };
+    f32 tex[kGCMaxActiveTextures][2];
+
+    // Position
+    const u8* pos_data = reinterpret_cast<const u8*>(in.position);
+    const int pos_type = vertex_state_.pos.comp_type;
+    model_pos[0] = ReadComponent(pos_data, pos_type, 0) * xf.pos_dqf;
+    model_pos[1] = ReadComponent(pos_data, pos_type, 1) * xf.pos_dqf;
+    model_pos[2] = (vertex_state_.pos.comp_count == GX_POS_XYZ) ?
+        ReadComponent(pos_data, pos_type, 2) * xf.pos_dqf : 0.0f;
+
+    const int pos_midx = (xf.pos_midx < 0) ? in.pm_idx : xf.pos_midx;
+    const f32* pos_mtx = xf_mem + pos_midx * 4;
+    pos[0] = MatrixRow(pos_mtx + 0, model_pos);
+    pos[1] = MatrixRow(pos_mtx + 4, model_pos);
+    pos[2] = MatrixRow(pos_mtx + 8, model_pos);
+
+    // Projection matrix is column major
+    for (int r = 0; r < 4; r++) {
+        out.pos[r] = projection[r] * pos[0] + projection[4 + r] * pos[1] +
+            projection[8 + r] * pos[2] + projection[12 + r];
+    }
+
+    // Normal, the normal matrix is only 32 entries
+    if (vertex_state_.nrm.attr_type != GX_NONE) {
+        const u8* nrm_data = reinterpret_cast<const u8*>(in.normal);
+        const int nrm_type = vertex_state_.nrm.comp_type;
+        const f32* nrm_mtx = xf_mem + 0x400 + (pos_midx & 0x1F) * 3;
+        for (int i = 0; i < 3; i++) {
+            model_normal[i] = ReadComponent(nrm_data, nrm_type, i);
+        }
+        for (int r = 0; r < 3; r++) {
+            normal[r] = Dot3(nrm_mtx + r * 3, model_normal);
+        }
+        Normalize3(normal);
+    }
+
+    // Raw texcoords, used as texgen sources
+    for (int i = 0; i < kGCMaxActiveTextures; i++) {
+        if (vertex_state_.tex[i].attr_type != GX_NONE) {
+            const u8* tex_data = reinterpret_cast<const u8*>(&in.texcoords[i * 2]);
+            const int tex_type = vertex_state_.tex[i].comp_type;
+            tex[i][0] = ReadComponent(tex_data, tex_type, 0) * xf.tex_dqf[i];
+            tex[i][1] = (vertex_state_.tex[i].comp_count == GX_TEX_ST) ?
+                ReadComponent(tex_data, tex_type, 1) * xf.tex_dqf[i] : 0.0f;
+        } else {
+            tex[i][0] = tex[i][1] = 0.0f;
+        }
+    }
+
+    // Texgens, only regular transforms of the position, normal or a texcoord are done
+    for (int i = 0; i < num_texgens_; i++) {
+        const gp::XFTexMtxInfo& info = gp::g_xf_regs.texMtxInfo[i];
+        const int tex_midx = (xf.tex_midx[i] < 0) ? in.tm_idx[i] : xf.tex_midx[i];
+        const f32* tex_mtx = xf_mem + tex_midx * 4;
+        f32 src[3];
+
+        if (info.source_row == 0) {
+            memcpy(src, model_pos, sizeof(src));
+        } else if (info.source_row == 1) {
+            memcpy(src, model_normal, sizeof(src));
+        } else if (info.source_row >= 5 && info.source_row < 5 + kGCMaxActiveTextures) {
+            src[0] = tex[info.source_row - 5][0];
+            src[1] = tex[info.source_row - 5][1];
+            src[2] = 1.0f;
+        } else {
+            src[0] = tex[i][0];
+            src[1] = tex[i][1];
+            src[2] = 1.0f;
+        }
+        // AB11 input form
+        if (info.input_form == 0) {
+            src[2] = 1.0f;
+        }
+        f32 s = MatrixRow(tex_mtx + 0, src);
+        f32 t = MatrixRow(tex_mtx + 4, src);
+        if (info.projection) {
+            const f32 q = MatrixRow(tex_mtx + 8, src);
+            if (q != 0.0f) {
+                s /= q;
+                t /= q;
+            }
+        }
+        out.attribs[kSoftAttrib_TexCoord + i * 2 + 0] = s;
+        out.attribs[kSoftAttrib_TexCoord + i * 2 + 1] = t;
+    }
+
+    // Lighting
+    f32 vertex_color[kGCMaxVertexColors][4];
+    bool has_color[kGCMaxVertexColors];
+    f32 color[kGCMaxVertexColors][4];
+
+    for (int chan = 0; chan < kGCMaxVertexColors; chan++) {
+        has_color[chan] = (vertex_state_.col[chan].attr_type != GX_NONE);
+        if (has_color[chan]) {
+            DecodeVertexColor(reinterpret_cast<const u8*>(&in.color[chan]),
+                vertex_state_.col[chan].comp_type, vertex_color[chan]);
+        } else {
+            vertex_color[chan][0] = vertex_color[chan][1] = 1.0f;
+            vertex_color[chan][2] = vertex_color[chan][3] = 1.0f;
+        }
+    }
+    for (int chan = 0; chan < xf.num_color_channels; chan++) {
+        // Color (RGB) and alpha are lit separately with their own channel settings
+        for (int part = 0; part < 2; part++) {
+            const gp::XFLitChannel& lit = (part == 0) ? gp::g_xf_regs.color[chan] :
+                gp::g_xf_regs.alpha[chan];
+            const int first = (part == 0) ? 0 : 3;
+            const int last = (part == 0) ? 3 : 4;
+            f32 light_sum[4];
+
+            for (int c = first; c < last; c++) {
+                const f32 material = lit.material_src ? vertex_color[chan][c] :
+                    xf.material[chan][c];
+                if (!lit.enable_lighting) {
+                    color[chan][c] = material;
+                    continue;
+                }
+                if (lit.ambsource) {
+                    light_sum[c] = has_color[chan] ? vertex_color[chan][c] : 0.0f;
+                } else {
+                    light_sum[c] = xf.ambient[chan][c];
+                }
+                color[chan][c] = material;
+            }
+            if (!lit.enable_lighting) {
+                continue;
+            }
+            const unsigned int light_mask = lit.get_light_mask();
+            for (int i = 0; i < kGCMaxLights; i++) {
+                if (!(light_mask & (1 << i))) {
+                    continue;
+                }
+                const Light& light = xf.lights[i];
+                f32 atten = 1.0f;
+                f32 intensity;
+                f32 dir[3];
+
+                if (!(lit.attn_func & 1)) {
+                    // Simple diffuse lighting
+                    for (int j = 0; j < 3; j++) {
+                        dir[j] = light.pos[j] - pos[j];
+                    }
+                    Normalize3(dir);
+                    intensity = Dot3(dir, normal);
+                } else if (lit.attn_func == 1) {
+                    // Specular lighting
+                    memcpy(dir, light.pos, sizeof(dir));
+                    Normalize3(dir);
+                    const f32 a = (Dot3(normal, dir) >= 0.0f) ?
+                        MAX(0.0f, Dot3(normal, light.dir)) : 0.0f;
+                    atten = MAX(0.0f, light.cos_atten[0] + light.cos_atten[1] * a +
+                        light.cos_atten[2] * a * a) / (light.dist_atten[0] +
+                        light.dist_atten[1] * a + light.dist_atten[2] * a * a);
+                    intensity = atten * Dot3(dir, normal);
+                } else {
+                    // Spot lighting
+                    for (int j = 0; j < 3; j++) {
+                        dir[j] = light.pos[j] - pos[j];
+                    }
+                    const f32 dist = sqrtf(Dot3(dir, dir));
+                    if (dist > 0.0f) {
+                        dir[0] /= dist;
+                        dir[1] /= dist;
+                        dir[2] /= dist;
+                    }
+                    const f32 a = MAX(0.0f, Dot3(dir, light.dir));
+                    atten = MAX(0.0f, light.cos_atten[0] + light.cos_atten[1] * a +
+                        light.cos_atten[2] * a * a) / (light.dist_atten[0] +
+                        light.dist_atten[1] * dist + light.dist_atten[2] * dist * dist);
+                    intensity = atten * Dot3(dir, normal);
+                }
+
+                f32 diffuse;
+                switch (lit.diffuse_func) {
+                case GX_DF_NONE:
+                    diffuse = atten;
+                    break;
+                case GX_DF_SIGN:
+                    diffuse = intensity;
+                    break;
+                default:
+                    diffuse = MAX(intensity, 0.0f);
+                    break;
+                }
+                for (int c = first; c < last; c++) {
+                    light_sum[c] += diffuse * light.color[c];
+                }
+            }
+            for (int c = first; c < last; c++) {
+                color[chan][c] *= CLAMP(light_sum[c], 0.0f, 1.0f);
+            }
+        }
+    }
+    // Channels that aren't lit pass on the vertex color (or channel 0 if there is one)
+    for (int chan = xf.num_color_channels; chan < kGCMaxVertexColors; chan++) {
+        const f32* src = (xf.num_color_channels > 0) ? color[0] : vertex_color[chan];
+        memcpy(color[chan], src, sizeof(color[chan]));
+    }
+    for (int c = 0; c < 4; c++) {
+        out.attribs[kSoftAttrib_Color0 + c] = color[0][c] * 255.0f;
+        out.attribs[kSoftAttrib_Color1 + c] = color[1][c] * 255.0f;
+    }
+}
+
+/// Project a clip space vertex to window coordinates
+void RendererSoft::ProjectVertex(const ClipVertex& in, SoftVertex& out) {
+    const int num_attribs = kSoftAttrib_TexCoord + 2 * num_texgens_;
+    const f32 inv_w = 1.0f / in.pos[3];
+
+    out.x = viewport_[0] + (in.pos[0] * inv_w + 1.0f) * 0.5f * viewport_[2];
+    out.y = viewport_[1] + (in.pos[1] * inv_w + 1.0f) * 0.5f * viewport_[3];
+    out.z = depth_range_[0] + (in.pos[2] * inv_w + 1.0f) * 0.5f *
+        (depth_range_[1] - depth_range_[0]);
+    out.inv_w = inv_w;
+    for (int i = 0; i < num_attribs; i++) {
+        out.attribs[i] = in.attribs[i] * inv_w;
+    }
+}
+
+/// Clip a triangle against the near/far planes and the guard band, then queue it
+void RendererSoft::DrawTriangle(const ClipVertex& v0, const ClipVertex& v1,
+    const ClipVertex& v2) {
+    const ClipVertex* input[3] = { &v0, &v1, &v2 };
+    int outside = 0;
+
+    for (int plane = 0; plane < kNumClipPlanes; plane++) {
+        for (int i = 0; i < 3; i++) {
+            if (ClipDistance(input[i]->pos, plane) < 0.0f) {
+                outside |= (1 << plane);
+            }
+        }
+    }
+    SoftVertex window[kMaxClipVertices];
+
+    // Fast path, the triangle is entirely inside
+    if (!outside) {
+        ProjectVertex(v0, window[0]);
+        ProjectVertex(v1, window[1]);
+        ProjectVertex(v2, window[2]);
+        rasterizer_.DrawTriangle(window[0], window[1], window[2], cull_mode_, scissor_);
+        return;
+    }
+
+    // Sutherland-Hodgman against each plane a vertex is outside of
+    ClipVertex buffers[2][kMaxClipVertices];
+    int num_vertices = 3;
+    ClipVertex* src = buffers[0];
+    ClipVertex* dst = buffers[1];
+    src[0] = v0;
+    src[1] = v1;
+    src[2] = v2;
+
+    for (int plane = 0; plane < kNumClipPlanes; plane++) {
+        if (!(outside & (1 << plane))) {
+            continue;
+        }
+        int num_out = 0;
+        for (int i = 0; i < num_vertices; i++) {
+            const ClipVertex& a = src[i];
+            const ClipVertex& b = src[(i + 1) % num_vertices];
+            const f32 da = ClipDistance(a.pos, plane);
+            const f32 db = ClipDistance(b.pos, plane);
+
+            if (da >= 0.0f) {
+                dst[num_out++] = a;
+            }
+            if ((da >= 0.0f) != (db >= 0.0f)) {
+                const f32 t = da / (da - db);
+                ClipVertex& v = dst[num_out++];
+                for (int j = 0; j < 4; j++) {
+                    v.pos[j] = a.pos[j] + (b.pos[j] - a.pos[j]) * t;
+                }
+                for (int j = 0; j < kSoftMaxAttribs; j++) {
+                    v.attribs[j] = a.attribs[j] + (b.attribs[j] - a.attribs[j]) * t;
+                }
+            }
+        }
+        if (num_out < 3) {
+            return;
+        }
+        num_vertices = num_out;
+        ClipVertex* temp = src;
+        src = dst;
+        dst = temp;
+    }
+
+    for (int i = 0; i < num_vertices; i++) {
+        ProjectVertex(src[i], window[i]);
+    }
+    for (int i = 1; i + 1 < num_vertices; i++) {
+        rasterizer_.DrawTriangle(window[0], window[i], window[i + 1], cull_mode_, scissor_);
+    }
+}
+
+/// Draw a line as a quad of the current line width, widened along the minor axis
+void RendererSoft::DrawLine(const ClipVertex& v0, const ClipVertex& v1) {
+    f32 t0 = 0.0f;
+    f32 t1 = 1.0f;
+
+    for (int plane = 0; plane < kNumClipPlanes; plane++) {
+        const f32 d0 = ClipDistance(v0.pos, plane);
+        const f32 d1 = ClipDistance(v1.pos, plane);
+        if (d0 < 0.0f && d1 < 0.0f) {
+            return;
+        }
+        if (d0 < 0.0f) {
+            t0 = MAX(t0, d0 / (d0 - d1));
+        } else if (d1 < 0.0f) {
+            t1 = MIN(t1, d0 / (d0 - d1));
+        }
+    }
+    if (t0 >= t1) {
+        return;
+    }
+    ClipVertex ends[2];
+    for (int i = 0; i < 2; i++) {
+        const f32 t = i ? t1 : t0;
+        for (int j = 0; j < 4; j++) {
+            ends[i].pos[j] = v0.pos[j] + (v1.pos[j] - v0.pos[j]) * t;
+        }
+        for (int j = 0; j < kSoftMaxAttribs; j++) {
+            ends[i].attribs[j] = v0.attribs[j] + (v1.attribs[j] - v0.attribs[j]) * t;
+        }
+    }
+    SoftVertex p[2];
+    ProjectVertex(ends[0], p[0]);
+    ProjectVertex(ends[1], p[1]);
+
+    const f32 half_width = MAX(line_width_, 1.0f) * 0.5f;
+    const bool x_major = fabs(p[1].x - p[0].x) >= fabs(p[1].y - p[0].y);
+    SoftVertex quad[4] = { p[0], p[0], p[1], p[1] };
+    if (x_major) {
+        quad[0].y -= half_width;
+        quad[1].y += half_width;
+        quad[2].y -= half_width;
+        quad[3].y += half_width;
+    } else {
+        quad[0].x -= half_width;
+        quad[1].x += half_width;
+        quad[2].x -= half_width;
+        quad[3].x += half_width;
+    }
+    rasterizer_.DrawTriangle(quad[0], quad[2], quad[3], 0, scissor_);
+    rasterizer_.DrawTriangle(quad[0], quad[3], quad[1], 0, scissor_);
+}
+
+/// Draw a point as a square of the current point size
+void RendererSoft::DrawPoint(const ClipVertex& v0) {
+    for (int plane = 0; plane < kNumClipPlanes; plane++) {
+        if (ClipDistance(v0.pos, plane) < 0.0f) {
+            return;
+        }
+    }
+    SoftVertex p;
+    ProjectVertex(v0, p);
+
+    const f32 half_size = MAX(point_size_, 1.0f) * 0.5f;
+    SoftVertex quad[4] = { p, p, p, p };
+    quad[0].x -= half_size; quad[0].y -= half_size;
+    quad[1].x += half_size; quad[1].y -= half_size;
+    quad[2].x += half_size; quad[2].y += half_size;
+    quad[3].x -= half_size; quad[3].y += half_size;
+    rasterizer_.DrawTriangle(quad[0], quad[1], quad[2], 0, scissor_);
+    rasterizer_.DrawTriangle(quad[0], quad[2], quad[3], 0, scissor_);
+}
+
+void RendererSoft::SetViewport(int x, int y, int width, int height) {
+    viewport_[0] = (f32)x;
+    viewport_[1] = (f32)y;
+    viewport_[2] = (f32)width;
+    viewport_[3] = (f32)height;
+}
+
+/// Swap buffers, the XFB is only shown if the window can display it
+void RendererSoft::SwapBuffers() {
+    rasterizer_.Flush();
+    current_frame_++;
+    if (render_window_) {
+        render_window_->SwapBuffers();
+    }
+}
+
+void RendererSoft::SetDepthRange(double znear, double zfar) {
+    depth_range_[0] = (f32)znear;
+    depth_range_[1] = (f32)zfar;
+}
+
+void RendererSoft::SetDepthMode() {
+}
+
+void RendererSoft::SetGenerationMode() {
+}
+
+void RendererSoft::SetBlendMode(const gp::BPPECMode0& pe_cmode_0,
+    const gp::BPPECMode1& pe_cmode_1, bool force_update) {
+}
+
+void RendererSoft::SetLogicOpMode(const gp::BPPECMode0& pe_cmode_0) {
+}
+
+void RendererSoft::SetDitherMode(const gp::BPPECMode0& pe_cmode_0) {
+}
+
+void RendererSoft::SetColorMask(const gp::BPPECMode0& pe_cmode_0) {
+}
+
+/// Sets the scissor box, the rect is GL style (y0_ is the top edge, rows go up)
+void RendererSoft::SetScissorBox(const Rect& rect) {
+    scissor_ = Rect(MIN(rect.x0_, rect.x1_), MIN(rect.y0_, rect.y1_),
+        MAX(rect.x0_, rect.x1_), MAX(rect.y0_, rect.y1_));
+}
+
+void RendererSoft::SetLinePointSize(f32 line_width, f32 point_size) {
+    line_width_ = line_width;
+    point_size_ = point_size;
+}
+
+/**
+ * Copy the EFB to the XFB, scaled to the destination size. Both are bottom up, so the copy keeps
+ * the orientation. If a dump path is set, every copy is also written out as a TGA file
+ */
+void RendererSoft::CopyToXFB(const Rect& src_rect, const Rect& dst_rect) {
+    rasterizer_.Flush();
+
+    const int width = dst_rect.width();
+    const int height = dst_rect.height();
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    xfb_width_ = width;
+    xfb_height_ = height;
+    xfb_.resize(width * height * 4);
+
+    const u8* color_buffer = rasterizer_.color_buffer();
+    const int src_x = MIN(src_rect.x0_, src_rect.x1_);
+    const int src_y = MIN(src_rect.y0_, src_rect.y1_);
+    const f32 scale_x = (f32)src_rect.width() / (f32)width;
+    const f32 scale_y = (f32)src_rect.height() / (f32)height;
+
+    for (int y = 0; y < height; y++) {
+        int efb_y = src_y + (int)(((f32)y + 0.5f) * scale_y);
+        efb_y = CLAMP(efb_y, 0, kGCEFBHeight - 1);
+        u8* dst = &xfb_[y * width * 4];
+
+        for (int x = 0; x < width; x++, dst += 4) {
+            int efb_x = src_x + (int)(((f32)x + 0.5f) * scale_x);
+            efb_x = CLAMP(efb_x, 0, kGCEFBWidth - 1);
+            memcpy(dst, color_buffer + (efb_y * kGCEFBWidth + efb_x) * 4, 4);
+        }
+    }
+
+    if (!dump_path_.empty()) {
+        common::CreateFullPath(dump_path_ + "/");
+        std::string filename = common::FormatStr("%s/xfb_%05d.tga", dump_path_.c_str(),
+            xfb_copies_);
+        video_core::DumpTGA(filename, width, height, &xfb_[0]);
+    }
+    xfb_copies_++;
+}
+
+/// Clear the EFB, the rect is GL style (y0_ is the top edge, rows go up)
+void RendererSoft::Clear(const Rect& rect, bool enable_color, bool enable_alpha, bool enable_z,
+    u32 color, u32 z) {
+    Rect pixel_rect(MIN(rect.x0_, rect.x1_), MIN(rect.y0_, rect.y1_),
+        MAX(rect.x0_, rect.x1_), MAX(rect.y0_, rect.y1_));
+    rasterizer_.Clear(pixel_rect, enable_color, enable_alpha, enable_z, color, z);
+}
+
+void RendererSoft::SetMode(kRenderMode flags) {
+    mode_ |= flags;
+}
+
+void RendererSoft::RestoreMode(const gp::BPPECMode0& pe_cmode_0) {
+    mode_ = 0;
+}
+
+void RendererSoft::ResetRenderState() {
+}
+
+void RendererSoft::RestoreRenderState() {
+}
+
+void RendererSoft::SetWindow(EmuWindow* window) {
+    render_window_ = window;
+}
+
+void RendererSoft::Init() {
+    int num_threads = num_threads_;
+    if (num_threads <= 0) {
+        num_threads = std::thread::hardware_concurrency();
+    }
+    rasterizer_.Init(MAX(num_threads, 1));
+    LOG_NOTICE(TVIDEO, "software renderer initialized ok (%d threads)", rasterizer_.num_threads());
+}
+
+void RendererSoft::ShutDown() {
+    rasterizer_.ShutDown();
+}
@@ -0,0 +1,215 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    renderer_soft.h
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Software renderer, draws into a system memory EFB without a GL context
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef VIDEO_CORE_RENDERER_SOFT_H_
+#define VIDEO_CORE_RENDERER_SOFT_H_
+
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "gx_types.h"
+#include "renderer_base.h"
+#include "rasterizer.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Software Renderer
+
+/**
+ * Renderer that does the work of the GP on the host CPU. Vertices are transformed and lit on the
+ * GP thread when a primitive ends, then clipped and queued in the tiled rasterizer, which runs the
+ * TEV stages, alpha test, Z test and blending for each pixel on a pool of threads. The EFB lives in
+ * system memory, so XFB copies can be read back with xfb() or dumped to TGA files to diff frames
+ * between runs. Indirect texturing, fog, TEV swap tables and mipmapping are not emulated.
+ */
+class RendererSoft : virtual public RendererBase {
+public:
+
+    RendererSoft();
+    ~RendererSoft();
+
+    void WriteBP(u8 addr, u32 data);
+    void WriteCP(u8 addr, u32 data);
+    void WriteXF(u16 addr, int length, u32* data);
+
+    /**
+     * Begin renderering of a primitive, vertices are loaded into a system memory buffer
+     * @param prim Primitive type (e.g. GX_TRIANGLES)
+     * @param count Number of vertices to be drawn
+     * @param layout Packed layout of the vertices
+     * @param vbo Set to where the vertices are loaded to
+     * @param vbo_offset Offset into VBO to use (in bytes)
+     */
+    void BeginPrimitive(GXPrimitive prim, int count, const gp::VertexLayout& layout, u8** vbo,
+        u32 vbo_offset);
+
+    void SetVertexState(const gp::VertexState& vertex_state);
+    void VertexPosition_UseIndexXF(u8 index);
+
+    /**
+     * End a primitive, the loaded vertices are transformed, clipped and queued for rasterization
+     * @param vbo_offset Offset into VBO of the first vertex (in bytes)
+     * @param vertex_num Number of vertices loaded
+     * @param indices List indices, NULL to draw the vertices in order
+     * @param index_num Number of indices
+     * @param primitive_num Number of GX primitives batched into this one
+     */
+    void EndPrimitive(u32 vbo_offset, u32 vertex_num, const u16* indices, u32 index_num,
+        u32 primitive_num);
+
+    void SetViewport(int x, int y, int width, int height);
+    void SwapBuffers();
+    void SetDepthRange(double znear, double zfar);
+    void SetDepthMode();
+    void SetGenerationMode();
+    void SetBlendMode(const gp::BPPECMode0& pe_cmode_0, const gp::BPPECMode1& pe_cmode_1,
+        bool force_update);
+    void SetLogicOpMode(const gp::BPPECMode0& pe_cmode_0);
+    void SetDitherMode(const gp::BPPECMode0& pe_cmode_0);
+    void SetColorMask(const gp::BPPECMode0& pe_cmode_0);
+    void SetScissorBox(const Rect& rect);
+    void SetLinePointSize(f32 line_width, f32 point_size);
+
+    /**
+     * Copy the EFB to the XFB, which is kept as an RGBA8 image (bottom row first)
+     * @param src_rect Source rectangle in the EFB
+     * @param dst_rect Destination rectangle, its size is the size of the XFB image
+     */
+    void CopyToXFB(const Rect& src_rect, const Rect& dst_rect);
+
+    void Clear(const Rect& rect, bool enable_color, bool enable_alpha, bool enable_z,
+        u32 color, u32 z);
+    void SetMode(kRenderMode flags);
+    void RestoreMode(const gp::BPPECMode0& pe_cmode_0);
+    void ResetRenderState();
+    void RestoreRenderState();
+    void SetWindow(EmuWindow* window);
+    void Init();
+    void ShutDown();
+
+    /// Last XFB copy, RGBA8 with the bottom row first
+    const u8* xfb() const { return xfb_.empty() ? NULL : &xfb_[0]; }
+    int xfb_width() const { return xfb_width_; }
+    int xfb_height() const { return xfb_height_; }
+
+    /// Directory XFB copies are dumped to as TGA files, empty to not dump
+    const std::string& dump_path() const { return dump_path_; }
+    void set_dump_path(const std::string& val) { dump_path_ = val; }
+
+    /// Number of rasterizer threads, 0 to use all host threads. Takes effect on Init
+    int num_threads() const { return num_threads_; }
+    void set_num_threads(int val) { num_threads_ = val; }
+
+private:
+    friend class ShaderInterfaceSoft;
+    friend class TextureInterfaceSoft;
+
+    /// Vertex after transform and lighting, in clip space
+    struct ClipVertex {
+        f32 pos[4];
+        f32 attribs[kSoftMaxAttribs];
+    };
+
+    /// Light parameters from XF memory
+    struct Light {
+        f32 color[4];
+        f32 cos_atten[3];
+        f32 dist_atten[3];
+        f32 pos[3];
+        f32 dir[3];
+    };
+
+    /// XF and CP state the vertices of a primitive are transformed with
+    struct TransformState {
+        f32     pos_dqf;
+        int     pos_midx;                           ///< -1 if loaded with each vertex
+        f32     tex_dqf[kGCMaxActiveTextures];
+        int     tex_midx[kGCMaxActiveTextures];     ///< -1 if loaded with each vertex
+        int     num_color_channels;
+        f32     material[kGCMaxVertexColors][4];
+        f32     ambient[kGCMaxVertexColors][4];
+        Light   lights[kGCMaxLights];
+    };
+
+    /// Capture the XF and CP state for the primitive that is about to be transformed
+    void UpdateTransformState();
+
+    /// Capture the pixel pipeline state for the primitive that is about to be drawn
+    void UpdateDrawState();
+
+    /**
+     * Run the XF on a vertex: position, normal and texcoord transforms, and lighting
+     * @param in Vertex as loaded by the vertex loader
+     * @param out Transformed vertex
+     */
+    void TransformVertex(const GXVertex& in, ClipVertex& out);
+
+    /// Project a clip space vertex to window coordinates
+    void ProjectVertex(const ClipVertex& in, SoftVertex& out);
+
+    /// Clip a triangle against the near/far planes and the guard band, then queue it
+    void DrawTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2);
+
+    /// Draw a line as a quad of the current line width
+    void DrawLine(const ClipVertex& v0, const ClipVertex& v1);
+
+    /// Draw a point as a square of the current point size
+    void DrawPoint(const ClipVertex& v0);
+
+    EmuWindow*              render_window_;
+    u8*                     vbo_;                   ///< System memory buffer vertices load into
+    RasterizerSoft          rasterizer_;
+    int                     num_threads_;
+
+    GXPrimitive             prim_type_;             ///< Type of the current primitive
+    gp::VertexState         vertex_state_;          ///< Vertex format of the current primitive
+    const gp::VertexLayout* vertex_layout_;         ///< Packed layout of the current primitive
+    GXVertex                vertex_;                ///< Packed vertex unpacked for the transform
+    std::vector<ClipVertex> clip_vertices_;         ///< Transformed vertices of a primitive
+    int                     num_texgens_;           ///< Texgens written by the current primitive
+    int                     cull_mode_;             ///< Cull mode of the current primitive
+    TransformState          xf_state_;
+
+    f32                     viewport_[4];           ///< x, y, width, height (GL style)
+    f32                     depth_range_[2];        ///< Near, far
+    Rect                    scissor_;               ///< In EFB pixels, y going up
+    f32                     line_width_;
+    f32                     point_size_;
+    int                     mode_;                  ///< kRenderMode flags
+
+    int                     tev_registers_[4][4];   ///< TEV color registers (signed 11-bit RGBA)
+    int                     tev_konst_[4][4];       ///< TEV konst colors (RGBA)
+    SoftSampler             samplers_[kGCMaxTextureMaps];
+    SoftDrawState           draw_state_;
+
+    std::vector<u8>         xfb_;                   ///< Last XFB copy, RGBA8
+    int                     xfb_width_;
+    int                     xfb_height_;
+    int                     xfb_copies_;            ///< Number of XFB copies dumped so far
+    std::string             dump_path_;
+
+    DISALLOW_COPY_AND_ASSIGN(RendererSoft);
+};
+
+#endif // VIDEO_CORE_RENDERER_SOFT_H_
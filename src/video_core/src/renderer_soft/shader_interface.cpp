@@ -0,0 +1,49 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    shader_interface.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Software renderer shader interface, the TEV is interpreted so nothing is compiled
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include "common.h"
+
+#include "renderer_soft.h"
+#include "shader_interface.h"
+
+ShaderInterfaceSoft::ShaderInterfaceSoft(RendererSoft* parent) : parent_(parent) {
+}
+
+ShaderInterfaceSoft::~ShaderInterfaceSoft() {
+}
+
+/// Create a new shader, nothing to compile
+ShaderManager::CacheEntry::BackendData* ShaderInterfaceSoft::Create(const char* vs_header, 
+    const char* fs_header) {
+    return new ShaderManager::CacheEntry::BackendData();
+}
+
+/// Delete a shader from the backend renderer
+void ShaderInterfaceSoft::Delete(ShaderManager::CacheEntry::BackendData* backend_data) {
+    delete backend_data;
+}
+
+/// Binds a shader to the backend renderer
+void ShaderInterfaceSoft::Bind(const ShaderManager::CacheEntry::BackendData* backend_data) {
+}
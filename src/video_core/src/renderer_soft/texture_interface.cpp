@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    texture_interface.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-10
+ * @brief   Software renderer texture interface, keeps decoded textures in system memory
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include "common.h"
+
+#include "renderer_soft.h"
+#include "texture_interface.h"
+
+TextureInterfaceSoft::TextureInterfaceSoft(RendererSoft* parent) : parent_(parent) {
+}
+
+TextureInterfaceSoft::~TextureInterfaceSoft() {
+}
+
+/// Create a new texture, keeps a copy of the decoded RGBA8 data
+TextureManager::CacheEntry::BackendData* TextureInterfaceSoft::Create(int active_texture_unit, 
+    const TextureManager::CacheEntry& cache_entry, u8* raw_data) {
+    BackendData* backend_data = new BackendData();
+    int width = MAX(cache_entry.width_, 1);
+    int height = MAX(cache_entry.height_, 1);
+    int size = width * height * 4;
+
+    backend_data->texture_.width = width;
+    backend_data->texture_.height = height;
+    backend_data->texture_.data = new u8[size];
+
+    switch (cache_entry.type_) {
+
+    // Normal texture from RAM
+    case TextureManager::kSourceType_Normal:
+        if (raw_data != NULL) {
+            memcpy(backend_data->texture_.data, raw_data, size);
+        } else {
+            memset(backend_data->texture_.data, 0, size);
+        }
+        break;
+
+    // Texture is the result of an EFB copy, filled in by CopyEFB
+    case TextureManager::kSourceType_EFBCopy:
+        backend_data->is_depth_copy = 
+            (cache_entry.efb_copy_data_.pixel_format_ == gp::kPixelFormat_Z24);
+        memset(backend_data->texture_.data, 0, size);
+        break;
+
+    // Unknown texture source
+    default:
+        _ASSERT_MSG(TGP, 0, "Unknown texture source %d", (int)cache_entry.type_);
+        break;
+    }
+    return backend_data;
+}
+
+/// Delete a texture, triangles still queued may sample from it so they are drawn first
+void TextureInterfaceSoft::Delete(TextureManager::CacheEntry::BackendData* backend_data) {
+    BackendData* data = static_cast<BackendData*>(backend_data);
+
+    parent_->rasterizer_.Flush();
+    for (int i = 0; i < kGCMaxTextureMaps; i++) {
+        if (parent_->samplers_[i].texture == &data->texture_) {
+            parent_->samplers_[i].texture = NULL;
+        }
+    }
+    delete backend_data;
+}
+
+/**
+ * Update a texture with an EFB copy. The source rectangle is GL style (y0_ is the top edge, rows
+ * go up), texture rows are stored top to bottom, so the copy flips it
+ */
+void TextureInterfaceSoft::CopyEFB(const Rect& src_rect, const Rect& dst_rect,
+    const TextureManager::CacheEntry::BackendData* backend_data) {
+    // The texture is our own system memory copy, so it is updated in place
+    BackendData* data = const_cast<BackendData*>(static_cast<const BackendData*>(backend_data));
+    SoftTexture& texture = data->texture_;
+
+    parent_->rasterizer_.Flush();
+
+    const u8* color_buffer = parent_->rasterizer_.color_buffer();
+    const u32* depth_buffer = parent_->rasterizer_.depth_buffer();
+    const int src_x = MIN(src_rect.x0_, src_rect.x1_);
+    const int src_top = MAX(src_rect.y0_, src_rect.y1_);
+    const int width = MIN((int)dst_rect.width(), texture.width);
+    const int height = MIN((int)dst_rect.height(), texture.height);
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    const f32 scale_x = (f32)src_rect.width() / (f32)width;
+    const f32 scale_y = (f32)src_rect.height() / (f32)height;
+
+    for (int y = 0; y < height; y++) {
+        int efb_y = (int)((f32)src_top - ((f32)y + 0.5f) * scale_y);
+        efb_y = CLAMP(efb_y, 0, kGCEFBHeight - 1);
+        u8* dst = texture.data + y * texture.width * 4;
+
+        for (int x = 0; x < width; x++, dst += 4) {
+            int efb_x = src_x + (int)(((f32)x + 0.5f) * scale_x);
+            efb_x = CLAMP(efb_x, 0, kGCEFBWidth - 1);
+            const int offset = efb_y * kGCEFBWidth + efb_x;
+
+            if (data->is_depth_copy) {
+                const u8 z = (u8)(depth_buffer[offset] >> 16);
+                dst[0] = dst[1] = dst[2] = dst[3] = z;
+            } else {
+                memcpy(dst, color_buffer + offset * 4, 4);
+            }
+        }
+    }
+}
+
+/// Binds a texture, stored for the next draw state the rasterizer captures
+void TextureInterfaceSoft::Bind(int active_texture_unit, 
+    const TextureManager::CacheEntry::BackendData* backend_data) {
+    const BackendData* data = static_cast<const BackendData*>(backend_data);
+    parent_->samplers_[active_texture_unit].texture = &data->texture_;
+}
+
+/// Updates the texture parameters, mipmaps aren't emulated so only the wrap modes and filter matter
+void TextureInterfaceSoft::UpdateParameters(int active_texture_unit, 
+    const gp::BPTexMode0& tex_mode_0, const gp::BPTexMode1& tex_mode_1) {
+    SoftSampler& sampler = parent_->samplers_[active_texture_unit];
+
+    // Wrap mode 3 is reserved, treated as repeat
+    sampler.wrap_s = (tex_mode_0.wrap_s == 3) ? 1 : tex_mode_0.wrap_s;
+    sampler.wrap_t = (tex_mode_0.wrap_t == 3) ? 1 : tex_mode_0.wrap_t;
+    sampler.linear = tex_mode_0.mag_filter;
+}
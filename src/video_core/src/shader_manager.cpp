@@ -56,7 +56,7 @@ void ShaderManager::UpdateFlag(Flag flag, int enable) {
     }
 }
 
-void ShaderManager::UpdateVertexState(gp::VertexState& vertex_state) {
+void ShaderManager::UpdateVertexState(const gp::VertexState& vertex_state) {
     state_.fields.vertex_state = vertex_state;
 }
 
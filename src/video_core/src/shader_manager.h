@@ -98,7 +98,7 @@ public:
     class BackendInterface{
     public:
         BackendInterface() { }
-        ~BackendInterface() { }
+        virtual ~BackendInterface() { } // Renderers delete their interfaces through this class
 
         /**
          * Create a new shader in the backend renderer
@@ -155,7 +155,7 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
 
     void UpdateFlag(Flag flag, int enable);
-    void UpdateVertexState(gp::VertexState& vertex_state);
+    void UpdateVertexState(const gp::VertexState& vertex_state);
     void UpdateGenMode(const gp::BPGenMode& gen_mode);
     void UpdateNumColorChans(u32 num_color_chans);
     void UpdateAlphaFunc(const gp::BPAlphaFunc& alpha_func);
@@ -25,16 +25,48 @@
 #include "sys/stat.h"
 #include "common.h"
 #include "config.h"
+#include "x86_utils.h"
 #include "memory.h"
 #include "hw/hw_gx.h"
 #include "bp_mem.h"
 #include "texture_decoder.h"
 #include "video_core.h"
 #include "fifo_player.h"
+#include "std_thread.h"
+#include "std_mutex.h"
+#include "std_condition_variable.h"
 
+#include <algorithm>
+#include <deque>
 #include <vector>
 using namespace std;
 
+// SSE2 is part of x86-64, 32-bit builds only get it when the compiler targets it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_DECODER_USE_SSE2
+#include <emmintrin.h>
+
+// SSSE3 decoders are selected at runtime, GCC needs them built for the extension explicitly
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || \
+    (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define TEXTURE_DECODER_HAVE_TARGET_ATTR 1
+#else
+#define TEXTURE_DECODER_HAVE_TARGET_ATTR 0
+#endif
+
+#if defined(_MSC_VER)
+#define TEXTURE_DECODER_USE_SSSE3
+#define TEXTURE_DECODER_SSSE3
+#elif TEXTURE_DECODER_HAVE_TARGET_ATTR
+#define TEXTURE_DECODER_USE_SSSE3
+#define TEXTURE_DECODER_SSSE3 __attribute__((target("ssse3")))
+#endif
+#ifdef TEXTURE_DECODER_USE_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#endif
+
 namespace gp {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -168,6 +200,716 @@ void unpack8(u8* dst, u8* src, int w, int h, u16* palette, u8 paletteFormat, int
             unpackPixel(src[y*w + x], runner, palette, paletteFormat);
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// FAST TEXTURE DECODING
+//
+// Decoders for textures made of whole blocks, the common case. They write the same texels as the
+// reference decoders below, straight into the destination, one block per iteration.
+
+/// Decodes a texture of whole blocks to RGBA8
+typedef void (*TextureDecoder_Func)(u32* dst, const u8* src, int width, int height);
+
+/// Block size and fast decoder of each texture format
+struct TextureDecoder_Format {
+    int                 block_width;
+    int                 block_height;
+    TextureDecoder_Func func;
+};
+
+static TextureDecoder_Format g_decoder_formats[kTextureFormat_None];
+
+/// Decode the palette TextureDecoder_Decode uses, set by TX_SETTLUT of the first texture unit
+static void TextureDecoder_DecodeSetPalette(u32* palette, int num_entries) {
+    u8 palette_fmt = (gp::g_bp_regs.mem[0x98] >> 10) & 3;
+    u32 palette_addr = ((gp::g_bp_regs.mem[0x98] & 0x3ff) << 5);
+
+    TextureDecoder_DecodePalette(&gp::tmem[palette_addr & TMEM_MASK], palette_fmt, num_entries,
+        palette);
+}
+
+/// C4, 8x8 blocks of 4-bit palette indices
+static void DecodeC4(u32* dst, const u8* src, int width, int height) {
+    u32 palette[16];
+    TextureDecoder_DecodeSetPalette(palette, 16);
+
+    for (int y = 0; y < height; y += 8) {
+        for (int x = 0; x < width; x += 8, src += 32) {
+            for (int dy = 0; dy < 8; dy++) {
+                u32* row = &dst[(y + dy) * width + x];
+                for (int dx = 0; dx < 4; dx++) {
+                    u8 val = src[(dy * 4 + dx) ^ 3];
+                    row[dx * 2 + 0] = palette[val >> 4];
+                    row[dx * 2 + 1] = palette[val & 0xf];
+                }
+            }
+        }
+    }
+}
+
+/// C8, 8x4 blocks of 8-bit palette indices
+static void DecodeC8(u32* dst, const u8* src, int width, int height) {
+    u32 palette[256];
+    TextureDecoder_DecodeSetPalette(palette, 256);
+
+    for (int y = 0; y < height; y += 4) {
+        for (int x = 0; x < width; x += 8, src += 32) {
+            for (int dy = 0; dy < 4; dy++) {
+                u32* row = &dst[(y + dy) * width + x];
+                for (int dx = 0; dx < 8; dx++) {
+                    row[dx] = palette[src[(dy * 8 + dx) ^ 3]];
+                }
+            }
+        }
+    }
+}
+
+#ifdef TEXTURE_DECODER_USE_SSE2
+
+/// Byte swap the words of a vector (RAM is stored word swapped)
+static inline __m128i TextureDecoder_Swap32(__m128i v) {
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+}
+
+/// Load 16 bytes of texture data in memory order
+static inline __m128i TextureDecoder_Load8(const u8* src) {
+    return TextureDecoder_Swap32(_mm_loadu_si128((const __m128i*)src));
+}
+
+/// Load 8 big endian halfwords of texture data as 16-bit values
+static inline __m128i TextureDecoder_Load16(const u8* src) {
+    __m128i v = _mm_loadu_si128((const __m128i*)src);
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+}
+
+/// Store 16 8-bit intensities as 2 rows of 8 RGBA8 texels
+static inline void TextureDecoder_StoreI(u32* dst, int stride, __m128i i) {
+    __m128i lo = _mm_unpacklo_epi8(i, i);
+    __m128i hi = _mm_unpackhi_epi8(i, i);
+    _mm_storeu_si128((__m128i*)&dst[0], _mm_unpacklo_epi16(lo, lo));
+    _mm_storeu_si128((__m128i*)&dst[4], _mm_unpackhi_epi16(lo, lo));
+    _mm_storeu_si128((__m128i*)&dst[stride + 0], _mm_unpacklo_epi16(hi, hi));
+    _mm_storeu_si128((__m128i*)&dst[stride + 4], _mm_unpackhi_epi16(hi, hi));
+}
+
+/// Store 16 8-bit intensity/alpha pairs as 2 rows of 8 RGBA8 texels
+static inline void TextureDecoder_StoreIA(u32* dst, int stride, __m128i i, __m128i a) {
+    __m128i ii = _mm_unpacklo_epi8(i, i);
+    __m128i ia = _mm_unpacklo_epi8(i, a);
+    _mm_storeu_si128((__m128i*)&dst[0], _mm_unpacklo_epi16(ii, ia));
+    _mm_storeu_si128((__m128i*)&dst[4], _mm_unpackhi_epi16(ii, ia));
+    ii = _mm_unpackhi_epi8(i, i);
+    ia = _mm_unpackhi_epi8(i, a);
+    _mm_storeu_si128((__m128i*)&dst[stride + 0], _mm_unpacklo_epi16(ii, ia));
+    _mm_storeu_si128((__m128i*)&dst[stride + 4], _mm_unpackhi_epi16(ii, ia));
+}
+
+/// Store 8 texels given as R | G << 8 and B | A << 8 halfwords as 2 rows of 4 RGBA8 texels
+static inline void TextureDecoder_StoreRGBA(u32* dst, int stride, __m128i rg, __m128i ba) {
+    _mm_storeu_si128((__m128i*)&dst[0], _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128((__m128i*)&dst[stride], _mm_unpackhi_epi16(rg, ba));
+}
+
+/// Scale 4-bit values in the low nibble of each byte to 8 bits
+static inline __m128i TextureDecoder_Expand4(__m128i v) {
+    return _mm_or_si128(v, _mm_slli_epi16(v, 4));
+}
+
+/// I4, 8x8 blocks of 4-bit intensities
+static void DecodeI4_SSE2(u32* dst, const u8* src, int width, int height) {
+    const __m128i mask = _mm_set1_epi8(0x0F);
+
+    for (int y = 0; y < height; y += 8) {
+        for (int x = 0; x < width; x += 8, src += 32) {
+            u32* row = &dst[y * width + x];
+            for (int i = 0; i < 2; i++, row += width * 4) {
+                __m128i v = TextureDecoder_Load8(src + i * 16);
+                __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+                __m128i lo = _mm_and_si128(v, mask);
+                TextureDecoder_StoreI(row, width,
+                    TextureDecoder_Expand4(_mm_unpacklo_epi8(hi, lo)));
+                TextureDecoder_StoreI(row + width * 2, width,
+                    TextureDecoder_Expand4(_mm_unpackhi_epi8(hi, lo)));
+            }
+        }
+    }
+}
+
+/// I8, 8x4 blocks of 8-bit intensities
+static void DecodeI8_SSE2(u32* dst, const u8* src, int width, int height) {
+    for (int y = 0; y < height; y += 4) {
+        for (int x = 0; x < width; x += 8, src += 32) {
+            u32* row = &dst[y * width + x];
+            TextureDecoder_StoreI(row, width, TextureDecoder_Load8(src));
+            TextureDecoder_StoreI(row + width * 2, width, TextureDecoder_Load8(src + 16));
+        }
+    }
+}
+
+/// IA4, 8x4 blocks of 4-bit alpha (high nibble) and intensity (low nibble) pairs
+static void DecodeIA4_SSE2(u32* dst, const u8* src, int width, int height) {
+    const __m128i mask = _mm_set1_epi8(0x0F);
+
+    for (int y = 0; y < height; y += 4) {
+        for (int x = 0; x < width; x += 8, src += 32) {
+            u32* row = &dst[y * width + x];
+            for (int i = 0; i < 2; i++, row += width * 2) {
+                __m128i v = TextureDecoder_Load8(src + i * 16);
+                __m128i a = TextureDecoder_Expand4(_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+                __m128i l = TextureDecoder_Expand4(_mm_and_si128(v, mask));
+                TextureDecoder_StoreIA(row, width, l, a);
+            }
+        }
+    }
+}
+
+/// IA8, 4x4 blocks of 8-bit alpha and intensity pairs
+static void DecodeIA8_SSE2(u32* dst, const u8* src, int width, int height) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+
+    for (int y = 0; y < height; y += 4) {
+        for (int x = 0; x < width; x += 4, src += 32) {
+            u32* row = &dst[y * width + x];
+            for (int i = 0; i < 2; i++, row += width * 2) {
+                // Halfwords are A << 8 | I, which is the upper half of a texel already
+                __m128i ai = TextureDecoder_Load16(src + i * 16);
+                __m128i l = _mm_and_si128(ai, mask);
+                TextureDecoder_StoreRGBA(row, width, _mm_or_si128(l, _mm_slli_epi16(l, 8)), ai);
+            }
+        }
+    }
+}
+
+/// RGB565, 4x4 blocks
+static void DecodeRGB565_SSE2(u32* dst, const u8* src, int width, int height) {
+    const __m128i mask5 = _mm_set1_epi16(0x1F);
+    const __m128i mask6 = _mm_set1_epi16(0x3F);
+    const __m128i alpha = _mm_set1_epi16((s16)0xFF00);
+
+    for (int y = 0; y < height; y += 4) {
+        for (int x = 0; x < width; x += 4, src += 32) {
+            u32* row = &dst[y * width + x];
+            for (int i = 0; i < 2; i++, row += width * 2) {
+                __m128i v = TextureDecoder_Load16(src + i * 16);
+                __m128i r = _mm_slli_epi16(_mm_srli_epi16(v, 11), 3);
+                __m128i g = _mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(v, 5), mask6), 2);
+                __m128i b = _mm_slli_epi16(_mm_and_si128(v, mask5), 3);
+                TextureDecoder_StoreRGBA(row, width, _mm_or_si128(r, _mm_slli_epi16(g, 8)),
+                    _mm_or_si128(b, alpha));
+            }
+        }
+    }
+}
+
+/// RGB5A3, 4x4 blocks of RGB555 (top bit set) or RGB4A3 texels
+static void DecodeRGB5A3_SSE2(u32* dst, const u8* src, int width, int height) {
+    const __m128i mask3 = _mm_set1_epi16(0x07);
+    const __m128i mask4 = _mm_set1_epi16(0x0F);
+    const __m128i mask5 = _mm_set1_epi16(0x1F);
+    const __m128i k17 = _mm_set1_epi16(17);
+    const __m128i k255 = _mm_set1_epi16(255);
+
+    for (int y = 0; y < height; y += 4) {
+        for (int x = 0; x < width; x += 4, src += 32) {
+            u32* row = &dst[y * width + x];
+            for (int i = 0; i < 2; i++, row += width * 2) {
+                __m128i v = TextureDecoder_Load16(src + i * 16);
+                __m128i rgb5 = _mm_srai_epi16(v, 15);
+
+                // 255 * (c / 32.0f) and 255 * (a / 8.0f) are exact, truncating them is a shift
+                __m128i r5 = _mm_and_si128(_mm_srli_epi16(v, 10), mask5);
+                __m128i g5 = _mm_and_si128(_mm_srli_epi16(v, 5), mask5);
+                __m128i b5 = _mm_and_si128(v, mask5);
+                r5 = _mm_srli_epi16(_mm_mullo_epi16(r5, k255), 5);
+                g5 = _mm_srli_epi16(_mm_mullo_epi16(g5, k255), 5);
+                b5 = _mm_srli_epi16(_mm_mullo_epi16(b5, k255), 5);
+
+                __m128i r4 = _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(v, 8), mask4), k17);
+                __m128i g4 = _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(v, 4), mask4), k17);
+                __m128i b4 = _mm_mullo_epi16(_mm_and_si128(v, mask4), k17);
+                __m128i a3 = _mm_and_si128(_mm_srli_epi16(v, 12), mask3);
+                a3 = _mm_srli_epi16(_mm_mullo_epi16(a3, k255), 3);
+
+                __m128i r = _mm_or_si128(_mm_and_si128(rgb5, r5), _mm_andnot_si128(rgb5, r4));
+                __m128i g = _mm_or_si128(_mm_and_si128(rgb5, g5), _mm_andnot_si128(rgb5, g4));
+                __m128i b = _mm_or_si128(_mm_and_si128(rgb5, b5), _mm_andnot_si128(rgb5, b4));
+                __m128i a = _mm_or_si128(_mm_and_si128(rgb5, k255), _mm_andnot_si128(rgb5, a3));
+                TextureDecoder_StoreRGBA(row, width, _mm_or_si128(r, _mm_slli_epi16(g, 8)),
+                    _mm_or_si128(b, _mm_slli_epi16(a, 8)));
+            }
+        }
+    }
+}
+
+/// RGBA8, 4x4 blocks of 16 AR pairs followed by 16 GB pairs
+static void DecodeRGBA8_SSE2(u32* dst, const u8* src, int width, int height) {
+    const __m128i lo = _mm_set1_epi16(0x00FF);
+    const __m128i hi = _mm_set1_epi16((s16)0xFF00);
+
+    for (int y = 0; y < height; y += 4) {
+        for (int x = 0; x < width; x += 4, src += 64) {
+            u32* row = &dst[y * width + x];
+            for (int i = 0; i < 2; i++, row += width * 2) {
+                __m128i ar = TextureDecoder_Load16(src + i * 16);
+                __m128i gb = TextureDecoder_Load16(src + i * 16 + 32);
+                TextureDecoder_StoreRGBA(row, width,
+                    _mm_or_si128(_mm_and_si128(ar, lo), _mm_and_si128(gb, hi)),
+                    _mm_or_si128(_mm_and_si128(gb, lo), _mm_and_si128(ar, hi)));
+            }
+        }
+    }
+}
+
+/// Scale DXT1 color components to 8 bits, without filling the low bits
+static inline __m128i TextureDecoder_Scale565(__m128i c, int shift, int mask, int scale) {
+    return _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(c, shift), _mm_set1_epi32(mask)), scale);
+}
+
+/// Divide 32-bit values below 768 by 3
+static inline __m128i TextureDecoder_Div3(__m128i v) {
+    return _mm_srli_epi32(_mm_mulhi_epu16(v, _mm_set1_epi32(0xAAAB)), 1);
+}
+
+/// Combine 8-bit components in 32-bit lanes to opaque RGBA8 colors
+static inline __m128i TextureDecoder_PackRGB(__m128i r, __m128i g, __m128i b) {
+    return _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+        _mm_or_si128(_mm_slli_epi32(b, 16), _mm_set1_epi32((int)0xFF000000)));
+}
+
+/**
+ * Store the 4x4 texels of a DXT1 block
+ * @param dst Top left texel of the block
+ * @param stride Width of the texture
+ * @param bits 2-bit indices of the block in each lane, top byte for the first row
+ * @param palette The 4 colors of the block
+ */
+static inline void TextureDecoder_StoreDXT(u32* dst, int stride, __m128i bits, __m128i palette) {
+    const __m128i mask = _mm_set_epi32(0x03000000, 0x0C000000, 0x30000000, 0xC0000000);
+    const __m128i one = _mm_set_epi32(0x01000000, 0x04000000, 0x10000000, 0x40000000);
+    const __m128i col0 = _mm_shuffle_epi32(palette, 0x00);
+    const __m128i col1 = _mm_shuffle_epi32(palette, 0x55);
+    const __m128i col2 = _mm_shuffle_epi32(palette, 0xAA);
+    const __m128i col3 = _mm_shuffle_epi32(palette, 0xFF);
+
+    for (int dy = 0; dy < 4; dy++, dst += stride, bits = _mm_slli_epi32(bits, 8)) {
+        __m128i index = _mm_and_si128(bits, mask);
+        __m128i texels = _mm_and_si128(_mm_cmpeq_epi32(index, _mm_setzero_si128()), col0);
+        texels = _mm_or_si128(texels, _mm_and_si128(_mm_cmpeq_epi32(index, one), col1));
+        texels = _mm_or_si128(texels, _mm_and_si128(_mm_cmpeq_epi32(index,
+            _mm_add_epi32(one, one)), col2));
+        texels = _mm_or_si128(texels, _mm_and_si128(_mm_cmpeq_epi32(index, mask), col3));
+        _mm_storeu_si128((__m128i*)dst, texels);
+    }
+}
+
+/**
+ * CMPR, 8x8 blocks of 4 DXT1 blocks. The palettes of the 4 blocks are built together, one block
+ * in each lane, then each texel selects its palette color with compares instead of a lookup.
+ */
+static void DecodeCMPR_SSE2(u32* dst, const u8* src, int width, int height) {
+    for (int y = 0; y < height; y += 8) {
+        for (int x = 0; x < width; x += 8, src += 32) {
+            __m128 lo = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)src));
+            __m128 hi = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(src + 16)));
+
+            // The first word of a block is color0 << 16 | color1 as RAM is word swapped
+            __m128i colors = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i bits = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+            __m128i c0 = _mm_srli_epi32(colors, 16);
+            __m128i c1 = _mm_and_si128(colors, _mm_set1_epi32(0xFFFF));
+            __m128i gt = _mm_cmpgt_epi32(c0, c1);
+
+            __m128i r0 = TextureDecoder_Scale565(c0, 11, 0x1F, 3);
+            __m128i g0 = TextureDecoder_Scale565(c0, 5, 0x3F, 2);
+            __m128i b0 = TextureDecoder_Scale565(c0, 0, 0x1F, 3);
+            __m128i r1 = TextureDecoder_Scale565(c1, 11, 0x1F, 3);
+            __m128i g1 = TextureDecoder_Scale565(c1, 5, 0x3F, 2);
+            __m128i b1 = TextureDecoder_Scale565(c1, 0, 0x1F, 3);
+
+            // color0 > color1: 2/3 and 1/3 of the way, otherwise halfway and transparent black
+            __m128i third0 = TextureDecoder_PackRGB(
+                TextureDecoder_Div3(_mm_add_epi32(_mm_add_epi32(r0, r0), r1)),
+                TextureDecoder_Div3(_mm_add_epi32(_mm_add_epi32(g0, g0), g1)),
+                TextureDecoder_Div3(_mm_add_epi32(_mm_add_epi32(b0, b0), b1)));
+            __m128i third1 = TextureDecoder_PackRGB(
+                TextureDecoder_Div3(_mm_add_epi32(_mm_add_epi32(r1, r1), r0)),
+                TextureDecoder_Div3(_mm_add_epi32(_mm_add_epi32(g1, g1), g0)),
+                TextureDecoder_Div3(_mm_add_epi32(_mm_add_epi32(b1, b1), b0)));
+            __m128i half = TextureDecoder_PackRGB(
+                _mm_srli_epi32(_mm_add_epi32(r0, r1), 1),
+                _mm_srli_epi32(_mm_add_epi32(g0, g1), 1),
+                _mm_srli_epi32(_mm_add_epi32(b0, b1), 1));
+
+            __m128i col0 = TextureDecoder_PackRGB(r0, g0, b0);
+            __m128i col1 = TextureDecoder_PackRGB(r1, g1, b1);
+            __m128i col2 = _mm_or_si128(_mm_and_si128(gt, third0), _mm_andnot_si128(gt, half));
+            __m128i col3 = _mm_and_si128(gt, third1);
+
+            // Transpose to the palette of each block
+            __m128i t0 = _mm_unpacklo_epi32(col0, col1);
+            __m128i t1 = _mm_unpacklo_epi32(col2, col3);
+            __m128i t2 = _mm_unpackhi_epi32(col0, col1);
+            __m128i t3 = _mm_unpackhi_epi32(col2, col3);
+
+            u32* row = &dst[y * width + x];
+            TextureDecoder_StoreDXT(row, width, _mm_shuffle_epi32(bits, 0x00),
+                _mm_unpacklo_epi64(t0, t1));
+            TextureDecoder_StoreDXT(row + 4, width, _mm_shuffle_epi32(bits, 0x55),
+                _mm_unpackhi_epi64(t0, t1));
+            TextureDecoder_StoreDXT(row + width * 4, width, _mm_shuffle_epi32(bits, 0xAA),
+                _mm_unpacklo_epi64(t2, t3));
+            TextureDecoder_StoreDXT(row + width * 4 + 4, width, _mm_shuffle_epi32(bits, 0xFF),
+                _mm_unpackhi_epi64(t2, t3));
+        }
+    }
+}
+
+#ifdef TEXTURE_DECODER_USE_SSSE3
+
+// With SSSE3 the word swap and the texel expansion are one shuffle of the data as it is in RAM
+
+/// I8, 8x4 blocks of 8-bit intensities
+TEXTURE_DECODER_SSSE3 static void DecodeI8_SSSE3(u32* dst, const u8* src, int width,
+    int height) {
+    const __m128i shuffle = _mm_setr_epi8(3, 3, 3, 3, 2, 2, 2, 2, 1, 1, 1, 1, 0, 0, 0, 0);
+    const __m128i next = _mm_set1_epi8(4);
+
+    for (int y = 0; y < height; y += 4) {
+        for (int x = 0; x < width; x += 8, src += 32) {
+            u32* row = &dst[y * width + x];
+            for (int i = 0; i < 2; i++, row += width * 2) {
+                __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 16));
+                __m128i s = shuffle;
+                for (int j = 0; j < 4; j++, s = _mm_add_epi8(s, next)) {
+                    _mm_storeu_si128((__m128i*)&row[(j >> 1) * width + (j & 1) * 4],
+                        _mm_shuffle_epi8(v, s));
+                }
+            }
+        }
+    }
+}
+
+/// IA8, 4x4 blocks of 8-bit alpha and intensity pairs
+TEXTURE_DECODER_SSSE3 static void DecodeIA8_SSSE3(u32* dst, const u8* src, int width,
+    int height) {
+    const __m128i shuffle0 = _mm_setr_epi8(2, 2, 2, 3, 0, 0, 0, 1, 6, 6, 6, 7, 4, 4, 4, 5);
+    const __m128i shuffle1 = _mm_add_epi8(shuffle0, _mm_set1_epi8(8));
+
+    for (int y = 0; y < height; y += 4) {
+        for (int x = 0; x < width; x += 4, src += 32) {
+            u32* row = &dst[y * width + x];
+            for (int i = 0; i < 2; i++, row += width * 2) {
+                __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 16));
+                _mm_storeu_si128((__m128i*)&row[0], _mm_shuffle_epi8(v, shuffle0));
+                _mm_storeu_si128((__m128i*)&row[width], _mm_shuffle_epi8(v, shuffle1));
+            }
+        }
+    }
+}
+
+/// RGBA8, 4x4 blocks of 16 AR pairs followed by 16 GB pairs
+TEXTURE_DECODER_SSSE3 static void DecodeRGBA8_SSSE3(u32* dst, const u8* src, int width,
+    int height) {
+    // Zeroed lanes (-128) stay zeroed when the shuffles are moved to the next 4 texels
+    const __m128i shuffle_ar = _mm_setr_epi8(2, -128, -128, 3, 0, -128, -128, 1,
+                                             6, -128, -128, 7, 4, -128, -128, 5);
+    const __m128i shuffle_gb = _mm_setr_epi8(-128, 3, 2, -128, -128, 1, 0, -128,
+                                             -128, 7, 6, -128, -128, 5, 4, -128);
+    const __m128i next = _mm_set1_epi8(8);
+
+    for (int y = 0; y < height; y += 4) {
+        for (int x = 0; x < width; x += 4, src += 64) {
+            u32* row = &dst[y * width + x];
+            for (int i = 0; i < 2; i++, row += width * 2) {
+                __m128i ar = _mm_loadu_si128((const __m128i*)(src + i * 16));
+                __m128i gb = _mm_loadu_si128((const __m128i*)(src + i * 16 + 32));
+                _mm_storeu_si128((__m128i*)&row[0], _mm_or_si128(
+                    _mm_shuffle_epi8(ar, shuffle_ar), _mm_shuffle_epi8(gb, shuffle_gb)));
+                _mm_storeu_si128((__m128i*)&row[width], _mm_or_si128(
+                    _mm_shuffle_epi8(ar, _mm_add_epi8(shuffle_ar, next)),
+                    _mm_shuffle_epi8(gb, _mm_add_epi8(shuffle_gb, next))));
+            }
+        }
+    }
+}
+
+#endif // TEXTURE_DECODER_USE_SSSE3
+
+#endif // TEXTURE_DECODER_USE_SSE2
+
+/// Set the block size and fast decoder of a texture format
+static void TextureDecoder_SetFormat(TextureFormat format, int block_width, int block_height,
+    TextureDecoder_Func func) {
+    g_decoder_formats[format].block_width = block_width;
+    g_decoder_formats[format].block_height = block_height;
+    g_decoder_formats[format].func = func;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// PARALLEL AND ASYNCHRONOUS DECODING
+//
+// A pool of worker threads decodes textures in the background. Large textures are split in rows of
+// blocks, which the workers decode together with the calling thread. Rows don't share source or
+// destination bytes, so the result is the same for any number of threads. Asynchronous jobs are
+// decoded whole by one worker each, from a copy of their source and into their own buffer. Color
+// indexed textures read the TLUT registers and TMEM, which only the GP thread may touch, so they
+// are decoded when the job is started.
+
+static const int kDecoderMaxThreads     = 16;           ///< Upper limit of decoder threads
+static const int kDecoderParallelTexels = 512 * 512;    ///< Smallest texture split across threads
+
+/// Texture being decoded by rows of blocks
+struct TextureDecoder_Rows {
+    TextureDecoder_Func func;
+    u32*                dst;
+    const u8*           src;
+    int                 width;
+    int                 block_height;
+    int                 num_rows;           ///< Rows of blocks
+    size_t              row_size;           ///< Source bytes per row of blocks
+};
+
+/// State of an asynchronous decode job
+enum TextureDecoder_JobState {
+    kJobState_Queued = 0,                   ///< Waiting for a worker
+    kJobState_Running,                      ///< Being decoded
+    kJobState_Done                          ///< Texels are ready
+};
+
+struct TextureDecoder_Job {
+    TextureFormat           format;
+    int                     width;
+    int                     height;
+    const u8*               src;            ///< Points into src_copy
+    std::vector<u8>         src_copy;       ///< Source texture, copied when the job is started
+    std::vector<u8>         dst;            ///< Decoded RGBA8 texels
+    TextureDecoder_JobState state;
+};
+
+static std::thread*             g_decoder_threads[kDecoderMaxThreads];
+static int                      g_decoder_num_threads = 1;
+static std::mutex               g_decoder_mutex;
+static std::condition_variable  g_decoder_work_cv;      ///< Signaled when there's work or on quit
+static std::condition_variable  g_decoder_done_cv;      ///< Signaled when rows or a job are done
+static TextureDecoder_Rows      g_decoder_rows;
+static int                      g_decoder_next_row = 0;     ///< Next row of blocks to be picked up
+static int                      g_decoder_rows_done = 0;    ///< Rows of blocks decoded
+static std::deque<TextureDecoder_Job*> g_decoder_queue;     ///< Jobs waiting for a worker
+static bool                     g_decoder_quit = false;
+
+static bool TextureDecoder_DecodeFast(TextureFormat format, int width, int height, const u8* src,
+    u8* dst, bool split);
+
+/**
+ * Decode the next row of blocks of the texture being split, if any
+ * @param lock Lock of g_decoder_mutex, held on entry and on return
+ * @return True if a row was decoded, false if there were none left
+ */
+static bool TextureDecoder_ProcessRow(std::unique_lock<std::mutex>& lock) {
+    if (g_decoder_next_row >= g_decoder_rows.num_rows) {
+        return false;
+    }
+    const TextureDecoder_Rows rows = g_decoder_rows;
+    const int row = g_decoder_next_row++;
+    lock.unlock();
+
+    rows.func(rows.dst + row * rows.block_height * rows.width, rows.src + row * rows.row_size,
+        rows.width, rows.block_height);
+
+    lock.lock();
+    if (++g_decoder_rows_done == rows.num_rows) {
+        g_decoder_done_cv.notify_all();
+    }
+    return true;
+}
+
+/**
+ * Decode a job on the calling thread
+ * @param lock Lock of g_decoder_mutex, held on entry and on return
+ * @param job Job to decode, already taken off the queue
+ * @param split Set to split a large texture across the workers, never set on a worker
+ */
+static void TextureDecoder_RunJob(std::unique_lock<std::mutex>& lock, TextureDecoder_Job* job,
+    bool split) {
+    job->state = kJobState_Running;
+    lock.unlock();
+
+    u8* dst = &job->dst[0];
+    if (!TextureDecoder_DecodeFast(job->format, job->width, job->height, job->src, dst, split)) {
+        TextureDecoder_DecodeReference(job->format, job->width, job->height, job->src, dst);
+    }
+
+    lock.lock();
+    job->state = kJobState_Done;
+    g_decoder_done_cv.notify_all();
+}
+
+/// Decoder worker thread entry point, rows of a split texture go first as a thread waits on them
+static void TextureDecoder_WorkerThread() {
+    std::unique_lock<std::mutex> lock(g_decoder_mutex);
+    while (!g_decoder_quit) {
+        if (TextureDecoder_ProcessRow(lock)) {
+            continue;
+        }
+        if (!g_decoder_queue.empty()) {
+            TextureDecoder_Job* job = g_decoder_queue.front();
+            g_decoder_queue.pop_front();
+            TextureDecoder_RunJob(lock, job, false);
+            continue;
+        }
+        g_decoder_work_cv.wait(lock);
+    }
+}
+
+/// Decode a texture of whole blocks with the worker threads, returns when all rows are done
+static void TextureDecoder_DecodeParallel(TextureFormat format, int width, int height,
+    const u8* src, u32* dst) {
+    const TextureDecoder_Format& fmt = g_decoder_formats[format];
+
+    std::unique_lock<std::mutex> lock(g_decoder_mutex);
+    g_decoder_rows.func = fmt.func;
+    g_decoder_rows.dst = dst;
+    g_decoder_rows.src = src;
+    g_decoder_rows.width = width;
+    g_decoder_rows.block_height = fmt.block_height;
+    g_decoder_rows.num_rows = height / fmt.block_height;
+    // Blocks are 32 bytes, RGBA8 blocks are two of them
+    g_decoder_rows.row_size = (width / fmt.block_width) *
+        (kTextureFormat_RGBA8 == format ? 64 : 32);
+    g_decoder_next_row = 0;
+    g_decoder_rows_done = 0;
+    g_decoder_work_cv.notify_all();
+
+    while (TextureDecoder_ProcessRow(lock)) {
+    }
+    // Rows picked up by workers may still be decoding
+    while (g_decoder_rows_done < g_decoder_rows.num_rows) {
+        g_decoder_done_cv.wait(lock);
+    }
+}
+
+/// Start the decoder worker threads, num_threads counts the thread calling the decoder
+static void TextureDecoder_StartThreads(int num_threads) {
+    g_decoder_num_threads = CLAMP(num_threads, 1, kDecoderMaxThreads);
+    g_decoder_quit = false;
+
+    // The calling thread decodes too, so one less worker is needed
+    for (int i = 1; i < g_decoder_num_threads; i++) {
+        g_decoder_threads[i] = new std::thread(TextureDecoder_WorkerThread);
+    }
+}
+
+/// Stop the decoder worker threads, jobs still queued are decoded by TextureDecoder_Wait
+static void TextureDecoder_StopThreads() {
+    {
+        std::lock_guard<std::mutex> lock(g_decoder_mutex);
+        g_decoder_quit = true;
+        g_decoder_work_cv.notify_all();
+    }
+    for (int i = 1; i < g_decoder_num_threads; i++) {
+        if (g_decoder_threads[i]) {
+            g_decoder_threads[i]->join();
+            delete g_decoder_threads[i];
+            g_decoder_threads[i] = NULL;
+        }
+    }
+    g_decoder_num_threads = 1;
+}
+
+/// Start decoding a texture on the decoder threads, into a buffer owned by the job
+TextureDecoder_Job* TextureDecoder_DecodeAsync(TextureFormat format, int width, int height,
+    const u8* src) {
+    TextureDecoder_Job* job = new TextureDecoder_Job();
+    job->format = format;
+    job->width = width;
+    job->height = height;
+    // The reference decoders write whole blocks, at most 8x8 texels
+    job->dst.resize(((width + 7) & ~7) * ((height + 7) & ~7) * 4);
+
+    if (kTextureFormat_C4 == format || kTextureFormat_C8 == format ||
+        kTextureFormat_C14X2 == format) {
+        job->src = src;
+        TextureDecoder_Decode(format, width, height, src, &job->dst[0]);
+        job->state = kJobState_Done;
+        return job;
+    }
+    // Emulation goes on writing RAM while the job waits, and the decoders read whole blocks
+    int block_width = (kTextureFormat_Intensity4 == format || kTextureFormat_CMPR == format ||
+        kTextureFormat_Intensity8 == format || kTextureFormat_IntensityAlpha4 == format) ? 8 : 4;
+    int block_height = (kTextureFormat_Intensity4 == format || kTextureFormat_CMPR == format) ?
+        8 : 4;
+    job->src_copy.assign(src, src + TextureDecoder_GetSize(format,
+        (width + block_width - 1) & ~(block_width - 1),
+        (height + block_height - 1) & ~(block_height - 1)));
+    job->src = &job->src_copy[0];
+    job->state = kJobState_Queued;
+
+    // Without workers the job is decoded when it's waited on
+    if (g_decoder_num_threads > 1) {
+        std::lock_guard<std::mutex> lock(g_decoder_mutex);
+        g_decoder_queue.push_back(job);
+        g_decoder_work_cv.notify_one();
+    }
+    return job;
+}
+
+/// Wait for a decode job to be done, returns the decoded texels
+u8* TextureDecoder_Wait(TextureDecoder_Job* job) {
+    std::unique_lock<std::mutex> lock(g_decoder_mutex);
+    if (kJobState_Queued == job->state) {
+        // Not picked up yet, it's quicker to decode it here than to wait for a worker
+        std::deque<TextureDecoder_Job*>::iterator itr =
+            std::find(g_decoder_queue.begin(), g_decoder_queue.end(), job);
+        if (itr != g_decoder_queue.end()) {
+            g_decoder_queue.erase(itr);
+        }
+        TextureDecoder_RunJob(lock, job, true);
+    }
+    while (kJobState_Done != job->state) {
+        g_decoder_done_cv.wait(lock);
+    }
+    return &job->dst[0];
+}
+
+/// Release a decode job, cancelling it if no worker has started it
+void TextureDecoder_Release(TextureDecoder_Job* job) {
+    std::unique_lock<std::mutex> lock(g_decoder_mutex);
+    if (kJobState_Queued == job->state) {
+        std::deque<TextureDecoder_Job*>::iterator itr =
+            std::find(g_decoder_queue.begin(), g_decoder_queue.end(), job);
+        if (itr != g_decoder_queue.end()) {
+            g_decoder_queue.erase(itr);
+        }
+    } else {
+        // A worker may still be writing the texels
+        while (kJobState_Done != job->state) {
+            g_decoder_done_cv.wait(lock);
+        }
+    }
+    lock.unlock();
+    delete job;
+}
+
+/**
+ * Decode a texture with the fast decoders
+ * @param split Set to split a large texture across the worker threads
+ * @return True on success, false if the texture must be decoded by the reference decoders
+ */
+static bool TextureDecoder_DecodeFast(TextureFormat format, int width, int height, const u8* src,
+    u8* dst, bool split) {
+    if (format >= kTextureFormat_None || NULL == g_decoder_formats[format].func ||
+        (width % g_decoder_formats[format].block_width) ||
+        (height % g_decoder_formats[format].block_height)) {
+        return false;
+    }
+    if (split && g_decoder_num_threads > 1 && width * height >= kDecoderParallelTexels) {
+        TextureDecoder_DecodeParallel(format, width, height, src, (u32*)dst);
+    } else {
+        g_decoder_formats[format].func((u32*)dst, src, width, height);
+    }
+    return true;
+}
+
 /**
  * Get the size of a texture
  * @param format Format of the texture
@@ -212,6 +954,93 @@ size_t TextureDecoder_GetSize(TextureFormat format, int width, int height) {
  * @param dst Destination data buffer for decoded RGBA8 texture
  */
 void TextureDecoder_Decode(TextureFormat format, int width, int height, const u8* src, u8* dst) {
+    if (!TextureDecoder_DecodeFast(format, width, height, src, dst, true)) {
+        TextureDecoder_DecodeReference(format, width, height, src, dst);
+    }
+}
+
+/**
+ * Decode the palette indices of a color indexed texture, one per texel
+ * @param format Format of the source texture (C4, C8 or C14X2)
+ * @param width Width in pixels of the texture
+ * @param height Height in pixels of the texture
+ * @param src Source data buffer of texture to decode
+ * @param dst Destination buffer for width * height indices, in row order
+ */
+void TextureDecoder_DecodeIndices(TextureFormat format, int width, int height, const u8* src,
+    u16* dst) {
+    int block_width = 8;
+    int block_height = 4;
+    if (kTextureFormat_C4 == format) {
+        block_height = 8;
+    } else if (kTextureFormat_C14X2 == format) {
+        block_width = 4;
+    }
+    // Blocks are 32 bytes, cut off at the right and bottom edges of the texture
+    for (int y = 0; y < height; y += block_height) {
+        for (int x = 0; x < width; x += block_width, src += 32) {
+            int rows = MIN(block_height, height - y);
+            int cols = MIN(block_width, width - x);
+            for (int dy = 0; dy < rows; dy++) {
+                u16* row = &dst[(y + dy) * width + x];
+                for (int dx = 0; dx < cols; dx++) {
+                    int i = dy * block_width + dx;
+                    switch (format) {
+                    case kTextureFormat_C4:
+                        row[dx] = (src[(i >> 1) ^ 3] >> ((~i & 1) << 2)) & 0xf;
+                        break;
+                    case kTextureFormat_C8:
+                        row[dx] = src[i ^ 3];
+                        break;
+                    default:
+                        row[dx] = ((src[(i * 2) ^ 3] << 8) | src[(i * 2 + 1) ^ 3]) & 0x3fff;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Decode a palette to RGBA8 format
+ * @param tlut Palette in TMEM
+ * @param tlut_format Palette format, 0 - IA8, 1 - RGB565, 2 - RGB5A3
+ * @param num_entries Number of palette entries
+ * @param dst Destination buffer for num_entries RGBA8 colors
+ */
+void TextureDecoder_DecodePalette(const u8* tlut, int tlut_format, int num_entries, u32* dst) {
+    memset(dst, 0, num_entries * 4);
+    for (int i = 0; i < num_entries; i++) {
+        unpackPixel(i, (u8*)&dst[i], (u16*)tlut, tlut_format);
+    }
+}
+
+/**
+ * Expand palette indices to a RGBA8 texture
+ * @param indices Palette indices, as decoded by TextureDecoder_DecodeIndices
+ * @param num_texels Number of texels
+ * @param palette RGBA8 palette, as decoded by TextureDecoder_DecodePalette
+ * @param dst Destination data buffer for decoded RGBA8 texture
+ */
+void TextureDecoder_ExpandIndices(const u16* indices, int num_texels, const u32* palette,
+    u8* dst) {
+    u32* dst32 = (u32*)dst;
+    for (int i = 0; i < num_texels; i++) {
+        dst32[i] = palette[indices[i]];
+    }
+}
+
+/**
+ * Decode a texture to RGBA8 format with the reference decoders, one texel at a time
+ * @param format Format of the source texture
+ * @param width Width in pixels of the texture
+ * @param height Height in pixels of the texture
+ * @param src Source data buffer of texture to decode
+ * @param dst Destination data buffer for decoded RGBA8 texture
+ */
+void TextureDecoder_DecodeReference(TextureFormat format, int width, int height, const u8* src,
+    u8* dst) {
     int	x = 0, y = 0, dx = 0, dy = 0, i = 0, j = 0;
     u32 val = 0;
     int _8_width = (width + 7) & ~7;
@@ -434,6 +1263,256 @@ void TextureDecoder_Decode(TextureFormat format, int width, int height, const u8
     delete dst8;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// SELF-CHECK
+//
+// Every build checks on startup that the fast decoders the host can run are bit exact with the
+// reference decoders, a decoder that differs is dropped and its format is decoded by the reference
+// decoder. Release builds check small textures so startup stays quick. Debug builds (DEBUG_GX)
+// check the 16-bit formats on every possible texel value, and stop on a difference.
+
+#ifdef DEBUG_GX
+static const int kSelfCheckSize = 256;  ///< Width and height of the checked textures
+#else
+static const int kSelfCheckSize = 32;   ///< Width and height of the checked textures
+#endif
+
+/// Fast decoder checked against the reference decoder
+struct TextureDecoder_CheckedFunc {
+    TextureFormat       format;
+    TextureDecoder_Func func;
+    const char*         name;
+};
+
+/**
+ * Fill a texture source with every 16-bit value in turn, or with noise
+ * @param src Source to fill, in RAM byte order
+ * @param size Size of the source in bytes
+ * @param noise Set for noise, otherwise values count up from 0
+ */
+static void TextureDecoder_FillSelfCheck(u8* src, size_t size, bool noise) {
+    u32 seed = 0x1234567;
+    for (size_t i = 0; i < size / 2; i++) {
+        seed = seed * 1103515245 + 12345;
+        // RAM is stored word swapped, the halfwords of a word are swapped too
+        ((u16*)src)[i ^ 1] = noise ? (u16)(seed >> 16) : (u16)i;
+    }
+}
+
+/**
+ * Compare a fast decoder with the reference decoder
+ * @param checked Decoder to check
+ * @param width Width in pixels of the texture, a multiple of 8
+ * @param height Height in pixels of the texture, a multiple of 8
+ * @param src Source data buffer of the texture
+ * @return True if both decoded the same texels
+ */
+static bool TextureDecoder_CheckFunc(const TextureDecoder_CheckedFunc& checked, int width,
+    int height, const u8* src) {
+    std::vector<u32> expected(width * height);
+    std::vector<u32> decoded(width * height);
+
+    TextureDecoder_DecodeReference(checked.format, width, height, src, (u8*)&expected[0]);
+    checked.func(&decoded[0], src, width, height);
+
+    for (int i = 0; i < width * height; i++) {
+        if (expected[i] != decoded[i]) {
+            LOG_ERROR(TGP, "%s texture decoder differs at texel %d,%d: %08x instead of %08x",
+                      checked.name, i % width, i / width, decoded[i], expected[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Compare the CMPR decoders with DecodeDtxBlock on blocks of both modes, and on a texture split in
+ * rows of blocks. The rows go to the worker threads already running, with a single hardware thread
+ * there are none and the calling thread decodes every row.
+ * @return True if both decoded the same texels
+ */
+static bool TextureDecoder_CheckCMPR() {
+    const int size = kSelfCheckSize;
+    // One row of blocks, the whole texture, then the whole texture split in rows
+    const int heights[] = { 8, size, size };
+    std::vector<u8> src(size * size / 2);
+    std::vector<u32> expected(size * size);
+    std::vector<u32> decoded(size * size);
+    bool ok = true;
+
+    TextureDecoder_FillSelfCheck(&src[0], src.size(), true);
+    for (size_t block = 0; block < src.size() / 8; block++) {
+        // Color 1 is the halfword at offset 2 and color 2 the one at offset 0 (see DecodeDtxBlock)
+        u16* colors = (u16*)&src[block * 8];
+        u16 high = MAX(colors[0], colors[1]);
+        u16 low = MIN(colors[0], colors[1]);
+
+        switch (block % 3) {
+        case 0: // 4 colors, color 1 greater than color 2
+            if (high == low) {
+                high |= 1;
+                low = high - 1;
+            }
+            colors[1] = high;
+            colors[0] = low;
+            break;
+        case 1: // 3 colors and transparent, color 1 less than color 2
+            colors[1] = low;
+            colors[0] = high;
+            break;
+        default: // 3 colors and transparent, both colors the same
+            colors[1] = colors[0];
+            break;
+        }
+    }
+    DecompressDxt1(&expected[0], &src[0], size, size);
+    for (int pass = 0; pass < 3; pass++) {
+        memset(&decoded[0], 0, decoded.size() * 4);
+        if (pass < 2) {
+            TextureDecoder_Decode(kTextureFormat_CMPR, size, heights[pass], &src[0],
+                (u8*)&decoded[0]);
+        } else if (g_decoder_formats[kTextureFormat_CMPR].func) {
+            // Large textures only take this path with workers, it's called directly so the
+            // split is checked whatever the number of threads
+            TextureDecoder_DecodeParallel(kTextureFormat_CMPR, size, size, &src[0], &decoded[0]);
+        } else {
+            break;
+        }
+
+        for (int i = 0; i < size * heights[pass]; i++) {
+            if (expected[i] != decoded[i]) {
+                LOG_ERROR(TGP, "CMPR texture decoder differs at texel %d,%d of %dx%d%s: %08x "
+                          "instead of %08x", i % size, i / size, size, heights[pass],
+                          pass == 2 ? " split" : "", decoded[i], expected[i]);
+                ok = false;
+                break;
+            }
+        }
+    }
+    return ok;
+}
+
+/**
+ * Check all the fast decoders the host CPU supports against the reference decoders, the selected
+ * decoders that fail are dropped
+ */
+static void TextureDecoder_SelfCheck() {
+    static const TextureDecoder_CheckedFunc kSSE2Funcs[] = {
+        { kTextureFormat_C4, DecodeC4, "C4" },
+        { kTextureFormat_C8, DecodeC8, "C8" },
+#ifdef TEXTURE_DECODER_USE_SSE2
+        { kTextureFormat_Intensity4, DecodeI4_SSE2, "I4 SSE2" },
+        { kTextureFormat_Intensity8, DecodeI8_SSE2, "I8 SSE2" },
+        { kTextureFormat_IntensityAlpha4, DecodeIA4_SSE2, "IA4 SSE2" },
+        { kTextureFormat_IntensityAlpha8, DecodeIA8_SSE2, "IA8 SSE2" },
+        { kTextureFormat_RGB565, DecodeRGB565_SSE2, "RGB565 SSE2" },
+        { kTextureFormat_RGB5A3, DecodeRGB5A3_SSE2, "RGB5A3 SSE2" },
+        { kTextureFormat_RGBA8, DecodeRGBA8_SSE2, "RGBA8 SSE2" },
+        { kTextureFormat_CMPR, DecodeCMPR_SSE2, "CMPR SSE2" },
+#endif
+    };
+    std::vector<TextureDecoder_CheckedFunc> funcs(kSSE2Funcs,
+        kSSE2Funcs + sizeof(kSSE2Funcs) / sizeof(kSSE2Funcs[0]));
+
+#ifdef TEXTURE_DECODER_USE_SSSE3
+    static const TextureDecoder_CheckedFunc kSSSE3Funcs[] = {
+        { kTextureFormat_Intensity8, DecodeI8_SSSE3, "I8 SSSE3" },
+        { kTextureFormat_IntensityAlpha8, DecodeIA8_SSSE3, "IA8 SSSE3" },
+        { kTextureFormat_RGBA8, DecodeRGBA8_SSSE3, "RGBA8 SSSE3" },
+    };
+    common::X86Utils x86_utils;
+    if (x86_utils.IsExtensionSupported(common::X86Utils::kExtensionX86_SSSE3)) {
+        funcs.insert(funcs.end(), kSSSE3Funcs,
+            kSSSE3Funcs + sizeof(kSSSE3Funcs) / sizeof(kSSSE3Funcs[0]));
+    }
+#endif
+
+    // Large enough for every 16-bit value of a 16-bit format, or for a RGBA8 texture
+    std::vector<u8> src(kSelfCheckSize * kSelfCheckSize * 4);
+    int failed = 0;
+
+    // C4/C8 are checked with a noise RGB5A3 palette, the TLUT state is restored afterwards
+    u32 tlut_reg = gp::g_bp_regs.mem[0x98];
+    std::vector<u8> tlut(&tmem[0], &tmem[512]);
+    gp::g_bp_regs.mem[0x98] = 2 << 10;
+    TextureDecoder_FillSelfCheck(&tmem[0], 512, true);
+
+    for (int noise = 0; noise < 2; noise++) {
+        TextureDecoder_FillSelfCheck(&src[0], src.size(), noise != 0);
+        for (size_t i = 0; i < funcs.size(); i++) {
+            if (!TextureDecoder_CheckFunc(funcs[i], kSelfCheckSize, kSelfCheckSize, &src[0])) {
+                if (g_decoder_formats[funcs[i].format].func == funcs[i].func) {
+                    g_decoder_formats[funcs[i].format].func = NULL;
+                }
+                failed++;
+            }
+        }
+    }
+    gp::g_bp_regs.mem[0x98] = tlut_reg;
+    std::copy(tlut.begin(), tlut.end(), &tmem[0]);
+
+    if (!TextureDecoder_CheckCMPR()) {
+        g_decoder_formats[kTextureFormat_CMPR].func = NULL;
+        failed++;
+    }
+
+    if (failed) {
+#ifdef DEBUG_GX
+        _ASSERT_MSG(TGP, 0, "%d texture decoder self-checks failed!", failed);
+#endif
+        LOG_ERROR(TGP, "%d texture decoder self-checks failed, using the reference decoders for "
+                  "them", failed);
+    } else {
+        LOG_NOTICE(TGP, "texture decoder self-check passed (%d decoders)", (int)funcs.size());
+    }
+}
+
+/// Select the fast decoders the host CPU supports
+static void TextureDecoder_SelectDecoders() {
+    TextureDecoder_SetFormat(kTextureFormat_C4, 8, 8, DecodeC4);
+    TextureDecoder_SetFormat(kTextureFormat_C8, 8, 4, DecodeC8);
+
+#ifdef TEXTURE_DECODER_USE_SSE2
+    TextureDecoder_SetFormat(kTextureFormat_Intensity4, 8, 8, DecodeI4_SSE2);
+    TextureDecoder_SetFormat(kTextureFormat_Intensity8, 8, 4, DecodeI8_SSE2);
+    TextureDecoder_SetFormat(kTextureFormat_IntensityAlpha4, 8, 4, DecodeIA4_SSE2);
+    TextureDecoder_SetFormat(kTextureFormat_IntensityAlpha8, 4, 4, DecodeIA8_SSE2);
+    TextureDecoder_SetFormat(kTextureFormat_RGB565, 4, 4, DecodeRGB565_SSE2);
+    TextureDecoder_SetFormat(kTextureFormat_RGB5A3, 4, 4, DecodeRGB5A3_SSE2);
+    TextureDecoder_SetFormat(kTextureFormat_RGBA8, 4, 4, DecodeRGBA8_SSE2);
+    TextureDecoder_SetFormat(kTextureFormat_CMPR, 8, 8, DecodeCMPR_SSE2);
+
+#ifdef TEXTURE_DECODER_USE_SSSE3
+    common::X86Utils x86_utils;
+    if (x86_utils.IsExtensionSupported(common::X86Utils::kExtensionX86_SSSE3)) {
+        TextureDecoder_SetFormat(kTextureFormat_Intensity8, 8, 4, DecodeI8_SSSE3);
+        TextureDecoder_SetFormat(kTextureFormat_IntensityAlpha8, 4, 4, DecodeIA8_SSSE3);
+        TextureDecoder_SetFormat(kTextureFormat_RGBA8, 4, 4, DecodeRGBA8_SSSE3);
+        LOG_NOTICE(TGP, "texture decoder using SSSE3");
+        return;
+    }
+#endif
+    LOG_NOTICE(TGP, "texture decoder using SSE2");
+#endif
+}
+
+/// Initialize the texture decoder, selecting the fast decoders the host CPU supports
+void TextureDecoder_Init() {
+    memset(g_decoder_formats, 0, sizeof(g_decoder_formats));
+    memset(g_decoder_threads, 0, sizeof(g_decoder_threads));
+
+    TextureDecoder_StartThreads(std::thread::hardware_concurrency());
+    LOG_NOTICE(TGP, "texture decoder using %d threads", g_decoder_num_threads);
+
+    TextureDecoder_SelectDecoders();
+    TextureDecoder_SelfCheck();
+}
+
+/// Shutdown the texture decoder, stopping the worker threads
+void TextureDecoder_Shutdown() {
+    TextureDecoder_StopThreads();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 
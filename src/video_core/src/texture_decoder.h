@@ -70,6 +70,85 @@ size_t TextureDecoder_GetSize(TextureFormat format, int width, int height);
  */
 void TextureDecoder_Decode(TextureFormat format, int width, int height, const u8* src, u8* dst);
 
+/**
+ * Decode a texture to RGBA8 format with the reference decoders, one texel at a time. The fast
+ * decoders used by TextureDecoder_Decode must give the same result.
+ * @param format Format of the source texture
+ * @param width Width in pixels of the texture
+ * @param height Height in pixels of the texture
+ * @param src Source data buffer of texture to decode
+ * @param dst Destination data buffer for decoded RGBA8 texture
+ */
+void TextureDecoder_DecodeReference(TextureFormat format, int width, int height, const u8* src,
+    u8* dst);
+
+/**
+ * Decode the palette indices of a color indexed texture, one per texel. Together with
+ * TextureDecoder_ExpandIndices this gives the same texels as TextureDecoder_Decode, but the
+ * indices can be kept while the palette changes.
+ * @param format Format of the source texture (C4, C8 or C14X2)
+ * @param width Width in pixels of the texture
+ * @param height Height in pixels of the texture
+ * @param src Source data buffer of texture to decode
+ * @param dst Destination buffer for width * height indices, in row order
+ */
+void TextureDecoder_DecodeIndices(TextureFormat format, int width, int height, const u8* src,
+    u16* dst);
+
+/**
+ * Decode a palette to RGBA8 format
+ * @param tlut Palette in TMEM
+ * @param tlut_format Palette format, 0 - IA8, 1 - RGB565, 2 - RGB5A3
+ * @param num_entries Number of palette entries
+ * @param dst Destination buffer for num_entries RGBA8 colors
+ */
+void TextureDecoder_DecodePalette(const u8* tlut, int tlut_format, int num_entries, u32* dst);
+
+/**
+ * Expand palette indices to a RGBA8 texture
+ * @param indices Palette indices, as decoded by TextureDecoder_DecodeIndices
+ * @param num_texels Number of texels
+ * @param palette RGBA8 palette, as decoded by TextureDecoder_DecodePalette
+ * @param dst Destination data buffer for decoded RGBA8 texture
+ */
+void TextureDecoder_ExpandIndices(const u16* indices, int num_texels, const u32* palette,
+    u8* dst);
+
+/// Texture decoded in the background, see TextureDecoder_DecodeAsync
+struct TextureDecoder_Job;
+
+/**
+ * Start decoding a texture to RGBA8 format on the decoder threads. The job copies its source and
+ * has its own output buffer, so any number of them may be in flight. Color indexed textures are
+ * decoded right away with the current TLUT.
+ * @param format Format of the source texture
+ * @param width Width in pixels of the texture
+ * @param height Height in pixels of the texture
+ * @param src Source data buffer of texture to decode, only read during the call
+ * @return Handle of the job, to be released with TextureDecoder_Release
+ */
+TextureDecoder_Job* TextureDecoder_DecodeAsync(TextureFormat format, int width, int height,
+    const u8* src);
+
+/**
+ * Wait for a decode job to be done, decoding it on the calling thread if no worker has started it
+ * @param job Job to wait on
+ * @return Decoded RGBA8 texture, valid until the job is released
+ */
+u8* TextureDecoder_Wait(TextureDecoder_Job* job);
+
+/**
+ * Release a decode job, cancelling it if no worker has started it
+ * @param job Job to release
+ */
+void TextureDecoder_Release(TextureDecoder_Job* job);
+
+/// Initialize the texture decoder, selecting the fast decoders the host CPU supports
+void TextureDecoder_Init();
+
+/// Shutdown the texture decoder, stopping the worker threads
+void TextureDecoder_Shutdown();
+
 } // namespace
 
 #endif // VIDEO_CORE_TEXTURE_DECODER_H_
\ No newline at end of file
@@ -28,17 +28,67 @@
 #include "texture_manager.h"
 #include "utils.h"
 #include "config.h"
+#include "profiler.h"
 
 TextureManager::TextureManager(const BackendInterface* backend_interface) {
+    common::Config::RendererConfig config = common::g_config->current_renderer_config();
+    int memory_budget = config.texture_cache_size;
+
     backend_interface_  = const_cast<BackendInterface*>(backend_interface);
-    cache_              = new CacheContainer();
+    num_entries_        = 0;
+    lru_head_           = NULL;
+    lru_tail_           = NULL;
+    bytes_used_         = 0;
+    memory_budget_      = (size_t)(memory_budget > 0 ? memory_budget : kDefaultMemoryBudget) << 20;
+    hash_samples_       = config.enable_texture_full_hash ? 0 : kHashSamples;
+    index_bytes_        = 0;
+    valid_units_        = 0;
+    table_.resize(kInitialTableSize, NULL);
     for (int i = 0; i < kGCMaxActiveTextures; i++) {
         active_textures_[i] = NULL;
     }
 }
 
 TextureManager::~TextureManager() {
-    delete cache_;
+    for (size_t i = 0; i < table_.size(); i++) {
+        if (NULL != table_[i] && NULL != table_[i]->decode_job_) {
+            gp::TextureDecoder_Release(table_[i]->decode_job_);
+        }
+        delete table_[i];
+    }
+}
+
+/// Hash of a cache key, the home slot of the texture in the cache table
+static inline u32 TextureManager_HashKey(const TextureManager::CacheKey& key) {
+    u64 hash = ((u64)key.address << 32) | (key.format << 24) | (key.width << 12) | key.height;
+    hash = (hash ^ key.tlut_hash) * 0x9E3779B97F4A7C15ULL;
+    return (u32)(hash >> 32);
+}
+
+/// Size of the palette an indexed texture format uses, 0 for direct formats
+static inline int TextureManager_GetTLUTSize(gp::TextureFormat format) {
+    switch (format) {
+    case gp::kTextureFormat_C4:
+        return 16 * 2;
+    case gp::kTextureFormat_C8:
+        return 256 * 2;
+    case gp::kTextureFormat_C14X2:
+        return 16384 * 2;
+    default:
+        break;
+    }
+    return 0;
+}
+
+/// Dumps a decoded texture to TGA if texture dumping is enabled
+static void TextureManager_DumpTexture(const TextureManager::CacheEntry& cache_entry,
+    u8* raw_data) {
+    if (common::g_config->current_renderer_config().enable_texture_dumping) {
+        std::string filepath = common::g_config->program_dir() + std::string("/dump/textures/");
+        common::CreateFullPath(filepath);
+        filepath = common::FormatStr("%s/%08x.tga", filepath.c_str(), cache_entry.hash_);
+        video_core::DumpTGA(filepath, cache_entry.width_, cache_entry.height_, raw_data);
+    }
 }
 
 /**
@@ -46,11 +96,15 @@ TextureManager::~TextureManager() {
  * @param active_texture_unit Texture unit to update (0-7)
  * @param tex_image_0 BP TexImage0 register to use for the update
  * @param tex_image_3 BP TexImage3 register to use for the update
+ * @param tex_tlut BP TexTLUT register to use for the update (only used by indexed formats)
  */
 void TextureManager::UpdateData(int active_texture_unit, const gp::BPTexImage0& tex_image_0, 
-    const gp::BPTexImage3& tex_image_3) {
+    const gp::BPTexImage3& tex_image_3, const gp::BPTexTLUT& tex_tlut) {
     static CacheEntry   cache_entry;
-    static u8           raw_data[kGCMaxTextureWidth * kGCMaxTextureHeight * 4];
+    CacheEntry*         cache_ptr;
+    CacheKey            key;
+
+    valid_units_ &= ~(1 << active_texture_unit);
 
     if (tex_image_3.image_base == 0) {
         return;
@@ -63,50 +117,104 @@ void TextureManager::UpdateData(int active_texture_unit, const gp::BPTexImage0&
     cache_entry.size_       = gp::TextureDecoder_GetSize(cache_entry.format_, 
                                                          cache_entry.width_, 
                                                          cache_entry.height_);
-    // Try to find an EFB copy in cache (EFB copy address used as hash)
-    active_textures_[active_texture_unit] = cache_->FetchFromHash(cache_entry.address_);
+    // Try to find an EFB copy in cache (EFB copy address used as key)
+    key = CacheKey();
+    key.address = cache_entry.address_;
+    key.format = gp::kTextureFormat_None;
+    cache_ptr = Lookup(key);
 
     // If that failed, try to find a normal texture in cache
-    if (NULL == active_textures_[active_texture_unit]) {
-
-        cache_entry.hash_       = common::GetHash64(&Mem_RAM[cache_entry.address_ & RAM_MASK],
-                                                    cache_entry.size_, 
-                                                    kHashSamples);
-        active_textures_[active_texture_unit] = cache_->FetchFromHash(cache_entry.hash_);
-
-        // If that failed, create a new normal texture
-        if (NULL == active_textures_[active_texture_unit]) {
-            // Decode texture from source data to RGBA8 raw data...
-            gp::TextureDecoder_Decode(cache_entry.format_, 
-                                      cache_entry.width_,
-                                      cache_entry.height_,
-                                      &Mem_RAM[cache_entry.address_ & RAM_MASK],
-                                      raw_data);
-
-            // Create a texture in VRAM from raw data...
-            cache_entry.backend_data_ = backend_interface_->Create(active_texture_unit, 
-                                                                   cache_entry,
-                                                                   raw_data);
-            // Optionally dump texture to TGA...
-            if (common::g_config->current_renderer_config().enable_texture_dumping) {
-                std::string filepath = common::g_config->program_dir() + std::string("/dump/textures/");
-                common::CreateFullPath(filepath);
-                filepath = common::FormatStr("%s/%08x.tga", filepath.c_str(), cache_entry.hash_);
-                video_core::DumpTGA(filepath, cache_entry.width_, cache_entry.height_, raw_data);
+    if (NULL == cache_ptr) {
+        key.width = cache_entry.width_;
+        key.height = cache_entry.height_;
+        key.format = cache_entry.format_;
+
+        int tlut_size = TextureManager_GetTLUTSize(cache_entry.format_);
+        if (tlut_size) {
+            key.tlut_hash = common::GetHash64(&gp::tmem[(tex_tlut.tmem_offset << 5) & TMEM_MASK],
+                                              tlut_size, 0) ^ tex_tlut.format;
+        }
+
+        cache_ptr = Lookup(key);
+
+        // Only textures whose source pages were written to since they were checked are hashed
+        if (NULL != cache_ptr && IsDirty(cache_ptr)) {
+            TrackSource(cache_ptr);
+
+            // Source data changed since the texture was decoded, replace it
+            if (cache_ptr->hash_ != HashSource(cache_ptr)) {
+                Remove(cache_ptr);
+                cache_ptr = NULL;
             }
+        }
 
-            // Update cache with new information...
-            active_textures_[active_texture_unit] = cache_->Update(cache_entry.hash_, cache_entry);
+        // If that failed, create a new normal texture, created in VRAM when it's bound. Indexed
+        // textures are expanded right away from their cached palette indices.
+        if (NULL == cache_ptr) {
+            TrackSource(&cache_entry);
+            cache_entry.hash_ = HashSource(&cache_entry);
+            if (tlut_size) {
+                cache_ptr = CreateIndexed(active_texture_unit, cache_entry, key, tex_tlut);
+            } else {
+                cache_ptr = StartDecode(cache_entry, key);
+            }
         }
     } else {
         // Get "used as" format for EFB copies
-        //_ASSERT_MSG(TGP, (cache_entry.format_ == active_textures_[active_texture_unit]->format_),
+        //_ASSERT_MSG(TGP, (cache_entry.format_ == cache_ptr->format_),
         //    "EFB copy target format %d (from BPEFBCopyExec) is not the same as requested %d!",
-        //    cache_entry.format_, active_textures_[active_texture_unit]->format_);
-        active_textures_[active_texture_unit]->format_ = cache_entry.format_;
+        //    cache_entry.format_, cache_ptr->format_);
+        cache_ptr->format_ = cache_entry.format_;
     }
 
-    active_textures_[active_texture_unit]->frame_used_ = video_core::g_current_frame;
+    active_textures_[active_texture_unit] = cache_ptr;
+    Touch(cache_ptr);
+    valid_units_ |= 1 << active_texture_unit;
+
+    EvictToBudget();
+}
+
+/**
+ * Starts decoding a texture as soon as its image registers are written, so it's ready by the
+ * time a draw binds it. Indexed textures aren't prefetched, as their palette is often loaded
+ * after the image registers.
+ * @param tex_image_0 BP TexImage0 register of the texture
+ * @param tex_image_3 BP TexImage3 register of the texture
+ */
+void TextureManager::Prefetch(const gp::BPTexImage0& tex_image_0,
+    const gp::BPTexImage3& tex_image_3) {
+    CacheEntry  cache_entry;
+    CacheKey    key;
+
+    if (tex_image_3.image_base == 0 ||
+        TextureManager_GetTLUTSize((gp::TextureFormat)tex_image_0.format)) {
+        return;
+    }
+    cache_entry.address_    = tex_image_3.image_base << 5;
+    cache_entry.format_     = (gp::TextureFormat)tex_image_0.format;
+    cache_entry.width_      = tex_image_0.width + 1;
+    cache_entry.height_     = tex_image_0.height + 1;
+    cache_entry.type_       = kSourceType_Normal;
+    cache_entry.size_       = gp::TextureDecoder_GetSize(cache_entry.format_, 
+                                                         cache_entry.width_, 
+                                                         cache_entry.height_);
+    // Textures already cached, or shadowed by an EFB copy, are checked by UpdateData when drawn
+    key.address = cache_entry.address_;
+    key.format = gp::kTextureFormat_None;
+    if (NULL != Lookup(key)) {
+        return;
+    }
+    key.width = cache_entry.width_;
+    key.height = cache_entry.height_;
+    key.format = cache_entry.format_;
+    if (NULL != Lookup(key)) {
+        return;
+    }
+    TrackSource(&cache_entry);
+    cache_entry.hash_ = HashSource(&cache_entry);
+    StartDecode(cache_entry, key);
+
+    EvictToBudget();
 }
 
 /** 
@@ -134,6 +242,9 @@ void TextureManager::CopyEFB(u32 addr, gp::BPPixelFormat efb_pixel_format,
     cache_entry.efb_copy_data_.addr_            = addr;
     cache_entry.efb_copy_data_.pixel_format_    = efb_pixel_format;
     cache_entry.efb_copy_data_.copy_exec_       = efb_copy_exec;
+    cache_entry.key_                            = CacheKey();
+    cache_entry.key_.address                    = addr;
+    cache_entry.key_.format                     = gp::kTextureFormat_None;
 
 
     // Size the texture in half if half_scale ("mipmap") mode is enabled
@@ -141,13 +252,18 @@ void TextureManager::CopyEFB(u32 addr, gp::BPPixelFormat efb_pixel_format,
         cache_entry.width_  /= 2;
         cache_entry.height_ /= 2;
     }
+    cache_entry.bytes_ = cache_entry.width_ * cache_entry.height_ * 4;
+
+    // The copy stays on the host GPU, but on hardware it overwrites RAM at addr. Textures read
+    // from there are checked again (the copy takes at most 32 bits per texel).
+    Memory_StampVideoPages(addr, cache_entry.width_ * cache_entry.height_ * 4);
 
     //cache_entry.size_           = gp::TextureDecoder_GetSize(cache_entry.format_, 
     //                                                     cache_entry.width_, 
     //                                                     cache_entry.height_);
 
     // Do we have a cache entry for the EFB copy texture?
-    cache_ptr = cache_->FetchFromHash(cache_entry.hash_);
+    cache_ptr = Lookup(cache_entry.key_);
 
     // If cache lookup did not fail...
     if (NULL != cache_ptr) {
@@ -156,8 +272,7 @@ void TextureManager::CopyEFB(u32 addr, gp::BPPixelFormat efb_pixel_format,
             // This would happen if a game reuses an area of memory for a different EFB copy - this
             //  isn't super common, but does happen (e.g. SSBM Pokemon Stadium level to print both
             //  game stats and the cam on the jumbotron
-            backend_interface_->Delete(cache_ptr->backend_data_);
-            cache_->Remove(cache_ptr->hash_);
+            Remove(cache_ptr);
             cache_ptr = NULL;
         }
     }
@@ -165,7 +280,11 @@ void TextureManager::CopyEFB(u32 addr, gp::BPPixelFormat efb_pixel_format,
     if (NULL == cache_ptr) {
         // create a texture in VRAM for storing the EFB copy...
         cache_entry.backend_data_ = backend_interface_->Create(0, cache_entry, NULL);
-        cache_ptr = cache_->Update(cache_entry.hash_, cache_entry);   
+        cache_ptr = Insert(cache_entry);   
+
+        // Creation binds to texture unit 0, and a texture at this address is now shadowed by the
+        // copy (see UpdateData)
+        valid_units_ = 0;
     }
     dst_rect.x1_ = cache_entry.width_;
     dst_rect.y1_ = cache_entry.height_;
@@ -190,20 +309,349 @@ void TextureManager::UpdateParameters(int active_texture_unit, const gp::BPTexMo
  * @param active_texture_unit Texture unit to bind (0-7)
  */
 void TextureManager::Bind(int active_texture_unit) {
-    if (NULL != active_textures_[active_texture_unit]) {
-        backend_interface_->Bind(active_texture_unit, 
-            active_textures_[active_texture_unit]->backend_data_);
+    CacheEntry* cache_entry = active_textures_[active_texture_unit];
+    if (NULL != cache_entry) {
+        if (NULL != cache_entry->decode_job_) {
+            FinishDecode(active_texture_unit, cache_entry);
+        }
+        backend_interface_->Bind(active_texture_unit, cache_entry->backend_data_);
+    }
+}
+
+/**
+ * Checks that the texture last updated for a texture unit is still current, i.e. its source
+ * memory hasn't been written to and the cache entry hasn't been replaced since
+ * @param active_texture_unit Texture unit to check (0-7)
+ * @return True if the texture can stay bound (it's flagged used this frame), false if the
+ *         unit needs UpdateData again
+ */
+bool TextureManager::Revalidate(int active_texture_unit) {
+    if (!(valid_units_ & (1 << active_texture_unit))) {
+        return false;
+    }
+    if (IsDirty(active_textures_[active_texture_unit])) {
+        valid_units_ &= ~(1 << active_texture_unit);
+        return false;
+    }
+    Touch(active_textures_[active_texture_unit]);
+    return true;
+}
+
+/**
+ * Drops units bound to a cache entry that is about to be removed
+ * @param cache_entry Cache entry being removed
+ */
+void TextureManager::Unbind(const CacheEntry* cache_entry) {
+    for (int i = 0; i < kGCMaxActiveTextures; i++) {
+        if (active_textures_[i] == cache_entry) {
+            active_textures_[i] = NULL;
+            valid_units_ &= ~(1 << i);
+        }
+    }
+}
+
+/**
+ * Adds a normal texture to the cache and starts decoding it
+ * @param cache_entry Texture to add, with the source fields and hash_ set
+ * @param key Key of the texture
+ * @return Cache entry of the texture
+ */
+TextureManager::CacheEntry* TextureManager::StartDecode(CacheEntry& cache_entry,
+    const CacheKey& key) {
+    const u8* src = &Mem_RAM[cache_entry.address_ & RAM_MASK];
+
+    cache_entry.key_            = key;
+    cache_entry.bytes_          = cache_entry.width_ * cache_entry.height_ * 4;
+    cache_entry.backend_data_   = NULL;
+    cache_entry.decode_job_     = gp::TextureDecoder_DecodeAsync(cache_entry.format_,
+                                                                 cache_entry.width_,
+                                                                 cache_entry.height_, src);
+    return Insert(cache_entry);
+}
+
+/**
+ * Waits for a texture to be decoded and creates it in the backend renderer
+ * @param active_texture_unit Texture unit to create the texture on
+ * @param cache_entry Texture with a decode in flight
+ */
+void TextureManager::FinishDecode(int active_texture_unit, CacheEntry* cache_entry) {
+    u8* raw_data;
+    {
+        // Only the time spent waiting is counted, the rest overlaps with emulation
+        common::profiler::ScopedTimer timer(common::profiler::kSection_TextureDecode);
+        raw_data = gp::TextureDecoder_Wait(cache_entry->decode_job_);
+    }
+
+    // Create a texture in VRAM from raw data...
+    cache_entry->backend_data_ = backend_interface_->Create(active_texture_unit, *cache_entry,
+                                                            raw_data);
+    TextureManager_DumpTexture(*cache_entry, raw_data);
+
+    gp::TextureDecoder_Release(cache_entry->decode_job_);
+    cache_entry->decode_job_ = NULL;
+}
+
+/**
+ * Adds an indexed texture to the cache, expanding its cached palette indices with the current
+ * palette and creating it in the backend renderer
+ * @param active_texture_unit Texture unit to create the texture on
+ * @param cache_entry Texture to add, with the source fields and hash_ set
+ * @param key Key of the texture
+ * @param tex_tlut BP TexTLUT register of the texture unit
+ * @return Cache entry of the texture
+ */
+TextureManager::CacheEntry* TextureManager::CreateIndexed(int active_texture_unit,
+    CacheEntry& cache_entry, const CacheKey& key, const gp::BPTexTLUT& tex_tlut) {
+    int num_entries = TextureManager_GetTLUTSize(cache_entry.format_) / 2;
+    int num_texels = cache_entry.width_ * cache_entry.height_;
+    {
+        common::profiler::ScopedTimer timer(common::profiler::kSection_TextureDecode);
+        const u16* indices = FetchIndices(cache_entry);
+
+        palette_buffer_.resize(num_entries);
+        expand_buffer_.resize(num_texels * 4);
+        gp::TextureDecoder_DecodePalette(&gp::tmem[(tex_tlut.tmem_offset << 5) & TMEM_MASK],
+                                         tex_tlut.format, num_entries, &palette_buffer_[0]);
+        gp::TextureDecoder_ExpandIndices(indices, num_texels, &palette_buffer_[0],
+                                         &expand_buffer_[0]);
     }
+    cache_entry.key_            = key;
+    cache_entry.bytes_          = num_texels * 4;
+    cache_entry.decode_job_     = NULL;
+    cache_entry.backend_data_   = backend_interface_->Create(active_texture_unit, cache_entry,
+                                                             &expand_buffer_[0]);
+    TextureManager_DumpTexture(cache_entry, &expand_buffer_[0]);
+
+    return Insert(cache_entry);
 }
 
 /**
- * Gets cached CacheEntry object from a index into the texture cache
- * @param index Index into texture cache of texture to select
- * @param res Result CacheEntry object
- * @return True if lookup succeeded, false if failed
+ * Gets the palette indices of an indexed texture, decoding them if they aren't cached or
+ * their source has changed
+ * @param cache_entry Texture to get the indices of, with the source fields and hash_ set
+ * @return Palette index of each texel
  */
-const TextureManager::CacheEntry& TextureManager::Fetch(int index) {
-    return *cache_->FetchFromIndex(index);
+const u16* TextureManager::FetchIndices(const CacheEntry& cache_entry) {
+    u64 id = ((u64)cache_entry.address_ << 32) | (cache_entry.format_ << 24) |
+             ((cache_entry.width_ - 1) << 12) | (cache_entry.height_ - 1);
+    size_t num_texels = cache_entry.width_ * cache_entry.height_;
+
+    // The texture was just hashed, the indices are still good if they were decoded from a source
+    // with the same hash
+    IndexMap::iterator itr = index_cache_.find(id);
+    if (itr != index_cache_.end()) {
+        if (itr->second.hash == cache_entry.hash_) {
+            itr->second.frame_used = video_core::g_current_frame;
+            return &itr->second.indices[0];
+        }
+    } else {
+        if (index_bytes_ + num_texels * 2 > (size_t)kMaxIndexBytes) {
+            LOG_NOTICE(TGP, "texture index cache full (%d textures), flushing",
+                       (int)index_cache_.size());
+            index_cache_.clear();
+            index_bytes_ = 0;
+        }
+        itr = index_cache_.insert(IndexMap::value_type(id, IndexEntry())).first;
+        itr->second.indices.resize(num_texels);
+        index_bytes_ += num_texels * 2;
+    }
+    itr->second.hash = cache_entry.hash_;
+    itr->second.frame_used = video_core::g_current_frame;
+    gp::TextureDecoder_DecodeIndices(cache_entry.format_, cache_entry.width_,
+                                     cache_entry.height_, &Mem_RAM[cache_entry.address_ & RAM_MASK],
+                                     &itr->second.indices[0]);
+    return &itr->second.indices[0];
+}
+
+/**
+ * Flags the source pages of a texture with MEM_PAGE_TEXTURE and stamps it, before its source
+ * is hashed, so a write from then on makes it dirty
+ * @param cache_entry Texture to track, with address_ and size_ set
+ */
+void TextureManager::TrackSource(CacheEntry* cache_entry) {
+    u32 address = cache_entry->address_;
+    size_t size = cache_entry->size_;
+
+    cache_entry->first_page_ = (address & RAM_MASK) >> MEM_PAGE_SHIFT;
+    cache_entry->num_pages_ = 0;
+    if (size) {
+        cache_entry->num_pages_ = (u32)MIN((((address & MEM_PAGE_MASK) + size - 1) >>
+                                            MEM_PAGE_SHIFT) + 1, (size_t)MEM_NUM_PAGES);
+    }
+    // A write to a flagged page stamps it with a newer clock, the flags are shared by all the
+    // textures on the page, the stamps tell which of them have seen the write. The CPU thread
+    // updates the flags too, so they're only changed atomically.
+    for (u32 i = 0; i < cache_entry->num_pages_; i++) {
+        common::AtomicOr(Mem_CodePage[(cache_entry->first_page_ + i) & (MEM_NUM_PAGES - 1)],
+                         MEM_PAGE_TEXTURE);
+    }
+    cache_entry->stamp_ = common::AtomicLoad(Mem_VideoClock);
+}
+
+/**
+ * Checks if a source page of a texture was written to since the texture was last tracked
+ * @param cache_entry Texture to check
+ * @return True if the texture must be hashed again
+ */
+bool TextureManager::IsDirty(const CacheEntry* cache_entry) const {
+    for (u32 i = 0; i < cache_entry->num_pages_; i++) {
+        u32 page = (cache_entry->first_page_ + i) & (MEM_NUM_PAGES - 1);
+        if ((s32)(Mem_VideoStamp[page] - cache_entry->stamp_) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Hashes the source of a texture, sampled or in full depending on the configuration
+common::Hash64 TextureManager::HashSource(const CacheEntry* cache_entry) const {
+    return common::GetHash64(&Mem_RAM[cache_entry->address_ & RAM_MASK], cache_entry->size_,
+                             hash_samples_);
+}
+
+/**
+ * Finds a texture in the cache
+ * @param key Key of the texture
+ * @return Cache entry on success, otherwise NULL
+ */
+TextureManager::CacheEntry* TextureManager::Lookup(const CacheKey& key) {
+    size_t mask = table_.size() - 1;
+    size_t slot = TextureManager_HashKey(key) & mask;
+
+    for (; NULL != table_[slot]; slot = (slot + 1) & mask) {
+        if (table_[slot]->key_ == key) {
+            return table_[slot];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Adds a texture to the cache, key_ and bytes_ must be set
+ * @param cache_entry Texture to add (copied)
+ * @return Cache entry of the texture
+ */
+TextureManager::CacheEntry* TextureManager::Insert(const CacheEntry& cache_entry) {
+    // Keep the table at most half full, so probe sequences stay short
+    if ((size_t)(num_entries_ + 1) * 2 > table_.size()) {
+        Rehash(table_.size() * 2);
+    }
+    CacheEntry* entry = new CacheEntry(cache_entry);
+    entry->key_hash_ = TextureManager_HashKey(entry->key_);
+    entry->lru_prev_ = NULL;
+    entry->lru_next_ = NULL;
+
+    size_t mask = table_.size() - 1;
+    size_t slot = entry->key_hash_ & mask;
+    while (NULL != table_[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    table_[slot] = entry;
+    num_entries_++;
+
+    // EFB copies are never evicted, only normal textures are in the LRU list
+    if (kSourceType_Normal == entry->type_) {
+        entry->lru_next_ = lru_head_;
+        if (lru_head_) {
+            lru_head_->lru_prev_ = entry;
+        } else {
+            lru_tail_ = entry;
+        }
+        lru_head_ = entry;
+        bytes_used_ += entry->bytes_;
+    }
+    return entry;
+}
+
+/**
+ * Removes a texture from the cache and deletes it from the backend renderer
+ * @param cache_entry Texture to remove
+ */
+void TextureManager::Remove(CacheEntry* cache_entry) {
+    size_t mask = table_.size() - 1;
+    size_t slot = cache_entry->key_hash_ & mask;
+    while (table_[slot] != cache_entry) {
+        slot = (slot + 1) & mask;
+    }
+    // Shift the following entries of the probe sequence back, unless that would move them before
+    // their home slot
+    for (size_t next = (slot + 1) & mask; NULL != table_[next]; next = (next + 1) & mask) {
+        size_t home = table_[next]->key_hash_ & mask;
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            table_[slot] = table_[next];
+            slot = next;
+        }
+    }
+    table_[slot] = NULL;
+    num_entries_--;
+
+    if (kSourceType_Normal == cache_entry->type_) {
+        if (cache_entry->lru_prev_) {
+            cache_entry->lru_prev_->lru_next_ = cache_entry->lru_next_;
+        } else {
+            lru_head_ = cache_entry->lru_next_;
+        }
+        if (cache_entry->lru_next_) {
+            cache_entry->lru_next_->lru_prev_ = cache_entry->lru_prev_;
+        } else {
+            lru_tail_ = cache_entry->lru_prev_;
+        }
+        bytes_used_ -= cache_entry->bytes_;
+    }
+    Unbind(cache_entry);
+    if (NULL != cache_entry->decode_job_) {
+        gp::TextureDecoder_Release(cache_entry->decode_job_);
+    }
+    if (NULL != cache_entry->backend_data_) {
+        backend_interface_->Delete(cache_entry->backend_data_);
+    }
+    delete cache_entry;
+}
+
+/// Flags a texture used this frame and moves it to the front of the LRU list
+void TextureManager::Touch(CacheEntry* cache_entry) {
+    cache_entry->frame_used_ = video_core::g_current_frame;
+
+    if (kSourceType_Normal != cache_entry->type_ || lru_head_ == cache_entry) {
+        return;
+    }
+    cache_entry->lru_prev_->lru_next_ = cache_entry->lru_next_;
+    if (cache_entry->lru_next_) {
+        cache_entry->lru_next_->lru_prev_ = cache_entry->lru_prev_;
+    } else {
+        lru_tail_ = cache_entry->lru_prev_;
+    }
+    cache_entry->lru_prev_ = NULL;
+    cache_entry->lru_next_ = lru_head_;
+    lru_head_->lru_prev_ = cache_entry;
+    lru_head_ = cache_entry;
+}
+
+/// Evicts least recently used textures until the cache is within its memory budget
+void TextureManager::EvictToBudget() {
+    // Textures used this frame may still be bound for a draw that hasn't been flushed yet, the
+    // budget is exceeded until the next frame rather than deleting them
+    while (bytes_used_ > memory_budget_ && NULL != lru_tail_ &&
+        lru_tail_->frame_used_ != video_core::g_current_frame) {
+        Remove(lru_tail_);
+    }
+}
+
+/// Resizes the cache table, reinserting all entries
+void TextureManager::Rehash(size_t table_size) {
+    std::vector<CacheEntry*> old_table(table_size, NULL);
+    old_table.swap(table_);
+
+    size_t mask = table_size - 1;
+    for (size_t i = 0; i < old_table.size(); i++) {
+        if (NULL != old_table[i]) {
+            size_t slot = old_table[i]->key_hash_ & mask;
+            while (NULL != table_[slot]) {
+                slot = (slot + 1) & mask;
+            }
+            table_[slot] = old_table[i];
+        }
+    }
 }
 
 /**
@@ -211,20 +659,27 @@ const TextureManager::CacheEntry& TextureManager::Fetch(int index) {
  * @return Integer number of active textures in the texture cache
  */
 int TextureManager::Size() {
-    return cache_->Size();
+    return num_entries_;
 }
 
 /**
- * Purges expired textures (textures that are older than current_frame + age_limit)
+ * Purges expired textures (textures that are older than current_frame + age_limit), walking
+ * the LRU list from its least recently used end so only expired textures are visited.
+ * Palette indices not used since then are dropped too.
  * @param age_limit Acceptable age limit (in frames) for textures to still be considered fresh
  */
 void TextureManager::Purge(int age_limit) {
-    CacheEntry* cache_entry = NULL;
-    for (int i = 0; i < this->Size(); i++) {
-        cache_entry = cache_->FetchFromIndex(i);
-        if ((cache_entry->frame_used_ + age_limit) < video_core::g_current_frame && cache_entry->type_ != kSourceType_EFBCopy) {
-            backend_interface_->Delete(cache_entry->backend_data_);
-            cache_->Remove(cache_entry->hash_);
+    while (NULL != lru_tail_ &&
+        (lru_tail_->frame_used_ + age_limit) < video_core::g_current_frame) {
+        Remove(lru_tail_);
+    }
+    IndexMap::iterator itr = index_cache_.begin();
+    while (itr != index_cache_.end()) {
+        if ((itr->second.frame_used + age_limit) < video_core::g_current_frame) {
+            index_bytes_ -= itr->second.indices.size() * 2;
+            index_cache_.erase(itr++);
+        } else {
+            ++itr;
         }
     }
 }
@@ -25,9 +25,11 @@
 #ifndef VIDEO_CORE_TEXTURE_MANAGER_H_
 #define VIDEO_CORE_TEXTURE_MANAGER_H_
 
+#include <map>
+#include <vector>
+
 #include "types.h"
 #include "hash.h"
-#include "hash_container.h"
 
 #include "memory.h"
 
@@ -49,6 +51,25 @@ public:
         kSourceType_EFBCopy,    ///< Texture is result of an EFB copy
     };
 
+    /// Key of a texture in the cache
+    struct CacheKey {
+        u32                 address;        ///< Source address of texture
+        u16                 width;          ///< Source texture width in pixels, 0 for EFB copies
+        u16                 height;         ///< Source texture height in pixels, 0 for EFB copies
+        u32                 format;         ///< Source texture format, None for EFB copies
+        common::Hash64      tlut_hash;      ///< Hash of the palette and its format, 0 if direct
+
+        inline bool operator == (const CacheKey& val) const {
+            return (
+                address     == val.address &&
+                width       == val.width &&
+                height      == val.height &&
+                format      == val.format &&
+                tlut_hash   == val.tlut_hash
+                );
+        }
+    };
+
     /// Texture cache entry
     class CacheEntry {
     public:
@@ -67,8 +88,17 @@ public:
             type_           = kSourceType_Normal;
             format_         = gp::kTextureFormat_None; 
             backend_data_   = NULL; 
+            decode_job_     = NULL;
             hash_           = 0;
             frame_used_     = -1;
+            bytes_          = 0;
+            first_page_     = 0;
+            num_pages_      = 0;
+            stamp_          = 0;
+            key_hash_       = 0;
+            lru_prev_       = NULL;
+            lru_next_       = NULL;
+            key_            = CacheKey();
         }
         ~CacheEntry() { 
         }
@@ -79,8 +109,17 @@ public:
         gp::TextureFormat   format_;        ///< Source texture format  (dest is always RGBA8)
         size_t              size_;          ///< Source size of texture in bytes
         BackendData*        backend_data_;  ///< Pointer to backend renderer data
+        gp::TextureDecoder_Job* decode_job_; ///< Decode in flight, NULL once created in backend
         common::Hash64      hash_;          ///< Hash of source texture raw data
         int                 frame_used_;    ///< Last frame that the texture was used
+        CacheKey            key_;           ///< Key of the texture in the cache
+        u32                 key_hash_;      ///< Hash of key_, its home slot in the cache table
+        size_t              bytes_;         ///< Size of the decoded texture in VRAM
+        u32                 first_page_;    ///< First RAM page of the source
+        u32                 num_pages_;     ///< RAM pages of the source, 0 for EFB copies
+        u32                 stamp_;         ///< Mem_VideoClock when hash_ was last checked
+        CacheEntry*         lru_prev_;      ///< More recently used texture, NULL if most recent
+        CacheEntry*         lru_next_;      ///< Less recently used texture, NULL if least recent
 
         /// EFB copy data (only relevant if if texture is from EFB copy)
         class _EFBCopyData {
@@ -108,15 +147,28 @@ public:
         } efb_copy_data_;
     };
 
-    typedef HashContainer_STLMap<common::Hash64, CacheEntry> CacheContainer;
+    /**
+     * Palette indices of an indexed texture. They are cached apart from the textures, which are
+     * keyed by palette too, so a texture whose palette is animated only redoes the palette lookups.
+     */
+    struct IndexEntry {
+        common::Hash64      hash;           ///< Hash of the source the indices were decoded from
+        int                 frame_used;     ///< Last frame that the indices were used
+        std::vector<u16>    indices;        ///< Palette index of each texel, in row order
+    };
+    typedef std::map<u64, IndexEntry> IndexMap;
 
     static const int kHashSamples = 128;    ///< Number of texture samples to use for hash
+    static const int kMaxIndexBytes = 64 * 1024 * 1024; ///< Palette indices kept at most
+
+    static const int kInitialTableSize = 1024;  ///< Initial number of cache table slots
+    static const int kDefaultMemoryBudget = 256;///< Default texture memory budget (in MB)
 
     /// Renderer interface for controlling textures
     class BackendInterface{
     public:
         BackendInterface() { }
-        ~BackendInterface() { }
+        virtual ~BackendInterface() { } // Renderers delete their interfaces through this class
 
         /**
          * Create a new texture in the backend renderer
@@ -168,9 +220,19 @@ public:
      * @param active_texture_unit Texture unit to update (0-7)
      * @param tex_image_0 BP TexImage0 register to use for the update
      * @param tex_image_3 BP TexImage3 register to use for the update
+     * @param tex_tlut BP TexTLUT register to use for the update (only used by indexed formats)
      */
     void UpdateData(int active_texture_unit, const gp::BPTexImage0& tex_image_0, 
-        const gp::BPTexImage3& tex_image_3);
+        const gp::BPTexImage3& tex_image_3, const gp::BPTexTLUT& tex_tlut);
+
+    /**
+     * Starts decoding a texture as soon as its image registers are written, so it's ready by the
+     * time a draw binds it. Indexed textures aren't prefetched, as their palette is often loaded
+     * after the image registers.
+     * @param tex_image_0 BP TexImage0 register of the texture
+     * @param tex_image_3 BP TexImage3 register of the texture
+     */
+    void Prefetch(const gp::BPTexImage0& tex_image_0, const gp::BPTexImage3& tex_image_3);
 
     /** 
      * Copy the EFB to a texture
@@ -192,18 +254,20 @@ public:
         const gp::BPTexMode1& tex_mode_1);
 
     /**
-     * Binds the most recently updated texture for a given active texture unit
+     * Binds the most recently updated texture for a given active texture unit, waiting for it to
+     * be decoded and creating it in the backend renderer if it's bound for the first time
      * @param active_texture_unit Texture unit to bind (0-7)
      */
     void Bind(int active_texture_unit);
 
     /**
-     * Gets cached CacheEntry object from a index into the texture cache
-     * @param index Index into texture cache of texture to select
-     * @param res Result CacheEntry object
-     * @return True if lookup succeeded, false if failed
+     * Checks that the texture last updated for a texture unit is still current, i.e. its source
+     * pages haven't been written to and the cache entry hasn't been replaced since
+     * @param active_texture_unit Texture unit to check (0-7)
+     * @return True if the texture can stay bound (it's flagged used this frame), false if the
+     *         unit needs UpdateData again
      */
-    const CacheEntry& Fetch(int index);
+    bool Revalidate(int active_texture_unit);
 
     /**
      * Gets the number of active textures in the texture cache
@@ -212,7 +276,9 @@ public:
     int Size();
 
     /**
-     * Purges expired textures (textures that are older than current_frame + age_limit)
+     * Purges expired textures (textures that are older than current_frame + age_limit), walking
+     * the LRU list from its least recently used end so only expired textures are visited.
+     * Palette indices not used since then are dropped too.
      * @param age_limit Acceptable age limit (in frames) for textures to still be considered fresh
      * @todo The age_limit seems to affect games - e.g. Link's eyes in ZWW. Figure out why.
      */
@@ -228,9 +294,105 @@ public:
 
 private:
 
-    CacheContainer*     cache_;                                 ///< Texture cache
+    /// Drops units bound to a cache entry that is about to be removed
+    void Unbind(const CacheEntry* cache_entry);
+
+    /**
+     * Adds a normal texture to the cache and starts decoding it
+     * @param cache_entry Texture to add, with the source fields and hash_ set
+     * @param key Key of the texture
+     * @return Cache entry of the texture
+     */
+    CacheEntry* StartDecode(CacheEntry& cache_entry, const CacheKey& key);
+
+    /**
+     * Waits for a texture to be decoded and creates it in the backend renderer
+     * @param active_texture_unit Texture unit to create the texture on
+     * @param cache_entry Texture with a decode in flight
+     */
+    void FinishDecode(int active_texture_unit, CacheEntry* cache_entry);
+
+    /**
+     * Adds an indexed texture to the cache, expanding its cached palette indices with the current
+     * palette and creating it in the backend renderer
+     * @param active_texture_unit Texture unit to create the texture on
+     * @param cache_entry Texture to add, with the source fields and hash_ set
+     * @param key Key of the texture
+     * @param tex_tlut BP TexTLUT register of the texture unit
+     * @return Cache entry of the texture
+     */
+    CacheEntry* CreateIndexed(int active_texture_unit, CacheEntry& cache_entry,
+        const CacheKey& key, const gp::BPTexTLUT& tex_tlut);
+
+    /**
+     * Gets the palette indices of an indexed texture, decoding them if they aren't cached or
+     * their source has changed
+     * @param cache_entry Texture to get the indices of, with the source fields and hash_ set
+     * @return Palette index of each texel
+     */
+    const u16* FetchIndices(const CacheEntry& cache_entry);
+
+    /**
+     * Finds a texture in the cache
+     * @param key Key of the texture
+     * @return Cache entry on success, otherwise NULL
+     */
+    CacheEntry* Lookup(const CacheKey& key);
+
+    /**
+     * Adds a texture to the cache, key_ and bytes_ must be set
+     * @param cache_entry Texture to add (copied)
+     * @return Cache entry of the texture
+     */
+    CacheEntry* Insert(const CacheEntry& cache_entry);
+
+    /**
+     * Removes a texture from the cache and deletes it from the backend renderer
+     * @param cache_entry Texture to remove
+     */
+    void Remove(CacheEntry* cache_entry);
+
+    /// Flags a texture used this frame and moves it to the front of the LRU list
+    void Touch(CacheEntry* cache_entry);
+
+    /// Evicts least recently used textures until the cache is within its memory budget
+    void EvictToBudget();
+
+    /// Resizes the cache table, reinserting all entries
+    void Rehash(size_t table_size);
+
+    /**
+     * Flags the source pages of a texture with MEM_PAGE_TEXTURE and stamps it, before its source
+     * is hashed, so a write from then on makes it dirty
+     * @param cache_entry Texture to track, with address_ and size_ set
+     */
+    void TrackSource(CacheEntry* cache_entry);
+
+    /**
+     * Checks if a source page of a texture was written to since the texture was last tracked
+     * @param cache_entry Texture to check
+     * @return True if the texture must be hashed again
+     */
+    bool IsDirty(const CacheEntry* cache_entry) const;
+
+    /// Hashes the source of a texture, sampled or in full depending on the configuration
+    common::Hash64 HashSource(const CacheEntry* cache_entry) const;
+
+    std::vector<CacheEntry*> table_;                            ///< Open addressing, linear probing
+    int                 num_entries_;                           ///< Textures in table_
+    CacheEntry*         lru_head_;                              ///< Most recently used texture
+    CacheEntry*         lru_tail_;                              ///< Least recently used texture
+    size_t              bytes_used_;                            ///< VRAM used by LRU textures
+    size_t              memory_budget_;                         ///< VRAM the LRU textures may use
+    int                 hash_samples_;                          ///< Samples hashed, 0 for all
+    IndexMap            index_cache_;       ///< Palette indices by source address, format and size
+    size_t              index_bytes_;                           ///< Memory used by index_cache_
+    std::vector<u32>    palette_buffer_;                        ///< Palette being expanded
+    std::vector<u8>     expand_buffer_;                         ///< Indexed texture being created
     BackendInterface*   backend_interface_;                     ///< Backend renderer interface
 
+    u32     valid_units_;                               ///< Units whose texture is still current
+
     DISALLOW_COPY_AND_ASSIGN(TextureManager);
 };
 
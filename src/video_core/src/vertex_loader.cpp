@@ -30,13 +30,15 @@
 #include "video_core.h"
 #include "vertex_manager.h"
 #include "vertex_loader.h"
+#include "vertex_loader_compiler.h"
+#include "display_list_cache.h"
 #include "fifo.h"
 #include "cp_mem.h"
 #include "xf_mem.h"
 
 namespace gp {
 
-typedef void (*VertexLoaderTable)(u32, u32*);	
+static VertexLoaderCompiler* g_loader_compiler = NULL;  ///< Loader routines by vertex format
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Memory access
@@ -604,13 +606,59 @@ void VertexLoader_DecodePrimitive(GXPrimitive type, int count) {
     state.tex[7].comp_count = (GXCompCnt)vat_c->tex7_count;
     state.tex[7].comp_type  = (GXCompType)vat_c->tex7_type;
 
-    video_core::g_renderer->SetVertexState(state);
-    video_core::g_shader_manager->UpdateVertexState(state);
-    video_core::g_shader_manager->UpdateFlag(ShaderManager::kFlag_VertexPostition_DQF, 
-        vat_a->get_pos_dqf_enabled());
+    // Configure renderer to begin a new primitive, the vertex state is sent with a new batch
+    VertexManager_BeginPrimitive(type, count, state);
+
+    // Use the routine compiled for this vertex format if there is one
+    VertexLoaderKey key;
+    bool indexed = false;
+    key.vcd_lo  = gp::g_cp_regs.vcd_lo[0]._u32;
+    key.vcd_hi  = gp::g_cp_regs.vcd_hi[0]._u32;
+    key.vat_a   = vat_a->_u32;
+    key.vat_b   = vat_b->_u32;
+    key.vat_c   = vat_c->_u32;
+    for (int i = 0; i < kVertexLoaderNumArrays; i++) {
+        u32 attr_type = (i < 4) ? (key.vcd_lo >> (9 + (i << 1))) & 3 :
+            (key.vcd_hi >> ((i - 4) << 1)) & 3;
+        key.stride[i] = 0;
+        if (attr_type >= GX_INDEX8) {
+            key.stride[i] = gp::g_cp_regs.array_stride[i].addr_stride;
+            indexed = true;
+        }
+    }
+    const VertexLoaderRoutine* routine = g_loader_compiler->GetRoutine(key);
 
-    // Configure renderer to begin a new primitive
-    VertexManager_BeginPrimitive(type, count);
+    if (routine) {
+        u32 array_base[kVertexLoaderNumArrays];
+        for (int i = 0; i < kVertexLoaderNumArrays; i++) {
+            array_base[i] = gp::g_cp_regs.array_base[i].addr_base;
+        }
+        const u8* src = Fifo_PopBlock(count * routine->vertex_size());
+
+        // Vertices without indexed components only depend on the command, so primitives in cached
+        // display lists are only decoded the first time the list is called
+        const GXVertex* batch = NULL;
+        GXVertex* record = NULL;
+        if (!indexed) {
+            batch = DisplayListCache_GetBatch(src, key, count, &record);
+        }
+        if (batch) {
+            for (int i = 0; i < count; i++) {
+                *g_vbo = batch[i];
+                VertexManager_NextVertex();
+            }
+        } else {
+            for (int i = 0; i < count; i++) {
+                src = routine->Load(src, g_vbo, array_base);
+                if (record) {
+                    record[i] = *g_vbo;
+                }
+                VertexManager_NextVertex();
+            }
+        }
+        VertexManager_EndPrimitive();
+        return;
+    }
 
     for (int i = 0; i < count; i++) {
 
@@ -834,10 +882,14 @@ void VertexLoader_DecodePrimitive(GXPrimitive type, int count) {
 
 /// Initialize the Vertex Loader
 void VertexLoader_Init() {
+    delete g_loader_compiler;
+    g_loader_compiler = new VertexLoaderCompiler();
 }
 
 /// Shutdown the Vertex Loader
 void VertexLoader_Shutdown() {
+    delete g_loader_compiler;
+    g_loader_compiler = NULL;
 }
 
 } // namespace
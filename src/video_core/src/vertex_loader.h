@@ -47,6 +47,15 @@ struct VertexState {
     VertexComponent tex[kGCMaxActiveTextures];
 };
 
+/// Vertex component decoder, addr is the component's RAM address when indexed
+typedef void (*VertexLoaderTable)(u32 addr, u32* dest);
+
+// Indexed component decoders, indexed by (count << 3) | type
+extern VertexLoaderTable LookupPositionIndexed[0x10];
+extern VertexLoaderTable LookupColorIndexed[0x10];
+extern VertexLoaderTable LookupNormalIndexed[0x10];
+extern VertexLoaderTable LookupTexCoordIndexed[0x10];
+
 /**
  * @brief Decode a primitive type
  * @param type Type of primitive (e.g. points, lines, triangles, etc.)
@@ -0,0 +1,459 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    vertex_loader_compiler.cpp
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-16
+ * @brief   Compiles vertex loader routines specialized for a vertex format
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#include "common.h"
+
+#include "cp_mem.h"
+#include "vertex_loader_compiler.h"
+
+#ifdef USE_VERTEX_LOADER_JIT
+#include <sys/mman.h>
+#endif
+
+namespace gp {
+
+typedef VertexLoaderRoutine::Step Step;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Component formats
+
+/// Direct component layout, type is -1 if the format isn't handled by routines
+struct ComponentFormat {
+    int type;
+    int count;
+};
+
+#define _BYTES(n)   { Step::kType_Bytes, n }
+#define _SHORTS(n)  { Step::kType_Shorts, n }
+#define _WORDS(n)   { Step::kType_Words, n }
+#define _INVALID    { -1, 0 }
+
+/// Position formats, indexed by (count << 3) | type
+static const ComponentFormat kPositionFormats[0x10] = {
+    _BYTES(2),  _BYTES(2),  _SHORTS(2), _SHORTS(2), _WORDS(2),  _INVALID,   _INVALID,   _INVALID,
+    _BYTES(3),  _BYTES(3),  _SHORTS(3), _SHORTS(3), _WORDS(3),  _INVALID,   _INVALID,   _INVALID
+};
+
+/// Normal formats, NBT (nine normals) is left to the generic loader
+static const ComponentFormat kNormalFormats[0x10] = {
+    _BYTES(3),  _BYTES(3),  _SHORTS(3), _SHORTS(3), _WORDS(3),  _INVALID,   _INVALID,   _INVALID,
+    _INVALID,   _INVALID,   _INVALID,   _INVALID,   _INVALID,   _INVALID,   _INVALID,   _INVALID
+};
+
+/// Color formats, RGB565/RGBA4 are one short and RGBX8/RGBA8 one word
+static const ComponentFormat kColorFormats[0x10] = {
+    _SHORTS(1), _BYTES(3),  _WORDS(1),  _SHORTS(1), _BYTES(3),  _WORDS(1),  _INVALID,   _INVALID,
+    _SHORTS(1), _BYTES(3),  _WORDS(1),  _SHORTS(1), _BYTES(3),  _WORDS(1),  _INVALID,   _INVALID
+};
+
+/// Texture coordinate formats
+static const ComponentFormat kTexCoordFormats[0x10] = {
+    _BYTES(1),  _BYTES(1),  _SHORTS(1), _SHORTS(1), _WORDS(1),  _INVALID,   _INVALID,   _INVALID,
+    _BYTES(2),  _BYTES(2),  _SHORTS(2), _SHORTS(2), _WORDS(2),  _INVALID,   _INVALID,   _INVALID
+};
+
+#undef _BYTES
+#undef _SHORTS
+#undef _WORDS
+#undef _INVALID
+
+static const int kComponentSize[] = { 1, 2, 4 };    ///< Size of Bytes/Shorts/Words elements
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Template steps
+
+template <int kCount> static void LoadBytes(const Step& step, const u8* src, u8* dest,
+    const u32* array_base) {
+    for (int i = 0; i < kCount; i++) {
+        dest[step.dest_offset + i] = src[step.src_offset + i];
+    }
+}
+
+template <int kCount> static void LoadShorts(const Step& step, const u8* src, u8* dest,
+    const u32* array_base) {
+    u16* v = (u16*)(dest + step.dest_offset);
+    for (int i = 0; i < kCount; i++) {
+        v[i] = BSWAP16(*(u16*)(src + step.src_offset + (i << 1)));
+    }
+}
+
+template <int kCount> static void LoadWords(const Step& step, const u8* src, u8* dest,
+    const u32* array_base) {
+    u32* v = (u32*)(dest + step.dest_offset);
+    for (int i = 0; i < kCount; i++) {
+        v[i] = BSWAP32(*(u32*)(src + step.src_offset + (i << 2)));
+    }
+}
+
+static void LoadConstant(const Step& step, const u8* src, u8* dest, const u32* array_base) {
+    *(u32*)(dest + step.dest_offset) = step.value;
+}
+
+template <int kIndexSize> static void LoadIndexed(const Step& step, const u8* src, u8* dest,
+    const u32* array_base) {
+    u32 index = (kIndexSize == 1) ? src[step.src_offset] :
+        BSWAP16(*(u16*)(src + step.src_offset));
+    step.indexed(array_base[step.array] + index * step.stride, (u32*)(dest + step.dest_offset));
+}
+
+/// Template functions of direct steps, indexed by type and count - 1
+static const Step::StepFunc kDirectFuncs[3][3] = {
+    { LoadBytes<1>,     LoadBytes<2>,   LoadBytes<3> },
+    { LoadShorts<1>,    LoadShorts<2>,  LoadShorts<3> },
+    { LoadWords<1>,     LoadWords<2>,   LoadWords<3> }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Routine construction
+
+bool VertexLoaderRoutine::AddDirect(Step::Type type, int count, int dest_offset) {
+    Step& step = steps_[num_steps_++];
+    step.func           = kDirectFuncs[type][count - 1];
+    step.type           = type;
+    step.count          = count;
+    step.src_offset     = vertex_size_;
+    step.dest_offset    = dest_offset;
+    step.array          = 0;
+    step.stride         = 0;
+    step.value          = 0;
+    step.indexed        = NULL;
+    vertex_size_ += kComponentSize[type] * count;
+    return true;
+}
+
+bool VertexLoaderRoutine::AddIndexed(u32 attr_type, VertexLoaderTable indexed, int array,
+    u32 stride, int dest_offset) {
+    Step& step = steps_[num_steps_++];
+    if (GX_INDEX8 == attr_type) {
+        step.func       = LoadIndexed<1>;
+        step.type       = Step::kType_Index8;
+    } else {
+        step.func       = LoadIndexed<2>;
+        step.type       = Step::kType_Index16;
+    }
+    step.count          = 1;
+    step.src_offset     = vertex_size_;
+    step.dest_offset    = dest_offset;
+    step.array          = array;
+    step.stride         = stride;
+    step.value          = 0;
+    step.indexed        = indexed;
+    vertex_size_ += (GX_INDEX8 == attr_type) ? 1 : 2;
+    return true;
+}
+
+bool VertexLoaderRoutine::AddComponent(u32 attr_type, int type, int count,
+    VertexLoaderTable indexed, int array, u32 stride, int dest_offset) {
+    if (GX_NONE == attr_type) {
+        return true;
+    }
+    if (type < 0) {
+        return false;
+    }
+    switch (attr_type) {
+    case GX_DIRECT:
+        return AddDirect((Step::Type)type, count, dest_offset);
+    case GX_INDEX8:
+    case GX_INDEX16:
+        return AddIndexed(attr_type, indexed, array, stride, dest_offset);
+    }
+    return true;
+}
+
+/// Build the decoding steps, in the order the generic loader reads the components
+bool VertexLoaderRoutine::Build(const VertexLoaderKey& key) {
+    CPVertDescLo vcd_lo;
+    CPVertDescHi vcd_hi;
+    CPVatRegA vat_a;
+    CPVatRegB vat_b;
+    CPVatRegC vat_c;
+
+    vcd_lo._u32 = key.vcd_lo;
+    vcd_hi._u32 = key.vcd_hi;
+    vat_a._u32  = key.vat_a;
+    vat_b._u32  = key.vat_b;
+    vat_c._u32  = key.vat_c;
+
+    code_ = NULL;
+    vertex_size_ = 0;
+    num_steps_ = 0;
+
+    // Matrix indices
+    if (vcd_lo.pos_midx_enable) {
+        AddDirect(Step::kType_Bytes, 1, offsetof(GXVertex, pm_idx));
+    }
+    for (int i = 0; i < kGCMaxActiveTextures; i++) {
+        if (vcd_lo._u32 & (2 << i)) {
+            AddDirect(Step::kType_Bytes, 1, offsetof(GXVertex, tm_idx) + i);
+        }
+    }
+
+    // Position and normal
+    const ComponentFormat& pos = kPositionFormats[vat_a.get_pos()];
+    if (!AddComponent(vcd_lo.position, pos.type, pos.count,
+        LookupPositionIndexed[vat_a.get_pos()], 0, key.stride[0],
+        offsetof(GXVertex, position))) {
+        return false;
+    }
+    const ComponentFormat& nrm = kNormalFormats[vat_a.get_normal()];
+    if (!AddComponent(vcd_lo.normal, nrm.type, nrm.count,
+        LookupNormalIndexed[vat_a.get_normal()], 1, key.stride[1],
+        offsetof(GXVertex, normal))) {
+        return false;
+    }
+
+    // Colors, a color that isn't present is white
+    u32 col_attr[kGCMaxVertexColors] = { vcd_lo.color0, vcd_lo.color1 };
+    u32 col_format[kGCMaxVertexColors] = { vat_a.get_col0(), vat_a.get_col1() };
+    for (int i = 0; i < kGCMaxVertexColors; i++) {
+        int dest_offset = offsetof(GXVertex, color) + (i << 2);
+        if (GX_NONE == col_attr[i]) {
+            Step& step = steps_[num_steps_++];
+            memset(&step, 0, sizeof(step));
+            step.func           = LoadConstant;
+            step.type           = Step::kType_Constant;
+            step.dest_offset    = dest_offset;
+            step.value          = 0xffffffff;
+            continue;
+        }
+        const ComponentFormat& col = kColorFormats[col_format[i]];
+        if (!AddComponent(col_attr[i], col.type, col.count,
+            LookupColorIndexed[col_format[i]], 2 + i, key.stride[2 + i], dest_offset)) {
+            return false;
+        }
+    }
+
+    // Texture coordinates
+    u32 tex_format[kGCMaxActiveTextures] = {
+        vat_a.get_tex0(), vat_b.get_tex1(), vat_b.get_tex2(), vat_b.get_tex3(),
+        vat_b.get_tex4(), vat_c.get_tex5(), vat_c.get_tex6(), vat_c.get_tex7()
+    };
+    for (int i = 0; i < kGCMaxActiveTextures; i++) {
+        u32 attr_type = (vcd_hi._u32 >> (i << 1)) & 3;
+        const ComponentFormat& tex = kTexCoordFormats[tex_format[i]];
+        if (!AddComponent(attr_type, tex.type, tex.count,
+            LookupTexCoordIndexed[tex_format[i]], 4 + i, key.stride[4 + i],
+            offsetof(GXVertex, texcoords) + (i << 3))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Routine cache
+
+VertexLoaderCompiler::VertexLoaderCompiler() {
+    cache_ = new CacheContainer();
+    last_routine_ = NULL;
+    last_valid_ = false;
+    memset(&last_key_, 0, sizeof(last_key_));
+
+#ifdef USE_VERTEX_LOADER_JIT
+    code_buffer_ = NULL;
+
+    void* buffer = mmap(NULL, kCodeBufferSize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (buffer == MAP_FAILED) {
+        LOG_ERROR(TGP, "vertex loader compiler failed to allocate code buffer, using templates");
+        return;
+    }
+    code_buffer_ = (u8*)buffer;
+    emit_.set_code_ptr(code_buffer_);
+    ProtectCodeBuffer(false);
+#endif
+}
+
+VertexLoaderCompiler::~VertexLoaderCompiler() {
+    Clear();
+    delete cache_;
+#ifdef USE_VERTEX_LOADER_JIT
+    if (code_buffer_) {
+        munmap(code_buffer_, kCodeBufferSize);
+        code_buffer_ = NULL;
+    }
+#endif
+}
+
+void VertexLoaderCompiler::Clear() {
+    for (int i = 0; i < cache_->Size(); i++) {
+        delete cache_->FetchFromIndex(i)->routine;
+    }
+    delete cache_;
+    cache_ = new CacheContainer();
+    last_routine_ = NULL;
+    last_valid_ = false;
+#ifdef USE_VERTEX_LOADER_JIT
+    emit_.set_code_ptr(code_buffer_);
+#endif
+}
+
+/// Lookup the routine for a vertex format, the last format used is checked first
+const VertexLoaderRoutine* VertexLoaderCompiler::GetRoutine(const VertexLoaderKey& key) {
+    if (last_valid_ && 0 == memcmp(&key, &last_key_, sizeof(key))) {
+        return last_routine_;
+    }
+    common::Hash64 hash = common::GetHash64((const u8*)&key, sizeof(key), 0);
+    CacheEntry* entry = cache_->FetchFromHash(hash);
+
+    // Formats that hash the same replace each other
+    if (entry && 0 != memcmp(&key, &entry->key, sizeof(key))) {
+        delete entry->routine;
+        cache_->Remove(hash);
+        entry = NULL;
+    }
+    if (NULL == entry) {
+        CacheEntry new_entry;
+        new_entry.key = key;
+        new_entry.routine = new VertexLoaderRoutine();
+
+        if (!new_entry.routine->Build(key)) {
+            delete new_entry.routine;
+            new_entry.routine = NULL;
+        }
+#ifdef USE_VERTEX_LOADER_JIT
+        if (new_entry.routine && code_buffer_) {
+            VertexLoaderRoutine::LoaderFunc code = Compile(*new_entry.routine);
+            if (NULL == code) {
+                // Out of code space, start over with an empty cache
+                delete new_entry.routine;
+                Clear();
+                return GetRoutine(key);
+            }
+            new_entry.routine->set_code(code);
+        }
+#endif
+        entry = cache_->Update(hash, new_entry);
+    }
+    last_key_ = key;
+    last_routine_ = entry->routine;
+    last_valid_ = true;
+
+    return last_routine_;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Native code generation
+
+#ifdef USE_VERTEX_LOADER_JIT
+
+/**
+ * Generated code follows the SysV calling convention, RDI = src, RSI = dest, RDX = array_base.
+ * These are kept in callee saved registers so indexed components can call their decoder.
+ */
+static const X64Emitter::Reg kRegSrc        = X64Emitter::RBX;
+static const X64Emitter::Reg kRegDest       = X64Emitter::R12;
+static const X64Emitter::Reg kRegArrayBase  = X64Emitter::R13;
+
+VertexLoaderRoutine::LoaderFunc VertexLoaderCompiler::Compile(const VertexLoaderRoutine& routine) {
+    if (emit_.code_ptr() + kMaxRoutineSize > code_buffer_ + kCodeBufferSize) {
+        return NULL;
+    }
+    ProtectCodeBuffer(true);
+
+    u8* entry = emit_.code_ptr();
+
+    // Three pushes leave the stack 16 byte aligned for calls
+    emit_.PUSH_R64(kRegSrc);
+    emit_.PUSH_R64(kRegDest);
+    emit_.PUSH_R64(kRegArrayBase);
+    emit_.MOV_RR64(kRegSrc, X64Emitter::RDI);
+    emit_.MOV_RR64(kRegDest, X64Emitter::RSI);
+    emit_.MOV_RR64(kRegArrayBase, X64Emitter::RDX);
+
+    for (int i = 0; i < routine.num_steps(); i++) {
+        const Step& step = routine.step(i);
+
+        switch (step.type) {
+        case Step::kType_Bytes:
+            for (int j = 0; j < step.count; j++) {
+                emit_.MOVZX_RM8(X64Emitter::RAX, kRegSrc, step.src_offset + j);
+                emit_.MOV_MR8(kRegDest, step.dest_offset + j, X64Emitter::RAX);
+            }
+            break;
+
+        case Step::kType_Shorts:
+            for (int j = 0; j < step.count; j++) {
+                emit_.MOVZX_RM16(X64Emitter::RAX, kRegSrc, step.src_offset + (j << 1));
+                emit_.BSWAP_R32(X64Emitter::RAX);
+                emit_.SHIFT_RI32(X64Emitter::SHIFT_SHR, X64Emitter::RAX, 16);
+                emit_.MOV_MR16(kRegDest, step.dest_offset + (j << 1), X64Emitter::RAX);
+            }
+            break;
+
+        case Step::kType_Words:
+            for (int j = 0; j < step.count; j++) {
+                emit_.MOV_RM32(X64Emitter::RAX, kRegSrc, step.src_offset + (j << 2));
+                emit_.BSWAP_R32(X64Emitter::RAX);
+                emit_.MOV_MR32(kRegDest, step.dest_offset + (j << 2), X64Emitter::RAX);
+            }
+            break;
+
+        case Step::kType_Constant:
+            emit_.MOV_MI32(kRegDest, step.dest_offset, step.value);
+            break;
+
+        case Step::kType_Index8:
+        case Step::kType_Index16:
+            // indexed(array_base[array] + index * stride, dest + dest_offset)
+            if (Step::kType_Index8 == step.type) {
+                emit_.MOVZX_RM8(X64Emitter::RDI, kRegSrc, step.src_offset);
+            } else {
+                emit_.MOVZX_RM16(X64Emitter::RDI, kRegSrc, step.src_offset);
+                emit_.BSWAP_R32(X64Emitter::RDI);
+                emit_.SHIFT_RI32(X64Emitter::SHIFT_SHR, X64Emitter::RDI, 16);
+            }
+            emit_.IMUL_RRI32(X64Emitter::RDI, X64Emitter::RDI, step.stride);
+            emit_.ALU_RM32(X64Emitter::ALU_ADD, X64Emitter::RDI, kRegArrayBase, step.array << 2);
+            emit_.LEA_RM64(X64Emitter::RSI, kRegDest, step.dest_offset);
+            emit_.CALL_ABS((const void*)step.indexed);
+            break;
+        }
+    }
+
+    emit_.LEA_RM64(X64Emitter::RAX, kRegSrc, routine.vertex_size());
+    emit_.POP_R64(kRegArrayBase);
+    emit_.POP_R64(kRegDest);
+    emit_.POP_R64(kRegSrc);
+    emit_.RET();
+
+    _ASSERT_MSG(TGP, emit_.code_ptr() <= entry + kMaxRoutineSize,
+        "Vertex loader routine overflowed (%d bytes)!", (int)(emit_.code_ptr() - entry));
+
+    ProtectCodeBuffer(false);
+
+    return (VertexLoaderRoutine::LoaderFunc)entry;
+}
+
+void VertexLoaderCompiler::ProtectCodeBuffer(bool writable) {
+    int prot = writable ? (PROT_READ | PROT_WRITE) : (PROT_READ | PROT_EXEC);
+    if (mprotect(code_buffer_, kCodeBufferSize, prot) != 0) {
+        LOG_ERROR(TGP, "vertex loader compiler failed to change code buffer protection");
+    }
+}
+
+#endif // USE_VERTEX_LOADER_JIT
+
+} // namespace
@@ -0,0 +1,201 @@
+/**
+ * Copyright (C) 2005-2012 Gekko Emulator
+ *
+ * @file    vertex_loader_compiler.h
+ * @author  ShizZy <shizzy247@gmail.com>
+ * @date    2013-02-16
+ * @brief   Compiles vertex loader routines specialized for a vertex format
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Official project repository can be found at:
+ * http://code.google.com/p/gekko-gc-emu/
+ */
+
+#ifndef VIDEO_CORE_VERTEX_LOADER_COMPILER_H_
+#define VIDEO_CORE_VERTEX_LOADER_COMPILER_H_
+
+#include "common.h"
+#include "hash.h"
+#include "hash_container.h"
+
+#include "gx_types.h"
+#include "vertex_loader.h"
+
+#if defined(EMU_ARCHITECTURE_X64) && EMU_PLATFORM == PLATFORM_LINUX
+#define USE_VERTEX_LOADER_JIT
+#include "powerpc/recompiler_x64/x64_emitter.h"
+#endif
+
+namespace gp {
+
+static const int kVertexLoaderNumArrays = 12;   ///< Position, normal, 2 colors, 8 texcoords
+
+/// Vertex format a loader routine is compiled for, compared as raw memory
+struct VertexLoaderKey {
+    u32 vcd_lo;
+    u32 vcd_hi;
+    u32 vat_a;
+    u32 vat_b;
+    u32 vat_c;
+    u8  stride[kVertexLoaderNumArrays];         ///< Array strides, 0 if the array isn't indexed
+};
+
+/**
+ * Vertex loader routine for one vertex format. Decodes a single vertex from a buffer in FIFO byte
+ * order into a GXVertex, writing exactly the bytes the generic loader would. The format is turned
+ * into a list of steps with fixed source and destination offsets, which are either compiled to
+ * native code or run through a table of precompiled template functions.
+ */
+class VertexLoaderRoutine {
+public:
+    /// Native loader entry point, returns src advanced past the vertex
+    typedef const u8* (*LoaderFunc)(const u8* src, GXVertex* dest, const u32* array_base);
+
+    /// Decoding step of a vertex component
+    struct Step {
+        /// Template function that runs the step
+        typedef void (*StepFunc)(const Step& step, const u8* src, u8* dest, const u32* array_base);
+
+        enum Type {
+            kType_Bytes = 0,    ///< count bytes copied as is
+            kType_Shorts,       ///< count 16-bit values byte swapped
+            kType_Words,        ///< count 32-bit values byte swapped
+            kType_Constant,     ///< 32-bit constant stored
+            kType_Index8,       ///< 8-bit array index, component read from RAM with indexed
+            kType_Index16       ///< 16-bit array index, component read from RAM with indexed
+        };
+
+        StepFunc            func;
+        Type                type;
+        int                 count;
+        int                 src_offset;         ///< Offset of the data in the vertex (in bytes)
+        int                 dest_offset;        ///< Offset of the data in the GXVertex (in bytes)
+        int                 array;              ///< Array number of indexed steps
+        u32                 stride;             ///< Array stride of indexed steps
+        u32                 value;              ///< Constant of kType_Constant
+        VertexLoaderTable   indexed;            ///< Indexed component decoder
+    };
+
+    static const int kMaxSteps = 32;
+
+    VertexLoaderRoutine() : code_(NULL), vertex_size_(0), num_steps_(0) {
+    }
+    ~VertexLoaderRoutine() {
+    }
+
+    /**
+     * Build the decoding steps for a vertex format
+     * @param key Vertex format
+     * @return True on success, false if the format has components the generic loader must handle
+     */
+    bool Build(const VertexLoaderKey& key);
+
+    /**
+     * Decode a vertex
+     * @param src Vertex data in FIFO byte order
+     * @param dest Vertex to decode into
+     * @param array_base Array base addresses
+     * @return src advanced past the vertex
+     */
+    inline const u8* Load(const u8* src, GXVertex* dest, const u32* array_base) const {
+        if (code_) {
+            return code_(src, dest, array_base);
+        }
+        for (int i = 0; i < num_steps_; i++) {
+            steps_[i].func(steps_[i], src, (u8*)dest, array_base);
+        }
+        return src + vertex_size_;
+    }
+
+    int vertex_size() const { return vertex_size_; }
+    int num_steps() const { return num_steps_; }
+    const Step& step(int index) const { return steps_[index]; }
+
+    LoaderFunc code() const { return code_; }
+    void set_code(LoaderFunc val) { code_ = val; }
+
+private:
+    /// Append a direct component
+    bool AddDirect(Step::Type type, int count, int dest_offset);
+
+    /// Append an indexed component
+    bool AddIndexed(u32 attr_type, VertexLoaderTable indexed, int array, u32 stride,
+        int dest_offset);
+
+    /// Append a component of a given format (type -1 if invalid), false if it can't be loaded
+    bool AddComponent(u32 attr_type, int type, int count, VertexLoaderTable indexed,
+        int array, u32 stride, int dest_offset);
+
+    LoaderFunc  code_;                          ///< Native code, NULL to run the steps
+    int         vertex_size_;                   ///< Size of a vertex in the FIFO (in bytes)
+    int         num_steps_;
+    Step        steps_[kMaxSteps];
+};
+
+/**
+ * Cache of vertex loader routines, keyed by vertex format. On x86-64 Linux hosts the routines are
+ * compiled to native code, other hosts use the template steps.
+ */
+class VertexLoaderCompiler {
+public:
+    VertexLoaderCompiler();
+    ~VertexLoaderCompiler();
+
+    /**
+     * Get the routine for a vertex format, building it on first use
+     * @param key Vertex format
+     * @return Routine, NULL if the format must be decoded by the generic loader
+     */
+    const VertexLoaderRoutine* GetRoutine(const VertexLoaderKey& key);
+
+    /// Discard all routines
+    void Clear();
+
+private:
+    /// Cache entry, routine is NULL for formats the generic loader handles
+    struct CacheEntry {
+        VertexLoaderKey         key;
+        VertexLoaderRoutine*    routine;
+    };
+    typedef HashContainer_STLMap<common::Hash64, CacheEntry> CacheContainer;
+
+#ifdef USE_VERTEX_LOADER_JIT
+    static const int kCodeBufferSize    = 1024 * 1024;  ///< Native code space
+    static const int kMaxRoutineSize    = 2048;         ///< Worst case native routine size
+
+    /**
+     * Compile a routine to native code
+     * @param routine Routine to compile
+     * @return Entry point of the code, NULL if out of code space
+     */
+    VertexLoaderRoutine::LoaderFunc Compile(const VertexLoaderRoutine& routine);
+
+    /// Toggle the code buffer between writable and executable
+    void ProtectCodeBuffer(bool writable);
+
+    u8*             code_buffer_;               ///< mmap'd native code space
+    X64Emitter      emit_;                      ///< Emitter writing into code_buffer_
+#endif
+
+    CacheContainer*             cache_;
+    VertexLoaderKey             last_key_;      ///< Format of the last lookup
+    const VertexLoaderRoutine*  last_routine_;  ///< Routine of the last lookup
+    bool                        last_valid_;    ///< Set if last_key_/last_routine_ may be used
+
+    DISALLOW_COPY_AND_ASSIGN(VertexLoaderCompiler);
+};
+
+} // namespace
+
+#endif // VIDEO_CORE_VERTEX_LOADER_COMPILER_H_
@@ -26,80 +26,314 @@
 #include "vertex_manager.h"
 #include "video_core.h"
 #include "bp_mem.h"
+#include "cp_mem.h"
+#include "fifo.h"
 
 namespace gp {
 
-GXVertex*   g_hardware_vbo = NULL;  ///< Pointer to hardware VBO (always GPU mem)
-GXVertex*   g_vbo = NULL;           ///< Pointer to VBO data (can be GPU or sys mem)
-GXVertex    g_quads_vbo[4];         ///< Temporary storage for a quad in the pipeline
-u32         g_vbo_offset = 0;       ///< Offset into VBO of current vertex writes
+static const u32 kMaxBatchVertices  = 0x10000;            ///< Vertices 16-bit indices can address
+static const u32 kMaxBatchIndices   = 3 * kMaxBatchVertices;///< Indices of a full batch of strips
+static const u32 kMaxBatchBytes     = 1024 * 1024 * 2;      ///< VBO space mapped for a batch
+
+GXVertex*   g_vbo = NULL;           ///< Vertex being decoded, packed into the VBO when done
+u8*         g_vbo_write = NULL;     ///< Where the next packed vertex goes (GPU or sys mem)
+u32         g_vbo_offset = 0;       ///< Offset into VBO of the current batch (in bytes)
 u32         g_vertex_num = 0;       ///< Current vertex number
-int         g_convert_quads_to_triangles = 0;
-int g_quad_counter = 0;
+
+static GXVertex     g_vertex;                           ///< Vertex the vertex loader decodes into
+static VertexLayout g_vertex_layout;                    ///< Layout of the current vertex format
+static u32          g_vertex_layout_key[5];             ///< VCD and VAT the layout was built for
+static bool         g_vertex_layout_valid = false;
+
+static GXPrimitive  g_prim = GX_TRIANGLES;              ///< Type of the current primitive
+static bool         g_batch_open = false;               ///< Set while primitives are batched
+static GXPrimitive  g_batch_prim = GX_TRIANGLES;        ///< Type the batch is drawn as
+static u32          g_batch_capacity = 0;               ///< Vertices mapped for the batch
+static u32          g_batch_vertex_num = 0;             ///< Vertices in the batch
+static u32          g_batch_index_num = 0;              ///< Indices in the batch
+static u32          g_batch_primitive_num = 0;          ///< GX primitives in the batch
+static u16          g_batch_indices[kMaxBatchIndices];  ///< Indices of the batch
+
+/**
+ * Append a component to a vertex layout
+ * @param layout Layout to append to
+ * @param enable Set if the vertex format has the component
+ * @param src_offset Offset of the component in GXVertex (in bytes)
+ * @param size Size of the component (in bytes)
+ * @return Offset of the component in the packed vertex, -1 if it isn't enabled
+ */
+static int VertexManager_AddComponent(VertexLayout& layout, bool enable, int src_offset, 
+    int size) {
+    if (!enable) {
+        return -1;
+    }
+    int offset = layout.stride;
+    size = (size + 3) & ~3;
+    layout.stride += size;
+
+    // Components are added in GXVertex order, so neighbours are copied as one span
+    if (layout.num_spans > 0) {
+        VertexLayout::Span& last = layout.spans[layout.num_spans - 1];
+        if (last.src_offset + last.size == src_offset) {
+            last.size += size;
+            return offset;
+        }
+    }
+    VertexLayout::Span& span = layout.spans[layout.num_spans++];
+    span.src_offset = src_offset;
+    span.dest_offset = offset;
+    span.size = size;
+    return offset;
+}
+
+/// Get the VCD and VAT of the current vertex format
+static inline void VertexManager_GetFormatKey(u32 key[5]) {
+    key[0] = g_cp_regs.vcd_lo[0]._u32;
+    key[1] = g_cp_regs.vcd_hi[0]._u32;
+    key[2] = g_cp_regs.vat_reg_a[g_cur_vat]._u32;
+    key[3] = g_cp_regs.vat_reg_b[g_cur_vat]._u32;
+    key[4] = g_cp_regs.vat_reg_c[g_cur_vat]._u32;
+}
+
+/**
+ * Rebuild the packed vertex layout if the vertex format changed
+ * @param key VCD and VAT of the current vertex format
+ */
+static void VertexManager_UpdateLayout(const u32 key[5]) {
+    static const int type_size[8] = { 1, 1, 2, 2, 4, 4, 4, 4 };
+    const CPVertDescLo& vcd_lo = g_cp_regs.vcd_lo[0];
+    const CPVertDescHi& vcd_hi = g_cp_regs.vcd_hi[0];
+    const CPVatRegA& vat_a = g_cp_regs.vat_reg_a[g_cur_vat];
+    const CPVatRegB& vat_b = g_cp_regs.vat_reg_b[g_cur_vat];
+    const CPVatRegC& vat_c = g_cp_regs.vat_reg_c[g_cur_vat];
+
+    if (g_vertex_layout_valid && 
+        0 == memcmp(key, g_vertex_layout_key, sizeof(g_vertex_layout_key))) {
+        return;
+    }
+    memcpy(g_vertex_layout_key, key, sizeof(g_vertex_layout_key));
+    g_vertex_layout_valid = true;
+
+    const u32 tex_attr[kGCMaxActiveTextures] = {
+        vcd_hi.tex0_coord, vcd_hi.tex1_coord, vcd_hi.tex2_coord, vcd_hi.tex3_coord, 
+        vcd_hi.tex4_coord, vcd_hi.tex5_coord, vcd_hi.tex6_coord, vcd_hi.tex7_coord
+    };
+    const u32 tex_type[kGCMaxActiveTextures] = {
+        vat_a.tex0_type, vat_b.tex1_type, vat_b.tex2_type, vat_b.tex3_type, 
+        vat_b.tex4_type, vat_c.tex5_type, vat_c.tex6_type, vat_c.tex7_type
+    };
+    VertexLayout& layout = g_vertex_layout;
+    layout.stride = 0;
+    layout.num_spans = 0;
+
+    // Position is always 3 components and the normal at least 4, as the GL3 renderer reads them
+    layout.position = VertexManager_AddComponent(layout, vcd_lo.position != GX_NONE, 0, 
+        3 * type_size[vat_a.pos_type]);
+    layout.color[0] = VertexManager_AddComponent(layout, vcd_lo.color0 != GX_NONE, 12, 4);
+    layout.color[1] = VertexManager_AddComponent(layout, vcd_lo.color1 != GX_NONE, 16, 4);
+    layout.normal = VertexManager_AddComponent(layout, vcd_lo.normal != GX_NONE, 20, 
+        ((vat_a.normal_count != GX_NRM_XYZ) ? 9 : 4) * type_size[vat_a.normal_type]);
+    for (int i = 0; i < kGCMaxActiveTextures; i++) {
+        layout.texcoord[i] = VertexManager_AddComponent(layout, tex_attr[i] != GX_NONE, 
+            56 + (i * 8), 2 * type_size[tex_type[i]]);
+    }
+    layout.pm_idx = VertexManager_AddComponent(layout, vcd_lo.pos_midx_enable != 0, 120, 4);
+    layout.tm_idx = VertexManager_AddComponent(layout, ((vcd_lo._u32 >> 1) & 0xFF) != 0, 124, 8);
+
+    // Clear what the new format doesn't decode, so packed vertices don't depend on older formats
+    memset(&g_vertex, 0, sizeof(g_vertex));
+}
 
 void VertexManager_NextVertex() {
     // Mark the vertex position XF index as "used" to renderer
     video_core::g_renderer->VertexPosition_UseIndexXF(g_vbo->pm_idx);
 
-    g_quad_counter++;
-
-    // Convert quads to triangles on every 4th vertex
-    if (g_convert_quads_to_triangles && (g_quad_counter == 4)) {
-        g_quad_counter = 0;
-        g_vbo -= 3;
-
-        g_hardware_vbo[0] = g_vbo[0];
-        g_hardware_vbo[1] = g_vbo[1];
-        g_hardware_vbo[2] = g_vbo[2];
-        
-        g_hardware_vbo[3] = g_vbo[2];
-        g_hardware_vbo[4] = g_vbo[3];
-        g_hardware_vbo[5] = g_vbo[0];
-        
-        g_hardware_vbo += 6;
-        g_vbo = g_quads_vbo;
-        g_vertex_num += 3;
-    } else {
-        g_vbo++;
-        g_vertex_num++;
+    g_vertex_layout.Pack(g_vbo, g_vbo_write);
+    g_vbo_write += g_vertex_layout.stride;
+    g_vertex_num++;
+}
+
+/// Primitive type a GX primitive is drawn as, once converted to an index list
+static inline GXPrimitive VertexManager_BatchType(GXPrimitive prim) {
+    switch (prim) {
+    case GX_LINES:
+    case GX_LINESTRIP:
+        return GX_LINES;
+    case GX_POINTS:
+        return GX_POINTS;
+    default:
+        return GX_TRIANGLES;
     }
 }
 
-/// Begin a primitive
-void VertexManager_BeginPrimitive(GXPrimitive prim, int count) {
-    g_vertex_num = 0;
-    g_quad_counter = 0;
-    
+/**
+ * Write the list indices of a primitive, so strips, fans and quads can share a draw with lists
+ * @param prim Primitive type
+ * @param base Index of the first vertex of the primitive in the batch
+ * @param num Number of vertices of the primitive
+ * @param out Where the indices are written
+ * @return out advanced past the indices written
+ */
+static u16* VertexManager_WriteIndices(GXPrimitive prim, u32 base, u32 num, u16* out) {
+    switch (prim) {
+    case GX_TRIANGLES:
+    case GX_LINES:
+    case GX_POINTS:
+        // Incomplete primitives at the end are dropped
+        if (GX_TRIANGLES == prim) {
+            num -= num % 3;
+        } else if (GX_LINES == prim) {
+            num &= ~1;
+        }
+        for (u32 i = 0; i < num; i++) {
+            *out++ = base + i;
+        }
+        break;
+
+    case GX_QUADS:
+        // Quad 0-1-2-3 is drawn as triangles 0-1-2 and 2-3-0
+        for (u32 i = base; i + 3 < base + num; i += 4) {
+            out[0] = i;
+            out[1] = i + 1;
+            out[2] = i + 2;
+            out[3] = i + 2;
+            out[4] = i + 3;
+            out[5] = i;
+            out += 6;
+        }
+        break;
+
+    case GX_TRIANGLESTRIP:
+        // Every other triangle is flipped to keep the winding of the strip
+        for (u32 i = base; i + 2 < base + num; i++) {
+            bool odd = ((i - base) & 1) != 0;
+            out[0] = odd ? i + 1 : i;
+            out[1] = odd ? i : i + 1;
+            out[2] = i + 2;
+            out += 3;
+        }
+        break;
+
+    case GX_TRIANGLEFAN:
+        for (u32 i = base + 1; i + 1 < base + num; i++) {
+            out[0] = base;
+            out[1] = i;
+            out[2] = i + 1;
+            out += 3;
+        }
+        break;
+
+    case GX_LINESTRIP:
+        for (u32 i = base; i + 1 < base + num; i++) {
+            out[0] = i;
+            out[1] = i + 1;
+            out += 2;
+        }
+        break;
+    }
+    return out;
+}
+
+/**
+ * Begin a batch, mapping VBO space for it
+ * @param prim Primitive type the batch is drawn as
+ * @param count Number of vertices of the first primitive
+ * @param key VCD and VAT of the vertex format
+ * @param vertex_state Vertex state of the vertex format
+ */
+static void VertexManager_BeginBatch(GXPrimitive prim, int count, const u32 key[5], 
+    const VertexState& vertex_state) {
+    VertexManager_UpdateLayout(key);
+
+    video_core::g_renderer->SetVertexState(vertex_state);
+    video_core::g_shader_manager->UpdateVertexState(vertex_state);
+    video_core::g_shader_manager->UpdateFlag(ShaderManager::kFlag_VertexPostition_DQF, 
+        g_cp_regs.vat_reg_a[g_cur_vat].get_pos_dqf_enabled());
+
+    // Map room for as many vertices as 16-bit indices can address, within a sensible size
+    u32 capacity = kMaxBatchVertices;
+    u32 stride = g_vertex_layout.stride;
+    if (stride > 0) {
+        capacity = MIN(kMaxBatchVertices, MAX((u32)count, kMaxBatchBytes / stride));
+        if (g_vbo_offset + capacity * stride > VBO_SIZE) {
+            g_vbo_offset = 0;   // Renderers orphan the VBO when offset 0 is mapped
+        }
+    }
     BP_LoadTexture();
-    if (GX_QUADS == prim) {
-        prim = GX_TRIANGLES;    // Most hardware doesn't support quads, so convert to triangles
-        count += count >> 1;    // Every 4 verts (quad) will be converted to 6 verts (triangle)
-        g_convert_quads_to_triangles = 1;
-        g_vbo = g_quads_vbo;
-        video_core::g_renderer->BeginPrimitive(prim, count, &g_hardware_vbo, g_vbo_offset);
-    } else {
-        video_core::g_renderer->BeginPrimitive(prim, count, &g_vbo, g_vbo_offset);
+    video_core::g_renderer->BeginPrimitive(prim, capacity, g_vertex_layout, &g_vbo_write, 
+        g_vbo_offset);
+
+    g_batch_open = true;
+    g_batch_prim = prim;
+    g_batch_capacity = capacity;
+    g_batch_vertex_num = 0;
+    g_batch_index_num = 0;
+    g_batch_primitive_num = 0;
+}
+
+/// Begin a primitive
+void VertexManager_BeginPrimitive(GXPrimitive prim, int count, const VertexState& vertex_state) {
+    GXPrimitive batch_prim = VertexManager_BatchType(prim);
+    u32 key[5];
+    VertexManager_GetFormatKey(key);
+
+    // Render state changes draw the batch before they happen, so the batch only has to end here
+    // if the primitive can't be drawn with the same call
+    if (g_batch_open && (batch_prim != g_batch_prim || 
+        0 != memcmp(key, g_vertex_layout_key, sizeof(key)) ||
+        g_batch_vertex_num + count > g_batch_capacity || 
+        g_batch_index_num + 3 * count > kMaxBatchIndices)) {
+        VertexManager_DrawBatch();
     }
+    if (!g_batch_open) {
+        VertexManager_BeginBatch(batch_prim, count, key, vertex_state);
+    }
+    g_prim = prim;
+    g_vertex_num = 0;
+    g_vbo = &g_vertex;
 }
 
 /// End a primitive
 void VertexManager_EndPrimitive() {
-    video_core::g_renderer->EndPrimitive(g_vbo_offset, g_vertex_num);
-    g_vbo_offset += g_vertex_num;
-    g_convert_quads_to_triangles = 0;
+    u16* indices = VertexManager_WriteIndices(g_prim, g_batch_vertex_num, g_vertex_num, 
+        g_batch_indices + g_batch_index_num);
+
+    g_batch_index_num = (u32)(indices - g_batch_indices);
+    g_batch_vertex_num += g_vertex_num;
+    g_batch_primitive_num++;
+}
+
+/// Draw the pending batch of primitives
+void VertexManager_DrawBatch() {
+    if (!g_batch_open) {
+        return;
+    }
+    g_batch_open = false;
+    video_core::g_renderer->EndPrimitive(g_vbo_offset, g_batch_vertex_num, g_batch_indices, 
+        g_batch_index_num, g_batch_primitive_num);
+    g_vbo_offset += g_batch_vertex_num * g_vertex_layout.stride;
 }
 
 /// Flush the vertex manager
 void VertexManager_Flush() {
+    VertexManager_DrawBatch();
     g_vbo_offset = 0;
     g_vertex_num = 0;
 }
 
 /// Initialize the vertex manager
 void VertexManager_Init() { 
-    g_vbo = NULL;
+    g_vbo = &g_vertex;
+    g_vbo_write = NULL;
     g_vbo_offset = 0;
     g_vertex_num = 0;
+    g_vertex_layout_valid = false;
+    g_batch_open = false;
+    g_batch_vertex_num = 0;
+    g_batch_index_num = 0;
+    g_batch_primitive_num = 0;
+    memset(&g_vertex, 0, sizeof(g_vertex));
+    memset(&g_vertex_layout, 0, sizeof(g_vertex_layout));
     LOG_NOTICE(TGP, "vertex manager initialized ok");
     return;
 }
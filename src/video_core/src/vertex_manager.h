@@ -28,6 +28,7 @@
 #include "common.h"
 
 #include "gx_types.h"
+#include "vertex_loader.h"
 
 #define VBO_SIZE                    (1024 * 1024 * 32)
 
@@ -36,18 +37,75 @@
 
 namespace gp {
 
-extern GXVertex*   g_vbo;               ///< Pointer to VBO data (when mapped, in GPU mem)
+/**
+ * Packed vertex layout of the current vertex format. Vertices are decoded into a GXVertex, which
+ * has room for every component, and only the components enabled in the VCD are copied to the VBO.
+ * Components keep their GXVertex encoding and order, all sizes and offsets are multiples of 4.
+ */
+struct VertexLayout {
+    static const int kMaxSpans = 16;
+
+    /// Run of words copied from a GXVertex to a packed vertex
+    struct Span {
+        u16 src_offset;                 ///< Offset in the GXVertex (in bytes)
+        u16 dest_offset;                ///< Offset in the packed vertex (in bytes)
+        u16 size;                       ///< Size (in bytes)
+    };
+
+    int     stride;                     ///< Size of a packed vertex (in bytes)
+    int     position;                   ///< Offset of each component (in bytes), -1 if disabled
+    int     color[kGCMaxVertexColors];
+    int     normal;
+    int     texcoord[kGCMaxActiveTextures];
+    int     pm_idx;                     ///< Position matrix index, padded to 4 bytes
+    int     tm_idx;                     ///< All texture coord matrix indices, if any are enabled
+    int     num_spans;
+    Span    spans[kMaxSpans];
+
+    /// Pack the enabled components of a vertex
+    inline void Pack(const GXVertex* src, u8* dest) const {
+        for (int i = 0; i < num_spans; i++) {
+            const u32* s = (const u32*)((const u8*)src + spans[i].src_offset);
+            u32* d = (u32*)(dest + spans[i].dest_offset);
+            for (int j = spans[i].size >> 2; j > 0; j--) {
+                *d++ = *s++;
+            }
+        }
+    }
+
+    /// Unpack a vertex, components that are disabled are left untouched in dest
+    inline void Unpack(const u8* src, GXVertex* dest) const {
+        for (int i = 0; i < num_spans; i++) {
+            const u32* s = (const u32*)(src + spans[i].dest_offset);
+            u32* d = (u32*)((u8*)dest + spans[i].src_offset);
+            for (int j = spans[i].size >> 2; j > 0; j--) {
+                *d++ = *s++;
+            }
+        }
+    }
+};
+
+extern GXVertex*   g_vbo;               ///< Vertex being decoded, packed into the VBO when done
 extern u32         g_vertex_num;        ///< Current vertex number
 
 /// Used for specifying next GX vertex is being sent to the renderer
 void VertexManager_NextVertex();
 
-/// Begin a primitive
-void VertexManager_BeginPrimitive(GXPrimitive prim, int count);
+/**
+ * Begin a primitive. Primitives are batched: consecutive primitives with the same vertex format are
+ * packed into one VBO region and drawn with a single call when the render state changes.
+ * @param prim Primitive type (e.g. GX_TRIANGLES)
+ * @param count Number of vertices
+ * @param vertex_state Vertex state of the primitive, sent to the renderer when a batch begins
+ */
+void VertexManager_BeginPrimitive(GXPrimitive prim, int count, const VertexState& vertex_state);
 
 /// End a primitive
 void VertexManager_EndPrimitive();
 
+/// Draw the pending batch of primitives, must be called before any render state changes
+void VertexManager_DrawBatch();
+
 /// Flush the vertex manager
 void VertexManager_Flush();
 
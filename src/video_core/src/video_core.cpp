@@ -32,15 +32,19 @@
 #include "video/emuwindow.h"
 
 #include "renderer_gl3/renderer_gl3.h"
+#include "renderer_null/renderer_null.h"
+#include "renderer_soft/renderer_soft.h"
 
 #include "video_core.h"
 #include "vertex_manager.h"
 #include "vertex_loader.h"
+#include "display_list_cache.h"
 #include "fifo.h"
 #include "fifo_player.h"
 #include "bp_mem.h"
 #include "cp_mem.h"
 #include "xf_mem.h"
+#include "texture_decoder.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Video Core namespace
@@ -53,14 +57,19 @@ SDL_Thread*     g_video_thread = NULL;
 ShaderManager*  g_shader_manager = NULL;
 TextureManager* g_texture_manager = NULL;
 int             g_current_frame = 0;
+static bool     g_paused = false;       ///< Set between Pause and Resume
 
 int VideoEntry(void*) {
     if (g_emu_window == NULL) {
         LOG_ERROR(TGP, "video_core::VideoEntry called without calling Init()!");
     }
     g_emu_window->MakeCurrent();
+
+    // Sleeps whenever the FIFO runs dry, returns once it's shut down
     for(;;) {
-        gp::Fifo_DecodeCommand();
+        if (!gp::Fifo_DecodeCommands() && !gp::Fifo_WaitForData()) {
+            break;
+        }
     }
     return E_OK;
 }
@@ -83,13 +92,21 @@ void Start() {
 /// Initialize the video core
 void Init(EmuWindow* emu_window) {
     g_emu_window = emu_window;
-    g_renderer = new RendererGL3();
+    if (common::g_config->current_renderer() == common::Config::RENDERER_NULL) {
+        g_renderer = new RendererNull();
+    } else if (common::g_config->current_renderer() == common::Config::RENDERER_SOFTWARE) {
+        g_renderer = new RendererSoft();
+    } else {
+        g_renderer = new RendererGL3();
+    }
     g_renderer->SetWindow(g_emu_window);
     g_renderer->Init();
 
     gp::Fifo_Init();
     gp::VertexManager_Init();
     gp::VertexLoader_Init();
+    gp::DisplayListCache_Init();
+    gp::TextureDecoder_Init();
     gp::BP_Init();
     gp::CP_Init();
     gp::XF_Init();
@@ -105,12 +122,50 @@ void Init(EmuWindow* emu_window) {
 /// Shutdown the video core
 void Shutdown() {
     gp::Fifo_Shutdown();
+    if (g_video_thread != NULL) {
+        SDL_WaitThread(g_video_thread, NULL);
+        g_video_thread = NULL;
+    }
     gp::VertexManager_Shutdown();
     gp::VertexLoader_Shutdown();
+    gp::DisplayListCache_Shutdown();
+    gp::TextureDecoder_Shutdown();
 
-    delete g_renderer;
+    // The managers hold the renderer's backend interfaces
     delete g_shader_manager;
     delete g_texture_manager;
+    g_renderer->ShutDown();
+    delete g_renderer;
+}
+
+/// Drain the FIFO and park the GP thread
+void Pause() {
+    _ASSERT_MSG(TVIDEO, !g_paused, "video_core::Pause called twice!");
+    if (g_video_thread != NULL) {
+        gp::Fifo_PauseGP();
+    }
+    g_paused = true;
+}
+
+/// Let the GP thread decode again
+void Resume() {
+    if (g_video_thread != NULL) {
+        gp::Fifo_ResumeGP();
+    }
+    g_paused = false;
+}
+
+/// Save/load the GP state
+void DoState(state::Serializer& s) {
+    // The GP thread owns the registers and TMEM
+    _ASSERT_MSG(TVIDEO, g_paused, "video_core::DoState called without pausing the GP!");
+
+    // XF viewport depends on the BP scissor offset, so BP goes first
+    gp::CP_DoState(s);
+    gp::BP_DoState(s);
+    gp::XF_DoState(s);
+    s.DoArray(gp::tmem, TMEM_SIZE);
+    gp::Fifo_DoState(s);
 }
 
 } // namespace
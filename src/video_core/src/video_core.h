@@ -29,6 +29,7 @@
 #include "renderer_base.h"
 #include "shader_manager.h"
 #include "texture_manager.h"
+#include "state.h"
 
 #define USE_NEW_VIDEO_CORE
 
@@ -54,6 +55,18 @@ void Init(EmuWindow* emu_window);
 /// Shutdown the video core
 void ShutDown();
 
+/**
+ * Make the GP thread decode everything pushed so far and keep it parked until Resume, so the GP
+ * state and the guest RAM it reads and writes can be saved/loaded. Call from the CPU thread.
+ */
+void Pause();
+
+/// Let the GP thread decode again after Pause
+void Resume();
+
+/// Save/load the GP state, the GP must be paused
+void DoState(state::Serializer& s);
+
 } // namespace
 
 #endif // VIDEO_COMMON_VIDEO_CORE_H_
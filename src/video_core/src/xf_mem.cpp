@@ -33,6 +33,7 @@
 #include "bp_mem.h"
 #include "cp_mem.h"
 #include "xf_mem.h"
+#include "vertex_manager.h"
 
 #define XF_VIEWPORT_ZMAX            16777215.0f
 
@@ -149,6 +150,17 @@ void XF_RegisterUpdate(u32 length, u32 base_addr) {
 }
 
 void XF_Load(u32 length, u32 base_addr, u32* data) {
+    // Draw the primitives batched with the old state, unless this rewrites the same data
+    if (base_addr & 0x1000) {
+        if (((base_addr & 0xff) + length) > (sizeof(g_xf_regs.mem) >> 2) ||
+            memcmp(&g_xf_regs.mem[base_addr & 0xff], data, length << 2)) {
+            VertexManager_DrawBatch();
+        }
+    } else if ((base_addr + length) >= 0x800 || 
+        memcmp(&g_xf_mem[base_addr], data, length << 2)) {
+        VertexManager_DrawBatch();
+    }
+
     // Register write
     if (base_addr & 0x1000) {
         u8 addr = (base_addr & 0xff);
@@ -167,6 +179,9 @@ void XF_Load(u32 length, u32 base_addr, u32* data) {
 /// Write data into a XF register indexed-form
 void XF_LoadIndexed(u8 n, u16 index, u8 length, u16 addr) {
     u32* data = (u32*)&Mem_RAM[CP_IDX_ADDR(index, n) & RAM_MASK];
+    if (memcmp(&g_xf_mem[addr], data, length << 2)) {
+        VertexManager_DrawBatch();
+    }
     memcpy(&g_xf_mem[addr], data, length << 2);
     video_core::g_renderer->WriteXF(addr, length, data);
 }
@@ -177,4 +192,18 @@ void XF_Init() {
     memset(&g_xf_regs, 0, sizeof(g_xf_regs));
 }
 
+/// Save/load XF memory and registers
+void XF_DoState(state::Serializer& s) {
+    s.DoArray(g_xf_mem, 0x800);
+    s.DoArray(g_xf_regs.mem, 0x100);
+
+    // Push everything to the renderer again, register loads also rebuild the derived state
+    if (s.is_reading()) {
+        XFMemory regs = g_xf_regs;
+
+        video_core::g_renderer->WriteXF(0, 0x800, g_xf_mem);
+        XF_Load(0x100, 0x1000, regs.mem);
+    }
+}
+
 } // namespace
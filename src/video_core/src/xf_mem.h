@@ -27,6 +27,7 @@
 
 #include "common.h"
 #include "cp_mem.h"
+#include "state.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Transformation Engine decoding
@@ -312,6 +313,9 @@ void XF_UpdateViewport();   // TODO(ShizZy): The reason for putting this here is
 /// Initialize XF
 void XF_Init();
 
+/// Save/load XF memory and registers
+void XF_DoState(state::Serializer& s);
+
 } // namespace
 
 #endif // VIDEO_CORE_XF_MEM_
\ No newline at end of file